@@ -0,0 +1,59 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <d3d11.h>
+#include <wrl/client.h>
+
+// Benchmarks register themselves by name with BENCHMARK(name), and the
+// Benchmarks program runs all of them, or just the ones named on its
+// command line
+// - They only print timings and measurements, correctness is checked by
+//   the Tests project
+// - Everything runs headless, so no window or GPU is needed
+typedef void (*BenchmarkFunction)();
+
+struct BenchmarkRegistration
+{
+	BenchmarkRegistration(const char* name, BenchmarkFunction function);
+};
+
+#define BENCHMARK(name) \
+	static void name##Benchmark(); \
+	static BenchmarkRegistration name##Registration(#name, name##Benchmark); \
+	static void name##Benchmark()
+
+// Seconds since a time from std::chrono::high_resolution_clock::now()
+inline double SecondsSince(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Best of a few runs, so one slow run (like the first one reading the file
+// from disk) doesn't skew the comparison
+template<typename Run>
+double BestOf(int runs, Run run)
+{
+	double best = 0;
+	for (int r = 0; r < runs; r++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		run();
+		double seconds = SecondsSince(start);
+		if (r == 0 || seconds < best)
+			best = seconds;
+	}
+	return best;
+}
+
+inline double Megabytes(size_t bytes)
+{
+	return bytes / (1024.0 * 1024.0);
+}
+
+// Writes a size x size grid of quads as an OBJ, the way modeling tools
+// export them (positions, uvs and normals on every corner), returning its name
+std::string WriteGridObj(const char* file, int size);
+
+// A WARP device (null if it couldn't be made), for benchmarks that need
+// real GPU objects without depending on the machine's GPU
+Microsoft::WRL::ComPtr<ID3D11Device> CreateWarpDevice();
@@ -0,0 +1,57 @@
+#include "Benchmark.h"
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+struct BenchmarkEntry
+{
+	const char* name;
+	BenchmarkFunction function;
+};
+
+// Function local, so registrations from other files can't run before it exists
+static std::vector<BenchmarkEntry>& GetBenchmarks()
+{
+	static std::vector<BenchmarkEntry> benchmarks;
+	return benchmarks;
+}
+
+BenchmarkRegistration::BenchmarkRegistration(const char* name, BenchmarkFunction function)
+{
+	GetBenchmarks().push_back({ name, function });
+}
+
+// Runs every benchmark, or only the ones named on the command line
+// - "-list" prints the names instead
+int main(int argc, char* argv[])
+{
+	std::vector<BenchmarkEntry>& benchmarks = GetBenchmarks();
+	if (argc > 1 && strcmp(argv[1], "-list") == 0)
+	{
+		for (size_t i = 0; i < benchmarks.size(); i++)
+			printf("%s\n", benchmarks[i].name);
+		return 0;
+	}
+
+	int run = 0;
+	for (size_t i = 0; i < benchmarks.size(); i++)
+	{
+		bool wanted = argc <= 1;
+		for (int a = 1; a < argc; a++)
+			wanted = wanted || strcmp(argv[a], benchmarks[i].name) == 0;
+		if (!wanted)
+			continue;
+
+		printf("== %s\n", benchmarks[i].name);
+		fflush(stdout);
+		benchmarks[i].function();
+		run++;
+	}
+
+	if (run == 0)
+	{
+		printf("No benchmarks matched, use -list to see them\n");
+		return 1;
+	}
+	return 0;
+}
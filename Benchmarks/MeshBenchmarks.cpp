@@ -0,0 +1,126 @@
+#include "Benchmark.h"
+#include "Mesh.h"
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// WARP is always there and needs no window, so buffer uploads are real
+// without depending on the machine's GPU
+Microsoft::WRL::ComPtr<ID3D11Device> CreateWarpDevice()
+{
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, nullptr, 0,
+		D3D11_SDK_VERSION, device.GetAddressOf(), nullptr, nullptr);
+	return device;
+}
+
+// Full OBJ load (parse, optimize, tangents, LODs, packing and the bake)
+// against loading the bake it wrote, with and without the content hash
+// - Uses the same options Game loads its meshes with
+BENCHMARK(MeshLoad)
+{
+	Microsoft::WRL::ComPtr<ID3D11Device> device = CreateWarpDevice();
+	if (!device)
+	{
+		printf("Couldn't create a WARP device, skipping\n");
+		return;
+	}
+
+	unsigned int loadFlags = MESH_LOAD_OPTIMIZE | MESH_LOAD_MESHLETS | MESH_LOAD_LODS | MESH_LOAD_PACK;
+	const int sizes[3] = { 64, 256, 512 };
+	for (int s = 0; s < 3; s++)
+	{
+		std::string file = WriteGridObj("BenchmarkMesh.obj", sizes[s]);
+		std::string cacheFile = file + ".meshcache";
+
+		// Every OBJ run has to start without a bake
+		MeshLoadStats objStats;
+		double obj = BestOf(3, [&]()
+		{
+			std::remove(cacheFile.c_str());
+			Mesh mesh(file.c_str(), device, loadFlags);
+			objStats = mesh.GetLoadStats();
+		});
+
+		// The last OBJ run left a bake behind
+		MeshLoadStats bakedStats;
+		UINT vertexStride = 0;
+		double baked = BestOf(3, [&]()
+		{
+			Mesh mesh(file.c_str(), device, loadFlags);
+			bakedStats = mesh.GetLoadStats();
+			vertexStride = mesh.GetVertexStride();
+		});
+
+		// Just opening the bake, with and without the full content hash
+		// (Mesh always uses the build's default)
+		unsigned int bakeFlags = loadFlags & ~MESH_LOAD_MESHLETS;
+		double open = BestOf(3, [&]()
+		{
+			MeshCache cache;
+			cache.Open(cacheFile.c_str(), file.c_str(), bakeFlags, vertexStride, false);
+		});
+		double verified = BestOf(3, [&]()
+		{
+			MeshCache cache;
+			cache.Open(cacheFile.c_str(), file.c_str(), bakeFlags, vertexStride, true);
+		});
+
+		printf("%d x %d grid: OBJ %.3fms, baked %.3fms (%.1f MB), %.1fx faster%s\n",
+			sizes[s], sizes[s], obj * 1000.0, baked * 1000.0, Megabytes(bakedStats.cacheBytes), obj / baked,
+			bakedStats.fromCache && !objStats.fromCache ? "" : " (bake wasn't used!)");
+		printf("  opening the bake: %.3fms, %.3fms with the content hash\n", open * 1000.0, verified * 1000.0);
+		std::remove(cacheFile.c_str());
+		std::remove(file.c_str());
+	}
+}
+
+// A bumpy size x size grid of quads with UVs across it, like the ones
+// WriteGridObj writes, but straight into vertices
+static void BuildGrid(int size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	for (int z = 0; z <= size; z++)
+	{
+		for (int x = 0; x <= size; x++)
+		{
+			Vertex v = {};
+			v.Position = DirectX::XMFLOAT3((float)x, sinf(x * 0.25f) * cosf(z * 0.2f), (float)z);
+			v.Normal = DirectX::XMFLOAT3(0, 1, 0);
+			v.UV = DirectX::XMFLOAT2((float)x / size, (float)z / size);
+			verts.push_back(v);
+		}
+	}
+	unsigned int row = (unsigned int)size + 1;
+	for (unsigned int z = 0; z < (unsigned int)size; z++)
+	{
+		for (unsigned int x = 0; x < (unsigned int)size; x++)
+		{
+			unsigned int i = z * row + x;
+			unsigned int quad[6] = { i, i + row, i + 1, i + 1, i + row, i + row + 1 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+// Scalar tangents against the vectorized ones, on one thread and on
+// every hardware thread, along with how far apart the two paths end up
+BENCHMARK(TangentGeneration)
+{
+	const int sizes[3] = { 64, 256, 1024 };
+	for (int s = 0; s < 3; s++)
+	{
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		BuildGrid(sizes[s], verts, indices);
+
+		TangentBenchmark single = TangentGenerator::Benchmark(verts.data(), verts.size(), indices.data(), indices.size(), 1);
+		TangentBenchmark threaded = TangentGenerator::Benchmark(verts.data(), verts.size(), indices.data(), indices.size(), 0);
+		printf("%d x %d grid (%zu triangles): scalar %.3fms, SIMD %.3fms (%.1fx), %u threads %.3fms (%.1fx)\n",
+			sizes[s], sizes[s], indices.size() / 3, single.scalarSeconds * 1000.0,
+			single.simdSeconds * 1000.0, single.Speedup(),
+			threaded.threads, threaded.simdSeconds * 1000.0, threaded.Speedup());
+		printf("  largest angle between the paths %.4f degrees, %zu handedness mismatches\n",
+			threaded.maxAngleError, threaded.handednessMismatches);
+	}
+}
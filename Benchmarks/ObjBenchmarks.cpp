@@ -0,0 +1,163 @@
+#include "Benchmark.h"
+#include "ObjParser.h"
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <algorithm>
+
+// A grid of quads written out the way modeling tools export them, with
+// positions, uvs and normals on every corner
+std::string WriteGridObj(const char* file, int size)
+{
+	std::ofstream out(file, std::ios::trunc);
+	char line[160];
+	for (int y = 0; y <= size; y++)
+	{
+		for (int x = 0; x <= size; x++)
+		{
+			snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", x * 0.01f, (x * y % 17) * 0.001f, y * 0.01f);
+			out << line;
+			snprintf(line, sizeof(line), "vt %.6f %.6f\n", (float)x / size, (float)y / size);
+			out << line;
+			snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", 0.0f, 1.0f, 0.0f);
+			out << line;
+		}
+	}
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			int a = y * (size + 1) + x + 1;
+			int b = a + 1;
+			int c = a + size + 2;
+			int d = a + size + 1;
+			snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+			out << line;
+		}
+	}
+	return file;
+}
+
+// The getline/sscanf_s loader Mesh used before ObjParser, kept as the
+// baseline (lines over 100 characters and anything but v/vt/vn quads or
+// triangles weren't supported)
+static void LoadObjBaseline(const char* file, ObjData& data)
+{
+	std::ifstream obj(file);
+	if (!obj.is_open())
+		return;
+
+	char chars[100];
+	while (obj.good())
+	{
+		obj.getline(chars, 100);
+		if (chars[0] == 'v' && chars[1] == 'n')
+		{
+			ObjFloat3 norm;
+			sscanf_s(chars, "vn %f %f %f", &norm.x, &norm.y, &norm.z);
+			data.normals.push_back(norm);
+		}
+		else if (chars[0] == 'v' && chars[1] == 't')
+		{
+			ObjFloat2 uv;
+			sscanf_s(chars, "vt %f %f", &uv.x, &uv.y);
+			data.uvs.push_back(uv);
+		}
+		else if (chars[0] == 'v')
+		{
+			ObjFloat3 pos;
+			sscanf_s(chars, "v %f %f %f", &pos.x, &pos.y, &pos.z);
+			data.positions.push_back(pos);
+		}
+		else if (chars[0] == 'f')
+		{
+			int i[12] = {};
+			int facesRead = sscanf_s(chars, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+				&i[0], &i[1], &i[2], &i[3], &i[4], &i[5], &i[6], &i[7], &i[8], &i[9], &i[10], &i[11]);
+			ObjCorner corners[4];
+			for (int c = 0; c < 4; c++)
+				corners[c] = { i[c * 3] - 1, i[c * 3 + 1] - 1, i[c * 3 + 2] - 1 };
+			data.corners.push_back(corners[0]);
+			data.corners.push_back(corners[1]);
+			data.corners.push_back(corners[2]);
+			if (facesRead == 12)
+			{
+				data.corners.push_back(corners[0]);
+				data.corners.push_back(corners[2]);
+				data.corners.push_back(corners[3]);
+			}
+		}
+	}
+}
+
+// ObjParser on one thread against the loader it replaced
+BENCHMARK(ObjParse)
+{
+	const int sizes[3] = { 64, 256, 1024 };
+	for (int s = 0; s < 3; s++)
+	{
+		std::string file = WriteGridObj("BenchmarkGrid.obj", sizes[s]);
+		size_t bytes = 0;
+		size_t corners = 0;
+		double parser = BestOf(3, [&]()
+		{
+			ObjData data;
+			ObjParseStats stats;
+			ObjParser::ParseFile(file.c_str(), data, &stats, 1);
+			bytes = stats.bytes;
+			corners = data.corners.size();
+		});
+		size_t baselineCorners = 0;
+		double baseline = BestOf(3, [&]()
+		{
+			ObjData data;
+			LoadObjBaseline(file.c_str(), data);
+			baselineCorners = data.corners.size();
+		});
+		printf("%.1f MB OBJ: getline/sscanf_s %.3fms (%.1f MB/s), ObjParser %.3fms (%.1f MB/s), %.2fx faster%s\n",
+			Megabytes(bytes), baseline * 1000.0, Megabytes(bytes) / baseline, parser * 1000.0, Megabytes(bytes) / parser,
+			baseline / parser, corners == baselineCorners ? "" : " (triangle counts differ!)");
+		std::remove(file.c_str());
+	}
+}
+
+// Chunked parsing from 1 thread up to every hardware thread, noting any
+// parse that doesn't match the single threaded one (the Tests project
+// checks that properly)
+BENCHMARK(ObjParseThreads)
+{
+	std::string file = WriteGridObj("BenchmarkGrid.obj", 1024);
+	ObjData serial;
+	ObjParser::ParseFile(file.c_str(), serial, nullptr, 1);
+
+	unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	double single = 0;
+	for (unsigned int threads = 1; ; threads = std::min(threads * 2, hardwareThreads))
+	{
+		ObjParseStats stats;
+		bool same = true;
+		double seconds = BestOf(3, [&]()
+		{
+			ObjData data;
+			ObjParser::ParseFile(file.c_str(), data, &stats, threads);
+			same = data.positions.size() == serial.positions.size() &&
+				data.uvs.size() == serial.uvs.size() &&
+				data.normals.size() == serial.normals.size() &&
+				data.corners.size() == serial.corners.size() &&
+				memcmp(data.positions.data(), serial.positions.data(), sizeof(ObjFloat3) * data.positions.size()) == 0 &&
+				memcmp(data.uvs.data(), serial.uvs.data(), sizeof(ObjFloat2) * data.uvs.size()) == 0 &&
+				memcmp(data.normals.data(), serial.normals.data(), sizeof(ObjFloat3) * data.normals.size()) == 0 &&
+				memcmp(data.corners.data(), serial.corners.data(), sizeof(ObjCorner) * data.corners.size()) == 0;
+		});
+		if (threads == 1)
+			single = seconds;
+		printf("%.1f MB OBJ on %u threads: %.3fms (%.1f MB/s), %.2fx one thread%s\n",
+			Megabytes(stats.bytes), stats.threads, seconds * 1000.0, Megabytes(stats.bytes) / seconds, single / seconds,
+			same ? "" : " (differs from one thread!)");
+		if (threads == hardwareThreads)
+			break;
+	}
+	std::remove(file.c_str());
+}
@@ -0,0 +1,106 @@
+#include "Benchmark.h"
+#include "SceneBVH.h"
+#include "OcclusionCuller.h"
+#include "Projection.h"
+#include "TransformStore.h"
+#include "Flythrough.h"
+#include <cstdio>
+
+// Building, culling, refitting and picking through the scene BVH, against
+// testing every box
+// - Whether the answers match is checked by the SceneBVH tests
+BENCHMARK(SceneBVHQueries)
+{
+	const size_t counts[3] = { 1000, 100000, 1000000 };
+	for (int i = 0; i < 3; i++)
+	{
+		SceneBVHBenchmark bvh = SceneBVH::Benchmark(counts[i]);
+		printf("%zu boxes: build %.3fms, cull %.3fms (%.2fx brute force, flat spheres %.3fms), refit 1%% %.3fms, "
+			"%zu rays %.3fms (%.2fx brute force), sphere queries %.3fms, %zu mismatches\n",
+			bvh.count, bvh.buildSeconds * 1000.0, bvh.bvhCullSeconds * 1000.0, bvh.CullSpeedup(), bvh.flatCullSeconds * 1000.0,
+			bvh.refitSeconds * 1000.0, bvh.rays, bvh.bvhRaySeconds * 1000.0, bvh.RaySpeedup(), bvh.sphereQuerySeconds * 1000.0,
+			bvh.mismatches);
+	}
+}
+
+// Rasterizing a room of occluders on one thread and on every hardware
+// thread, then testing boxes against it
+// - The ray cast check of every occluded box, and one thread against many,
+//   are what the OcclusionCuller tests fail on
+BENCHMARK(OcclusionRaster)
+{
+	const size_t occluderCounts[3] = { 0, 20, 200 };
+	for (int i = 0; i < 3; i++)
+	{
+		OcclusionBenchmark occlusion = OcclusionCuller::Benchmark(occluderCounts[i], 20000);
+		printf("%zu occluder triangles: rasterize %.3fms on 1 thread, %.3fms on %u (%.2fx), %zu of %zu boxes occluded in %.3fms, "
+			"%zu false occlusions, %zu thread mismatches\n",
+			occlusion.occluderTriangles, occlusion.singleThreadSeconds * 1000.0, occlusion.threadedSeconds * 1000.0, occlusion.threads,
+			occlusion.Speedup(), occlusion.occluded, occlusion.occludees, occlusion.testSeconds * 1000.0,
+			occlusion.falseOcclusions, occlusion.threadMismatches);
+	}
+}
+
+// How finely the standard projection and reverse-Z tell depths apart
+// - The Projection tests fail if reverse-Z is ever the coarser one
+BENCHMARK(DepthPrecision)
+{
+	DepthPrecisionReport precision = Projection::MeasureDepthPrecision(1.0f, 1000.0f, 7);
+	for (size_t i = 0; i < precision.samples.size(); i++)
+	{
+		const DepthPrecisionSample& sample = precision.samples[i];
+		printf("Depth at %.1f: standard 24-bit step %g, standard float %g, reverse-Z float %g\n",
+			sample.distance, sample.standard24Step, sample.standardFloatStep, sample.reverseFloatStep);
+	}
+	printf("Worst relative depth step: standard 24-bit %g, standard float %g, reverse-Z float %g (%.0fx finer)\n",
+		precision.worstStandard24, precision.worstStandardFloat, precision.worstReverseFloat, precision.Gain());
+}
+
+// The transform store's batch update against building matrices one at a time
+BENCHMARK(TransformUpdate)
+{
+	const size_t counts[3] = { 1000, 100000, 1000000 };
+	for (int i = 0; i < 3; i++)
+	{
+		TransformBenchmark result = TransformStore::Benchmark(counts[i]);
+		printf("%zu transforms: one at a time %.3fms, batch %.3fms (%.2fx), %u threads %.3fms, 10%% dirty %.3fms, max difference %g\n",
+			result.count, result.onDemandSeconds * 1000.0, result.batchSeconds * 1000.0, result.Speedup(),
+			result.threads, result.threadedSeconds * 1000.0, result.sparseSeconds * 1000.0, result.maxError);
+	}
+}
+
+// Culling a scene of spheres 4 at a time against one at a time
+// - Whether the two agree is checked by the FrustumCuller tests
+BENCHMARK(FrustumCull)
+{
+	const size_t counts[3] = { 1000, 100000, 1000000 };
+	for (int i = 0; i < 3; i++)
+	{
+		CullBenchmark cull = FrustumCuller::Benchmark(counts[i]);
+		printf("%zu spheres: %zu visible, one at a time %.3fms, 4 at a time %.3fms (%.2fx), %zu mismatches\n",
+			cull.count, cull.visible, cull.scalarSeconds * 1000.0, cull.simdSeconds * 1000.0, cull.Speedup(), cull.mismatches);
+	}
+}
+
+// CPU side of a flythrough of the room path through a generated scene
+// - Run from Visual Studio the working directory is Benchmarks, and from a
+//   command line it's usually the solution's
+BENCHMARK(Flythrough)
+{
+	const char* pathFiles[2] = { "../Assets/Paths/room.path", "Assets/Paths/room.path" };
+	CameraPath path;
+	if (!path.Load(pathFiles[0]) && !path.Load(pathFiles[1]))
+	{
+		printf("Couldn't find Assets/Paths/room.path, skipping\n");
+		return;
+	}
+
+	FrameProfiler times = Flythrough::RunHeadless(path, 5000);
+	for (int s = FRAME_STAGE_UPDATE; s <= FRAME_STAGE_CULL; s++)
+	{
+		FrameStageSummary summary = times.Summarize((FrameStage)s);
+		printf("Flythrough %s over %zu frames: mean %.3fms, p50 %.3fms, p95 %.3fms, p99 %.3fms, max %.3fms\n",
+			FrameProfiler::GetStageName((FrameStage)s), times.GetFrameCount(),
+			summary.mean, summary.p50, summary.p95, summary.p99, summary.max);
+	}
+}
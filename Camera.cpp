@@ -2,16 +2,16 @@
 
 // Constructors
 // Every constructor needs an aspect ratio because that comes from the computer
+// - These delegate to the full constructor (calling it in the body would
+//   only build a temporary and leave this camera uninitialized)
 Camera::Camera(float aspectRatio)
+	: Camera(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0), aspectRatio, .5f, 1, 100, 1, 1)
 {
-	// Call full constructor with defaults + aspect ratio
-	Camera(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0), aspectRatio, .5f, 1, 100, 1, 1);
 }
 
 Camera::Camera(XMFLOAT3 position, XMFLOAT3 orientation, float aspectRatio)
+	: Camera(position, orientation, aspectRatio, .5f, 1, 100, 1, 1)
 {
-	// Call full constructor with defaults + 3 params
-	Camera(position, orientation, aspectRatio, .5f, 1, 100, 1, 1);
 }
 
 Camera::Camera(XMFLOAT3 position, XMFLOAT3 orientation, float aspectRatio, float fov, float nearClip, float farClip, float moveSpeed, float rotSpeed)
@@ -25,35 +25,103 @@ Camera::Camera(XMFLOAT3 position, XMFLOAT3 orientation, float aspectRatio, float
 	this->fov = fov;
 	this->farClip = farClip;
 	this->nearClip = nearClip;
+	this->reverseZ = false;
 	this->moveSpeed = moveSpeed;
 	this->mouseSpeed = rotSpeed;
+	prevMousePos = XMINT2(0, 0);
 
 	// Set up the matrices
+	version = 0;
+	transformVersion = 0;
+	viewChanged = true;
 	UpdateProjectionMatrix(aspectRatio);
 	UpdateViewMatrix();
 }
 
 // Basic Getters
-XMFLOAT4X4 Camera::GetViewMatrix() { return viewMatrix; }
-XMFLOAT4X4 Camera::GetProjMatrix() { return projMatrix; }
+const XMFLOAT4X4& Camera::GetViewMatrix() { UpdateViewMatrix(); return viewMatrix; }
+const XMFLOAT4X4& Camera::GetProjMatrix() { UpdateViewMatrix(); return projMatrix; }
+const XMFLOAT4X4& Camera::GetViewProjMatrix() { UpdateViewMatrix(); return viewProjMatrix; }
+const XMFLOAT4X4& Camera::GetInverseViewMatrix() { UpdateViewMatrix(); return inverseViewMatrix; }
+const XMFLOAT4X4& Camera::GetInverseProjMatrix() { UpdateViewMatrix(); return inverseProjMatrix; }
+const XMFLOAT4X4& Camera::GetInverseViewProjMatrix() { UpdateViewMatrix(); return inverseViewProjMatrix; }
+const Frustum& Camera::GetFrustum() { UpdateViewMatrix(); return frustum; }
+uint32_t Camera::GetVersion() { UpdateViewMatrix(); return version; }
+XMINT2 Camera::GetMousePosition() { return prevMousePos; }
+bool Camera::GetReverseZ() { return reverseZ; }
+float Camera::GetFarDepth() { return reverseZ ? 0.0f : 1.0f; }
+
+void Camera::SetReverseZ(bool reverseZ)
+{
+	this->reverseZ = reverseZ;
+	UpdateProjectionMatrix(aspectRatio);
+}
+
+// The projection scales view space x and y by _11 and _22 before the
+// divide by depth, so undoing that gives the pixel's direction at a depth
+// of 1, which is then just a mix of the camera's axes
+void Camera::GetPickRay(float x, float y, float viewportWidth, float viewportHeight, XMFLOAT3& origin, XMFLOAT3& direction)
+{
+	float ndcX = x / viewportWidth * 2.0f - 1.0f;
+	float ndcY = 1.0f - y / viewportHeight * 2.0f;
+	XMFLOAT3 right = transform.GetRight();
+	XMFLOAT3 up = transform.GetUp();
+	XMFLOAT3 forward = transform.GetForward();
+	XMVECTOR dir = XMLoadFloat3(&forward);
+	dir = XMVectorMultiplyAdd(XMVectorReplicate(ndcX / projMatrix._11), XMLoadFloat3(&right), dir);
+	dir = XMVectorMultiplyAdd(XMVectorReplicate(ndcY / projMatrix._22), XMLoadFloat3(&up), dir);
+	XMStoreFloat3(&direction, dir);
+	origin = transform.GetPosition();
+}
 
 void Camera::UpdateProjectionMatrix(float aspectRatio)
 {
+	this->aspectRatio = aspectRatio;
 	// Set new (temp) projection matrix
-	XMMATRIX projMat = XMMatrixPerspectiveFovLH(fov, aspectRatio, nearClip, farClip);
+	XMMATRIX projMat = reverseZ ?
+		Projection::ReverseZInfinite(fov, aspectRatio, nearClip) :
+		Projection::Standard(fov, aspectRatio, nearClip, farClip);
 	// Turn the matrix into a 4x4
 	XMStoreFloat4x4(&projMatrix, projMat);
+	projectionChanged = true;
 }
 
+// The transform's world version says whether it moved (asking for the
+// world matrix is what brings that version up to date)
 void Camera::UpdateViewMatrix()
+{
+	transform.GetWorldMatrix();
+	uint32_t currentVersion = transform.GetWorldVersion();
+	if (!viewChanged && !projectionChanged && currentVersion == transformVersion)
+		return;
+
+	if (viewChanged || currentVersion != transformVersion)
+	{
+		BuildViewMatrix();
+		transformVersion = currentVersion;
+		viewChanged = false;
+	}
+	projectionChanged = false;
+
+	// Everything else comes from the view and projection
+	XMMATRIX view = XMLoadFloat4x4(&viewMatrix);
+	XMMATRIX proj = XMLoadFloat4x4(&projMatrix);
+	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+	XMStoreFloat4x4(&viewProjMatrix, viewProj);
+	XMStoreFloat4x4(&inverseViewMatrix, XMMatrixInverse(nullptr, view));
+	XMStoreFloat4x4(&inverseProjMatrix, XMMatrixInverse(nullptr, proj));
+	XMStoreFloat4x4(&inverseViewProjMatrix, XMMatrixInverse(nullptr, viewProj));
+	frustum = Frustum::FromMatrix(viewProjMatrix);
+	version++;
+}
+
+void Camera::BuildViewMatrix()
 {
 	// Move into XMVector
 	XMVECTOR position = XMVectorSet(transform.GetPosition().x, transform.GetPosition().y, transform.GetPosition().z, 0);
-	// Get the forward vector rotated
-	XMVECTOR vec = XMVectorSet(0, 0, 1, 0);
-	XMVECTOR rotationVec = XMQuaternionRotationRollPitchYaw(transform.GetRotation().x, transform.GetRotation().y, transform.GetRotation().z);
-	// Actual forward vector
-	XMVECTOR direction = XMVector3Rotate(vec, rotationVec);
+	// Forward vector (kept up to date by the transform whenever it turns)
+	XMFLOAT3 forward = transform.GetForward();
+	XMVECTOR direction = XMLoadFloat3(&forward);
 	// Calculate the view matrix
 	XMMATRIX viewMat = XMMatrixLookToLH(position, direction, XMVectorSet(0, 1, 0, 0));
 	// Actually store this
@@ -61,21 +129,18 @@ void Camera::UpdateViewMatrix()
 }
 
 // Update on delta time
-void Camera::Update(float dt, HWND windowHandle)
+void Camera::Update(float dt)
 {
 	// Call the helper method
 	CheckKeys(dt);
 
 	// Mouse input
-	// Define object for current mouse pos
-	POINT mousePos = {};
-	// Get current mouse pos
-	GetCursorPos(&mousePos);
-	// Coordinate system
-	ScreenToClient(windowHandle, &mousePos);
+	// Current mouse pos (already in the window's coordinate system)
+	Input& input = Input::Default();
+	XMINT2 mousePos(input.GetMouseX(), input.GetMouseY());
 
 	// Camera rotation on left mouse hold
-	if (GetAsyncKeyState(VK_LBUTTON) & 0x8000)
+	if (input.IsKeyDown(INPUT_KEY_LBUTTON))
 	{ 
 		// Difference in mouse positions
 		float xDiff = mousePos.x - prevMousePos.x;
@@ -88,7 +153,7 @@ void Camera::Update(float dt, HWND windowHandle)
 	// Set previous mouse position
 	prevMousePos = mousePos;
 
-	// Update matrix based on the transform
+	// Update matrix based on the transform (only does anything if it moved)
 	UpdateViewMatrix();
 }
 
@@ -97,32 +162,33 @@ void Camera::Update(float dt, HWND windowHandle)
 void Camera::CheckKeys(float dt)
 {
 	// Movement with keys
-	if (GetAsyncKeyState('W') & 0x8000)
+	Input& input = Input::Default();
+	if (input.IsKeyDown('W'))
 	{
 		// Forward movement
 		transform.LocalTranslate(0, 0, moveSpeed * dt);
 	}
-	if (GetAsyncKeyState('S') & 0x8000)
+	if (input.IsKeyDown('S'))
 	{
 		// Backward movement
 		transform.LocalTranslate(0, 0, -moveSpeed * dt);
 	}
-	if (GetAsyncKeyState('D') & 0x8000)
+	if (input.IsKeyDown('D'))
 	{
 		// Right movement
 		transform.LocalTranslate(moveSpeed * dt, 0, 0);
 	}
-	if (GetAsyncKeyState('A') & 0x8000)
+	if (input.IsKeyDown('A'))
 	{
 		// Left movement
 		transform.LocalTranslate(-moveSpeed * dt, 0, 0);
 	}
-	if (GetAsyncKeyState(VK_SPACE) & 0x8000)
+	if (input.IsKeyDown(INPUT_KEY_SPACE))
 	{
 		// World up movement
 		transform.WorldTranslate(0, moveSpeed * dt, 0);
 	}
-	if (GetAsyncKeyState('X') & 0x8000)
+	if (input.IsKeyDown('X'))
 	{
 		// World down movement
 		transform.WorldTranslate(0, -moveSpeed * dt, 0);
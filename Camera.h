@@ -1,6 +1,8 @@
 #pragma once
-#include <Windows.h>
 #include "Transform.h"
+#include "Input.h"
+#include "FrustumCuller.h"
+#include "Projection.h"
 
 class Camera
 {
@@ -10,15 +12,33 @@ private:
 	XMFLOAT4X4 viewMatrix;
 	// Secondary information about the camera like view distance, aspect ration and orthographic
 	XMFLOAT4X4 projMatrix;
+	// Everything built from the two above, only redone when one of them changes
+	XMFLOAT4X4 viewProjMatrix;
+	XMFLOAT4X4 inverseViewMatrix;
+	XMFLOAT4X4 inverseProjMatrix;
+	XMFLOAT4X4 inverseViewProjMatrix;
+	Frustum frustum;
+	// Goes up every time the matrices change
+	uint32_t version;
+	// World version of the transform the view matrix was built from
+	uint32_t transformVersion;
+	// Does the view matrix need building even if the transform hasn't moved?
+	bool viewChanged;
+	// Has the projection changed since the matrices were last built?
+	bool projectionChanged;
 	// Previous mouse position
-	POINT prevMousePos;
+	XMINT2 prevMousePos;
 	// Information for customization
 	// Field of view
 	float fov;
 	// Distance to near clipping plane
 	float nearClip;
-	// Distance to far clipping plane
+	// Distance to far clipping plane (unused with reverse-Z, which has none)
 	float farClip;
+	// Width over height of the view, kept for rebuilding the projection
+	float aspectRatio;
+	// Is the projection reverse-Z with an infinite far plane?
+	bool reverseZ;
 	// Physical move speed
 	float moveSpeed;
 	// Rotation speed
@@ -26,6 +46,8 @@ private:
 
 	// Helper Methods
 	void CheckKeys(float dt);
+	// Builds the view matrix from the transform's position and forward
+	void BuildViewMatrix();
 public:
 	// Transform data
 	Transform transform;
@@ -39,14 +61,41 @@ public:
 	Camera(XMFLOAT3 position, XMFLOAT3 orientation, float aspectRatio, float fov, float nearClip, float farClip, float moveSpeed, float rotSpeed);
 	
 	// Methods - Getters
-	XMFLOAT4X4 GetViewMatrix();
-	XMFLOAT4X4 GetProjMatrix();
+	// - Each one brings the matrices up to date first, which does nothing
+	//   unless the transform or the projection changed
+	const XMFLOAT4X4& GetViewMatrix();
+	const XMFLOAT4X4& GetProjMatrix();
+	const XMFLOAT4X4& GetViewProjMatrix();
+	const XMFLOAT4X4& GetInverseViewMatrix();
+	const XMFLOAT4X4& GetInverseProjMatrix();
+	const XMFLOAT4X4& GetInverseViewProjMatrix();
+	// Planes of what the camera can currently see, in world space
+	const Frustum& GetFrustum();
+	// Changes whenever any of the matrices do, so anything built from them
+	// (culling results, constant buffers) can tell when it's out of date
+	uint32_t GetVersion();
+	// Reverse-Z with an infinite far plane instead of the standard projection
+	// - Off by default; whoever turns it on has to clear depth to
+	//   GetFarDepth() and compare with GREATER instead of LESS
+	void SetReverseZ(bool reverseZ);
+	bool GetReverseZ();
+	// Depth the far end of the view ends up at (1, or 0 with reverse-Z)
+	float GetFarDepth();
+	// Mouse position (in client pixels) from the last Update
+	XMINT2 GetMousePosition();
+	// Ray from the camera through a pixel, for picking
+	// - direction isn't normalized; it has a length of 1 along the view direction
+	void GetPickRay(float x, float y, float viewportWidth, float viewportHeight, XMFLOAT3& origin, XMFLOAT3& direction);
 	
 	// Methods - Update Matrices
 	void UpdateProjectionMatrix(float aspectRatio);
+	// Rebuilds the view matrix and everything built from it, but only if
+	// the transform or the projection changed since last time
 	void UpdateViewMatrix();
 
 	// Method - Loop
-	void Update(float dh, HWND windowHandle);
+	// - Reads the keyboard and mouse from Input::Default(), so it moves the
+	//   same way during a replay (and doesn't need a window)
+	void Update(float dh);
 };
 
@@ -0,0 +1,98 @@
+#include "CameraPath.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+
+using namespace DirectX;
+
+bool CameraPath::Load(const char* file)
+{
+	keys.clear();
+	std::ifstream in(file);
+	if (!in.is_open())
+		return false;
+
+	std::string line;
+	while (std::getline(in, line))
+	{
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start == std::string::npos || line[start] == '#')
+			continue;
+
+		std::istringstream fields(line);
+		float time;
+		XMFLOAT3 position, rotation;
+		if (!(fields >> time >> position.x >> position.y >> position.z >> rotation.x >> rotation.y >> rotation.z))
+		{
+			keys.clear();
+			return false;
+		}
+		AddKey(time, position, rotation);
+	}
+	return !keys.empty();
+}
+
+void CameraPath::AddKey(float time, const XMFLOAT3& position, const XMFLOAT3& rotation)
+{
+	CameraKey key;
+	key.time = time;
+	key.position = position;
+	XMVECTOR orientation = XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
+	if (!keys.empty() && XMVectorGetX(XMVector4Dot(orientation, XMLoadFloat4(&keys.back().orientation))) < 0.0f)
+		orientation = XMVectorNegate(orientation);
+	XMStoreFloat4(&key.orientation, orientation);
+	keys.push_back(key);
+}
+
+// Cubic Hermite between the two keys around the time, with each key's
+// tangent pointing from the key before it to the key after it
+void CameraPath::Evaluate(float time, XMFLOAT3& position, XMFLOAT4& orientation) const
+{
+	if (keys.empty())
+	{
+		position = XMFLOAT3(0, 0, 0);
+		orientation = XMFLOAT4(0, 0, 0, 1);
+		return;
+	}
+	if (keys.size() == 1 || time <= keys.front().time)
+	{
+		position = keys.front().position;
+		orientation = keys.front().orientation;
+		return;
+	}
+	if (time >= keys.back().time)
+	{
+		position = keys.back().position;
+		orientation = keys.back().orientation;
+		return;
+	}
+
+	// First key after the time, so the segment is [next - 1, next]
+	size_t next = std::upper_bound(keys.begin(), keys.end(), time,
+		[](float t, const CameraKey& key) { return t < key.time; }) - keys.begin();
+	const CameraKey& a = keys[next - 1];
+	const CameraKey& b = keys[next];
+	const CameraKey& before = keys[next > 1 ? next - 2 : next - 1];
+	const CameraKey& after = keys[next + 1 < keys.size() ? next + 1 : next];
+	float duration = b.time - a.time;
+	float t = duration > 0.0f ? (time - a.time) / duration : 0.0f;
+
+	// Tangents in units per second, then scaled to this segment
+	XMVECTOR p0 = XMLoadFloat3(&a.position);
+	XMVECTOR p1 = XMLoadFloat3(&b.position);
+	float spanA = b.time - before.time;
+	float spanB = after.time - a.time;
+	XMVECTOR m0 = spanA > 0.0f ? XMVectorScale(XMVectorSubtract(p1, XMLoadFloat3(&before.position)), duration / spanA) : XMVectorZero();
+	XMVECTOR m1 = spanB > 0.0f ? XMVectorScale(XMVectorSubtract(XMLoadFloat3(&after.position), p0), duration / spanB) : XMVectorZero();
+
+	float t2 = t * t, t3 = t2 * t;
+	XMVECTOR result = XMVectorScale(p0, 2 * t3 - 3 * t2 + 1);
+	result = XMVectorAdd(result, XMVectorScale(m0, t3 - 2 * t2 + t));
+	result = XMVectorAdd(result, XMVectorScale(p1, -2 * t3 + 3 * t2));
+	result = XMVectorAdd(result, XMVectorScale(m1, t3 - t2));
+	XMStoreFloat3(&position, result);
+
+	XMStoreFloat4(&orientation, XMQuaternionNormalize(
+		XMQuaternionSlerp(XMLoadFloat4(&a.orientation), XMLoadFloat4(&b.orientation), t)));
+}
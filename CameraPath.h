@@ -0,0 +1,42 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <cstddef>
+
+// One point a camera path passes through
+struct CameraKey
+{
+	float time;
+	DirectX::XMFLOAT3 position;
+	// Unit quaternion, flipped when loaded so neighbors take the short way round
+	DirectX::XMFLOAT4 orientation;
+};
+
+// Timed camera path through a list of keys
+// - Positions follow a Catmull-Rom style spline (tangents from the
+//   neighboring keys, scaled by time so uneven spacing doesn't jerk)
+// - Orientations are slerped between keys
+// - Files are plain text, one key per line: time x y z pitch yaw roll
+//   (seconds, world units and radians like Transform::SetRotation), with
+//   blank lines and lines starting with # ignored
+// - Doesn't need DirectX, so it can be built and checked without a GPU
+class CameraPath
+{
+public:
+	// Replaces the keys with the ones in a file, returning false if it
+	// can't be read or has a line that isn't a key
+	bool Load(const char* file);
+	// Keys have to be added in time order
+	void AddKey(float time, const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& rotation);
+	void Clear() { keys.clear(); }
+
+	size_t GetKeyCount() const { return keys.size(); }
+	// Time of the last key
+	float GetDuration() const { return keys.empty() ? 0.0f : keys.back().time; }
+
+	// Where the camera is at a time (clamped to the path)
+	void Evaluate(float time, DirectX::XMFLOAT3& position, DirectX::XMFLOAT4& orientation) const;
+
+private:
+	std::vector<CameraKey> keys;
+};
@@ -234,7 +234,7 @@ HRESULT DXCore::InitDirectX()
 	depthStencilDesc.Height				= height;
 	depthStencilDesc.MipLevels			= 1;
 	depthStencilDesc.ArraySize			= 1;
-	depthStencilDesc.Format				= DXGI_FORMAT_D24_UNORM_S8_UINT;
+	depthStencilDesc.Format				= DepthBufferFormat;
 	depthStencilDesc.Usage				= D3D11_USAGE_DEFAULT;
 	depthStencilDesc.BindFlags			= D3D11_BIND_DEPTH_STENCIL;
 	depthStencilDesc.CPUAccessFlags		= 0;
@@ -318,7 +318,7 @@ void DXCore::OnResize()
 	depthStencilDesc.Height				= height;
 	depthStencilDesc.MipLevels			= 1;
 	depthStencilDesc.ArraySize			= 1;
-	depthStencilDesc.Format				= DXGI_FORMAT_D24_UNORM_S8_UINT;
+	depthStencilDesc.Format				= DepthBufferFormat;
 	depthStencilDesc.Usage				= D3D11_USAGE_DEFAULT;
 	depthStencilDesc.BindFlags			= D3D11_BIND_DEPTH_STENCIL;
 	depthStencilDesc.CPUAccessFlags		= 0;
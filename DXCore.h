@@ -66,6 +66,9 @@ protected:
 
 	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> backBufferRTV;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> depthStencilView;
+	// Float depth, so a reverse-Z projection gets its precision where it's needed
+	// - Nothing uses stencil, so none is allocated
+	static const DXGI_FORMAT DepthBufferFormat = DXGI_FORMAT_D32_FLOAT;
 
 	// Helper function for allocating a console window
 	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
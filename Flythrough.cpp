@@ -0,0 +1,152 @@
+#include "Flythrough.h"
+#include "SceneBVH.h"
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <vector>
+#include <cstring>
+#include <cfloat>
+
+using namespace DirectX;
+
+const float Flythrough::DefaultDeltaTime = 1.0f / 60.0f;
+const size_t Flythrough::HeadlessOccluderCount = 64;
+
+bool Flythrough::Start(const char* pathFile, const char* summaryFile, float fixedDeltaTime)
+{
+	running = false;
+	if (!path.Load(pathFile))
+		return false;
+	this->summaryFile = summaryFile;
+	deltaTime = fixedDeltaTime;
+	time = 0;
+	step = 0;
+	profiler.Clear();
+	running = true;
+	return true;
+}
+
+// Steps are counted in whole time steps from the start, so no error
+// builds up over a long path
+bool Flythrough::Step(Camera& camera)
+{
+	if (!running)
+		return false;
+	if (time > path.GetDuration())
+	{
+		running = false;
+		WriteSummary(summaryFile.c_str());
+		return false;
+	}
+
+	XMFLOAT3 position;
+	XMFLOAT4 orientation;
+	path.Evaluate(time, position, orientation);
+	camera.transform.SetPosition(position.x, position.y, position.z);
+	camera.transform.SetOrientation(orientation);
+	step++;
+	time = (float)step * deltaTime;
+	return true;
+}
+
+bool Flythrough::WriteSummary(const char* file) const
+{
+	size_t length = strlen(file);
+	if (length >= 4 && strcmp(file + length - 4, ".csv") == 0)
+		return profiler.WriteCsv(file);
+	return profiler.WriteJson(file);
+}
+
+FrameProfiler Flythrough::RunHeadless(const CameraPath& path, size_t boxCount, float fixedDeltaTime)
+{
+	uint32_t seed = 12345;
+	auto random = [&seed](float lo, float hi)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return lo + (hi - lo) * ((seed >> 8) / 16777216.0f);
+	};
+
+	// Boxes spread over the space the path covers, plus a bit
+	XMFLOAT3 lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (float t = 0; t <= path.GetDuration(); t += fixedDeltaTime)
+	{
+		XMFLOAT3 position;
+		XMFLOAT4 orientation;
+		path.Evaluate(t, position, orientation);
+		lo = XMFLOAT3(fminf(lo.x, position.x), fminf(lo.y, position.y), fminf(lo.z, position.z));
+		hi = XMFLOAT3(fmaxf(hi.x, position.x), fmaxf(hi.y, position.y), fmaxf(hi.z, position.z));
+	}
+	float margin = 10.0f;
+	std::vector<XMFLOAT3> mins(boxCount), maxs(boxCount);
+	std::vector<float> sizes(boxCount);
+	for (size_t i = 0; i < boxCount; i++)
+	{
+		XMFLOAT3 center(random(lo.x - margin, hi.x + margin), random(lo.y - margin, hi.y + margin), random(lo.z - margin, hi.z + margin));
+		float size = random(0.1f, 1.0f);
+		size = size * size * size * 4.0f;	// Mostly small, a few big ones
+		mins[i] = XMFLOAT3(center.x - size, center.y - size, center.z - size);
+		maxs[i] = XMFLOAT3(center.x + size, center.y + size, center.z + size);
+		sizes[i] = size;
+	}
+	SceneBVH bvh;
+	bvh.Build(mins.data(), maxs.data(), boxCount);
+
+	// The biggest boxes hide things, like the walls and floors of a real scene
+	std::vector<uint32_t> bySize(boxCount);
+	for (size_t i = 0; i < boxCount; i++)
+		bySize[i] = (uint32_t)i;
+	std::sort(bySize.begin(), bySize.end(), [&sizes](uint32_t a, uint32_t b) { return sizes[a] > sizes[b]; });
+	bySize.resize(std::min(boxCount, HeadlessOccluderCount));
+	static const uint32_t boxIndices[36] =
+	{
+		0, 2, 3, 0, 3, 1,	4, 5, 7, 4, 7, 6,	0, 1, 5, 0, 5, 4,
+		2, 6, 7, 2, 7, 3,	0, 4, 6, 0, 6, 2,	1, 3, 7, 1, 7, 5
+	};
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+	Camera camera(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0), 16.0f / 9.0f, XM_PIDIV4, 0.1f, 1000.0f, 1, 1);
+	camera.SetReverseZ(true);
+	Flythrough run;
+	run.path = path;
+	run.deltaTime = fixedDeltaTime;
+	run.running = true;
+	OcclusionCuller occlusion;
+	std::vector<uint32_t> visible;
+	for (;;)
+	{
+		run.profiler.Begin(FRAME_STAGE_UPDATE);
+		bool stepped = run.Step(camera);
+		if (stepped)
+		{
+			TransformStore::Default().UpdateWorldMatrices();
+			camera.GetVersion();
+		}
+		run.profiler.End(FRAME_STAGE_UPDATE);
+		if (!stepped)
+			break;
+
+		run.profiler.Begin(FRAME_STAGE_CULL);
+		bvh.QueryFrustum(camera.GetFrustum(), visible);
+		occlusion.BeginFrame(camera.GetViewProjMatrix());
+		for (size_t o = 0; o < bySize.size(); o++)
+		{
+			const XMFLOAT3& a = mins[bySize[o]];
+			const XMFLOAT3& b = maxs[bySize[o]];
+			XMFLOAT3 corners[8];
+			for (int c = 0; c < 8; c++)
+				corners[c] = XMFLOAT3((c & 1) ? b.x : a.x, (c & 2) ? b.y : a.y, (c & 4) ? b.z : a.z);
+			occlusion.AddOccluder(corners, 8, boxIndices, 36, identity);
+		}
+		occlusion.Rasterize();
+		size_t kept = 0;
+		for (size_t v = 0; v < visible.size(); v++)
+		{
+			if (!occlusion.IsOccluded(mins[visible[v]], maxs[visible[v]]))
+				visible[kept++] = visible[v];
+		}
+		visible.resize(kept);
+		run.profiler.End(FRAME_STAGE_CULL);
+		run.profiler.EndFrame();
+	}
+	return run.profiler;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "Camera.h"
+#include "CameraPath.h"
+#include "FrameProfiler.h"
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Benchmark run that flies the camera along a CameraPath at a fixed time
+// step while a FrameProfiler times every frame
+// - The summary is written when the path ends, as CSV if the file name
+//   ends in .csv and JSON otherwise
+// - RunHeadless does the CPU side of a frame (camera, transforms and
+//   culling) against a generated scene, with no window or GPU, so CPU
+//   costs can be tracked on machines that can't run the game
+class Flythrough
+{
+public:
+	// 60 frames a second
+	static const float DefaultDeltaTime;
+	// Biggest boxes RunHeadless draws into the occlusion buffer
+	static const size_t HeadlessOccluderCount;
+
+	// Loads the path and starts the run, returning false if the path can't be loaded
+	bool Start(const char* pathFile, const char* summaryFile, float fixedDeltaTime = DefaultDeltaTime);
+	bool IsRunning() const { return running; }
+	float GetDeltaTime() const { return deltaTime; }
+	FrameProfiler& GetProfiler() { return profiler; }
+
+	// Puts the camera at the next step of the path, returning false once
+	// the path is over (which ends the run and writes the summary)
+	bool Step(Camera& camera);
+	bool WriteSummary(const char* file) const;
+
+	// Flies a camera along the path through boxCount random boxes, timing
+	// the update (camera and transforms) and cull (BVH frustum query, then
+	// occlusion culling behind the biggest boxes) stages of every frame
+	static FrameProfiler RunHeadless(const CameraPath& path, size_t boxCount, float fixedDeltaTime = DefaultDeltaTime);
+
+private:
+	CameraPath path;
+	FrameProfiler profiler;
+	std::string summaryFile;
+	float deltaTime = DefaultDeltaTime;
+	float time = 0;
+	uint32_t step = 0;
+	bool running = false;
+};
@@ -0,0 +1,38 @@
+#include "FrameAllocator.h"
+
+FrameAllocator::FrameAllocator(size_t capacity, size_t alignment, uint32_t firstGeneration)
+	: alignment(alignment > 0 ? alignment : 1),
+	generation(firstGeneration > 0 ? firstGeneration : 1)
+{
+	// Only whole aligned blocks can be handed out
+	this->capacity = capacity / this->alignment * this->alignment;
+}
+
+void FrameAllocator::BeginFrame()
+{
+	head = 0;
+	generation++;
+	if (generation == 0)
+		generation = 1;
+	stats = FrameAllocatorStats();
+}
+
+bool FrameAllocator::Allocate(size_t size, FrameAllocation& allocation)
+{
+	size_t aligned = (size + alignment - 1) / alignment * alignment;
+	if (aligned == 0 || aligned > capacity - head)
+	{
+		stats.overflows++;
+		return false;
+	}
+
+	allocation.offset = head;
+	allocation.size = aligned;
+	allocation.firstInFrame = head == 0;
+	head += aligned;
+	if (head > highWater)
+		highWater = head;
+	stats.allocations++;
+	stats.bytes += aligned;
+	return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// Where an allocation landed, from FrameAllocator::Allocate
+struct FrameAllocation
+{
+	size_t offset = 0;
+	size_t size = 0;
+	// The first allocation of a frame, so the memory behind it should be
+	// thrown away (discarded) rather than written around
+	bool firstInFrame = false;
+};
+
+// What one frame of allocating took
+struct FrameAllocatorStats
+{
+	size_t allocations = 0;
+	size_t bytes = 0;
+	// Allocations that didn't fit, which the caller has to put somewhere else
+	size_t overflows = 0;
+};
+
+// Linear allocator over a fixed size block that starts over every frame,
+// for handing out per draw constant data in one big GPU buffer
+// - Sizes and offsets are rounded up to the alignment (constant buffer
+//   offsets are set in 256 byte steps)
+// - BeginFrame moves the generation on, so anything allocated in an
+//   older generation has to be written again before it's used
+// - Only does the bookkeeping, so it doesn't need DirectX and can be
+//   built and checked without a GPU
+class FrameAllocator
+{
+public:
+	static const size_t DefaultAlignment = 256;
+
+	// firstGeneration is only there so wrapping around can be tested
+	FrameAllocator(size_t capacity = 0, size_t alignment = DefaultAlignment, uint32_t firstGeneration = 1);
+
+	// Starts over from the front and begins a new generation
+	void BeginFrame();
+	// Finds room for size bytes, returning false if the frame is full
+	bool Allocate(size_t size, FrameAllocation& allocation);
+
+	size_t GetCapacity() const { return capacity; }
+	size_t GetAlignment() const { return alignment; }
+	// Bytes handed out so far this frame
+	size_t GetUsed() const { return head; }
+	// Starts at 1, so 0 can mean "never allocated"
+	uint32_t GetGeneration() const { return generation; }
+	const FrameAllocatorStats& GetStats() const { return stats; }
+	// The largest frame so far, in bytes
+	size_t GetHighWater() const { return highWater; }
+
+private:
+	size_t capacity;
+	size_t alignment;
+	size_t head = 0;
+	size_t highWater = 0;
+	uint32_t generation;
+	FrameAllocatorStats stats;
+};
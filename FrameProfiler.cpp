@@ -0,0 +1,109 @@
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <fstream>
+#include <cmath>
+
+void FrameProfiler::EndFrame()
+{
+	frames.insert(frames.end(), current, current + FRAME_STAGE_COUNT);
+	std::fill(current, current + FRAME_STAGE_COUNT, 0.0);
+}
+
+void FrameProfiler::Clear()
+{
+	frames.clear();
+	std::fill(current, current + FRAME_STAGE_COUNT, 0.0);
+}
+
+FrameStageSummary FrameProfiler::Summarize(FrameStage stage) const
+{
+	std::vector<double> times(GetFrameCount());
+	for (size_t f = 0; f < times.size(); f++)
+		times[f] = GetTime(f, stage);
+	return SummarizeTimes(times);
+}
+
+FrameStageSummary FrameProfiler::SummarizeTotal() const
+{
+	std::vector<double> times(GetFrameCount(), 0.0);
+	for (size_t f = 0; f < times.size(); f++)
+	{
+		for (int s = 0; s < FRAME_STAGE_COUNT; s++)
+			times[f] += GetTime(f, (FrameStage)s);
+	}
+	return SummarizeTimes(times);
+}
+
+// Nearest rank: the smallest time that at least p% of frames are at or under
+FrameStageSummary FrameProfiler::SummarizeTimes(std::vector<double>& times)
+{
+	FrameStageSummary summary;
+	if (times.empty())
+		return summary;
+
+	std::sort(times.begin(), times.end());
+	auto percentile = [&times](double p)
+	{
+		size_t rank = (size_t)ceil(p / 100.0 * times.size());
+		return times[rank > 0 ? rank - 1 : 0];
+	};
+	double sum = 0;
+	for (size_t i = 0; i < times.size(); i++)
+		sum += times[i];
+	summary.mean = sum / times.size();
+	summary.p50 = percentile(50);
+	summary.p95 = percentile(95);
+	summary.p99 = percentile(99);
+	summary.max = times.back();
+	return summary;
+}
+
+const char* FrameProfiler::GetStageName(FrameStage stage)
+{
+	switch (stage)
+	{
+	case FRAME_STAGE_UPDATE: return "update";
+	case FRAME_STAGE_CULL: return "cull";
+	case FRAME_STAGE_DRAW: return "draw";
+	case FRAME_STAGE_POST_PROCESS: return "postProcess";
+	default: return "unknown";
+	}
+}
+
+bool FrameProfiler::WriteJson(const char* file) const
+{
+	std::ofstream out(file, std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	auto write = [&out](const char* name, const FrameStageSummary& summary, bool last)
+	{
+		out << "\t\t\"" << name << "\": { \"mean\": " << summary.mean << ", \"p50\": " << summary.p50 <<
+			", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max <<
+			" }" << (last ? "\n" : ",\n");
+	};
+	out << "{\n\t\"frames\": " << GetFrameCount() << ",\n\t\"units\": \"ms\",\n\t\"stages\": {\n";
+	for (int s = 0; s < FRAME_STAGE_COUNT; s++)
+		write(GetStageName((FrameStage)s), Summarize((FrameStage)s), false);
+	write("total", SummarizeTotal(), true);
+	out << "\t}\n}\n";
+	return out.good();
+}
+
+bool FrameProfiler::WriteCsv(const char* file) const
+{
+	std::ofstream out(file, std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	auto write = [&out, this](const char* name, const FrameStageSummary& summary)
+	{
+		out << name << "," << GetFrameCount() << "," << summary.mean << "," << summary.p50 << "," <<
+			summary.p95 << "," << summary.p99 << "," << summary.max << "\n";
+	};
+	out << "stage,frames,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+	for (int s = 0; s < FRAME_STAGE_COUNT; s++)
+		write(GetStageName((FrameStage)s), Summarize((FrameStage)s));
+	write("total", SummarizeTotal());
+	return out.good();
+}
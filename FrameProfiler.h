@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <cstddef>
+
+// Parts of a frame that get timed separately
+enum FrameStage
+{
+	// Input, camera, transforms and the scene BVH (Game::Update)
+	FRAME_STAGE_UPDATE,
+	// Frustum and occlusion culling
+	FRAME_STAGE_CULL,
+	// Setting up and submitting every draw, sky included
+	FRAME_STAGE_DRAW,
+	// The full screen post process pass
+	FRAME_STAGE_POST_PROCESS,
+	FRAME_STAGE_COUNT
+};
+
+// Spread of one stage's times over every recorded frame, in milliseconds
+struct FrameStageSummary
+{
+	double mean = 0;
+	double p50 = 0;
+	double p95 = 0;
+	double p99 = 0;
+	double max = 0;
+};
+
+// CPU time of each stage of every frame, for benchmark runs
+// - Stages are timed with Begin and End, then EndFrame keeps the frame
+//   and starts the next one (a stage that didn't run counts as 0)
+// - Summaries use nearest rank percentiles, so p99 is a frame that really happened
+// - Doesn't need DirectX, so it can be built and checked without a GPU
+class FrameProfiler
+{
+public:
+	void Begin(FrameStage stage) { starts[stage] = std::chrono::high_resolution_clock::now(); }
+	void End(FrameStage stage)
+	{
+		current[stage] += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - starts[stage]).count();
+	}
+	void EndFrame();
+	void Clear();
+
+	size_t GetFrameCount() const { return frames.size() / FRAME_STAGE_COUNT; }
+	// Milliseconds a stage took in one recorded frame
+	double GetTime(size_t frame, FrameStage stage) const { return frames[frame * FRAME_STAGE_COUNT + stage]; }
+
+	FrameStageSummary Summarize(FrameStage stage) const;
+	// Every stage added together
+	FrameStageSummary SummarizeTotal() const;
+	static const char* GetStageName(FrameStage stage);
+
+	// Writes the summaries of every stage and the total, returning false if
+	// the file can't be written
+	bool WriteJson(const char* file) const;
+	bool WriteCsv(const char* file) const;
+
+private:
+	std::chrono::high_resolution_clock::time_point starts[FRAME_STAGE_COUNT];
+	double current[FRAME_STAGE_COUNT] = {};
+	// FRAME_STAGE_COUNT times per frame, frame after frame
+	std::vector<double> frames;
+
+	static FrameStageSummary SummarizeTimes(std::vector<double>& times);
+};
@@ -0,0 +1,205 @@
+#include "FrustumCuller.h"
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+// Each plane is a sum or difference of two columns of the matrix
+// - The last column is the clip space w, so x >= -w is w + x >= 0 and so on
+Frustum Frustum::FromMatrix(const XMFLOAT4X4& m)
+{
+	XMVECTOR column[4];
+	for (int c = 0; c < 4; c++)
+		column[c] = XMVectorSet(m.m[0][c], m.m[1][c], m.m[2][c], m.m[3][c]);
+
+	XMVECTOR planes[6] =
+	{
+		XMVectorAdd(column[3], column[0]),		// Left
+		XMVectorSubtract(column[3], column[0]),	// Right
+		XMVectorAdd(column[3], column[1]),		// Bottom
+		XMVectorSubtract(column[3], column[1]),	// Top
+		column[2],								// z >= 0
+		XMVectorSubtract(column[3], column[2])	// z <= w
+	};
+
+	// Normalized so the plane test gives real distances to compare radii to
+	Frustum frustum;
+	for (int p = 0; p < 6; p++)
+	{
+		float length = XMVectorGetX(XMVector3Length(planes[p]));
+		if (length > 1e-6f)
+			XMStoreFloat4(&frustum.planes[p], XMVectorScale(planes[p], 1.0f / length));
+		else
+			frustum.planes[p] = XMFLOAT4(0, 0, 0, 1);
+	}
+	return frustum;
+}
+
+Frustum Frustum::FromCamera(const XMFLOAT4X4& view, const XMFLOAT4X4& proj)
+{
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&proj)));
+	return FromMatrix(viewProj);
+}
+
+// Outside as soon as the whole sphere is behind any one plane
+// - The sum is in the same order as the SIMD version so both round the same way
+bool Frustum::IntersectsSphere(const XMFLOAT3& center, float radius) const
+{
+	for (int p = 0; p < 6; p++)
+	{
+		const XMFLOAT4& plane = planes[p];
+		float distance = center.x * plane.x + (center.y * plane.y + (center.z * plane.z + plane.w));
+		if (distance < -radius)
+			return false;
+	}
+	return true;
+}
+
+void FrustumCuller::Clear()
+{
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	radii.clear();
+	count = 0;
+}
+
+uint32_t FrustumCuller::Add(const XMFLOAT3& center, float radius)
+{
+	// Start a new block of 4, all of them outside until they're used
+	if ((count & 3) == 0)
+	{
+		centerX.resize(count + 4, 0.0f);
+		centerY.resize(count + 4, 0.0f);
+		centerZ.resize(count + 4, 0.0f);
+		radii.resize(count + 4, -FLT_MAX);
+	}
+	uint32_t index = (uint32_t)count++;
+	Set(index, center, radius);
+	return index;
+}
+
+void FrustumCuller::Set(uint32_t index, const XMFLOAT3& center, float radius)
+{
+	centerX[index] = center.x;
+	centerY[index] = center.y;
+	centerZ[index] = center.z;
+	radii[index] = radius;
+}
+
+// Tests 4 spheres against each plane at once, then appends the ones that
+// survived without branching on the result
+size_t FrustumCuller::Cull(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+	// Every sphere could be visible, so make room for all of them up front
+	size_t padded = radii.size();
+	visible.resize(padded);
+	if (padded == 0)
+		return 0;
+
+	// Each plane component copied to all 4 lanes
+	XMVECTOR planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = XMVectorReplicate(frustum.planes[p].x);
+		planeY[p] = XMVectorReplicate(frustum.planes[p].y);
+		planeZ[p] = XMVectorReplicate(frustum.planes[p].z);
+		planeW[p] = XMVectorReplicate(frustum.planes[p].w);
+	}
+
+	uint32_t* out = visible.data();
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < padded; i += 4)
+	{
+		XMVECTOR x = XMLoadFloat4((const XMFLOAT4*)&centerX[i]);
+		XMVECTOR y = XMLoadFloat4((const XMFLOAT4*)&centerY[i]);
+		XMVECTOR z = XMLoadFloat4((const XMFLOAT4*)&centerZ[i]);
+		XMVECTOR negativeRadius = XMVectorNegate(XMLoadFloat4((const XMFLOAT4*)&radii[i]));
+
+		XMVECTOR outside = XMVectorFalseInt();
+		for (int p = 0; p < 6; p++)
+		{
+			XMVECTOR distance = XMVectorMultiplyAdd(x, planeX[p],
+				XMVectorMultiplyAdd(y, planeY[p], XMVectorMultiplyAdd(z, planeZ[p], planeW[p])));
+			outside = XMVectorOrInt(outside, XMVectorLess(distance, negativeRadius));
+		}
+
+		// Always write the index, but only keep it if the sphere was inside
+		uint32_t lanes[4];
+		XMStoreInt4(lanes, outside);
+		for (int l = 0; l < 4; l++)
+		{
+			out[visibleCount] = (uint32_t)(i + l);
+			visibleCount += lanes[l] == 0;
+		}
+	}
+
+	visible.resize(visibleCount);
+	return visibleCount;
+}
+
+size_t FrustumCuller::CullScalar(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+	visible.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		if (frustum.IntersectsSphere(XMFLOAT3(centerX[i], centerY[i], centerZ[i]), radii[i]))
+			visible.push_back((uint32_t)i);
+	}
+	return visible.size();
+}
+
+// Random spheres filling a box around a camera that sees about a tenth of them
+CullBenchmark FrustumCuller::Benchmark(size_t count)
+{
+	CullBenchmark result;
+	result.count = count;
+
+	uint32_t seed = 12345;
+	auto random = [&seed](float lo, float hi)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return lo + (hi - lo) * ((seed >> 8) / 16777216.0f);
+	};
+	FrustumCuller culler;
+	for (size_t i = 0; i < count; i++)
+		culler.Add(XMFLOAT3(random(-500, 500), random(-500, 500), random(-500, 500)), random(0.5f, 5.0f));
+
+	XMFLOAT4X4 view, proj;
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(0, 0, -100, 0), XMVectorSet(0.3f, 0.1f, 1, 0), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f));
+	Frustum frustum = Frustum::FromCamera(view, proj);
+
+	// Both lists are sized before timing, like they would be after the first frame
+	std::vector<uint32_t> scalarVisible, simdVisible;
+	scalarVisible.reserve(count);
+	simdVisible.reserve(count + 4);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	culler.CullScalar(frustum, scalarVisible);
+	result.scalarSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	result.visible = culler.Cull(frustum, simdVisible);
+	result.simdSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	// Both lists are sorted, so walk them together
+	size_t a = 0, b = 0;
+	while (a < scalarVisible.size() || b < simdVisible.size())
+	{
+		if (b == simdVisible.size() || (a < scalarVisible.size() && scalarVisible[a] < simdVisible[b]))
+			a++;
+		else if (a == scalarVisible.size() || simdVisible[b] < scalarVisible[a])
+			b++;
+		else
+		{
+			a++;
+			b++;
+			continue;
+		}
+		result.mismatches++;
+	}
+	return result;
+}
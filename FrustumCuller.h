@@ -0,0 +1,73 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// The six planes of a camera's view volume, all facing inwards
+// - A point is inside a plane (a, b, c, d) when a*x + b*y + c*z + d >= 0
+// - Planes that don't exist (like the far plane of an infinite
+//   projection) are stored as (0, 0, 0, 1), which everything passes
+struct Frustum
+{
+	DirectX::XMFLOAT4 planes[6];
+
+	// Pulls the planes out of a combined view * projection matrix
+	// - "Fast Extraction of Viewing Frustum Planes from the World-View-
+	//   Projection Matrix" (Gribb and Hartmann), for row vectors and a
+	//   0 to 1 clip space depth like Direct3D's
+	static Frustum FromMatrix(const DirectX::XMFLOAT4X4& viewProj);
+	static Frustum FromCamera(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj);
+
+	// One sphere at a time, the same test the culler does 4 at a time
+	bool IntersectsSphere(const DirectX::XMFLOAT3& center, float radius) const;
+};
+
+// Timings from FrustumCuller::Benchmark
+struct CullBenchmark
+{
+	size_t count = 0;
+	// Spheres that were inside the frustum
+	size_t visible = 0;
+	// Testing one sphere at a time
+	double scalarSeconds = 0;
+	// FrustumCuller::Cull
+	double simdSeconds = 0;
+	// Spheres the two ways disagreed on
+	size_t mismatches = 0;
+
+	double Speedup() const { return simdSeconds > 0 ? scalarSeconds / simdSeconds : 0; }
+};
+
+// World space bounding spheres, tested against a frustum 4 at a time
+// - Spheres are kept as separate arrays (structure of arrays) so each SIMD
+//   instruction works on one component of 4 different spheres
+// - The result is a compact list of the visible indices, in order, so the
+//   draw loop only walks what it needs to
+// - Doesn't need DirectX, so it can be built and checked without a GPU
+class FrustumCuller
+{
+public:
+	// Forgets every sphere (keeps the memory for next time)
+	void Clear();
+	// Adds a sphere, returning its index
+	uint32_t Add(const DirectX::XMFLOAT3& center, float radius);
+	// Moves a sphere that was already added
+	void Set(uint32_t index, const DirectX::XMFLOAT3& center, float radius);
+	size_t GetCount() const { return count; }
+
+	// Replaces visible with the index of every sphere touching the frustum,
+	// returning how many there are
+	size_t Cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+	// Same result, one sphere at a time (for checking and timing)
+	size_t CullScalar(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+	// Times both ways of culling a random scene of count spheres
+	static CullBenchmark Benchmark(size_t count);
+
+private:
+	// Padded to a multiple of 4 with spheres that are always outside,
+	// so the last block doesn't need any special handling
+	std::vector<float> centerX, centerY, centerZ, radii;
+	size_t count = 0;
+};
@@ -7,6 +7,8 @@
 // Needed for a helper function to read compiled shader files from the hard drive
 #pragma comment(lib, "d3dcompiler.lib")
 #include <d3dcompiler.h>
+#include <algorithm>
+#include <cfloat>
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -153,6 +155,10 @@ void Game::CreateObjects()
 	entities[6]->GetTransform()->SetPosition(0, 9, 0);
 	entities[6]->GetTransform()->SetScale(20, 1, 20);
 
+	// The room's big pieces hide most of whatever is behind them
+	for (int i = 0; i <= 6; i++)
+		entities[i]->occluder = true;
+
 
 	// Create bench seat
 	entities.push_back(std::shared_ptr<GameEntity>(new GameEntity(meshes[2], materials[0])));
@@ -186,48 +192,40 @@ void Game::CreateObjects()
 	entities[12]->GetTransform()->SetScale(0.25f, 2, 0.25f);
 
 
-	// Create piece holder 1
-	entities.push_back(std::shared_ptr<GameEntity>(new GameEntity(meshes[3], materials[0])));
-	// Move piece holder 1 into place
-	entities[13]->GetTransform()->SetPosition(.5f, .35f, 1.1f);
-	entities[13]->GetTransform()->SetScale(0.25f, 6, 0.25f);
-	// Create piece holder 2
-	entities.push_back(std::shared_ptr<GameEntity>(new GameEntity(meshes[3], materials[0])));
-	// Move piece holder 2 into place
-	entities[14]->GetTransform()->SetPosition(1.1f, .35f, .5f);
-	entities[14]->GetTransform()->SetScale(0.25f, 6, 0.25f);
-	// Create piece holder 3
-	entities.push_back(std::shared_ptr<GameEntity>(new GameEntity(meshes[3], materials[0])));
-	// Move piece holder 3 into place
-	entities[15]->GetTransform()->SetPosition(-1.1f, .35f, -.5f);
-	entities[15]->GetTransform()->SetScale(0.25f, 6, 0.25f);
-	// Create piece holder 4
-	entities.push_back(std::shared_ptr<GameEntity>(new GameEntity(meshes[3], materials[0])));
-	// Move piece holder 4 into place
-	entities[16]->GetTransform()->SetPosition(-.5f, .35f, -1.1f);
-	entities[16]->GetTransform()->SetScale(0.25f, 6, 0.25f);
-
-
-	// Create abstract piece 1
-	entities.push_back(std::shared_ptr<GameEntity>(new GameEntity(meshes[0], materials[2])));
-	// Move piece holder 1 into place
-	entities[17]->GetTransform()->SetPosition(-.5, 3.5f, -1.1f);
-	entities[17]->GetTransform()->SetScale(0.45f, 0.45f, 0.45f);
-	// Create abstract piece 2
-	entities.push_back(std::shared_ptr<GameEntity>(new GameEntity(meshes[0], materials[2])));
-	// Move piece holder 2 into place
-	entities[18]->GetTransform()->SetPosition(.5, 3.5f, 1.1f);
-	entities[18]->GetTransform()->SetScale(0.45f, 0.45f, 0.45f);
-	// Create abstract piece 3
-	entities.push_back(std::shared_ptr<GameEntity>(new GameEntity(meshes[0], materials[2])));
-	// Move piece holder 3 into place
-	entities[19]->GetTransform()->SetPosition(-1.1, 3.5f, -0.5f);
-	entities[19]->GetTransform()->SetScale(0.45f, 0.45f, 0.45f);
-	// Create abstract piece 4
-	entities.push_back(std::shared_ptr<GameEntity>(new GameEntity(meshes[0], materials[2])));
-	// Move piece holder 4 into place
-	entities[20]->GetTransform()->SetPosition(1.1, 3.5f, 0.5f);
-	entities[20]->GetTransform()->SetScale(0.45f, 0.45f, 0.45f);
+	// The display around the center pillar
+	// - Each corner has a pivot, and the piece holder and piece are placed
+	//   relative to it, so moving a pivot (or the whole stand) moves both
+	displayStand = std::make_shared<Transform>();
+	const XMFLOAT2 corners[4] = { XMFLOAT2(.5f, 1.1f), XMFLOAT2(1.1f, .5f), XMFLOAT2(-1.1f, -.5f), XMFLOAT2(-.5f, -1.1f) };
+	for (int i = 0; i < 4; i++)
+	{
+		displayPivots.push_back(std::make_shared<Transform>());
+		displayPivots[i]->SetParent(displayStand.get());
+		displayPivots[i]->SetPosition(corners[i].x, 0, corners[i].y);
+	}
+
+	// Create piece holders 1 to 4
+	for (int i = 0; i < 4; i++)
+	{
+		std::shared_ptr<GameEntity> holder(new GameEntity(meshes[3], materials[0]));
+		// Move piece holder into place
+		holder->GetTransform()->SetParent(displayPivots[i].get());
+		holder->GetTransform()->SetPosition(0, .35f, 0);
+		holder->GetTransform()->SetScale(0.25f, 6, 0.25f);
+		entities.push_back(holder);
+	}
+
+	// Create abstract pieces 1 to 4, each on top of a holder
+	const int pieceCorners[4] = { 3, 0, 2, 1 };
+	for (int i = 0; i < 4; i++)
+	{
+		std::shared_ptr<GameEntity> piece(new GameEntity(meshes[0], materials[2]));
+		// Move piece into place
+		piece->GetTransform()->SetParent(displayPivots[pieceCorners[i]].get());
+		piece->GetTransform()->SetPosition(0, 3.5f, 0);
+		piece->GetTransform()->SetScale(0.45f, 0.45f, 0.45f);
+		entities.push_back(piece);
+	}
 }
 
 // --------------------------------------------------------
@@ -242,6 +240,13 @@ void Game::Init()
 	LoadShaders();
 	CreateBasicGeometry();
 
+#if defined(DEBUG) || defined(_DEBUG)
+	// Report whether shader reflection came from the sidecar files
+	const SimpleReflectionStats& reflectionStats = ISimpleShader::GetReflectionStats();
+	printf("Shaders: %zu loaded from reflection sidecars, %zu reflected (%zu sidecars saved) in %.3fms\n",
+		reflectionStats.cacheLoads, reflectionStats.reflections, reflectionStats.cacheWrites, reflectionStats.seconds * 1000.0);
+#endif
+
 	// Create sampler state description
 	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
 	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
@@ -297,6 +302,9 @@ void Game::Init()
 	materials.push_back(std::shared_ptr<Material>(new Material(XMFLOAT4(1, 1, 1, 0), 256, pixelShaderNormals, vertexShaderNormals, texture5SRV, texture6SRV, texture7SRV, texture8SRV, samplerState)));
 	materials.push_back(std::shared_ptr<Material>(new Material(XMFLOAT4(1, 1, 1, 0), 256, pixelShaderNormals, vertexShaderNormals, texture9SRV, texture10SRV, texture11SRV, texture12SRV, samplerState)));
 	materials.push_back(std::shared_ptr<Material>(new Material(XMFLOAT4(1, 1, 1, 0), 256, pixelShaderNormals, vertexShaderNormals, texture13SRV, texture14SRV, texture15SRV, texture16SRV, samplerState)));
+	// Let every material draw packed meshes too
+	for (size_t i = 0; i < materials.size(); i++)
+		materials[i]->SetPackedVertexShader(vertexShaderNormalsPacked);
 	
 	// Create the sky
 	sky = std::shared_ptr<Sky>(new Sky(meshes[2], samplerState, device, cubeTexSRV, pixelShaderSky, vertexShaderSky));
@@ -324,6 +332,14 @@ void Game::Init()
 
 	// Add the camera away from the objects
 	camera = std::shared_ptr<Camera> (new Camera(XMFLOAT3(6.25f, 6, -6.75f), XMFLOAT3(.1f, -3.141592f / 4, 0), ((float)this->width / this->height), 1, 1, 1000, 3, 3));
+	// Reverse-Z, which keeps depth precise all the way out (and needs the
+	// depth test flipped to match)
+	camera->SetReverseZ(true);
+	D3D11_DEPTH_STENCIL_DESC depthDesc = {};
+	depthDesc.DepthEnable = true;
+	depthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	depthDesc.DepthFunc = D3D11_COMPARISON_GREATER;
+	device->CreateDepthStencilState(&depthDesc, reverseZDepthState.GetAddressOf());
 
 	// Set up the original directional light
 	dLight.ambientColor = XMFLOAT3(0.01f, 0.01f, 0.1f);
@@ -356,6 +372,8 @@ void Game::LoadShaders()
 
 	// New vertex shader that has normals
 	vertexShaderNormals = std::shared_ptr<SimpleVertexShader>(new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"VertexShaderNormals.cso").c_str()));
+	// Same thing for meshes stored as PackedVertex
+	vertexShaderNormalsPacked = std::shared_ptr<SimpleVertexShader>(new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"VertexShaderNormalsPacked.cso").c_str()));
 	// New pixel shader that has normals
 	pixelShaderNormals = std::shared_ptr<SimplePixelShader>(new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"PixelShaderNormals.cso").c_str()));
 
@@ -372,6 +390,21 @@ void Game::LoadShaders()
 	vertexShaderSky = std::shared_ptr<SimpleVertexShader>(new SimpleVertexShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"VertexShaderSky.cso").c_str()));
 	// Skybox specific pixel shader
 	pixelShaderSky = std::shared_ptr<SimplePixelShader>(new SimplePixelShader(device.Get(), context.Get(), GetFullPathTo_Wide(L"PixelShaderSky.cso").c_str()));
+
+	// The shaders entities draw with copy their constants into one shared
+	// buffer, if the device can bind constant buffers by offset
+	// - The sky and post process only draw once a frame, so they keep their own
+	constantAllocator = std::shared_ptr<SimpleConstantAllocator>(new SimpleConstantAllocator(device.Get(), context.Get()));
+	if (constantAllocator->IsValid())
+	{
+		std::shared_ptr<ISimpleShader> entityShaders[] =
+		{
+			vertexShader, pixelShader, vertexShaderNormals, vertexShaderNormalsPacked,
+			pixelShaderNormals, pixelToon, pixelStipple
+		};
+		for (size_t i = 0; i < sizeof(entityShaders) / sizeof(entityShaders[0]); i++)
+			entityShaders[i]->SetConstantAllocator(constantAllocator.get());
+	}
 }
 
 
@@ -381,13 +414,69 @@ void Game::LoadShaders()
 // --------------------------------------------------------
 void Game::CreateBasicGeometry()
 {
-	meshes.push_back(std::shared_ptr<Mesh>(new Mesh(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), device)));
-	meshes.push_back(std::shared_ptr<Mesh>(new Mesh(GetFullPathTo("../../Assets/Models/cone.obj").c_str(), device)));
-	meshes.push_back(std::shared_ptr<Mesh>(new Mesh(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), device)));
-	meshes.push_back(std::shared_ptr<Mesh>(new Mesh(GetFullPathTo("../../Assets/Models/cylinder.obj").c_str(), device)));
-	meshes.push_back(std::shared_ptr<Mesh>(new Mesh(GetFullPathTo("../../Assets/Models/helix.obj").c_str(), device)));
-	meshes.push_back(std::shared_ptr<Mesh>(new Mesh(GetFullPathTo("../../Assets/Models/torus.obj").c_str(), device)));
+	// Options every mesh is loaded with
+	unsigned int loadFlags = MESH_LOAD_OPTIMIZE | MESH_LOAD_MESHLETS | MESH_LOAD_LODS;
+
+	// Everything but the cube is packed, since the sky draws the cube
+	// with its own vertex shader that expects full vertices
+	meshes.push_back(std::shared_ptr<Mesh>(new Mesh(GetFullPathTo("../../Assets/Models/sphere.obj").c_str(), device, loadFlags | MESH_LOAD_PACK)));
+	meshes.push_back(std::shared_ptr<Mesh>(new Mesh(GetFullPathTo("../../Assets/Models/cone.obj").c_str(), device, loadFlags | MESH_LOAD_PACK)));
+	meshes.push_back(std::shared_ptr<Mesh>(new Mesh(GetFullPathTo("../../Assets/Models/cube.obj").c_str(), device, loadFlags | MESH_LOAD_OCCLUDER)));
+	meshes.push_back(std::shared_ptr<Mesh>(new Mesh(GetFullPathTo("../../Assets/Models/cylinder.obj").c_str(), device, loadFlags | MESH_LOAD_PACK)));
+	meshes.push_back(std::shared_ptr<Mesh>(new Mesh(GetFullPathTo("../../Assets/Models/helix.obj").c_str(), device, loadFlags | MESH_LOAD_PACK)));
+	meshes.push_back(std::shared_ptr<Mesh>(new Mesh(GetFullPathTo("../../Assets/Models/torus.obj").c_str(), device, loadFlags | MESH_LOAD_PACK)));
 
+#if defined(DEBUG) || defined(_DEBUG)
+	// Report how quickly the meshes were loaded, and whether they came from a bake
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		MeshLoadStats stats = meshes[i]->GetLoadStats();
+		if (stats.fromCache)
+		{
+			printf("Mesh %zu: loaded %zu baked bytes in %.3fms\n",
+				i, stats.cacheBytes, stats.seconds * 1000.0);
+		}
+		else
+		{
+			printf("Mesh %zu: parsed %zu bytes in %.3fms (%.1f MB/s, %u threads), loaded in %.3fms\n",
+				i, stats.parse.bytes, stats.parse.seconds * 1000.0, stats.parse.MegabytesPerSecond(), stats.parse.threads,
+				stats.seconds * 1000.0);
+			printf("        tangents in %.3fms (%u threads, %zu degenerate triangles)\n",
+				stats.tangents.seconds * 1000.0, stats.tangents.threads, stats.tangents.degenerateTriangles);
+		}
+		printf("        %d unique vertices for %d %u-bit indices (%.2fx fewer vertices)\n",
+			meshes[i]->GetVertexCount(), meshes[i]->GetIndexCount(), meshes[i]->GetIndexSize() * 8, meshes[i]->GetVertexReductionRatio());
+		if (stats.optimized)
+		{
+			printf("        ACMR %.3f -> %.3f, ATVR %.3f -> %.3f%s\n",
+				stats.optimize.before.acmr, stats.optimize.after.acmr,
+				stats.optimize.before.atvr, stats.optimize.after.atvr,
+				stats.optimize.overdrawApplied ? " (overdraw order kept)" : "");
+		}
+		if (stats.meshlets.meshletCount > 0)
+		{
+			printf("        %zu meshlets in %.3fms (%.0f%% vertex fill, %.0f%% triangle fill)\n",
+				stats.meshlets.meshletCount, stats.meshlets.seconds * 1000.0,
+				stats.meshlets.vertexFill * 100.0f, stats.meshlets.triangleFill * 100.0f);
+		}
+		if (!stats.fromCache && stats.lods.lodCount > 0)
+		{
+			printf("        %zu LODs in %.3fms (%zu vertices locked on borders)\n",
+				stats.lods.lodCount, stats.lods.seconds * 1000.0, stats.lods.lockedVertices);
+		}
+		for (int l = 1; l < meshes[i]->GetLodCount(); l++)
+		{
+			const MeshLod& lod = meshes[i]->GetLod(l);
+			printf("        LOD %d: %u triangles, error %g\n", l, lod.indexCount / 3, lod.error);
+		}
+		if (stats.packed)
+		{
+			printf("        packed %zu -> %zu bytes (%.2fx smaller), max error: position %g, normal %.3f deg, tangent %.3f deg, uv %g\n",
+				stats.packing.fullBytes, stats.packing.packedBytes, stats.packing.SavingsRatio(),
+				stats.packing.maxPositionError, stats.packing.maxNormalError, stats.packing.maxTangentError, stats.packing.maxUVError);
+		}
+	}
+#endif
 }
 
 
@@ -413,8 +502,52 @@ void Game::OnResize()
 // Method for switching between post processing types
 void Game::InputCheck()
 {
+	Input& input = Input::Default();
+#if defined(DEBUG) || defined(_DEBUG)
+	// What the last frame did
+	// - Anything that has to time a lot of work (shader setters, big
+	//   scenes) is in the Benchmarks program, so pressing this never
+	//   stalls the game
+	if (input.WasKeyPressed('B'))
+	{
+		const SimpleUploadStats& uploads = ISimpleShader::GetUploadStats();
+		printf("Last frame: %zu constant buffer uploads (%zu bytes), %zu skipped as unchanged\n",
+			uploads.uploads, uploads.bytesUploaded, uploads.skipped);
+		if (constantAllocator->IsValid())
+		{
+			const FrameAllocator& frameConstants = constantAllocator->GetAllocator();
+			printf("Shared constants: %zu slices, %zu of %zu bytes (most ever %zu), %zu overflowed\n",
+				frameConstants.GetStats().allocations, frameConstants.GetStats().bytes, frameConstants.GetCapacity(),
+				frameConstants.GetHighWater(), frameConstants.GetStats().overflows);
+		}
+		const StateCacheStats& binds = pixelShader->GetStateCache().GetStats();
+		printf("Last frame: %zu state changes sent to the context, %zu filtered as already bound (%.0f%%)\n",
+			binds.issued, binds.filtered, binds.FilteredShare() * 100);
+		const OcclusionStats& occlusionStats = occlusionCuller.GetStats();
+		printf("Occlusion: %zu occluder triangles, %zu of %zu tested entities hidden\n",
+			occlusionStats.occluderTriangles, occlusionStats.occluded, occlusionStats.tested);
+		const SceneBVHStats& stats = sceneBVH.GetStats();
+		printf("%zu of %zu entities visible (BVH: %zu nodes, depth %zu, cost %.2f, %zu refits, %zu rebuilds)\n",
+			visibleEntities.size(), entities.size(), stats.nodeCount, stats.depth, stats.cost, stats.refits, stats.rebuilds);
+	}
+
+	// Pick whatever is under the mouse on a right click
+	if (input.WasKeyPressed(INPUT_KEY_RBUTTON))
+	{
+		XMINT2 mouse = camera->GetMousePosition();
+		XMFLOAT3 origin, direction;
+		camera->GetPickRay((float)mouse.x, (float)mouse.y, (float)width, (float)height, origin, direction);
+		uint32_t picked;
+		float distance;
+		if (sceneBVH.Raycast(origin, direction, FLT_MAX, picked, distance))
+			printf("Picked entity %u at a depth of %.2f\n", picked, distance);
+		else
+			printf("Picked nothing\n");
+	}
+#endif
+
 	// Check for input to switch shaders
-	if (GetAsyncKeyState('1') & 0x8000)
+	if (input.IsKeyDown('1'))
 	{
 		postProcessing = false;
 		stipple = false;
@@ -423,7 +556,7 @@ void Game::InputCheck()
 			materials[i]->SetPixelShader(pixelShaderNormals);
 		}
 	}
-	if (GetAsyncKeyState('2') & 0x8000)
+	if (input.IsKeyDown('2'))
 	{
 		// Enable toon shading
 		postProcessing = true;
@@ -436,7 +569,7 @@ void Game::InputCheck()
 			materials[i]->SetPixelShader(pixelToon);
 		}
 	}
-	if (GetAsyncKeyState('3') & 0x8000)
+	if (input.IsKeyDown('3'))
 	{
 		// Enable toon shading
 		postProcessing = true;
@@ -449,7 +582,7 @@ void Game::InputCheck()
 			materials[i]->SetPixelShader(pixelToon);
 		}
 	}
-	if (GetAsyncKeyState('4') & 0x8000)
+	if (input.IsKeyDown('4'))
 	{
 		// Enable toon shading
 		postProcessing = true;
@@ -463,7 +596,7 @@ void Game::InputCheck()
 			materials[i]->SetPixelShader(pixelToon);
 		}
 	}
-	if (GetAsyncKeyState('5') & 0x8000)
+	if (input.IsKeyDown('5'))
 	{
 		// Enable toon shading
 		postProcessing = true;
@@ -477,7 +610,7 @@ void Game::InputCheck()
 			materials[i]->SetPixelShader(pixelToon);
 		}
 	}
-	if (GetAsyncKeyState('6') & 0x8000)
+	if (input.IsKeyDown('6'))
 	{
 		// Enable toon shading
 		postProcessing = true;
@@ -492,20 +625,97 @@ void Game::InputCheck()
 	}
 }
 
+// Only entities whose world matrix changed get a new box, and anything
+// new is added (which rebuilds the tree)
+void Game::UpdateSceneBVH()
+{
+	for (size_t i = 0; i < entities.size(); i++)
+	{
+		uint32_t version = entities[i]->transform.GetWorldVersion();
+		if (i < sceneBVH.GetCount() && entityVersions[i] == version)
+			continue;
+		sceneVersion++;
+
+		XMFLOAT3 boxMin, boxMax;
+		entities[i]->GetWorldBox(boxMin, boxMax);
+		if (i < sceneBVH.GetCount())
+		{
+			sceneBVH.Update((uint32_t)i, boxMin, boxMax);
+			entityVersions[i] = version;
+		}
+		else
+		{
+			sceneBVH.Add(boxMin, boxMax);
+			entityVersions.push_back(version);
+		}
+	}
+	sceneBVH.Refit();
+}
+
+// Rasterizes the visible occluders on the CPU, then drops every visible
+// entity that's entirely behind them
+void Game::CullOccludedEntities()
+{
+	occlusionCuller.BeginFrame(camera->GetViewProjMatrix());
+	for (size_t v = 0; v < visibleEntities.size(); v++)
+	{
+		GameEntity* entity = entities[visibleEntities[v]].get();
+		const std::vector<XMFLOAT3>& positions = entity->mesh->GetOccluderPositions();
+		const std::vector<uint32_t>& indices = entity->mesh->GetOccluderIndices();
+		if (!entity->occluder || indices.empty())
+			continue;
+		occlusionCuller.AddOccluder(&positions[0], positions.size(), &indices[0], indices.size(),
+			entity->transform.GetWorldMatrix());
+	}
+	occlusionCuller.Rasterize();
+
+	// Keeps the order, so they still draw in the order they were made
+	size_t kept = 0;
+	for (size_t v = 0; v < visibleEntities.size(); v++)
+	{
+		XMFLOAT3 boxMin, boxMax;
+		entities[visibleEntities[v]]->GetWorldBox(boxMin, boxMax);
+		if (!occlusionCuller.IsOccluded(boxMin, boxMax))
+			visibleEntities[kept++] = visibleEntities[v];
+	}
+	visibleEntities.resize(kept);
+}
+
+bool Game::StartFlythrough(const char* pathFile, const char* summaryFile)
+{
+	return flythrough.Start(pathFile, summaryFile);
+}
+
 // --------------------------------------------------------
 // Update your game here - user input, move objects, AI, etc.
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	FrameProfiler& profiler = flythrough.GetProfiler();
+	profiler.Begin(FRAME_STAGE_UPDATE);
+
+	// Take this frame's input (which may be a replay, and may change the frame time)
+	Input& input = Input::Default();
+	deltaTime = input.BeginFrame(deltaTime, hWnd);
+
 	// Check for input to switch shaders
 	InputCheck();
 
-	// Update camera
-	camera->Update(deltaTime, this->hWnd);
+	// Update camera, from the path when running a flythrough
+	bool flythroughOver = false;
+	if (flythrough.IsRunning())
+		flythroughOver = !flythrough.Step(*camera);
+	else
+		camera->Update(deltaTime);
+
+	// Rebuild every world matrix that changed this frame in one pass
+	TransformStore::Default().UpdateWorldMatrices();
+	UpdateSceneBVH();
 
-	// Quit if the escape key is pressed
-	if (GetAsyncKeyState(VK_ESCAPE))
+	// Quit if the escape key is pressed, or a replay or flythrough is over
+	if (input.IsKeyDown(INPUT_KEY_ESCAPE) || input.IsReplayFinished() || flythroughOver)
 		Quit();
+	profiler.End(FRAME_STAGE_UPDATE);
 }
 
 // --------------------------------------------------------
@@ -516,6 +726,12 @@ void Game::Draw(float deltaTime, float totalTime)
 	// Background color (Cornflower Blue in this case) for clearing
 	const float color[4] = { 0.4f, 0.6f, 0.75f, 0.0f };
 
+	// Count this frame's constant buffer uploads and state changes from
+	// zero, and start the shared constant buffer over
+	ISimpleShader::ResetUploadStats();
+	pixelShader->GetStateCache().ResetStats();
+	constantAllocator->BeginFrame();
+
 	// Clear the render target and depth buffer (erases what's on the screen)
 	//  - Do this ONCE PER FRAME
 	//  - At the beginning of Draw (before drawing *anything*)
@@ -523,8 +739,9 @@ void Game::Draw(float deltaTime, float totalTime)
 	context->ClearDepthStencilView(
 		depthStencilView.Get(),
 		D3D11_CLEAR_DEPTH,
-		1.0f,
+		camera->GetFarDepth(),
 		0);
+	context->OMSetDepthStencilState(camera->GetReverseZ() ? reverseZDepthState.Get() : nullptr, 0);
 
 	// Set up post processing rendering
 	if (postProcessing)
@@ -546,36 +763,57 @@ void Game::Draw(float deltaTime, float totalTime)
 	}
 
 	
-	// Draw all game entities
-	for (size_t i = 0; i < entities.size(); i++)
+	// Find the entities inside the camera's view
+	// - Sorted so they still draw in the order they were made
+	// - Last frame's answer still holds if neither the camera nor anything
+	//   in the scene moved
+	FrameProfiler& profiler = flythrough.GetProfiler();
+	profiler.Begin(FRAME_STAGE_CULL);
+	if (camera->GetVersion() != culledCameraVersion || sceneVersion != culledSceneVersion)
 	{
+		sceneBVH.QueryFrustum(camera->GetFrustum(), visibleEntities);
+		std::sort(visibleEntities.begin(), visibleEntities.end());
+		CullOccludedEntities();
+		culledCameraVersion = camera->GetVersion();
+		culledSceneVersion = sceneVersion;
+	}
+	profiler.End(FRAME_STAGE_CULL);
+
+	// Draw the game entities that can be seen
+	profiler.Begin(FRAME_STAGE_DRAW);
+	for (size_t v = 0; v < visibleEntities.size(); v++)
+	{
+		size_t i = visibleEntities[v];
 		// Send in lights to the shader
-		entities[i]->material->GetPixelShader()->SetData("dLight", &dLight, sizeof(DirectionalLight));
-		entities[i]->material->GetPixelShader()->SetData("pLight", &pLight, sizeof(PointLight));
-		entities[i]->material->GetPixelShader()->SetFloat3("cameraPos", camera->transform.GetPosition());
-		entities[i]->material->GetPixelShader()->SetFloat("specExponent", entities[i]->material->GetSpecularExponent());
+		// - Names are hashed at compile time, since this runs for every entity
+		entities[i]->material->GetPixelShader()->SetData("dLight"_ssn, &dLight, sizeof(DirectionalLight));
+		entities[i]->material->GetPixelShader()->SetData("pLight"_ssn, &pLight, sizeof(PointLight));
+		entities[i]->material->GetPixelShader()->SetFloat3("cameraPos"_ssn, camera->transform.GetPosition());
+		entities[i]->material->GetPixelShader()->SetFloat("specExponent"_ssn, entities[i]->material->GetSpecularExponent());
 		// Send in textures
-		entities[i]->material->GetPixelShader()->SetShaderResourceView("Albedo", entities[i]->material->GetDiffuseSRV().Get());
-		entities[i]->material->GetPixelShader()->SetShaderResourceView("MetalnessMap", entities[i]->material->GetMetalSRV().Get());
-		entities[i]->material->GetPixelShader()->SetShaderResourceView("RoughnessMap", entities[i]->material->GetRoughSRV().Get());
-		entities[i]->material->GetPixelShader()->SetShaderResourceView("ShadowChart", shadowSRV.Get());
+		entities[i]->material->GetPixelShader()->SetShaderResourceView("Albedo"_ssn, entities[i]->material->GetDiffuseSRV().Get());
+		entities[i]->material->GetPixelShader()->SetShaderResourceView("MetalnessMap"_ssn, entities[i]->material->GetMetalSRV().Get());
+		entities[i]->material->GetPixelShader()->SetShaderResourceView("RoughnessMap"_ssn, entities[i]->material->GetRoughSRV().Get());
+		entities[i]->material->GetPixelShader()->SetShaderResourceView("ShadowChart"_ssn, shadowSRV.Get());
 		// Check for if it has a normal
 		if (entities[i]->material->GetNormalsSRV() != nullptr)
 		{
-			entities[i]->material->GetPixelShader()->SetShaderResourceView("NormalMap", entities[i]->material->GetNormalsSRV().Get());
+			entities[i]->material->GetPixelShader()->SetShaderResourceView("NormalMap"_ssn, entities[i]->material->GetNormalsSRV().Get());
 		}
-		entities[i]->material->GetPixelShader()->SetSamplerState("samplerOptions", samplerState.Get());
-		entities[i]->material->GetPixelShader()->SetSamplerState("samplerState2", samplerState2.Get());
+		entities[i]->material->GetPixelShader()->SetSamplerState("samplerOptions"_ssn, samplerState.Get());
+		entities[i]->material->GetPixelShader()->SetSamplerState("samplerState2"_ssn, samplerState2.Get());
 		// Send the data actually into the shader
 		entities[i]->material->GetPixelShader()->CopyAllBufferData();
-		entities[i]->Draw(context, camera);
+		entities[i]->Draw(context, camera, (float)height);
 	}
 
 	// Draw the sky
 	sky->Draw(context, camera);
+	profiler.End(FRAME_STAGE_DRAW);
 
 
 	// Render post processing
+	profiler.Begin(FRAME_STAGE_POST_PROCESS);
 	if (postProcessing)
 	{
 		// Now that the scene is rendered, swap to the back buffer
@@ -613,9 +851,17 @@ void Game::Draw(float deltaTime, float totalTime)
 		// "figure out" on the fly (resulting in our "full screen triangle")
 		context->Draw(3, 0);
 	}
+	profiler.End(FRAME_STAGE_POST_PROCESS);
 
 	ID3D11ShaderResourceView* nullSRVs[16] = {};
 	context->PSSetShaderResources(0, 16, nullSRVs);
+	pixelShader->GetStateCache().InvalidateShaderResourceViews(STATE_STAGE_PIXEL, 0, 16);
+
+	// Keep this frame's timings when benchmarking, otherwise throw them away
+	if (flythrough.IsRunning())
+		profiler.EndFrame();
+	else
+		profiler.Clear();
 
 
 	// Present the back buffer to the user
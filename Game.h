@@ -6,6 +6,9 @@
 #include "Lights.h"
 #include "Camera.h"
 #include "Sky.h"
+#include "SceneBVH.h"
+#include "OcclusionCuller.h"
+#include "Flythrough.h"
 #include <DirectXMath.h>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 #include <vector>
@@ -27,6 +30,10 @@ public:
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
 
+	// Flies the camera along a path file instead of taking input, then
+	// writes the frame timings to summaryFile and quits
+	bool StartFlythrough(const char* pathFile, const char* summaryFile);
+
 private:
 
 	// Initialization helper methods - feel free to customize, combine, etc.
@@ -34,6 +41,10 @@ private:
 	void CreateBasicGeometry();
 	void ResizePostProcessResources();
 	void InputCheck();
+	// Refits the scene BVH around any entities that moved
+	void UpdateSceneBVH();
+	// Drops visible entities that are hidden behind the occluders
+	void CullOccludedEntities();
 
 	
 	// Note the usage of ComPtr below
@@ -50,6 +61,7 @@ private:
 	std::shared_ptr<SimpleVertexShader> vertexShader;
 	std::shared_ptr<SimplePixelShader> pixelShaderNormals;
 	std::shared_ptr<SimpleVertexShader> vertexShaderNormals;
+	std::shared_ptr<SimpleVertexShader> vertexShaderNormalsPacked;
 	std::shared_ptr<SimplePixelShader> pixelShaderSky;
 	std::shared_ptr<SimpleVertexShader> vertexShaderSky;
 
@@ -58,12 +70,33 @@ private:
 	std::shared_ptr<SimplePixelShader> pixelStipple;
 	std::shared_ptr<SimplePixelShader> pixelPostProcess;
 	std::shared_ptr<SimpleVertexShader> postProcessVS;
+	// One big constant buffer shared by the shaders used for every entity
+	std::shared_ptr<SimpleConstantAllocator> constantAllocator;
 
 	// CBuffer
 	//	Microsoft::WRL::ComPtr<ID3D11Buffer> constantBufferVS;
 
 	std::vector<std::shared_ptr<Mesh>> meshes;
 	std::vector<std::shared_ptr<GameEntity>> entities;
+	// Boxes around the entities (item i is entities[i]), for culling and picking
+	SceneBVH sceneBVH;
+	// World matrix version each entity's box was last made from
+	std::vector<uint32_t> entityVersions;
+	// Entities the camera can see this frame
+	std::vector<uint32_t> visibleEntities;
+	// Goes up whenever an entity's box changes
+	uint32_t sceneVersion = 1;
+	// Camera and scene versions visibleEntities was worked out for
+	uint32_t culledCameraVersion = 0;
+	uint32_t culledSceneVersion = 0;
+	// CPU depth buffer of the big occluders, for skipping hidden entities
+	OcclusionCuller occlusionCuller;
+	// Scripted camera run, when benchmarking
+	Flythrough flythrough;
+	// Transforms that only exist to group entities
+	// - The stand holds the four display pillars, each with a piece on top
+	std::shared_ptr<Transform> displayStand;
+	std::vector<std::shared_ptr<Transform>> displayPivots;
 	std::vector<std::shared_ptr<Material>> materials;
 	std::shared_ptr<Camera> camera;
 
@@ -96,6 +129,9 @@ private:
 	DirectionalLight dLight;
 	PointLight pLight;
 
+	// Depth test for a reverse-Z camera (nearer is larger)
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> reverseZDepthState;
+
 	// Skybox
 	std::shared_ptr<Sky> sky;
 
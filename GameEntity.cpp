@@ -1,4 +1,5 @@
 #include "GameEntity.h"
+#include <cmath>
 
 // Constructor that brings in the mesh
 GameEntity::GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material)
@@ -7,6 +8,9 @@ GameEntity::GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> mat
 	this->mesh = mesh;
 	// Assign material
 	this->material = material;
+	// About a pixel of error is hard to spot
+	maxLodError = 1.0f;
+	occluder = false;
 }
 
 // Return mesh pointer
@@ -21,22 +25,92 @@ Transform* GameEntity::GetTransform()
 	return &transform;
 }
 
-void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera)
+// Moves the mesh's bounding sphere into world space
+void GameEntity::GetWorldBounds(XMFLOAT3& center, float& radius)
+{
+	XMFLOAT3 localCenter = mesh->GetBoundsCenter();
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+	XMStoreFloat3(&center, XMVector3Transform(XMLoadFloat3(&localCenter), worldMatrix));
+	radius = mesh->GetBoundsRadius() * GetMaxScale(world);
+}
+
+// Transforms the box's center, and works out how far the rotated box
+// reaches along each world axis from the absolute values of the matrix
+void GameEntity::GetWorldBox(XMFLOAT3& boxMin, XMFLOAT3& boxMax)
+{
+	XMFLOAT3 localMin = mesh->GetBoundsMin();
+	XMFLOAT3 localMax = mesh->GetBoundsMax();
+	XMVECTOR lo = XMLoadFloat3(&localMin);
+	XMVECTOR hi = XMLoadFloat3(&localMax);
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+
+	XMVECTOR center = XMVector3Transform(XMVectorScale(XMVectorAdd(lo, hi), 0.5f), worldMatrix);
+	XMVECTOR extent = XMVectorScale(XMVectorSubtract(hi, lo), 0.5f);
+	XMVECTOR reach = XMVectorMultiply(XMVectorSplatX(extent), XMVectorAbs(worldMatrix.r[0]));
+	reach = XMVectorMultiplyAdd(XMVectorSplatY(extent), XMVectorAbs(worldMatrix.r[1]), reach);
+	reach = XMVectorMultiplyAdd(XMVectorSplatZ(extent), XMVectorAbs(worldMatrix.r[2]), reach);
+	XMStoreFloat3(&boxMin, XMVectorSubtract(center, reach));
+	XMStoreFloat3(&boxMax, XMVectorAdd(center, reach));
+}
+
+// Length of the longest axis of a world matrix
+float GameEntity::GetMaxScale(const XMFLOAT4X4& world)
+{
+	float x = world._11 * world._11 + world._12 * world._12 + world._13 * world._13;
+	float y = world._21 * world._21 + world._22 * world._22 + world._23 * world._23;
+	float z = world._31 * world._31 + world._32 * world._32 + world._33 * world._33;
+	return sqrtf(fmaxf(x, fmaxf(y, z)));
+}
+
+// Projects each LOD's error onto the screen at the nearest point of the
+// mesh's bounding sphere, and takes the coarsest one that stays small enough
+int GameEntity::SelectLod(std::shared_ptr<Camera> camera, float viewportHeight)
+{
+	if (mesh->GetLodCount() < 2)
+		return 0;
+
+	XMFLOAT3 center;
+	float radius;
+	GetWorldBounds(center, radius);
+
+	// Inside the sphere means something could be right in front of the camera
+	XMFLOAT3 cameraPosition = camera->transform.GetPosition();
+	float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&center), XMLoadFloat3(&cameraPosition)))) - radius;
+	if (distance <= 0.0f)
+		return 0;
+
+	// Pixels covered by one object space unit at that distance
+	// - The projection's _22 is 1 / tan(fov / 2), which maps a unit at
+	//   distance 1 to half the viewport height
+	XMFLOAT4X4 proj = camera->GetProjMatrix();
+	float pixelsPerUnit = proj._22 * viewportHeight * 0.5f * GetMaxScale(transform.GetWorldMatrix()) / distance;
+	return mesh->SelectLod(pixelsPerUnit, maxLodError);
+}
+
+void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera, float viewportHeight)
 {
 	// Set the vertex and pixel shaders to use for the next Draw() command
 	//  - These don't technically need to be set every frame
 	//  - Once you start applying different shaders to different objects,
 	//    you'll need to swap the current shaders before each draw
-	material->GetVertexShader()->SetShader();
+	std::shared_ptr<SimpleVertexShader> vs = material->GetVertexShader(mesh->GetVertexFormat());
+	vs->SetShader();
 	material->GetPixelShader()->SetShader();
 
 	// Constant Buffer defined data
-	std::shared_ptr<SimpleVertexShader> vs = material->GetVertexShader(); 
-	vs->SetFloat4("colorTint", material->GetColorTint());
-	vs->SetMatrix4x4("worldMatrix", transform.GetWorldMatrix());
+	// - Names are hashed at compile time, since this runs for every entity
+	vs->SetFloat4("colorTint"_ssn, material->GetColorTint());
+	vs->SetMatrix4x4("worldMatrix"_ssn, transform.GetWorldMatrix());
 	// Camera data
-	vs->SetMatrix4x4("viewMatrix", camera->GetViewMatrix());
-	vs->SetMatrix4x4("projMatrix", camera->GetProjMatrix());
+	vs->SetMatrix4x4("viewProjMatrix"_ssn, camera->GetViewProjMatrix());
+	// Decoding data for packed vertices
+	if (mesh->GetVertexFormat() == MESH_VERTEX_PACKED)
+	{
+		vs->SetFloat3("positionScale"_ssn, mesh->GetPositionScale());
+		vs->SetFloat3("positionOffset"_ssn, mesh->GetPositionOffset());
+	}
 
 	vs->CopyAllBufferData();
 
@@ -47,10 +121,10 @@ void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::
 		//  - for this demo, this step *could* simply be done once during Init(),
 		//    but I'm doing it here because it's often done multiple times per frame
 		//    in a larger application/game
-	UINT stride = sizeof(Vertex);
+	UINT stride = mesh->GetVertexStride();
 	UINT offset = 0;
 	context->IASetVertexBuffers(0, 1, mesh->GetVertexBuffer().GetAddressOf(), &stride, &offset);
-	context->IASetIndexBuffer(mesh->GetIndexBuffer().Get(), DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(mesh->GetIndexBuffer().Get(), mesh->GetIndexFormat(), 0);
 
 
 	// Finally do the actual drawing
@@ -58,8 +132,10 @@ void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::
 	//  - This will use all of the currently set DirectX "stuff" (shaders, buffers, etc)
 	//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
 	//     vertices in the currently set VERTEX BUFFER
+	//  - Each LOD is its own range of the index buffer
+	const MeshLod& lod = mesh->GetLod(SelectLod(camera, viewportHeight));
 	context->DrawIndexed(
-		mesh->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
+		lod.indexCount,     // The number of indices to use
+		lod.indexStart,     // Offset to the first index we want to use
 		0);    // Offset to add to each index when looking up vertices
 }
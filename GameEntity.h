@@ -21,12 +21,30 @@ public:
 	std::shared_ptr<Mesh> mesh;
 	// Material
 	std::shared_ptr<Material> material;
+	// Largest error, in pixels, that a lower detail LOD is allowed to show
+	float maxLodError;
+	// Is it big and solid enough to hide other entities? (needs MESH_LOAD_OCCLUDER)
+	bool occluder;
 
 	// Getters
 	std::shared_ptr<Mesh> GetMesh();
 	Transform* GetTransform();
 
+	// Bounding sphere of the mesh after the world matrix (and any parents)
+	// - Scaled by the longest axis, so it still covers stretched meshes
+	void GetWorldBounds(XMFLOAT3& center, float& radius);
+	// Box around the mesh's bounding box after the world matrix
+	void GetWorldBox(XMFLOAT3& boxMin, XMFLOAT3& boxMax);
+
+	// Picks the LOD of the mesh to draw from this camera
+	// - viewportHeight is in pixels
+	int SelectLod(std::shared_ptr<Camera> camera, float viewportHeight);
+
 	// Draw call
-	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera);
+	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera, float viewportHeight);
+
+private:
+	// Length of the longest axis of a world matrix
+	static float GetMaxScale(const XMFLOAT4X4& world);
 };
 
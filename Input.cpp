@@ -0,0 +1,261 @@
+#include "Input.h"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+Input& Input::Default()
+{
+	static Input input;
+	return input;
+}
+
+Input::~Input()
+{
+	Stop();
+}
+
+bool Input::StartRecording(const char* file, float fixedDeltaTime)
+{
+	Stop();
+	recordFile.open(file, std::ios::binary | std::ios::trunc);
+	if (!recordFile.is_open())
+		return false;
+
+	InputLogHeader header = {};
+	memcpy(header.magic, "INPT", 4);
+	header.version = Version;
+	header.fixedDeltaTime = fixedDeltaTime;
+	recordFile.write((const char*)&header, sizeof(InputLogHeader));
+
+	// Recordings start from nothing pressed, so anything already held
+	// down shows up as a change on the first frame
+	memset(down, 0, sizeof(down));
+	mode = INPUT_RECORD;
+	this->fixedDeltaTime = fixedDeltaTime;
+	frame = 0;
+	return recordFile.good();
+}
+
+bool Input::StartReplay(const char* file, float fixedDeltaTime)
+{
+	Stop();
+	replayFile.open(file, std::ios::binary);
+	if (!replayFile.is_open())
+		return false;
+
+	// Make sure it's a log we understand
+	InputLogHeader header = {};
+	replayFile.read((char*)&header, sizeof(InputLogHeader));
+	bool valid = replayFile.good() && memcmp(header.magic, "INPT", 4) == 0 && header.version == Version;
+
+	// Every record has to read back cleanly, with exactly as many as the
+	// header says and nothing left over
+	for (uint32_t i = 0; valid && i < header.frameCount; i++)
+	{
+		float deltaTime;
+		int16_t mouse[2];
+		uint8_t changeCount;
+		uint16_t changes[KeyCount];
+		valid = ReadRecord(deltaTime, mouse, changeCount, changes);
+	}
+	if (!valid || replayFile.peek() != std::char_traits<char>::eof())
+	{
+		replayFile.close();
+		return false;
+	}
+	replayFile.clear();
+	replayFile.seekg(sizeof(InputLogHeader));
+
+	// Replays start from nothing pressed, just like a recording does
+	memset(down, 0, sizeof(down));
+	memset(pressed, 0, sizeof(pressed));
+	mouseX = 0;
+	mouseY = 0;
+	mode = INPUT_REPLAY;
+	this->fixedDeltaTime = fixedDeltaTime;
+	replayFinished = false;
+	frame = 0;
+	return true;
+}
+
+void Input::Stop()
+{
+	// A recording only counts as finished once it has its frame count
+	if (recordFile.is_open())
+	{
+		recordFile.seekp(offsetof(InputLogHeader, frameCount));
+		recordFile.write((const char*)&frame, sizeof(uint32_t));
+		recordFile.close();
+	}
+	if (replayFile.is_open())
+		replayFile.close();
+	mode = INPUT_LIVE;
+	fixedDeltaTime = 0;
+}
+
+float Input::BeginFrame(float deltaTime, void* window)
+{
+	uint64_t previousDown[KeyCount / 64];
+	memcpy(previousDown, down, sizeof(down));
+	if (mode != INPUT_REPLAY)
+		Poll(window);
+	return EndFrame(deltaTime, previousDown);
+}
+
+float Input::BeginFrame(float deltaTime, const int* keysDown, int keyCount, int mouseX, int mouseY)
+{
+	uint64_t previousDown[KeyCount / 64];
+	memcpy(previousDown, down, sizeof(down));
+	if (mode != INPUT_REPLAY)
+	{
+		memset(down, 0, sizeof(down));
+		memset(pressed, 0, sizeof(pressed));
+		for (int i = 0; i < keyCount; i++)
+		{
+			if (keysDown[i] > 0 && keysDown[i] < KeyCount)
+				down[keysDown[i] >> 6] |= 1ull << (keysDown[i] & 63);
+		}
+		this->mouseX = mouseX;
+		this->mouseY = mouseY;
+	}
+	return EndFrame(deltaTime, previousDown);
+}
+
+float Input::EndFrame(float deltaTime, const uint64_t* previousDown)
+{
+	if (fixedDeltaTime > 0)
+		deltaTime = fixedDeltaTime;
+
+	if (mode == INPUT_REPLAY)
+	{
+		float recordedDeltaTime;
+		if (Replay(recordedDeltaTime))
+		{
+			if (fixedDeltaTime <= 0)
+				deltaTime = recordedDeltaTime;
+		}
+		else
+		{
+			// Nothing new is pressed once the log is over
+			replayFinished = true;
+			memset(pressed, 0, sizeof(pressed));
+		}
+	}
+	else
+	{
+		// Anything that went down counts as a press, even if Windows
+		// already handed its press bit to someone else
+		for (int word = 0; word < KeyCount / 64; word++)
+			pressed[word] |= down[word] & ~previousDown[word];
+		if (mode == INPUT_RECORD)
+			Record(deltaTime, previousDown);
+	}
+	frame++;
+	return deltaTime;
+}
+
+// Each key's "pressed since last asked" bit is kept by Windows, and this
+// is the only place that asks
+void Input::Poll(void* window)
+{
+	memset(down, 0, sizeof(down));
+	memset(pressed, 0, sizeof(pressed));
+#ifdef _WIN32
+	for (int key = 1; key < KeyCount; key++)
+	{
+		SHORT state = GetAsyncKeyState(key);
+		if (state & 0x8000)
+			down[key >> 6] |= 1ull << (key & 63);
+		if (state & 1)
+			pressed[key >> 6] |= 1ull << (key & 63);
+	}
+
+	POINT mouse = {};
+	GetCursorPos(&mouse);
+	if (window)
+		ScreenToClient((HWND)window, &mouse);
+	mouseX = mouse.x;
+	mouseY = mouse.y;
+#else
+	(void)window;
+#endif
+}
+
+// Only keys that went up, went down or were pressed get an entry
+void Input::Record(float deltaTime, const uint64_t* previousDown)
+{
+	uint16_t changes[KeyCount];
+	uint8_t changeCount = 0;
+	for (int key = 1; key < KeyCount; key++)
+	{
+		uint64_t bit = 1ull << (key & 63);
+		uint16_t change = (uint16_t)key;
+		if ((down[key >> 6] ^ previousDown[key >> 6]) & bit)
+			change |= KeyChanged;
+		if (pressed[key >> 6] & bit)
+			change |= KeyPressed;
+		if (change & (KeyChanged | KeyPressed))
+			changes[changeCount++] = change;
+	}
+
+	// Positions outside the window are clamped, which is fine for anything
+	// that only cares about movement inside it
+	int16_t mouse[2] =
+	{
+		(int16_t)(mouseX < -32768 ? -32768 : mouseX > 32767 ? 32767 : mouseX),
+		(int16_t)(mouseY < -32768 ? -32768 : mouseY > 32767 ? 32767 : mouseY)
+	};
+	mouseX = mouse[0];
+	mouseY = mouse[1];
+	recordFile.write((const char*)&deltaTime, sizeof(float));
+	recordFile.write((const char*)mouse, sizeof(mouse));
+	recordFile.write((const char*)&changeCount, sizeof(uint8_t));
+	recordFile.write((const char*)changes, sizeof(uint16_t) * changeCount);
+}
+
+bool Input::Replay(float& deltaTime)
+{
+	int16_t mouse[2];
+	uint8_t changeCount = 0;
+	uint16_t changes[KeyCount];
+	if (replayFile.peek() == std::char_traits<char>::eof() || !ReadRecord(deltaTime, mouse, changeCount, changes))
+		return false;
+
+	mouseX = mouse[0];
+	mouseY = mouse[1];
+	memset(pressed, 0, sizeof(pressed));
+	for (int i = 0; i < changeCount; i++)
+	{
+		int key = changes[i] & 0xFF;
+		uint64_t bit = 1ull << (key & 63);
+		if (changes[i] & KeyChanged)
+			down[key >> 6] ^= bit;
+		if (changes[i] & KeyPressed)
+			pressed[key >> 6] |= bit;
+	}
+	return true;
+}
+
+// Records only ever hold real frame times, and changes to real keys with
+// no bits beyond the two flags
+bool Input::ReadRecord(float& deltaTime, int16_t* mouse, uint8_t& changeCount, uint16_t* changes)
+{
+	changeCount = 0;
+	replayFile.read((char*)&deltaTime, sizeof(float));
+	replayFile.read((char*)mouse, sizeof(int16_t) * 2);
+	replayFile.read((char*)&changeCount, sizeof(uint8_t));
+	replayFile.read((char*)changes, sizeof(uint16_t) * changeCount);
+	if (!replayFile.good() || !std::isfinite(deltaTime) || deltaTime < 0)
+		return false;
+
+	for (int i = 0; i < changeCount; i++)
+	{
+		if ((changes[i] & 0xFF) == 0 || (changes[i] & ~(0xFF | KeyChanged | KeyPressed)) != 0)
+			return false;
+	}
+	return true;
+}
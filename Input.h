@@ -0,0 +1,123 @@
+#pragma once
+#include <fstream>
+#include <cstdint>
+
+// Keys that don't have a character of their own
+// - Same values as the Windows virtual key codes, and letters and digits
+//   are their upper case characters ('W', '1'), also like Windows
+enum InputKey
+{
+	INPUT_KEY_LBUTTON = 0x01,
+	INPUT_KEY_RBUTTON = 0x02,
+	INPUT_KEY_ESCAPE = 0x1B,
+	INPUT_KEY_SPACE = 0x20
+};
+
+// Where each frame's input comes from
+enum InputMode
+{
+	// Straight from the keyboard and mouse
+	INPUT_LIVE,
+	// From the keyboard and mouse, and also written to a log
+	INPUT_RECORD,
+	// From a log, ignoring the keyboard and mouse
+	INPUT_REPLAY
+};
+
+// Header at the start of an input log
+// - Followed by frameCount records, and nothing after them:
+//   float deltaTime, int16_t mouseX, int16_t mouseY, uint8_t changeCount,
+//   then changeCount uint16_t key changes (see Input::KeyChanged)
+struct InputLogHeader
+{
+	char magic[4];				// Always "INPT"
+	uint32_t version;			// Bumped whenever the layout changes
+	float fixedDeltaTime;		// Delta time the recording was forced to, or 0
+	uint32_t frameCount;		// Filled in when the recording stops
+};
+
+// One snapshot of the keyboard and mouse per frame, which can be recorded
+// to a compact log and played back later
+// - Everything that reacts to input reads it from here instead of asking
+//   Windows, so a replay drives the camera and game exactly like the
+//   recording did (and needs no window, so it also runs headless)
+// - A frame only stores the keys that changed, so a log is a few bytes a frame
+// - Without Windows, live input is just nothing pressed
+class Input
+{
+public:
+	static const uint32_t Version = 2;
+	// Highest key code there is
+	static const int KeyCount = 256;
+
+	// Input used by the game and camera
+	static Input& Default();
+
+	~Input();
+
+	// Starts writing every frame to a log, returning false if it can't be made
+	// - A fixedDeltaTime above 0 replaces the real frame time while
+	//   recording, so a replay takes exactly the same steps
+	bool StartRecording(const char* file, float fixedDeltaTime = 0);
+	// Starts reading frames from a log, returning false if it can't be read
+	// - The whole log is checked first, so one that was cut short (or
+	//   never finished) or has damaged records is turned down up front
+	//   instead of going wrong partway through
+	// - A fixedDeltaTime above 0 replaces the recorded frame times
+	bool StartReplay(const char* file, float fixedDeltaTime = 0);
+	// Finishes any recording or replay and goes back to live input
+	void Stop();
+	InputMode GetMode() const { return mode; }
+	// Has a replay run out of frames? (input stays as it was on the last one)
+	bool IsReplayFinished() const { return replayFinished; }
+
+	// Takes this frame's snapshot, recording or replaying it, and returns
+	// the delta time the frame should use
+	// - Call once at the start of every frame, before anything reads input
+	// - window is the HWND mouse positions are relative to (unused headless)
+	float BeginFrame(float deltaTime, void* window);
+	// Same, but with the keys held down and the mouse position given instead
+	// of read from the keyboard and mouse (scripted input, like tests)
+	// - Ignored during a replay, just like the real keyboard and mouse are
+	float BeginFrame(float deltaTime, const int* keysDown, int keyCount, int mouseX, int mouseY);
+	uint32_t GetFrame() const { return frame; }
+
+	// Is the key held down this frame?
+	bool IsKeyDown(int key) const { return (down[key >> 6] >> (key & 63)) & 1; }
+	// Was the key pressed since the last frame? (true once per press)
+	bool WasKeyPressed(int key) const { return (pressed[key >> 6] >> (key & 63)) & 1; }
+	// Mouse position in the window's client area, in pixels
+	int GetMouseX() const { return mouseX; }
+	int GetMouseY() const { return mouseY; }
+
+private:
+	// Bits of a key change in the log
+	// - The low byte is the key code
+	static const uint16_t KeyChanged = 1 << 8;	// Went up or down
+	static const uint16_t KeyPressed = 1 << 9;	// Pressed since the last frame
+
+	InputMode mode = INPUT_LIVE;
+	float fixedDeltaTime = 0;
+	bool replayFinished = false;
+	std::ofstream recordFile;
+	std::ifstream replayFile;
+	uint32_t frame = 0;
+
+	// One bit per key
+	uint64_t down[KeyCount / 64] = {};
+	uint64_t pressed[KeyCount / 64] = {};
+	int mouseX = 0;
+	int mouseY = 0;
+
+	// Fills in the snapshot from the keyboard and mouse
+	void Poll(void* window);
+	// Everything after the snapshot: replaying, working out presses and
+	// recording, then moving on a frame
+	float EndFrame(float deltaTime, const uint64_t* previousDown);
+	void Record(float deltaTime, const uint64_t* previousDown);
+	// Returns false once the log runs out
+	bool Replay(float& deltaTime);
+	// Reads one record without applying it, returning false if it's cut
+	// short or doesn't make sense
+	bool ReadRecord(float& deltaTime, int16_t* mouse, uint8_t& changeCount, uint16_t* changes);
+};
@@ -1,5 +1,6 @@
 
 #include <Windows.h>
+#include <cstdio>
 #include "Game.h"
 
 // --------------------------------------------------------
@@ -18,10 +19,34 @@ int WINAPI WinMain(
 	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
 #endif
 
+	// "-record file" writes every frame's input to a log, and "-replay file"
+	// plays one back (and quits at the end), so runs can be repeated exactly
+	// - Recordings use a fixed 60 fps time step so the replay takes the same steps
+	char inputLog[MAX_PATH] = {};
+	if (sscanf_s(lpCmdLine, "-record %259s", inputLog, (unsigned)_countof(inputLog)) == 1)
+		Input::Default().StartRecording(inputLog, 1.0f / 60.0f);
+	else if (sscanf_s(lpCmdLine, "-replay %259s", inputLog, (unsigned)_countof(inputLog)) == 1)
+	{
+		if (!Input::Default().StartReplay(inputLog))
+			printf("Couldn't replay input log %s\n", inputLog);
+	}
+
 	// Create the Game object using
 	// the app handle we got from WinMain
 	Game dxGame(hInstance);
 
+	// "-benchmark path [summary]" flies the camera along a path file at a
+	// fixed time step, then writes per stage frame timings (JSON, or CSV if
+	// the summary ends in .csv) and quits
+	char benchmarkPath[MAX_PATH] = {};
+	char benchmarkSummary[MAX_PATH] = "benchmark.json";
+	if (sscanf_s(lpCmdLine, "-benchmark %259s %259s", benchmarkPath, (unsigned)_countof(benchmarkPath),
+		benchmarkSummary, (unsigned)_countof(benchmarkSummary)) >= 1)
+	{
+		if (!dxGame.StartFlythrough(benchmarkPath, benchmarkSummary))
+			printf("Couldn't load camera path %s\n", benchmarkPath);
+	}
+
 	// Result variable for function calls below
 	HRESULT hr = S_OK;
 
@@ -27,3 +27,14 @@ Microsoft::WRL::ComPtr<ID3D11SamplerState> Material::GetSamplerState() { return
 std::shared_ptr<SimplePixelShader> Material::GetPixelShader() { return pixelShader; }
 void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> value) { pixelShader = value; }
 std::shared_ptr<SimpleVertexShader> Material::GetVertexShader() { return vertexShader; }
+void Material::SetPackedVertexShader(std::shared_ptr<SimpleVertexShader> value) { packedVertexShader = value; }
+
+// Packed meshes need a shader that decodes them
+// - Falls back to the regular one, which keeps materials without a packed
+//   shader working for unpacked meshes
+std::shared_ptr<SimpleVertexShader> Material::GetVertexShader(MeshVertexFormat format)
+{
+	if (format == MESH_VERTEX_PACKED && packedVertexShader)
+		return packedVertexShader;
+	return vertexShader;
+}
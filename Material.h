@@ -3,6 +3,7 @@
 #include <wrl/client.h> 
 #include "DXCore.h"
 #include "SimpleShader.h"
+#include "VertexPacking.h"
 #include <memory>
 
 using namespace DirectX;
@@ -19,6 +20,8 @@ private:
 	float specularExponent;
 	std::shared_ptr<SimplePixelShader> pixelShader;
 	std::shared_ptr<SimpleVertexShader> vertexShader;
+	// Version of the vertex shader for meshes made of PackedVertex
+	std::shared_ptr<SimpleVertexShader> packedVertexShader;
 public:
 	// Constructor with a lot of params
 	Material(XMFLOAT4 colorTint, float specularExponent,
@@ -38,5 +41,8 @@ public:
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> value);
 	std::shared_ptr<SimplePixelShader> GetPixelShader();
 	std::shared_ptr<SimpleVertexShader> GetVertexShader();
+	// Picks the vertex shader that can read the given vertex format
+	std::shared_ptr<SimpleVertexShader> GetVertexShader(MeshVertexFormat format);
+	void SetPackedVertexShader(std::shared_ptr<SimpleVertexShader> value);
 };
 
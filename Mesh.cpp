@@ -1,7 +1,36 @@
 #include "Mesh.h"
+#include <unordered_map>
+#include <chrono>
+#include <cfloat>
+#include <cstddef>
 
 using namespace DirectX;
 
+const float Mesh::OccluderMaxError = 0.01f;
+
+// Hashing for OBJ corners so identical corners can be merged into one vertex
+// - FNV-1a over the three indices in order, so corners like 1/2/3 and 2/1/3
+//   (common when the indices run side by side) don't collide
+struct ObjCornerHash
+{
+	size_t operator()(const ObjCorner& c) const
+	{
+		uint64_t h = 14695981039346656037ull;
+		h = (h ^ (uint32_t)c.position) * 1099511628211ull;
+		h = (h ^ (uint32_t)c.uv) * 1099511628211ull;
+		h = (h ^ (uint32_t)c.normal) * 1099511628211ull;
+		return (size_t)(h ^ (h >> 32));
+	}
+};
+
+struct ObjCornerEqual
+{
+	bool operator()(const ObjCorner& a, const ObjCorner& b) const
+	{
+		return a.position == b.position && a.uv == b.uv && a.normal == b.normal;
+	}
+};
+
 // Getters
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer()
 {
@@ -18,27 +47,193 @@ int Mesh::GetIndexCount()
 	return indexCount;
 }
 
+int Mesh::GetVertexCount()
+{
+	return vertexCount;
+}
+
+// How many times fewer vertices the mesh has than a
+// vertex-per-index mesh would (1 when nothing is shared)
+float Mesh::GetVertexReductionRatio()
+{
+	return vertexCount > 0 ? (float)indexCount / vertexCount : 1.0f;
+}
+
+XMFLOAT3 Mesh::GetBoundsMin()
+{
+	return boundsMin;
+}
+
+XMFLOAT3 Mesh::GetBoundsMax()
+{
+	return boundsMax;
+}
+
+XMFLOAT3 Mesh::GetBoundsCenter()
+{
+	return XMFLOAT3((boundsMin.x + boundsMax.x) * 0.5f, (boundsMin.y + boundsMax.y) * 0.5f, (boundsMin.z + boundsMax.z) * 0.5f);
+}
+
+float Mesh::GetBoundsRadius()
+{
+	return boundsRadius;
+}
+
+MeshVertexFormat Mesh::GetVertexFormat()
+{
+	return vertexFormat;
+}
+
+UINT Mesh::GetVertexStride()
+{
+	return vertexFormat == MESH_VERTEX_PACKED ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+DXGI_FORMAT Mesh::GetIndexFormat()
+{
+	return indexFormat;
+}
+
+UINT Mesh::GetIndexSize()
+{
+	return indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(UINT);
+}
+
+XMFLOAT3 Mesh::GetPositionScale()
+{
+	return XMFLOAT3(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z);
+}
+
+XMFLOAT3 Mesh::GetPositionOffset()
+{
+	return boundsMin;
+}
+
+MeshLoadStats Mesh::GetLoadStats()
+{
+	return loadStats;
+}
+
+const MeshletData& Mesh::GetMeshlets()
+{
+	return meshlets;
+}
+
+const std::vector<XMFLOAT3>& Mesh::GetOccluderPositions()
+{
+	return occluderPositions;
+}
+
+const std::vector<uint32_t>& Mesh::GetOccluderIndices()
+{
+	return occluderIndices;
+}
+
+int Mesh::GetLodCount()
+{
+	return (int)lods.size();
+}
+
+const MeshLod& Mesh::GetLod(int lod)
+{
+	return lods[lod];
+}
+
+// Errors only grow with the level, so the first one that's too big ends the search
+int Mesh::SelectLod(float pixelsPerUnit, float maxPixelError)
+{
+	int selected = 0;
+	for (int i = 1; i < (int)lods.size(); i++)
+	{
+		if (lods[i].error * pixelsPerUnit > maxPixelError)
+			break;
+		selected = i;
+	}
+	return selected;
+}
+
 //  Original Constructor
 Mesh::Mesh(Vertex* vertexList, int vertexCount, UINT* indexList, int indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device)
 {
+	vertexFormat = MESH_VERTEX_FULL;
+	indexFormat = DXGI_FORMAT_R32_UINT;
 	CreateMesh(vertexList, vertexCount, indexList, indexCount, device);
 }
 
 // Constructor Helper Method
 void Mesh::CreateMesh(Vertex* vertexList, int vertexCount, UINT* indexList, int indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device)
 {
-	// Directly set index list
-	this->indexCount = indexCount;
-	
+	PrepareVertices(vertexList, vertexCount, indexList, indexCount);
+
+	// Send everything to the GPU
+	std::vector<uint16_t> shortIndices;
+	const void* indexData = ConvertIndices(indexList, indexCount, vertexCount, shortIndices);
+	CreateBuffers(vertexList, vertexCount, indexData, indexCount, device);
+}
+
+// Uses 16-bit indices when every vertex can be reached with one
+// - Stops at 65535 vertices, since 0xFFFF is the strip cut value
+const void* Mesh::ConvertIndices(const UINT* indexList, int indexCount, int vertexCount, std::vector<uint16_t>& storage)
+{
+	if (vertexCount > 0xFFFF)
+	{
+		indexFormat = DXGI_FORMAT_R32_UINT;
+		return indexList;
+	}
+
+	indexFormat = DXGI_FORMAT_R16_UINT;
+	storage.resize(indexCount);
+	for (int i = 0; i < indexCount; i++)
+		storage[i] = (uint16_t)indexList[i];
+	return storage.data();
+}
+
+// Fills in everything that's derived from the vertices themselves
+void Mesh::PrepareVertices(Vertex* vertexList, int vertexCount, UINT* indexList, int indexCount)
+{
 	// Calculate tangents
 	CalculateTangents(vertexList, vertexCount, indexList, indexCount);
 
+	// Find the bounding box
+	XMVECTOR minimum = XMVectorReplicate(vertexCount > 0 ? FLT_MAX : 0.0f);
+	XMVECTOR maximum = XMVectorReplicate(vertexCount > 0 ? -FLT_MAX : 0.0f);
+	for (int i = 0; i < vertexCount; i++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&vertexList[i].Position);
+		minimum = XMVectorMin(minimum, pos);
+		maximum = XMVectorMax(maximum, pos);
+	}
+	XMStoreFloat3(&boundsMin, minimum);
+	XMStoreFloat3(&boundsMax, maximum);
+
+	// Sphere around the box's center that reaches the farthest vertex
+	XMVECTOR center = XMVectorScale(XMVectorAdd(minimum, maximum), 0.5f);
+	XMVECTOR radiusSq = XMVectorZero();
+	for (int i = 0; i < vertexCount; i++)
+	{
+		XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&vertexList[i].Position), center);
+		radiusSq = XMVectorMax(radiusSq, XMVector3LengthSq(offset));
+	}
+	boundsRadius = XMVectorGetX(XMVectorSqrt(radiusSq));
+}
+
+// Creates the vertex and index buffers from finished data
+void Mesh::CreateBuffers(const void* vertexData, int vertexCount, const void* indexData, int indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device)
+{
+	// Meshes without a LOD chain are their own only LOD
+	if (lods.empty())
+		lods.push_back({ 0, (uint32_t)indexCount, 0.0f });
+
+	// Directly set index list
+	this->indexCount = (int)lods[0].indexCount;
+	this->vertexCount = vertexCount;
+
 	// Create the VERTEX BUFFER description -----------------------------------
 	// - The description is created on the stack because we only need
 	//    it to create the buffer.  The description is then useless.
 	D3D11_BUFFER_DESC vbd;
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * vertexCount;       // 3 = number of vertices in the buffer
+	vbd.ByteWidth = GetVertexStride() * vertexCount;       // 3 = number of vertices in the buffer
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells DirectX this is a vertex buffer
 	vbd.CPUAccessFlags = 0;
 	vbd.MiscFlags = 0;
@@ -47,7 +242,7 @@ void Mesh::CreateMesh(Vertex* vertexList, int vertexCount, UINT* indexList, int
 	// Create the proper struct to hold the initial vertex data
 	// - This is how we put the initial data into the buffer
 	D3D11_SUBRESOURCE_DATA initialVertexData;
-	initialVertexData.pSysMem = vertexList;
+	initialVertexData.pSysMem = vertexData;
 
 	// Actually create the buffer with the initial data
 	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
@@ -60,7 +255,7 @@ void Mesh::CreateMesh(Vertex* vertexList, int vertexCount, UINT* indexList, int
 	//    it to create the buffer.  The description is then useless.
 	D3D11_BUFFER_DESC ibd;
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * indexCount;	// 3 = number of indices in the buffer
+	ibd.ByteWidth = GetIndexSize() * indexCount;	// 3 = number of indices in the buffer
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;	// Tells DirectX this is an index buffer
 	ibd.CPUAccessFlags = 0;
 	ibd.MiscFlags = 0;
@@ -69,7 +264,7 @@ void Mesh::CreateMesh(Vertex* vertexList, int vertexCount, UINT* indexList, int
 	// Create the proper struct to hold the initial index data
 	// - This is how we put the initial data into the buffer
 	D3D11_SUBRESOURCE_DATA initialIndexData;
-	initialIndexData.pSysMem = indexList;
+	initialIndexData.pSysMem = indexData;
 
 	// Actually create the buffer with the initial data
 	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
@@ -77,266 +272,250 @@ void Mesh::CreateMesh(Vertex* vertexList, int vertexCount, UINT* indexList, int
 }
 
 // New Constructor
-Mesh::Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> device)
+Mesh::Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int loadFlags)
 {
-	// NOTE: You'll need to #include <fstream>
+	// Nothing loaded yet
+	vertexFormat = (loadFlags & MESH_LOAD_PACK) ? MESH_VERTEX_PACKED : MESH_VERTEX_FULL;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	indexCount = 0;
+	vertexCount = 0;
+	boundsMin = XMFLOAT3(0, 0, 0);
+	boundsMax = XMFLOAT3(0, 0, 0);
+	boundsRadius = 0.0f;
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Use the baked version if it's still up to date
+	// - It's mapped straight into the buffer upload, no parsing at all
+	std::string cacheFile = std::string(objFile) + ".meshcache";
+	unsigned int bakeFlags = loadFlags & ~(MESH_LOAD_MESHLETS | MESH_LOAD_OCCLUDER);
+	MeshCache cache;
+	if (cache.Open(cacheFile.c_str(), objFile, bakeFlags, GetVertexStride()))
+	{
+		const MeshCacheHeader* header = cache.GetHeader();
+		boundsMin = XMFLOAT3(header->boundsMin);
+		boundsMax = XMFLOAT3(header->boundsMax);
+		boundsRadius = header->boundsRadius;
+		indexFormat = header->indexSize == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+		lods.assign(cache.GetLods(), cache.GetLods() + header->lodCount);
+		CreateBuffers(cache.GetVertices(), header->vertexCount, cache.GetIndices(), header->indexCount, device);
+		if (loadFlags & MESH_LOAD_MESHLETS)
+			BuildMeshlets(cache.GetVertices(), header->vertexCount, cache.GetIndices(), indexCount);
+		if (loadFlags & MESH_LOAD_OCCLUDER)
+			BuildOccluder(cache.GetVertices(), header->vertexCount, cache.GetIndices());
+
+		// Record how it went
+		loadStats.fromCache = true;
+		loadStats.cacheBytes = cache.GetFileSize();
+		loadStats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		return;
+	}
 
-// File input object
-	std::ifstream obj(objFile);
+	// Parse the whole file straight out of memory
+	// - Large files are split across every hardware thread
+	ObjData obj;
+	if (!ObjParser::ParseFile(objFile, obj, &loadStats.parse, 0))
+		return;
 
-	// Check for successful open
-	if (!obj.is_open())
+	// Nothing to make a mesh from
+	if (obj.corners.empty())
 		return;
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;     // Positions from the file
-	std::vector<XMFLOAT3> normals;       // Normals from the file
-	std::vector<XMFLOAT2> uvs;           // UVs from the file
-	std::vector<Vertex> verts;           // Verts we're assembling
+	// Variables used while assembling the mesh
+	std::vector<Vertex> verts;           // Unique verts we're assembling
 	std::vector<UINT> indices;           // Indices of these verts
-	unsigned int vertCounter = 0;        // Count of vertices/indices
-	char chars[100];                     // String for line reading
+	indices.reserve(obj.corners.size());
 
-	// Still have data left?
-	while (obj.good())
-	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
+	// Each unique (position, uv, normal) combination becomes one vertex,
+	// so corners shared between triangles share a vertex too
+	std::unordered_map<ObjCorner, UINT, ObjCornerHash, ObjCornerEqual> vertexLookup;
+	vertexLookup.reserve(obj.corners.size());
 
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
+	// Build each triangle from its three corners, flipping the winding order
+	// - Indices were already made 0-based by the parser
+	static const int windingOrder[3] = { 0, 2, 1 };
+	for (size_t c = 0; c < obj.corners.size(); c += 3)
+	{
+		for (int w = 0; w < 3; w++)
 		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			//  If the model is missing any of these, this 
-			//  code will not handle the file correctly!
-			unsigned int i[12];
-			int facesRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// - Create the verts by looking up
-//    corresponding data from vectors
-// - OBJ File indices are 1-based, so
-//    they need to be adusted
-Vertex v1;
-v1.Position = positions[i[0] - 1];
-v1.UV = uvs[i[1] - 1];
-v1.Normal = normals[i[2] - 1];
-
-Vertex v2;
-v2.Position = positions[i[3] - 1];
-v2.UV = uvs[i[4] - 1];
-v2.Normal = normals[i[5] - 1];
-
-Vertex v3;
-v3.Position = positions[i[6] - 1];
-v3.UV = uvs[i[7] - 1];
-v3.Normal = normals[i[8] - 1];
-
-// The model is most likely in a right-handed space,
-// especially if it came from Maya.  We want to convert
-// to a left-handed space for DirectX.  This means we 
-// need to:
-//  - Invert the Z position
-//  - Invert the normal's Z
-//  - Flip the winding order
-// We also need to flip the UV coordinate since DirectX
-// defines (0,0) as the top left of the texture, and many
-// 3D modeling packages use the bottom left as (0,0)
-
-// Flip the UV's since they're probably "upside down"
-v1.UV.y = 1.0f - v1.UV.y;
-v2.UV.y = 1.0f - v2.UV.y;
-v3.UV.y = 1.0f - v3.UV.y;
-
-// Flip Z (LH vs. RH)
-v1.Position.z *= -1.0f;
-v2.Position.z *= -1.0f;
-v3.Position.z *= -1.0f;
-
-// Flip normal Z
-v1.Normal.z *= -1.0f;
-v2.Normal.z *= -1.0f;
-v3.Normal.z *= -1.0f;
-
-// Add the verts to the vector (flipping the winding order)
-verts.push_back(v1);
-verts.push_back(v3);
-verts.push_back(v2);
-
-// Add three more indices
-indices.push_back(vertCounter); vertCounter += 1;
-indices.push_back(vertCounter); vertCounter += 1;
-indices.push_back(vertCounter); vertCounter += 1;
-
-// Was there a 4th face?
-if (facesRead == 12)
-{
-	// Make the last vertex
-	Vertex v4;
-	v4.Position = positions[i[9] - 1];
-	v4.UV = uvs[i[10] - 1];
-	v4.Normal = normals[i[11] - 1];
-
-	// Flip the UV, Z pos and normal
-	v4.UV.y = 1.0f - v4.UV.y;
-	v4.Position.z *= -1.0f;
-	v4.Normal.z *= -1.0f;
-
-	// Add a whole triangle (flipping the winding order)
-	verts.push_back(v1);
-	verts.push_back(v4);
-	verts.push_back(v3);
-
-	// Add three more indices
-	indices.push_back(vertCounter); vertCounter += 1;
-	indices.push_back(vertCounter); vertCounter += 1;
-	indices.push_back(vertCounter); vertCounter += 1;
-}
+			const ObjCorner& corner = obj.corners[c + windingOrder[w]];
+
+			// Reuse the vertex if we've seen this corner before
+			auto result = vertexLookup.insert(std::make_pair(corner, (UINT)verts.size()));
+			if (result.second)
+				verts.push_back(MakeVertex(obj, corner));
+			indices.push_back(result.first->second);
 		}
 	}
 
-	// Close the file and create the actual buffers
-	obj.close();
-
-
-	// - At this point, "verts" is a vector of Vertex structs, and can be used
+	// - At this point, "verts" is a vector of unique Vertex structs, and can be used
 	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
 	//
 	// - The vector "indices" is similar. It's a vector of unsigned ints and
 	//    can be used directly for the index buffer: &indices[0] is the address of the first int
-	//
-	// - "vertCounter" is BOTH the number of vertices and the number of indices
-	// - Yes, the indices are a bit redundant here (one per vertex).  Could you skip using
-	//    an index buffer in this case?  Sure!  Though, if your mesh class assumes you have
-	//    one, you'll need to write some extra code to handle cases when you don't.
+
+	// Reorder for the post transform cache and early-z if asked to
+	// - Done before tangents, which don't care about order
+	if (loadFlags & MESH_LOAD_OPTIMIZE)
+	{
+		size_t used = MeshOptimizer::Optimize(&verts[0], verts.size(), sizeof(Vertex), offsetof(Vertex, Position),
+			&indices[0], indices.size(), &loadStats.optimize);
+		verts.resize(used);
+		loadStats.optimized = true;
+	}
 
 	// To get warning to go away
 	indexCount = (int)indices.size();
-	CreateMesh(&verts[0], (int)verts.size(), &indices[0], (int)indices.size(), device);
+	PrepareVertices(&verts[0], (int)verts.size(), &indices[0], (int)indices.size());
+
+	// Simplified copies of the triangles go after the full ones
+	// - They reuse the same vertices, so only the index buffer grows
+	if (loadFlags & MESH_LOAD_LODS)
+	{
+		std::vector<XMFLOAT3> positions(verts.size());
+		for (size_t i = 0; i < verts.size(); i++)
+			positions[i] = verts[i].Position;
+		MeshSimplifier::BuildLods(&positions[0], positions.size(), indices, lods, &loadStats.lods);
+
+		// Each level gets the same triangle passes as the full mesh
+		// - The vertex order stays the one picked for LOD 0, since every
+		//   level shares the one vertex buffer
+		if (loadFlags & MESH_LOAD_OPTIMIZE)
+		{
+			for (size_t l = 1; l < lods.size(); l++)
+			{
+				MeshOptimizer::OptimizeTriangles(&verts[0], verts.size(), sizeof(Vertex), offsetof(Vertex, Position),
+					&indices[lods[l].indexStart], lods[l].indexCount);
+			}
+		}
+	}
+
+	// Quantize if asked to, now that the bounds are known
+	const void* vertexData = &verts[0];
+	std::vector<PackedVertex> packed;
+	if (vertexFormat == MESH_VERTEX_PACKED)
+	{
+		packed.resize(verts.size());
+		VertexPacking::PackAll(&verts[0], verts.size(), boundsMin, boundsMax, &packed[0]);
+		vertexData = &packed[0];
+		loadStats.packed = true;
+
+#if defined(DEBUG) || defined(_DEBUG)
+		// Only worth the extra decode pass when someone will see the results
+		loadStats.packing = VertexPacking::Measure(&verts[0], verts.size(), boundsMin, boundsMax);
+#endif
+	}
+	std::vector<uint16_t> shortIndices;
+	const void* indexData = ConvertIndices(&indices[0], (int)indices.size(), (int)verts.size(), shortIndices);
+	CreateBuffers(vertexData, (int)verts.size(), indexData, (int)indices.size(), device);
+	if (loadFlags & MESH_LOAD_MESHLETS)
+		BuildMeshlets(vertexData, (int)verts.size(), indexData, indexCount);
+	if (loadFlags & MESH_LOAD_OCCLUDER)
+		BuildOccluder(vertexData, (int)verts.size(), indexData);
+
+	// Bake the finished mesh so the next load can skip all of the above
+	if (MeshCache::Write(cacheFile.c_str(), objFile, bakeFlags,
+		vertexData, GetVertexStride(), (uint32_t)verts.size(), indexData, GetIndexSize(), (uint32_t)indices.size(),
+		&lods[0], (uint32_t)lods.size(), &boundsMin.x, &boundsMax.x, boundsRadius))
+	{
+		loadStats.cacheBytes = sizeof(MeshCacheHeader) + GetVertexStride() * verts.size() +
+			((GetIndexSize() * indices.size() + 3) & ~(size_t)3) + sizeof(MeshLod) * lods.size();
+	}
+	loadStats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Pulls positions and 32-bit indices back out of the final data, whatever
+// format it ended up in
+void Mesh::ReadBack(const void* vertexData, int vertexCount, const void* indexData, int indexStart, int indexCount,
+	std::vector<XMFLOAT3>& positions, std::vector<uint32_t>& indices)
+{
+	// Positions (decoded the same way the shader does for packed vertices)
+	positions.resize(vertexCount);
+	for (int i = 0; i < vertexCount; i++)
+	{
+		if (vertexFormat == MESH_VERTEX_PACKED)
+			positions[i] = VertexPacking::Unpack(((const PackedVertex*)vertexData)[i], boundsMin, boundsMax).Position;
+		else
+			positions[i] = ((const Vertex*)vertexData)[i].Position;
+	}
+
+	// Indices
+	indices.resize(indexCount);
+	for (int i = 0; i < indexCount; i++)
+	{
+		if (indexFormat == DXGI_FORMAT_R16_UINT)
+			indices[i] = ((const uint16_t*)indexData)[indexStart + i];
+		else
+			indices[i] = ((const uint32_t*)indexData)[indexStart + i];
+	}
+}
+
+void Mesh::BuildMeshlets(const void* vertexData, int vertexCount, const void* indexData, int indexCount)
+{
+	std::vector<XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+	ReadBack(vertexData, vertexCount, indexData, 0, indexCount, positions, indices);
+	MeshletBuilder::Build(positions.data(), positions.size(), indices.data(), indices.size(), meshlets, &loadStats.meshlets);
+}
+
+// Occluders only need a rough shape, so the coarsest LOD that stays within
+// a small fraction of the mesh's size is used
+void Mesh::BuildOccluder(const void* vertexData, int vertexCount, const void* indexData)
+{
+	int lod = 0;
+	for (int i = 1; i < (int)lods.size(); i++)
+	{
+		if (lods[i].error > boundsRadius * OccluderMaxError)
+			break;
+		lod = i;
+	}
+	ReadBack(vertexData, vertexCount, indexData, lods[lod].indexStart, lods[lod].indexCount, occluderPositions, occluderIndices);
+}
+
+// Creates a single vertex from one corner of an OBJ face
+// - The model is most likely in a right-handed space,
+//   especially if it came from Maya.  We want to convert
+//   to a left-handed space for DirectX.  This means we 
+//   need to invert the Z position and the normal's Z
+//   (the winding order is flipped by the caller)
+// - We also need to flip the UV coordinate since DirectX
+//   defines (0,0) as the top left of the texture, and many
+//   3D modeling packages use the bottom left as (0,0)
+Vertex Mesh::MakeVertex(const ObjData& obj, const ObjCorner& corner)
+{
+	Vertex v = {};
+	if (corner.position >= 0 && corner.position < (int)obj.positions.size())
+	{
+		const ObjFloat3& p = obj.positions[corner.position];
+		v.Position = XMFLOAT3(p.x, p.y, -p.z);
+	}
+	if (corner.uv >= 0 && corner.uv < (int)obj.uvs.size())
+	{
+		const ObjFloat2& t = obj.uvs[corner.uv];
+		v.UV = XMFLOAT2(t.x, 1.0f - t.y);
+	}
+	if (corner.normal >= 0 && corner.normal < (int)obj.normals.size())
+	{
+		const ObjFloat3& n = obj.normals[corner.normal];
+		v.Normal = XMFLOAT3(n.x, n.y, -n.z);
+	}
+	return v;
 }
 
 
 // Calculates the tangents of the vertices in a mesh
-// - Code originally adapted from: http://www.terathon.com/code/tangent.html
+// - Math originally adapted from: http://www.terathon.com/code/tangent.html
 //   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
 //   - See listing 7.4 in section 7.5 (page 9 of the PDF)
 //
 // - Note: For this code to work, your Vertex format must
-//         contain an XMFLOAT3 called Tangent
+//         contain an XMFLOAT4 called Tangent (w is the handedness)
 //
 // - Be sure to call this BEFORE creating your D3D vertex/index buffers
 //
+// - The work is done 4 triangles at a time by TangentGenerator, and split
+//   across threads for big meshes
+//
 void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
-	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
-	}
-
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
-	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
-	}
-
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
-
-		// Use Gram-Schmidt orthogonalize
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
-
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
-	}
-}
\ No newline at end of file
+	TangentGenerator::Generate(verts, numVerts, indices, numIndices, 0, &loadStats.tangents);
+}
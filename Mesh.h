@@ -1,13 +1,63 @@
 #pragma once
 #include "Vertex.h"
+#include "ObjParser.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "TangentGenerator.h"
+#include "VertexPacking.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
 #include <DirectXMath.h>
 #include <wrl/client.h>
 #include <Windows.h>
 #include <d3d11.h>
 #include <string>
-#include <fstream>
 #include <vector>
 
+// Extra processing to do while loading a mesh
+// - Also stored in the bake, so changing them causes a rebuild
+enum MeshLoadFlags
+{
+	MESH_LOAD_DEFAULT = 0,
+	// Reorders triangles and vertices for the GPU (see MeshOptimizer)
+	MESH_LOAD_OPTIMIZE = 1 << 0,
+	// Stores PackedVertex instead of Vertex (needs a packed vertex shader)
+	MESH_LOAD_PACK = 1 << 1,
+	// Keeps a CPU side meshlet split of the mesh for culling (see MeshletBuilder)
+	// - Built from the final vertices, so it isn't part of the bake
+	MESH_LOAD_MESHLETS = 1 << 2,
+	// Appends simplified versions of the mesh to the index buffer (see MeshSimplifier)
+	MESH_LOAD_LODS = 1 << 3,
+	// Keeps a CPU side copy of a coarse LOD for occlusion culling (see OcclusionCuller)
+	// - Built from the final data like meshlets, so it isn't part of the bake either
+	MESH_LOAD_OCCLUDER = 1 << 4
+};
+
+// How a mesh was loaded and how long it took
+struct MeshLoadStats
+{
+	// Timing of the OBJ parse (empty when loaded from a bake)
+	ObjParseStats parse;
+	// Was the baked mesh cache used instead of the OBJ?
+	bool fromCache = false;
+	// Size of the baked file that was read or written
+	size_t cacheBytes = 0;
+	// Vertex cache results (only filled in when MESH_LOAD_OPTIMIZE ran)
+	bool optimized = false;
+	MeshOptimizeStats optimize;
+	// Tangent generation results
+	TangentStats tangents;
+	// Quantization error and savings (the report is only filled in for debug builds)
+	bool packed = false;
+	VertexPackingReport packing;
+	// Meshlet build results (only filled in when MESH_LOAD_MESHLETS ran)
+	MeshletStats meshlets;
+	// LOD chain results (only filled in when MESH_LOAD_LODS ran)
+	MeshSimplifyStats lods;
+	// Total time from opening the file to the buffers being created
+	double seconds = 0;
+};
+
 class Mesh
 {
 private:
@@ -15,8 +65,54 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
 	void CreateMesh(Vertex* vertexList, int vertexCount, UINT* indexList, int indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device);
-	// Number of indices
+	// Calculates tangents and bounds (box and sphere)
+	void PrepareVertices(Vertex* vertexList, int vertexCount, UINT* indexList, int indexCount);
+	// Uploads finished vertex and index data, which may be read only (like a mapped bake)
+	// - vertexData holds either Vertex or PackedVertex structs, based on vertexFormat
+	// - indexData holds 16 or 32-bit indices, based on indexFormat, and
+	//   indexCount covers every LOD
+	void CreateBuffers(const void* vertexData, int vertexCount, const void* indexData, int indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device);
+	// Picks the index format for the vertex count and converts the indices
+	// to it if needed (using storage), returning what to upload
+	const void* ConvertIndices(const UINT* indexList, int indexCount, int vertexCount, std::vector<uint16_t>& storage);
+	// Number of indices in the full detail mesh (LOD 0)
 	int indexCount;
+	// Number of (unique) vertices
+	int vertexCount;
+	// Layout of the vertex buffer
+	MeshVertexFormat vertexFormat;
+	// R16_UINT whenever the vertex count allows it, R32_UINT otherwise
+	DXGI_FORMAT indexFormat;
+	// Object space bounding box (also used to decode packed positions)
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+	// Object space bounding sphere, centered on the box
+	// - Usually a lot tighter than half the box's diagonal
+	float boundsRadius;
+	// Timing of the load (empty for meshes made from arrays)
+	MeshLoadStats loadStats;
+	// Clusters of triangles for culling (empty unless asked for)
+	MeshletData meshlets;
+	// Ranges of the index buffer, from full detail to coarsest
+	// - Always has at least the full mesh
+	std::vector<MeshLod> lods;
+	// Occluder triangles (empty unless asked for)
+	std::vector<DirectX::XMFLOAT3> occluderPositions;
+	std::vector<uint32_t> occluderIndices;
+
+	// Largest LOD error, as a share of the bounding radius, allowed in the occluder
+	static const float OccluderMaxError;
+
+	// Decodes part of the final vertex and index data back into plain arrays
+	void ReadBack(const void* vertexData, int vertexCount, const void* indexData, int indexStart, int indexCount,
+		std::vector<DirectX::XMFLOAT3>& positions, std::vector<uint32_t>& indices);
+	// Splits the final vertex and index data into meshlets
+	void BuildMeshlets(const void* vertexData, int vertexCount, const void* indexData, int indexCount);
+	// Keeps a coarse LOD of the final data for the occlusion culler
+	void BuildOccluder(const void* vertexData, int vertexCount, const void* indexData);
+
+	// Helper for building a vertex out of a parsed OBJ face corner
+	static Vertex MakeVertex(const ObjData& obj, const ObjCorner& corner);
 
 public:
 	// Methods for getting information
@@ -24,10 +120,35 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 	int GetIndexCount();
+	int GetVertexCount();
+	float GetVertexReductionRatio();
+	DirectX::XMFLOAT3 GetBoundsMin();
+	DirectX::XMFLOAT3 GetBoundsMax();
+	DirectX::XMFLOAT3 GetBoundsCenter();
+	float GetBoundsRadius();
+	MeshVertexFormat GetVertexFormat();
+	UINT GetVertexStride();
+	DXGI_FORMAT GetIndexFormat();
+	UINT GetIndexSize();
+	// Packed positions decode as offset + position * scale
+	DirectX::XMFLOAT3 GetPositionScale();
+	DirectX::XMFLOAT3 GetPositionOffset();
+	MeshLoadStats GetLoadStats();
+	const MeshletData& GetMeshlets();
+	// Object space triangles to rasterize as an occluder (MESH_LOAD_OCCLUDER)
+	const std::vector<DirectX::XMFLOAT3>& GetOccluderPositions();
+	const std::vector<uint32_t>& GetOccluderIndices();
+	int GetLodCount();
+	const MeshLod& GetLod(int lod);
+	// Coarsest LOD whose error covers no more than maxPixelError pixels
+	// - pixelsPerUnit is how many pixels one object space unit covers on screen
+	int SelectLod(float pixelsPerUnit, float maxPixelError);
 
 	// Constructors
 	Mesh(Vertex* vertexList, int vertexCount, UINT* indexList, int indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device);
 	// Mesh loading constructor
-	Mesh(const char* file, Microsoft::WRL::ComPtr<ID3D11Device> device);
+	// - Uses "file.meshcache" when it's up to date, and bakes it otherwise
+	// - loadFlags is any combination of MeshLoadFlags
+	Mesh(const char* file, Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int loadFlags = MESH_LOAD_DEFAULT);
 };
 
@@ -0,0 +1,232 @@
+#include "MeshCache.h"
+#include <fstream>
+#include <cstring>
+#include <string>
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+// Header is expected to keep the vertex data 16 byte aligned
+static_assert(sizeof(MeshCacheHeader) % 16 == 0, "MeshCacheHeader must stay a multiple of 16 bytes");
+
+#if defined(DEBUG) || defined(_DEBUG)
+const bool MeshCache::VerifyContentsByDefault = true;
+#else
+const bool MeshCache::VerifyContentsByDefault = false;
+#endif
+
+// Hashes bytes with 64-bit FNV-1a
+uint64_t MeshCache::Hash(const void* data, size_t size, uint64_t hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// Indices are padded so the LOD table after them stays 4 byte aligned
+size_t MeshCache::IndexBytes(uint32_t indexSize, uint32_t indexCount)
+{
+	return ((size_t)indexSize * indexCount + 3) & ~(size_t)3;
+}
+
+// Gets the size and last write time of the source file
+bool MeshCache::GetSourceStamp(const char* sourceFile, uint64_t& size, int64_t& time)
+{
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(sourceFile, &info) != 0)
+		return false;
+#else
+	struct stat info;
+	if (stat(sourceFile, &info) != 0)
+		return false;
+#endif
+	size = (uint64_t)info.st_size;
+	time = (int64_t)info.st_mtime;
+	return true;
+}
+
+// Renames the temporary file over the bake, replacing any older one
+bool MeshCache::ReplaceFile(const char* tempFile, const char* cacheFile)
+{
+#ifdef _WIN32
+	if (MoveFileExA(tempFile, cacheFile, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+		return true;
+#else
+	if (rename(tempFile, cacheFile) == 0)
+		return true;
+#endif
+	remove(tempFile);
+	return false;
+}
+
+// Writes the header followed by the raw vertex, index and LOD arrays
+bool MeshCache::Write(const char* cacheFile, const char* sourceFile, uint32_t flags,
+	const void* vertices, uint32_t vertexSize, uint32_t vertexCount,
+	const void* indices, uint32_t indexSize, uint32_t indexCount,
+	const MeshLod* lods, uint32_t lodCount,
+	const float boundsMin[3], const float boundsMax[3], float boundsRadius)
+{
+	// Nothing to upload, so nothing worth baking
+	if (vertexCount == 0 || indexCount == 0)
+		return false;
+
+	// Fill out the header
+	MeshCacheHeader header = {};
+	memcpy(header.magic, "MSHC", 4);
+	header.version = Version;
+	header.vertexSize = vertexSize;
+	header.flags = flags;
+	header.vertexCount = vertexCount;
+	header.indexCount = indexCount;
+	header.indexSize = indexSize;
+	header.lodCount = lodCount;
+	if (!GetSourceStamp(sourceFile, header.sourceSize, header.sourceTime))
+		return false;
+	memcpy(header.boundsMin, boundsMin, sizeof(float) * 3);
+	memcpy(header.boundsMax, boundsMax, sizeof(float) * 3);
+	header.boundsRadius = boundsRadius;
+
+	// Hash covers everything after the header
+	static const char padding[4] = {};
+	size_t indexBytes = (size_t)indexSize * indexCount;
+	size_t paddingBytes = IndexBytes(indexSize, indexCount) - indexBytes;
+	header.contentHash = Hash(vertices, (size_t)vertexSize * vertexCount);
+	header.contentHash = Hash(indices, indexBytes, header.contentHash);
+	header.contentHash = Hash(padding, paddingBytes, header.contentHash);
+	header.contentHash = Hash(lods, sizeof(MeshLod) * lodCount, header.contentHash);
+
+	// Write it all out next to the real file
+	// - The process id keeps two instances baking the same mesh apart
+#ifdef _WIN32
+	int processId = _getpid();
+#else
+	int processId = (int)getpid();
+#endif
+	std::string tempFile = std::string(cacheFile) + ".tmp" + std::to_string(processId);
+	{
+		std::ofstream out(tempFile, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+		out.write((const char*)&header, sizeof(MeshCacheHeader));
+		out.write((const char*)vertices, (size_t)vertexSize * vertexCount);
+		out.write((const char*)indices, indexBytes);
+		out.write(padding, paddingBytes);
+		out.write((const char*)lods, sizeof(MeshLod) * lodCount);
+		out.close();
+		if (!out.good())
+		{
+			remove(tempFile.c_str());
+			return false;
+		}
+	}
+
+	// Only a complete file ever takes the real name
+	return ReplaceFile(tempFile.c_str(), cacheFile);
+}
+
+// Maps and validates a baked mesh
+bool MeshCache::Open(const char* cacheFile, const char* sourceFile, uint32_t flags, uint32_t vertexSize, bool verifyContents)
+{
+	header = nullptr;
+	vertices = nullptr;
+	indices = nullptr;
+	lods = nullptr;
+
+	// Is there a file at all?
+	if (!file.Open(cacheFile) || file.GetSize() < sizeof(MeshCacheHeader))
+	{
+		file.Close();
+		return false;
+	}
+
+	// Make sure it's a bake we understand, made with the same options
+	const MeshCacheHeader* h = (const MeshCacheHeader*)file.GetData();
+	if (memcmp(h->magic, "MSHC", 4) != 0 ||
+		h->version != Version ||
+		h->vertexSize != vertexSize ||
+		h->flags != flags ||
+		(h->indexSize != 2 && h->indexSize != 4) ||
+		h->vertexCount == 0 ||
+		h->indexCount == 0 ||
+		h->lodCount == 0 ||
+		(h->indexSize == 2 && h->vertexCount > 65536))
+	{
+		file.Close();
+		return false;
+	}
+
+	// Is the file the size the header says it should be?
+	size_t expected = sizeof(MeshCacheHeader) +
+		(size_t)h->vertexCount * vertexSize +
+		IndexBytes(h->indexSize, h->indexCount) +
+		sizeof(MeshLod) * h->lodCount;
+	if (file.GetSize() != expected)
+	{
+		file.Close();
+		return false;
+	}
+
+	// Rebuild whenever the source has changed since the bake
+	// - A missing source is fine, the bake can ship on its own
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	if (GetSourceStamp(sourceFile, sourceSize, sourceTime) &&
+		(sourceSize != h->sourceSize || sourceTime != h->sourceTime))
+	{
+		file.Close();
+		return false;
+	}
+
+	// Point into the mapping
+	const char* v = file.GetData() + sizeof(MeshCacheHeader);
+	const char* i = v + (size_t)h->vertexCount * vertexSize;
+	const char* l = i + IndexBytes(h->indexSize, h->indexCount);
+
+	// Every LOD has to be a whole number of triangles inside the index array
+	// - The table is tiny, so this is checked even without the full hash
+	const MeshLod* lodTable = (const MeshLod*)l;
+	for (uint32_t lod = 0; lod < h->lodCount; lod++)
+	{
+		const MeshLod& range = lodTable[lod];
+		if (range.indexCount == 0 || range.indexCount % 3 != 0 ||
+			range.indexStart > h->indexCount ||
+			range.indexCount > h->indexCount - range.indexStart)
+		{
+			file.Close();
+			return false;
+		}
+	}
+
+	// Catch damaged files (writes are atomic, so this is rarely needed)
+	if (verifyContents)
+	{
+		uint64_t hash = Hash(v, (size_t)vertexSize * h->vertexCount);
+		hash = Hash(i, IndexBytes(h->indexSize, h->indexCount), hash);
+		hash = Hash(l, sizeof(MeshLod) * h->lodCount, hash);
+		if (hash != h->contentHash)
+		{
+			file.Close();
+			return false;
+		}
+	}
+
+	// All good
+	header = h;
+	vertices = v;
+	indices = i;
+	lods = lodTable;
+	return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "ObjParser.h"
+#include "MeshSimplifier.h"
+#include <cstdint>
+
+// Header at the very start of a baked mesh file
+// - Followed directly by the vertex array, the index array (padded to
+//   4 bytes) and then the LOD table
+// - Sized to a multiple of 16 bytes so the vertex data stays aligned
+struct MeshCacheHeader
+{
+	char magic[4];				// Always "MSHC"
+	uint32_t version;			// Bumped whenever the layout or the processing changes
+	uint32_t vertexSize;		// Size of one vertex (depends on the vertex format)
+	uint32_t flags;				// Options the mesh was baked with
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint64_t sourceSize;		// Size of the source OBJ file
+	int64_t sourceTime;			// Last modification time of the source OBJ file
+	uint64_t contentHash;		// Hash of the vertex and index data
+	float boundsMin[3];			// Object space bounding box
+	float boundsMax[3];
+	uint32_t indexSize;			// 2 or 4 bytes per index
+	uint32_t lodCount;			// Entries in the LOD table
+	float boundsRadius;			// Bounding sphere around the center of the box
+	uint32_t reserved[3];		// Keeps the header a multiple of 16 bytes
+};
+
+// Versioned binary container for a fully processed mesh
+// - Holds the final vertex array (tangents included, packed or not) and
+//   index array, so loading one is just a memory map and a buffer upload
+// - Pure C++, so bakes can be written and checked without a device
+class MeshCache
+{
+public:
+	static const uint32_t Version = 6;
+
+	// Whether Open hashes the whole payload when not told otherwise
+	// - On in debug builds, where catching a damaged bake matters more
+	//   than load time, and off in release where Open only checks the
+	//   header, the file size and the LOD table
+	static const bool VerifyContentsByDefault;
+
+	// Writes a baked mesh, returning false if the file can't be written
+	// or the mesh is empty
+	// - Goes to a temporary file first which is then renamed over the
+	//   old bake, so a crash part way through never leaves a truncated cache
+	static bool Write(const char* cacheFile, const char* sourceFile, uint32_t flags,
+		const void* vertices, uint32_t vertexSize, uint32_t vertexCount,
+		const void* indices, uint32_t indexSize, uint32_t indexCount,
+		const MeshLod* lods, uint32_t lodCount,
+		const float boundsMin[3], const float boundsMax[3], float boundsRadius);
+
+	// Maps a baked mesh, returning false if it is missing, corrupt, empty,
+	// from another version, has other sized vertices or older than its source file
+	// - verifyContents also compares the hash of the whole payload, which
+	//   costs about as much as reading the file once more
+	bool Open(const char* cacheFile, const char* sourceFile, uint32_t flags, uint32_t vertexSize,
+		bool verifyContents = VerifyContentsByDefault);
+
+	// Access to the mapped data (only valid while this object is open)
+	const MeshCacheHeader* GetHeader() const { return header; }
+	const void* GetVertices() const { return vertices; }
+	const void* GetIndices() const { return indices; }
+	const MeshLod* GetLods() const { return lods; }
+	size_t GetFileSize() const { return file.GetSize(); }
+
+	// 64-bit FNV-1a hash of a block of memory
+	static uint64_t Hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+private:
+	MappedFile file;
+	const MeshCacheHeader* header = nullptr;
+	const void* vertices = nullptr;
+	const void* indices = nullptr;
+	const MeshLod* lods = nullptr;
+
+	// Bytes taken up by the indices, including the padding after them
+	static size_t IndexBytes(uint32_t indexSize, uint32_t indexCount);
+	// Size and modification time of the source file
+	static bool GetSourceStamp(const char* sourceFile, uint64_t& size, int64_t& time);
+	// Moves a finished temporary file over the real one
+	static bool ReplaceFile(const char* tempFile, const char* cacheFile);
+};
@@ -0,0 +1,311 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+// Pulls the position of a vertex out of raw vertex bytes
+static inline const float* GetPosition(const void* vertices, size_t index, size_t stride, size_t offset)
+{
+	return (const float*)((const unsigned char*)vertices + index * stride + offset);
+}
+
+// Runs the full optimization pipeline
+size_t MeshOptimizer::Optimize(void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+	unsigned int* indices, size_t indexCount, MeshOptimizeStats* stats)
+{
+	if (stats)
+		stats->before = AnalyzeVertexCache(indices, indexCount, vertexCount);
+
+	// Triangle order first (vertex cache, then overdraw)
+	bool overdraw = OptimizeTriangles(vertices, vertexCount, vertexStride, positionOffset, indices, indexCount);
+
+	// Finally make the vertex buffer follow the new triangle order
+	size_t newVertexCount = OptimizeVertexFetch(vertices, vertexCount, vertexStride, indices, indexCount);
+
+	if (stats)
+	{
+		stats->after = AnalyzeVertexCache(indices, indexCount, newVertexCount);
+		stats->overdrawApplied = overdraw;
+	}
+	return newVertexCount;
+}
+
+// Cache order, keeping track of where clusters start, then whole clusters
+// shuffled around for early-z
+bool MeshOptimizer::OptimizeTriangles(const void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+	unsigned int* indices, size_t indexCount)
+{
+	std::vector<size_t> clusters;
+	OptimizeVertexCache(indices, indexCount, vertexCount, DefaultCacheSize, &clusters);
+	return OptimizeOverdraw(indices, indexCount, clusters, vertices, vertexCount, vertexStride, positionOffset);
+}
+
+// Tipsify, from "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+// (Sander, Nehab and Barczak 2007)
+// - Fans around one vertex at a time, picking the next vertex to fan
+//   around from the ones that are still likely to be in the cache
+void MeshOptimizer::OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount,
+	unsigned int cacheSize, std::vector<size_t>* clusters)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return;
+
+	// Build vertex -> triangle adjacency as one flat array
+	std::vector<unsigned int> live(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		live[indices[i]]++;
+
+	std::vector<size_t> adjacencyOffset(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + live[v];
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<size_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int c = 0; c < 3; c++)
+			adjacency[fill[indices[t * 3 + c]]++] = (unsigned int)t;
+	}
+
+	// Working state
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnd;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+	unsigned int timeStamp = cacheSize + 1;
+	size_t scanCursor = 0;
+
+	// Start from the first vertex of the first triangle
+	long long fanning = indices[0];
+	if (clusters)
+	{
+		clusters->clear();
+		clusters->push_back(0);
+	}
+
+	while (fanning >= 0)
+	{
+		// Emit every triangle still waiting around the fanning vertex
+		candidates.clear();
+		for (size_t a = adjacencyOffset[(size_t)fanning]; a < adjacencyOffset[(size_t)fanning + 1]; a++)
+		{
+			unsigned int t = adjacency[a];
+			if (emitted[t])
+				continue;
+
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned int v = indices[t * 3 + c];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+
+				// Not in the cache any more? It gets loaded now
+				if (timeStamp - cacheTime[v] > cacheSize)
+					cacheTime[v] = timeStamp++;
+			}
+			emitted[t] = true;
+		}
+
+		// Pick the candidate that will still be cached after its remaining fan
+		long long best = -1;
+		int bestPriority = -1;
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			unsigned int v = candidates[i];
+			if (live[v] == 0)
+				continue;
+
+			int priority = 0;
+			if (timeStamp - cacheTime[v] + 2 * live[v] <= cacheSize)
+				priority = (int)(timeStamp - cacheTime[v]);
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				best = v;
+			}
+		}
+
+		// Dead end, so fall back to recently used vertices, then to a scan
+		if (best < 0)
+		{
+			while (!deadEnd.empty() && best < 0)
+			{
+				unsigned int v = deadEnd.back();
+				deadEnd.pop_back();
+				if (live[v] > 0)
+					best = v;
+			}
+			while (best < 0 && scanCursor < vertexCount)
+			{
+				if (live[scanCursor] > 0)
+					best = (long long)scanCursor;
+				scanCursor++;
+			}
+
+			// Anything emitted after a dead end is a new cluster
+			if (best >= 0 && clusters && output.size() / 3 != clusters->back())
+				clusters->push_back(output.size() / 3);
+		}
+
+		fanning = best;
+	}
+
+	// Copy the new order back
+	memcpy(indices, output.data(), sizeof(unsigned int) * output.size());
+}
+
+// Sorts clusters by how much they face away from the mesh center
+// - Based on the view independent sort in the Tipsify paper: clusters on
+//   the outside of the mesh, facing outwards, are drawn first
+bool MeshOptimizer::OptimizeOverdraw(unsigned int* indices, size_t indexCount, const std::vector<size_t>& clusters,
+	const void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+	float threshold, unsigned int cacheSize)
+{
+	size_t triangleCount = indexCount / 3;
+	if (clusters.size() < 2 || triangleCount == 0)
+		return false;
+
+	// Center of the whole mesh, weighted by triangle area
+	float meshCenter[3] = { 0, 0, 0 };
+	float meshArea = 0;
+	std::vector<float> clusterData(clusters.size() * 7, 0.0f); // centroid * area, normal * area, area
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		size_t begin = clusters[c];
+		size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+		float* data = &clusterData[c * 7];
+		for (size_t t = begin; t < end; t++)
+		{
+			const float* p0 = GetPosition(vertices, indices[t * 3 + 0], vertexStride, positionOffset);
+			const float* p1 = GetPosition(vertices, indices[t * 3 + 1], vertexStride, positionOffset);
+			const float* p2 = GetPosition(vertices, indices[t * 3 + 2], vertexStride, positionOffset);
+
+			// Unnormalized normal, whose length is twice the area
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			for (int i = 0; i < 3; i++)
+			{
+				float centroid = (p0[i] + p1[i] + p2[i]) / 3.0f;
+				data[i] += centroid * area;
+				data[3 + i] += n[i];
+				meshCenter[i] += centroid * area;
+			}
+			data[6] += area;
+			meshArea += area;
+		}
+	}
+	if (meshArea <= 0)
+		return false;
+	for (int i = 0; i < 3; i++)
+		meshCenter[i] /= meshArea;
+
+	// Sort key: how far the cluster sits out along its own normal
+	std::vector<float> keys(clusters.size(), 0.0f);
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		const float* data = &clusterData[c * 7];
+		if (data[6] <= 0)
+			continue;
+		float normalLength = std::sqrt(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+		if (normalLength <= 0)
+			continue;
+		for (int i = 0; i < 3; i++)
+			keys[c] += (data[i] / data[6] - meshCenter[i]) * (data[3 + i] / normalLength);
+	}
+
+	// Stable sort, so the result is deterministic
+	std::vector<size_t> order(clusters.size());
+	for (size_t c = 0; c < order.size(); c++)
+		order[c] = c;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+	// Build the new triangle order
+	std::vector<unsigned int> sorted;
+	sorted.reserve(triangleCount * 3);
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		size_t c = order[i];
+		size_t begin = clusters[c];
+		size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+		sorted.insert(sorted.end(), indices + begin * 3, indices + end * 3);
+	}
+
+	// Only keep it if the vertex cache doesn't suffer much
+	float before = AnalyzeVertexCache(indices, triangleCount * 3, vertexCount, cacheSize).acmr;
+	float after = AnalyzeVertexCache(sorted.data(), sorted.size(), vertexCount, cacheSize).acmr;
+	if (after > before * threshold)
+		return false;
+
+	memcpy(indices, sorted.data(), sizeof(unsigned int) * sorted.size());
+	return true;
+}
+
+// Renumbers vertices in the order the index buffer first touches them
+size_t MeshOptimizer::OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexStride,
+	unsigned int* indices, size_t indexCount)
+{
+	const unsigned int unused = 0xFFFFFFFFu;
+	std::vector<unsigned int> remap(vertexCount, unused);
+	unsigned int next = 0;
+
+	// Assign new indices as vertices are first seen
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int& newIndex = remap[indices[i]];
+		if (newIndex == unused)
+			newIndex = next++;
+		indices[i] = newIndex;
+	}
+
+	// Move the vertex data to match
+	std::vector<unsigned char> original((unsigned char*)vertices, (unsigned char*)vertices + vertexCount * vertexStride);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		if (remap[v] != unused)
+			memcpy((unsigned char*)vertices + remap[v] * vertexStride, &original[v * vertexStride], vertexStride);
+	}
+	return next;
+}
+
+// Counts vertex shader invocations with a simulated FIFO cache
+MeshCacheStats MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+	unsigned int cacheSize)
+{
+	MeshCacheStats stats;
+	if (indexCount < 3 || vertexCount == 0)
+		return stats;
+
+	// A vertex is cached if it was loaded within the last cacheSize loads
+	std::vector<unsigned int> loadTime(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	unsigned int timeStamp = cacheSize + 1;
+	size_t misses = 0;
+	size_t uniqueVertices = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (timeStamp - loadTime[v] > cacheSize)
+		{
+			loadTime[v] = timeStamp++;
+			misses++;
+		}
+		if (!referenced[v])
+		{
+			referenced[v] = true;
+			uniqueVertices++;
+		}
+	}
+
+	stats.acmr = (float)misses / (indexCount / 3);
+	stats.atvr = (float)misses / uniqueVertices;
+	return stats;
+}
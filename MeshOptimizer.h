@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// Cache efficiency numbers for an indexed triangle list
+struct MeshCacheStats
+{
+	// Average cache miss ratio: vertex shader runs per triangle
+	// (3 is the worst case, ~0.5 is about the best a large mesh can do)
+	float acmr = 0;
+	// Average transform to vertex ratio: vertex shader runs per unique vertex
+	// (1 is perfect)
+	float atvr = 0;
+};
+
+// Before and after numbers from MeshOptimizer::Optimize
+struct MeshOptimizeStats
+{
+	MeshCacheStats before;
+	MeshCacheStats after;
+	// Was the overdraw cluster order kept? (It's thrown out if it hurts the cache too much)
+	bool overdrawApplied = false;
+};
+
+// Triangle and vertex reordering for indexed triangle lists
+// - Works on plain index arrays and raw vertex bytes, so it has no
+//   DirectX dependency and can be run on any platform
+class MeshOptimizer
+{
+public:
+	// Size of the simulated post transform vertex cache
+	static const unsigned int DefaultCacheSize = 16;
+
+	// Runs every pass below in order: vertex cache, overdraw, vertex fetch
+	// - positionOffset is the byte offset of the float3 position inside a
+	//   vertex, and vertexStride is the distance between vertices in bytes
+	// - The vertex array is reordered in place, and the return value is
+	//   the new vertex count (unreferenced vertices are dropped)
+	static size_t Optimize(void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+		unsigned int* indices, size_t indexCount, MeshOptimizeStats* stats = nullptr);
+
+	// Just the vertex cache and overdraw passes, for extra index ranges
+	// (like LODs) that share a vertex buffer whose order is already set
+	// - Returns whether the overdraw order was kept
+	static bool OptimizeTriangles(const void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+		unsigned int* indices, size_t indexCount);
+
+	// Reorders triangles for the post transform vertex cache (Tipsify)
+	// - clusters receives the first triangle of each run that ended in a
+	//   dead end, which are the safe places to reorder for overdraw
+	static void OptimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount,
+		unsigned int cacheSize = DefaultCacheSize, std::vector<size_t>* clusters = nullptr);
+
+	// Sorts the clusters found by OptimizeVertexCache so outward facing
+	// ones, which are most likely to occlude the rest, are drawn first
+	// - Returns false (leaving the indices untouched) if the new order
+	//   would raise the ACMR by more than the given threshold
+	static bool OptimizeOverdraw(unsigned int* indices, size_t indexCount, const std::vector<size_t>& clusters,
+		const void* vertices, size_t vertexCount, size_t vertexStride, size_t positionOffset,
+		float threshold = 1.05f, unsigned int cacheSize = DefaultCacheSize);
+
+	// Reorders vertices so they appear in the order they're first used
+	// - Returns the new vertex count
+	static size_t OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t vertexStride,
+		unsigned int* indices, size_t indexCount);
+
+	// Simulates a FIFO vertex cache to measure ACMR and ATVR
+	static MeshCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+		unsigned int cacheSize = DefaultCacheSize);
+};
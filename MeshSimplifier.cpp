@@ -0,0 +1,404 @@
+#include "MeshSimplifier.h"
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+// Plane of a triangle, weighted by its area so big triangles matter more
+void MeshSimplifier::AddPlane(Quadric& q, const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+{
+	double e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+	double e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+	double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+	double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	if (length <= 0.0)
+		return;
+
+	// |n| is twice the area, so the unit normal times the area is n / 2
+	double area = length * 0.5;
+	n[0] /= length;
+	n[1] /= length;
+	n[2] /= length;
+	double d = -(n[0] * p0.x + n[1] * p0.y + n[2] * p0.z);
+
+	q.a00 += area * n[0] * n[0];
+	q.a01 += area * n[0] * n[1];
+	q.a02 += area * n[0] * n[2];
+	q.a11 += area * n[1] * n[1];
+	q.a12 += area * n[1] * n[2];
+	q.a22 += area * n[2] * n[2];
+	q.b0 += area * n[0] * d;
+	q.b1 += area * n[1] * d;
+	q.b2 += area * n[2] * d;
+	q.c += area * d * d;
+	q.weight += area;
+}
+
+void MeshSimplifier::AddQuadric(Quadric& q, const Quadric& other)
+{
+	q.a00 += other.a00;
+	q.a01 += other.a01;
+	q.a02 += other.a02;
+	q.a11 += other.a11;
+	q.a12 += other.a12;
+	q.a22 += other.a22;
+	q.b0 += other.b0;
+	q.b1 += other.b1;
+	q.b2 += other.b2;
+	q.c += other.c;
+	q.weight += other.weight;
+}
+
+// Error of the two quadrics combined, without building the sum
+double MeshSimplifier::Evaluate(const Quadric& q, const Quadric& other, const XMFLOAT3& p)
+{
+	double x = p.x, y = p.y, z = p.z;
+	double a00 = q.a00 + other.a00, a01 = q.a01 + other.a01, a02 = q.a02 + other.a02;
+	double a11 = q.a11 + other.a11, a12 = q.a12 + other.a12, a22 = q.a22 + other.a22;
+	double b0 = q.b0 + other.b0, b1 = q.b1 + other.b1, b2 = q.b2 + other.b2;
+	double weight = q.weight + other.weight;
+
+	double error =
+		a00 * x * x + a11 * y * y + a22 * z * z +
+		2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+		2.0 * (b0 * x + b1 * y + b2 * z) +
+		q.c + other.c;
+	return weight > 0.0 ? fabs(error) / weight : 0.0;
+}
+
+// Greedy edge collapse in passes
+// - Each pass sorts every possible collapse by error, then takes as many
+//   as it can that don't touch each other, so the adjacency used to check
+//   them stays valid until the pass is done
+// - Based on the approach used by meshoptimizer's simplifier
+size_t MeshSimplifier::Simplify(const XMFLOAT3* positions, size_t vertexCount,
+	const uint32_t* indices, size_t indexCount, uint32_t* out, size_t targetIndexCount,
+	float maxError, float* resultError, size_t* lockedVertices)
+{
+	size_t triangleCount = indexCount / 3;
+	size_t targetTriangles = targetIndexCount / 3;
+	memcpy(out, indices, triangleCount * 3 * sizeof(uint32_t));
+	if (resultError)
+		*resultError = 0.0f;
+	if (triangleCount <= targetTriangles)
+		return triangleCount * 3;
+
+	// Group vertices by exact position
+	// - A group of more than one is a UV or normal seam
+	std::vector<uint32_t> group(vertexCount);
+	{
+		struct PositionHash
+		{
+			size_t operator()(const XMFLOAT3& p) const
+			{
+				uint32_t bits[3];
+				memcpy(bits, &p, sizeof(bits));
+				return (size_t)(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+			}
+		};
+		struct PositionEqual
+		{
+			bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const
+			{
+				return a.x == b.x && a.y == b.y && a.z == b.z;
+			}
+		};
+		std::unordered_map<XMFLOAT3, uint32_t, PositionHash, PositionEqual> lookup;
+		lookup.reserve(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			group[v] = lookup.insert(std::make_pair(positions[v], (uint32_t)v)).first->second;
+		}
+	}
+
+	// Copies of each position, so a seam can be moved as one
+	std::vector<uint32_t> memberOffset(vertexCount + 1, 0);
+	std::vector<uint32_t> members(vertexCount);
+	{
+		for (size_t v = 0; v < vertexCount; v++)
+			memberOffset[group[v] + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			memberOffset[v + 1] += memberOffset[v];
+		std::vector<uint32_t> fill(memberOffset.begin(), memberOffset.end() - 1);
+		for (size_t v = 0; v < vertexCount; v++)
+			members[fill[group[v]]++] = (uint32_t)v;
+	}
+
+	// Lock anything on an edge that doesn't have exactly two triangles
+	// (open borders and non-manifold edges)
+	// - Edges are compared by position group, so seam edges count as shared
+	// - Everything below works on position groups, so locked, touched and
+	//   the quadrics are all indexed by group
+	std::vector<bool> locked(vertexCount, false);
+	{
+		std::unordered_map<uint64_t, uint32_t> edgeUses;
+		edgeUses.reserve(triangleCount * 3);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				uint32_t a = group[indices[t * 3 + e]];
+				uint32_t b = group[indices[t * 3 + (e + 1) % 3]];
+				uint64_t key = a < b ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+				edgeUses[key]++;
+			}
+		}
+		for (auto& edge : edgeUses)
+		{
+			if (edge.second != 2)
+			{
+				locked[(uint32_t)(edge.first >> 32)] = true;
+				locked[(uint32_t)edge.first] = true;
+			}
+		}
+	}
+	if (lockedVertices)
+	{
+		*lockedVertices = 0;
+		for (size_t v = 0; v < vertexCount; v++)
+			*lockedVertices += locked[group[v]] ? 1 : 0;
+	}
+
+	// Every position group starts with the planes of the triangles around it
+	std::vector<Quadric> quadrics(vertexCount);
+	memset(quadrics.data(), 0, quadrics.size() * sizeof(Quadric));
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const uint32_t* tri = &indices[t * 3];
+		for (int c = 0; c < 3; c++)
+			AddPlane(quadrics[group[tri[c]]], positions[tri[0]], positions[tri[1]], positions[tri[2]]);
+	}
+
+	// Does moving vertex "from" onto "to" turn any of its triangles over?
+	std::vector<uint32_t> adjacencyOffset(vertexCount + 1);
+	std::vector<uint32_t> adjacency;
+	auto flips = [&](uint32_t from, uint32_t to)
+	{
+		for (uint32_t a = adjacencyOffset[from]; a < adjacencyOffset[from + 1]; a++)
+		{
+			const uint32_t* tri = &out[adjacency[a] * 3];
+			if (tri[0] == to || tri[1] == to || tri[2] == to)
+				continue;
+
+			// Normal before and after the move
+			XMVECTOR p[3];
+			XMVECTOR moved[3];
+			for (int c = 0; c < 3; c++)
+			{
+				p[c] = XMLoadFloat3(&positions[tri[c]]);
+				moved[c] = tri[c] == from ? XMLoadFloat3(&positions[to]) : p[c];
+			}
+			XMVECTOR before = XMVector3Cross(XMVectorSubtract(p[1], p[0]), XMVectorSubtract(p[2], p[0]));
+			XMVECTOR after = XMVector3Cross(XMVectorSubtract(moved[1], moved[0]), XMVectorSubtract(moved[2], moved[0]));
+
+			// Anything more than ~75 degrees of turn (or a squashed triangle) counts
+			float d = XMVectorGetX(XMVector3Dot(before, after));
+			float limit = 0.25f * XMVectorGetX(XMVector3Length(before)) * XMVectorGetX(XMVector3Length(after));
+			if (d <= limit)
+				return true;
+		}
+		return false;
+	};
+
+	// Which copy of position group "to" each copy of vertex "from" moves onto
+	// - It has to be a copy that shares an edge with it, so every copy stays
+	//   on its own side of a seam and seams can only slide along themselves
+	// - Fails if any copy that's still in use has none (the edge crosses
+	//   one side of a seam) or more than one (the seam splits right there)
+	std::vector<uint32_t> partner(vertexCount);
+	auto findPartners = [&](uint32_t from, uint32_t to)
+	{
+		for (uint32_t m = memberOffset[from]; m < memberOffset[from + 1]; m++)
+		{
+			uint32_t copy = members[m];
+			uint32_t found = UINT32_MAX;
+			for (uint32_t a = adjacencyOffset[copy]; a < adjacencyOffset[copy + 1]; a++)
+			{
+				const uint32_t* tri = &out[adjacency[a] * 3];
+				for (int c = 0; c < 3; c++)
+				{
+					if (group[tri[c]] != to)
+						continue;
+					if (found != UINT32_MAX && found != tri[c])
+						return false;
+					found = tri[c];
+				}
+			}
+			if (found == UINT32_MAX && adjacencyOffset[copy] != adjacencyOffset[copy + 1])
+				return false;
+			partner[copy] = found;
+		}
+		return true;
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double error;
+	};
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	double maxErrorSq = maxError < FLT_MAX ? (double)maxError * maxError : DBL_MAX;
+	double worstError = 0.0;
+
+	while (triangleCount > targetTriangles)
+	{
+		// Vertex -> triangle adjacency for the current triangles
+		std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+			adjacencyOffset[out[i] + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacencyOffset[v + 1] += adjacencyOffset[v];
+		adjacency.resize(triangleCount * 3);
+		std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int c = 0; c < 3; c++)
+				adjacency[fill[out[t * 3 + c]]++] = (uint32_t)t;
+		}
+
+		// Every way an edge can be collapsed, cheapest first
+		// - Ties go to the lower indices, so the result is the same every run
+		collapses.clear();
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				uint32_t a = group[out[t * 3 + e]];
+				uint32_t b = group[out[t * 3 + (e + 1) % 3]];
+				if (!locked[a])
+					collapses.push_back({ a, b, Evaluate(quadrics[a], quadrics[b], positions[b]) });
+				if (!locked[b])
+					collapses.push_back({ b, a, Evaluate(quadrics[b], quadrics[a], positions[a]) });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y)
+		{
+			if (x.error != y.error)
+				return x.error < y.error;
+			return x.from != y.from ? x.from < y.from : x.to < y.to;
+		});
+
+		// Take every collapse that doesn't overlap one already taken
+		for (size_t v = 0; v < vertexCount; v++)
+			remap[v] = (uint32_t)v;
+		std::fill(touched.begin(), touched.end(), false);
+		size_t remaining = triangleCount;
+		size_t applied = 0;
+		for (size_t i = 0; i < collapses.size() && remaining > targetTriangles; i++)
+		{
+			// Each edge shows up once per triangle and seam side
+			const Collapse& collapse = collapses[i];
+			if (i > 0 && collapse.from == collapses[i - 1].from && collapse.to == collapses[i - 1].to)
+				continue;
+			if (collapse.error > maxErrorSq)
+				break;
+			if (touched[collapse.from] || touched[collapse.to] || !findPartners(collapse.from, collapse.to))
+				continue;
+
+			// Every copy has to be able to move without flipping anything
+			bool flipped = false;
+			for (uint32_t m = memberOffset[collapse.from]; m < memberOffset[collapse.from + 1] && !flipped; m++)
+			{
+				uint32_t copy = members[m];
+				flipped = partner[copy] != UINT32_MAX && flips(copy, partner[copy]);
+			}
+			if (flipped)
+				continue;
+
+			AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+			worstError = std::max(worstError, collapse.error);
+			applied++;
+
+			// Move every copy, lock down the neighborhood for the rest of
+			// the pass, and count the triangles that are about to disappear
+			for (uint32_t m = memberOffset[collapse.from]; m < memberOffset[collapse.from + 1]; m++)
+			{
+				uint32_t copy = members[m];
+				if (partner[copy] == UINT32_MAX)
+					continue;
+				remap[copy] = partner[copy];
+				for (uint32_t a = adjacencyOffset[copy]; a < adjacencyOffset[copy + 1]; a++)
+				{
+					const uint32_t* tri = &out[adjacency[a] * 3];
+					if (tri[0] == partner[copy] || tri[1] == partner[copy] || tri[2] == partner[copy])
+						remaining--;
+					for (int c = 0; c < 3; c++)
+						touched[group[tri[c]]] = true;
+				}
+			}
+		}
+
+		// Nothing left that can be collapsed
+		if (applied == 0)
+			break;
+
+		// Rewrite the triangles, dropping the ones that collapsed to nothing
+		size_t written = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			uint32_t a = remap[out[t * 3 + 0]];
+			uint32_t b = remap[out[t * 3 + 1]];
+			uint32_t c = remap[out[t * 3 + 2]];
+			if (group[a] == group[b] || group[b] == group[c] || group[a] == group[c])
+				continue;
+			out[written * 3 + 0] = a;
+			out[written * 3 + 1] = b;
+			out[written * 3 + 2] = c;
+			written++;
+		}
+		triangleCount = written;
+	}
+
+	if (resultError)
+		*resultError = (float)sqrt(worstError);
+	return triangleCount * 3;
+}
+
+// Each level is simplified from the original triangles, so errors don't
+// pile up from one level to the next
+void MeshSimplifier::BuildLods(const XMFLOAT3* positions, size_t vertexCount,
+	std::vector<uint32_t>& indices, std::vector<MeshLod>& lods, MeshSimplifyStats* stats,
+	size_t maxLods, float ratio)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	size_t baseCount = indices.size() / 3 * 3;
+	lods.clear();
+	lods.push_back({ 0, (uint32_t)baseCount, 0.0f });
+
+	std::vector<uint32_t> simplified(baseCount);
+	size_t locked = 0;
+	double target = (double)(baseCount / 3);
+	for (size_t level = 1; level < maxLods; level++)
+	{
+		target *= ratio;
+		float error = 0.0f;
+		size_t count = Simplify(positions, vertexCount, indices.data(), baseCount, simplified.data(),
+			(size_t)target * 3, FLT_MAX, &error, &locked);
+
+		// Not worth another draw range unless it's at least 10% smaller
+		const MeshLod& previous = lods.back();
+		if (count == 0 || count * 10 > (size_t)previous.indexCount * 9)
+			break;
+
+		// Errors have to grow with the level for LOD selection to make sense
+		MeshLod lod;
+		lod.indexStart = (uint32_t)indices.size();
+		lod.indexCount = (uint32_t)count;
+		lod.error = std::max(error, previous.error);
+		lods.push_back(lod);
+		indices.insert(indices.end(), simplified.begin(), simplified.begin() + count);
+	}
+
+	if (stats)
+	{
+		stats->lodCount = lods.size();
+		stats->lockedVertices = locked;
+		stats->seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
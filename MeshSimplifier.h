@@ -0,0 +1,76 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cfloat>
+
+// One level of detail, as a range of a mesh's index buffer
+// - Every level shares the same vertex buffer
+struct MeshLod
+{
+	uint32_t indexStart;
+	uint32_t indexCount;
+	// Roughly how far the simplified surface strays from the original,
+	// in object space units (0 for the full mesh)
+	float error;
+};
+
+// What building a LOD chain did
+struct MeshSimplifyStats
+{
+	// Levels made, including the full mesh
+	size_t lodCount = 0;
+	// Vertices that were never moved because they're on an open edge
+	size_t lockedVertices = 0;
+	double seconds = 0;
+};
+
+// Quadric error metric simplification of indexed triangle lists
+// - Collapses edges onto existing vertices, so the simplified triangles
+//   can keep using the original vertex buffer
+// - Vertices that share a position with another vertex (UV and normal
+//   seams) only collapse along the seam, with every copy moving onto the
+//   matching copy on its own side, so seams don't tear
+// - Vertices on open edges are never moved
+// - Doesn't need DirectX, so it can be built and checked without a GPU
+class MeshSimplifier
+{
+public:
+	// Levels in a default chain (full, 1/2, 1/4 and 1/8 of the triangles)
+	static const size_t DefaultLodCount = 4;
+
+	// Simplifies towards targetIndexCount indices, writing the result to out
+	// (which needs room for indexCount indices) and returning how many were written
+	// - Stops early if the next collapse would move the surface more than maxError
+	// - resultError receives the error of the result, in object space units
+	static size_t Simplify(const DirectX::XMFLOAT3* positions, size_t vertexCount,
+		const uint32_t* indices, size_t indexCount, uint32_t* out, size_t targetIndexCount,
+		float maxError = FLT_MAX, float* resultError = nullptr, size_t* lockedVertices = nullptr);
+
+	// Appends a chain of simplified versions of the triangles to indices
+	// - Each level aims for ratio times the triangles of the one before it,
+	//   and the chain ends early once a level stops getting smaller
+	// - lods receives every level, starting with the original triangles
+	// - Levels come out in simplification order, so run them through
+	//   MeshOptimizer::OptimizeTriangles before drawing them
+	static void BuildLods(const DirectX::XMFLOAT3* positions, size_t vertexCount,
+		std::vector<uint32_t>& indices, std::vector<MeshLod>& lods, MeshSimplifyStats* stats = nullptr,
+		size_t maxLods = DefaultLodCount, float ratio = 0.5f);
+
+private:
+	// Sum of squared distances to a set of planes, weighted by triangle area
+	// - Symmetric 4x4 matrix [A b; b c] plus the total weight
+	struct Quadric
+	{
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double weight;
+	};
+
+	static void AddPlane(Quadric& q, const DirectX::XMFLOAT3& p0, const DirectX::XMFLOAT3& p1, const DirectX::XMFLOAT3& p2);
+	static void AddQuadric(Quadric& q, const Quadric& other);
+	// Average squared distance from p to the planes
+	static double Evaluate(const Quadric& q, const Quadric& other, const DirectX::XMFLOAT3& p);
+};
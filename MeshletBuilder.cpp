@@ -0,0 +1,243 @@
+#include "MeshletBuilder.h"
+#include <chrono>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+using namespace DirectX;
+
+// Grows one meshlet at a time, always adding the neighboring triangle
+// that needs the fewest new vertices
+// - Based on the greedy approach used by meshoptimizer's meshlet builder
+void MeshletBuilder::Build(const XMFLOAT3* positions, size_t vertexCount,
+	const uint32_t* indices, size_t indexCount, MeshletData& out, MeshletStats* stats,
+	size_t maxVertices, size_t maxTriangles)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	out.meshlets.clear();
+	out.vertices.clear();
+	out.triangles.clear();
+
+	size_t triangleCount = indexCount / 3;
+	maxVertices = std::max<size_t>(3, std::min<size_t>(256, maxVertices));
+	maxTriangles = std::max<size_t>(1, maxTriangles);
+
+	// Build vertex -> triangle adjacency as one flat array
+	std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		adjacencyOffset[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyOffset[v + 1] += adjacencyOffset[v];
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int c = 0; c < 3; c++)
+			adjacency[fill[indices[t * 3 + c]]++] = (uint32_t)t;
+	}
+
+	// Working state
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<int> local(vertexCount, -1);	// Index in the current meshlet, or -1
+	Meshlet current = {};
+	size_t lastTriangle = 0;
+	size_t seedCursor = 0;
+
+	// How many vertices a triangle would add to the current meshlet
+	auto newVertices = [&](size_t t)
+	{
+		int count = 0;
+		for (int c = 0; c < 3; c++)
+			count += local[indices[t * 3 + c]] < 0 ? 1 : 0;
+		return count;
+	};
+
+	// Picks the best unused triangle touching any of the given vertices
+	auto findCandidate = [&](const uint32_t* vertices, size_t count, long long& best, int& bestNew)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			uint32_t v = vertices[i];
+			for (uint32_t a = adjacencyOffset[v]; a < adjacencyOffset[v + 1]; a++)
+			{
+				uint32_t t = adjacency[a];
+				if (emitted[t])
+					continue;
+
+				// Lowest triangle index breaks ties, keeping things deterministic
+				int extra = newVertices(t);
+				if (extra < bestNew || (extra == bestNew && (long long)t < best))
+				{
+					best = t;
+					bestNew = extra;
+				}
+			}
+		}
+	};
+
+	// Puts a triangle into the current meshlet
+	auto addTriangle = [&](size_t t)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			uint32_t v = indices[t * 3 + c];
+			if (local[v] < 0)
+			{
+				local[v] = (int)current.vertexCount++;
+				out.vertices.push_back(v);
+			}
+			out.triangles.push_back((uint8_t)local[v]);
+		}
+		current.triangleCount++;
+		emitted[t] = true;
+		lastTriangle = t;
+	};
+
+	// Closes off the current meshlet and starts an empty one
+	auto finishMeshlet = [&]()
+	{
+		if (current.triangleCount == 0)
+			return;
+
+		ComputeBounds(current, out, positions);
+		out.meshlets.push_back(current);
+
+		for (uint32_t i = 0; i < current.vertexCount; i++)
+			local[out.vertices[current.vertexOffset + i]] = -1;
+
+		current = {};
+		current.vertexOffset = (uint32_t)out.vertices.size();
+		current.triangleOffset = (uint32_t)out.triangles.size();
+	};
+
+	for (size_t added = 0; added < triangleCount; added++)
+	{
+		long long best = -1;
+		int bestNew = 4;
+
+		if (current.triangleCount > 0)
+		{
+			// Neighbors of the last triangle first, then anything touching the meshlet
+			findCandidate(&indices[lastTriangle * 3], 3, best, bestNew);
+			if (best < 0)
+				findCandidate(&out.vertices[current.vertexOffset], current.vertexCount, best, bestNew);
+
+			// Doesn't fit (or nothing is connected), so start a new meshlet
+			// - A triangle that didn't fit seeds the next one, keeping it nearby
+			if (best < 0 || current.vertexCount + bestNew > maxVertices || current.triangleCount + 1 > maxTriangles)
+				finishMeshlet();
+		}
+
+		// Empty meshlet and nothing nearby, so take the next unused triangle
+		if (best < 0)
+		{
+			while (emitted[seedCursor])
+				seedCursor++;
+			best = (long long)seedCursor;
+		}
+
+		addTriangle((size_t)best);
+	}
+	finishMeshlet();
+
+	if (stats)
+	{
+		stats->meshletCount = out.meshlets.size();
+		if (!out.meshlets.empty())
+		{
+			stats->vertexFill = (float)out.vertices.size() / (out.meshlets.size() * maxVertices);
+			stats->triangleFill = (float)(out.triangles.size() / 3) / (out.meshlets.size() * maxTriangles);
+		}
+		stats->seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+// Bounding sphere from the box around the vertices, and a normal cone
+// from the average of the triangle normals
+void MeshletBuilder::ComputeBounds(Meshlet& meshlet, const MeshletData& data, const XMFLOAT3* positions)
+{
+	const uint32_t* vertices = &data.vertices[meshlet.vertexOffset];
+	const uint8_t* triangles = &data.triangles[meshlet.triangleOffset];
+
+	// Sphere around the center of the box
+	float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+	{
+		const float* p = &positions[vertices[i]].x;
+		for (int a = 0; a < 3; a++)
+		{
+			lo[a] = std::min(lo[a], p[a]);
+			hi[a] = std::max(hi[a], p[a]);
+		}
+	}
+	meshlet.center = XMFLOAT3((lo[0] + hi[0]) * 0.5f, (lo[1] + hi[1]) * 0.5f, (lo[2] + hi[2]) * 0.5f);
+
+	float radiusSq = 0;
+	for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+	{
+		const XMFLOAT3& p = positions[vertices[i]];
+		float dx = p.x - meshlet.center.x;
+		float dy = p.y - meshlet.center.y;
+		float dz = p.z - meshlet.center.z;
+		radiusSq = std::max(radiusSq, dx * dx + dy * dy + dz * dz);
+	}
+	meshlet.radius = sqrtf(radiusSq);
+
+	// Unit normal of every triangle
+	// - cross(p1 - p0, p2 - p0) points out of the front face with our winding
+	std::vector<XMFLOAT3> normals;
+	normals.reserve(meshlet.triangleCount);
+	float axis[3] = { 0, 0, 0 };
+	for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+	{
+		const XMFLOAT3& p0 = positions[vertices[triangles[t * 3 + 0]]];
+		const XMFLOAT3& p1 = positions[vertices[triangles[t * 3 + 1]]];
+		const XMFLOAT3& p2 = positions[vertices[triangles[t * 3 + 2]]];
+		float e1[3] = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+		float e2[3] = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+		float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+		// Slivers don't face any particular way
+		if (length <= 0.0f)
+			continue;
+		normals.push_back(XMFLOAT3(n[0] / length, n[1] / length, n[2] / length));
+		for (int a = 0; a < 3; a++)
+			axis[a] += n[a] / length;
+	}
+
+	// No useful cone unless every normal is within 90 degrees of the axis
+	meshlet.coneAxis = XMFLOAT3(0, 0, 0);
+	meshlet.coneCutoff = 1.0f;
+	float axisLength = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	if (axisLength <= 0.0f)
+		return;
+	meshlet.coneAxis = XMFLOAT3(axis[0] / axisLength, axis[1] / axisLength, axis[2] / axisLength);
+
+	float minDot = 1.0f;
+	for (size_t i = 0; i < normals.size(); i++)
+	{
+		float d = normals[i].x * meshlet.coneAxis.x + normals[i].y * meshlet.coneAxis.y + normals[i].z * meshlet.coneAxis.z;
+		minDot = std::min(minDot, d);
+	}
+	if (minDot > 0.0f)
+		meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+// Cone test against the whole bounding sphere
+// - From "Optimizing the Graphics Pipeline with Compute" (Wihlidal 2016), as
+//   used by meshoptimizer: dot(center - camera, axis) >= cutoff * |center - camera| + radius
+bool MeshletBuilder::IsBackfacing(const Meshlet& meshlet, const XMFLOAT3& cameraPosition)
+{
+	if (meshlet.coneCutoff >= 1.0f)
+		return false;
+
+	float dx = meshlet.center.x - cameraPosition.x;
+	float dy = meshlet.center.y - cameraPosition.y;
+	float dz = meshlet.center.z - cameraPosition.z;
+	float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+	float along = dx * meshlet.coneAxis.x + dy * meshlet.coneAxis.y + dz * meshlet.coneAxis.z;
+	return along >= meshlet.coneCutoff * distance + meshlet.radius;
+}
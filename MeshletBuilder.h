@@ -0,0 +1,70 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// One small cluster of triangles from a mesh
+struct Meshlet
+{
+	// Where this meshlet's data starts in MeshletData
+	uint32_t vertexOffset;		// First entry in MeshletData::vertices
+	uint32_t triangleOffset;	// First byte in MeshletData::triangles
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+
+	// Object space bounding sphere
+	DirectX::XMFLOAT3 center;
+	float radius;
+
+	// Normal cone: every triangle's normal is within the cone around the axis
+	// - coneCutoff is the sine of the cone's half angle, or 1 when the
+	//   triangles face too many ways for the cone to be useful
+	DirectX::XMFLOAT3 coneAxis;
+	float coneCutoff;
+};
+
+// Every meshlet of a mesh, sharing two flat arrays
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	// Indices into the mesh's vertex buffer
+	std::vector<uint32_t> vertices;
+	// 3 bytes per triangle, each one indexing into that meshlet's vertices
+	std::vector<uint8_t> triangles;
+};
+
+// How well the triangles were packed into meshlets
+struct MeshletStats
+{
+	size_t meshletCount = 0;
+	// Average fraction of the vertex and triangle limits that got used
+	float vertexFill = 0;
+	float triangleFill = 0;
+	double seconds = 0;
+};
+
+// Splits an indexed triangle list into meshlets for finer grained culling
+// - Meshlets are grown from neighboring triangles, so they stay compact
+// - The result depends only on the input, so it's the same on every run
+// - Doesn't need DirectX, so it can be built and checked without a GPU
+class MeshletBuilder
+{
+public:
+	static const size_t MaxVertices = 64;
+	static const size_t MaxTriangles = 124;
+
+	// Builds meshlets out of the given triangles
+	// - maxVertices can't be more than 256, since local indices are bytes
+	static void Build(const DirectX::XMFLOAT3* positions, size_t vertexCount,
+		const uint32_t* indices, size_t indexCount, MeshletData& out, MeshletStats* stats = nullptr,
+		size_t maxVertices = MaxVertices, size_t maxTriangles = MaxTriangles);
+
+	// Can this meshlet be skipped because every triangle faces away from the camera?
+	// - cameraPosition must be in the same space as the meshlet (object space)
+	static bool IsBackfacing(const Meshlet& meshlet, const DirectX::XMFLOAT3& cameraPosition);
+
+private:
+	// Fills in the sphere and cone of a finished meshlet
+	static void ComputeBounds(Meshlet& meshlet, const MeshletData& data, const DirectX::XMFLOAT3* positions);
+};
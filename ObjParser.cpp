@@ -0,0 +1,455 @@
+#include "ObjParser.h"
+#include <chrono>
+#include <cstdint>
+#include <climits>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <functional>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Memory mapped file ---------------------------------------------------------
+
+MappedFile::MappedFile()
+{
+	data = nullptr;
+	size = 0;
+#ifdef _WIN32
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+// Maps the entire file as read only
+bool MappedFile::Open(const char* file)
+{
+	// Only one mapping at a time
+	Close();
+
+#ifdef _WIN32
+	// Open the file itself
+	fileHandle = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	// Empty files can't be mapped, but they're still valid (and empty)
+	LARGE_INTEGER fileSize = {};
+	GetFileSizeEx(fileHandle, &fileSize);
+	size = (size_t)fileSize.QuadPart;
+	if (size == 0)
+		return true;
+
+	// Map the whole thing
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle == nullptr)
+	{
+		Close();
+		return false;
+	}
+	data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+	// Open the file itself
+	int fd = open(file, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	// Empty files can't be mapped, but they're still valid (and empty)
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	size = (size_t)info.st_size;
+	if (size == 0)
+	{
+		close(fd);
+		return true;
+	}
+
+	// Map the whole thing, the mapping stays valid after the descriptor closes
+	void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	data = (view == MAP_FAILED) ? nullptr : (const char*)view;
+	if (data)
+		madvise(view, size, MADV_SEQUENTIAL);
+#endif
+
+	// Did the mapping work?
+	if (data == nullptr)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+// Unmaps the file and releases the handles
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (data) munmap((void*)data, size);
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+
+// Parsing helpers ------------------------------------------------------------
+
+// Spaces and tabs separate tokens, '\r' is treated the same so CRLF files work
+static inline bool IsBlank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool IsDigit(char c)
+{
+	return (unsigned char)(c - '0') < 10;
+}
+
+static inline void SkipBlanks(const char*& cursor, const char* end)
+{
+	while (cursor < end && IsBlank(*cursor))
+		cursor++;
+}
+
+static inline void SkipLine(const char*& cursor, const char* end)
+{
+	while (cursor < end && *cursor != '\n')
+		cursor++;
+	if (cursor < end)
+		cursor++;
+}
+
+// Converts a 1-based (or negative, relative) OBJ index to a 0-based one
+// - Relative indices set the given flag so chunked parsing can fix them up
+static inline int ResolveIndex(int index, size_t count, unsigned char& relative, unsigned char flag)
+{
+	if (index > 0) return index - 1;
+	if (index < 0) { relative |= flag; return (int)count + index; }
+	return -1;
+}
+
+// Powers of ten that are exactly representable as doubles
+static const double powersOfTen[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Reads a floating point number like "-1.25e-3"
+float ObjParser::ParseFloat(const char*& cursor, const char* end)
+{
+	SkipBlanks(cursor, end);
+
+	// Sign
+	bool negative = false;
+	if (cursor < end && (*cursor == '-' || *cursor == '+'))
+	{
+		negative = (*cursor == '-');
+		cursor++;
+	}
+
+	// Gather up to 19 significant digits, any beyond that only move the exponent
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	while (cursor < end && IsDigit(*cursor))
+	{
+		if (digits < 19) { mantissa = mantissa * 10 + (*cursor - '0'); if (mantissa) digits++; }
+		else exponent++;
+		cursor++;
+	}
+
+	// Fractional part
+	if (cursor < end && *cursor == '.')
+	{
+		cursor++;
+		while (cursor < end && IsDigit(*cursor))
+		{
+			if (digits < 19) { mantissa = mantissa * 10 + (*cursor - '0'); if (mantissa) digits++; exponent--; }
+			cursor++;
+		}
+	}
+
+	// Exponent part
+	if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+	{
+		cursor++;
+		int written = ParseInt(cursor, end);
+		exponent = (int)std::max<int64_t>(INT_MIN, std::min<int64_t>(INT_MAX, (int64_t)exponent + written));
+	}
+
+	// Scale the mantissa, exactly when the exponent fits in the table
+	double value = (double)mantissa;
+	if (exponent < 0)
+		value = (exponent >= -22) ? value / powersOfTen[-exponent] : value * std::pow(10.0, exponent);
+	else if (exponent > 0)
+		value = (exponent <= 22) ? value * powersOfTen[exponent] : value * std::pow(10.0, exponent);
+
+	return (float)(negative ? -value : value);
+}
+
+// Reads a (possibly signed) integer
+int ObjParser::ParseInt(const char*& cursor, const char* end)
+{
+	SkipBlanks(cursor, end);
+
+	// Sign
+	bool negative = false;
+	if (cursor < end && (*cursor == '-' || *cursor == '+'))
+	{
+		negative = (*cursor == '-');
+		cursor++;
+	}
+
+	// Digits, stopping at INT_MAX so a malformed index can't overflow
+	// (it just ends up out of range)
+	int value = 0;
+	while (cursor < end && IsDigit(*cursor))
+	{
+		int digit = *cursor - '0';
+		value = (value > (INT_MAX - digit) / 10) ? INT_MAX : value * 10 + digit;
+		cursor++;
+	}
+	return negative ? -value : value;
+}
+
+
+// Parsing --------------------------------------------------------------------
+
+// Memory maps the file and parses it
+bool ObjParser::ParseFile(const char* file, ObjData& data, ObjParseStats* stats, unsigned int threadCount)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Get the file into memory
+	MappedFile mapped;
+	if (!mapped.Open(file))
+		return false;
+
+	// Parse directly out of the mapping
+	ParseText(mapped.GetData(), mapped.GetSize(), data, threadCount);
+
+	// Record how it went
+	if (stats)
+	{
+		auto stop = std::chrono::high_resolution_clock::now();
+		stats->bytes = mapped.GetSize();
+		stats->seconds = std::chrono::duration<double>(stop - start).count();
+		stats->threads = ChooseThreadCount(mapped.GetSize(), threadCount);
+	}
+	return true;
+}
+
+// Picks between the serial and chunked paths
+void ObjParser::ParseText(const char* text, size_t length, ObjData& data, unsigned int threadCount)
+{
+	threadCount = ChooseThreadCount(length, threadCount);
+	if (threadCount <= 1)
+		ParseRange(text, text + length, data, nullptr);
+	else
+		ParseChunked(text, length, data, threadCount);
+}
+
+// How many threads are actually worth using for this much text
+unsigned int ObjParser::ChooseThreadCount(size_t length, unsigned int requested)
+{
+	if (requested == 0)
+		requested = std::max(1u, std::thread::hardware_concurrency());
+
+	// Don't give any thread too small a piece
+	size_t useful = std::max<size_t>(1, length / MinBytesPerThread);
+	return (unsigned int)std::min<size_t>(requested, useful);
+}
+
+// Walks the text one record at a time
+void ObjParser::ParseRange(const char* cursor, const char* end, ObjData& data, std::vector<unsigned char>* relative)
+{
+	// Reused between faces so polygons don't allocate
+	std::vector<ObjCorner> face;
+	std::vector<unsigned char> faceRelative;
+
+	while (cursor < end)
+	{
+		SkipBlanks(cursor, end);
+		if (cursor + 1 >= end)
+			break;
+
+		// Check the type of line
+		if (cursor[0] == 'v' && IsBlank(cursor[1]))
+		{
+			// Position
+			cursor += 2;
+			ObjFloat3 pos;
+			pos.x = ParseFloat(cursor, end);
+			pos.y = ParseFloat(cursor, end);
+			pos.z = ParseFloat(cursor, end);
+			data.positions.push_back(pos);
+		}
+		else if (cursor[0] == 'v' && cursor[1] == 't')
+		{
+			// Texture coordinate
+			cursor += 2;
+			ObjFloat2 uv;
+			uv.x = ParseFloat(cursor, end);
+			uv.y = ParseFloat(cursor, end);
+			data.uvs.push_back(uv);
+		}
+		else if (cursor[0] == 'v' && cursor[1] == 'n')
+		{
+			// Normal
+			cursor += 2;
+			ObjFloat3 norm;
+			norm.x = ParseFloat(cursor, end);
+			norm.y = ParseFloat(cursor, end);
+			norm.z = ParseFloat(cursor, end);
+			data.normals.push_back(norm);
+		}
+		else if (cursor[0] == 'f' && IsBlank(cursor[1]))
+		{
+			// Face, with any number of "p", "p/t", "p//n" or "p/t/n" corners
+			cursor += 2;
+			face.clear();
+			faceRelative.clear();
+			while (true)
+			{
+				SkipBlanks(cursor, end);
+				if (cursor >= end || !(IsDigit(*cursor) || *cursor == '-'))
+					break;
+
+				// Bits 1, 2 and 4 mark relative position, uv and normal indices
+				unsigned char rel = 0;
+				ObjCorner corner;
+				corner.position = ResolveIndex(ParseInt(cursor, end), data.positions.size(), rel, 1);
+				corner.uv = -1;
+				corner.normal = -1;
+				if (cursor < end && *cursor == '/')
+				{
+					cursor++;
+					if (cursor < end && *cursor != '/')
+						corner.uv = ResolveIndex(ParseInt(cursor, end), data.uvs.size(), rel, 2);
+					if (cursor < end && *cursor == '/')
+					{
+						cursor++;
+						corner.normal = ResolveIndex(ParseInt(cursor, end), data.normals.size(), rel, 4);
+					}
+				}
+				face.push_back(corner);
+				faceRelative.push_back(rel);
+			}
+
+			// Fan triangulate, which matches the old (0,1,2) (0,2,3) quad split
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				data.corners.push_back(face[0]);
+				data.corners.push_back(face[i - 1]);
+				data.corners.push_back(face[i]);
+				if (relative)
+				{
+					relative->push_back(faceRelative[0]);
+					relative->push_back(faceRelative[i - 1]);
+					relative->push_back(faceRelative[i]);
+				}
+			}
+		}
+
+		// Anything else (comments, groups, materials) is ignored
+		SkipLine(cursor, end);
+	}
+}
+
+// Splits the text into newline aligned chunks, parses them in parallel
+// and then stitches the results back together in file order
+void ObjParser::ParseChunked(const char* text, size_t length, ObjData& data, unsigned int threadCount)
+{
+	const char* end = text + length;
+
+	// Find chunk boundaries, moving each one forward to the start of a line
+	std::vector<const char*> bounds;
+	bounds.push_back(text);
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+		const char* split = std::max(text + length / threadCount * i, bounds.back());
+		while (split < end && split[-1] != '\n')
+			split++;
+		bounds.push_back(split);
+	}
+	bounds.push_back(end);
+
+	// Parse every chunk on its own thread
+	std::vector<ObjData> chunks(threadCount);
+	std::vector<std::vector<unsigned char>> relatives(threadCount);
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::thread(ParseRange, bounds[i], bounds[i + 1], std::ref(chunks[i]), &relatives[i]));
+	}
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	// Work out where each chunk lands in the merged arrays
+	size_t positionCount = data.positions.size();
+	size_t uvCount = data.uvs.size();
+	size_t normalCount = data.normals.size();
+	size_t cornerCount = data.corners.size();
+	std::vector<size_t> positionBase(threadCount), uvBase(threadCount), normalBase(threadCount), cornerBase(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		positionBase[i] = positionCount; positionCount += chunks[i].positions.size();
+		uvBase[i] = uvCount; uvCount += chunks[i].uvs.size();
+		normalBase[i] = normalCount; normalCount += chunks[i].normals.size();
+		cornerBase[i] = cornerCount; cornerCount += chunks[i].corners.size();
+	}
+	data.positions.resize(positionCount);
+	data.uvs.resize(uvCount);
+	data.normals.resize(normalCount);
+	data.corners.resize(cornerCount);
+
+	// Copy each chunk into place, also on worker threads
+	// - Relative indices were resolved against the chunk's own counts,
+	//   so they only need the chunk's starting offsets added
+	workers.clear();
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		workers.push_back(std::thread([&, i]()
+		{
+			const ObjData& chunk = chunks[i];
+			std::copy(chunk.positions.begin(), chunk.positions.end(), data.positions.begin() + positionBase[i]);
+			std::copy(chunk.uvs.begin(), chunk.uvs.end(), data.uvs.begin() + uvBase[i]);
+			std::copy(chunk.normals.begin(), chunk.normals.end(), data.normals.begin() + normalBase[i]);
+			for (size_t c = 0; c < chunk.corners.size(); c++)
+			{
+				ObjCorner corner = chunk.corners[c];
+				unsigned char rel = relatives[i][c];
+				if (rel & 1) corner.position += (int)positionBase[i];
+				if (rel & 2) corner.uv += (int)uvBase[i];
+				if (rel & 4) corner.normal += (int)normalBase[i];
+				data.corners[cornerBase[i] + c] = corner;
+			}
+		}));
+	}
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// Plain float storage so the parser has no DirectX (or Windows) dependency
+// and can be used headless for asset tools
+struct ObjFloat3
+{
+	float x;
+	float y;
+	float z;
+};
+
+struct ObjFloat2
+{
+	float x;
+	float y;
+};
+
+// One corner of a triangle, as 0-based indices into the parsed arrays
+// - Missing attributes (like "f 1//3") are stored as -1
+struct ObjCorner
+{
+	int position;
+	int uv;
+	int normal;
+};
+
+// Everything read out of an OBJ file
+// - Faces with more than 3 corners are fan triangulated,
+//   so "corners" always holds 3 entries per triangle
+struct ObjData
+{
+	std::vector<ObjFloat3> positions;
+	std::vector<ObjFloat2> uvs;
+	std::vector<ObjFloat3> normals;
+	std::vector<ObjCorner> corners;
+};
+
+// Timing information from the most recent parse
+struct ObjParseStats
+{
+	size_t bytes = 0;
+	double seconds = 0;
+	unsigned int threads = 1;
+
+	// Throughput of the parse in megabytes per second
+	double MegabytesPerSecond() const
+	{
+		return seconds > 0 ? (bytes / (1024.0 * 1024.0)) / seconds : 0;
+	}
+};
+
+// Read only view of a whole file mapped into memory
+// - Uses CreateFileMapping on Windows and mmap everywhere else
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Maps the file, returning false if it can't be opened
+	bool Open(const char* file);
+	void Close();
+
+	const char* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	// No copying, the mapping is owned by one object
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* data;
+	size_t size;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+};
+
+// OBJ parsing engine
+// - Tokenizes the memory mapped text in place, without copying lines
+//   and without locale aware scanf calls
+// - Large files can be split into newline aligned chunks that are parsed
+//   on worker threads, then merged in file order.  The result is identical
+//   to a single threaded parse
+class ObjParser
+{
+public:
+	// Parses the given file into data, returning false if it can't be read
+	// - threadCount of 0 uses every hardware thread, 1 parses serially
+	static bool ParseFile(const char* file, ObjData& data, ObjParseStats* stats = nullptr, unsigned int threadCount = 1);
+	// Parses text that's already in memory
+	static void ParseText(const char* text, size_t length, ObjData& data, unsigned int threadCount = 1);
+
+	// Files smaller than this are always parsed on one thread
+	static const size_t MinBytesPerThread = 256 * 1024;
+
+	// Number parsing helpers, exposed for reuse by other text formats
+	// - Each one advances the cursor past what it read
+	static float ParseFloat(const char*& cursor, const char* end);
+	static int ParseInt(const char*& cursor, const char* end);
+
+private:
+	// Parses one range of text
+	// - Negative (relative) indices are resolved against the counts seen so far
+	//   in this range, and flagged in "relative" so a chunked parse can offset them
+	static void ParseRange(const char* cursor, const char* end, ObjData& data, std::vector<unsigned char>* relative);
+	static void ParseChunked(const char* text, size_t length, ObjData& data, unsigned int threadCount);
+	static unsigned int ChooseThreadCount(size_t length, unsigned int requested);
+};
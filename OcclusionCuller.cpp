@@ -0,0 +1,523 @@
+#include "OcclusionCuller.h"
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+	// Triangles are clipped where w gets this small, so 1 / w stays finite
+	const float NearW = 1e-4f;
+	// Triangles are clipped a little past the screen edges, which keeps the
+	// edge functions small enough to stay accurate in floats
+	const float GuardBand = 1.25f;
+	// Most vertices a triangle can have after clipping against 5 planes
+	const int MaxClipVertices = 8;
+
+	// Signed distance of a clip space point to each clipping plane
+	float ClipDistance(const XMFLOAT4& v, int plane)
+	{
+		switch (plane)
+		{
+		case 0: return v.w - NearW;
+		case 1: return GuardBand * v.w - v.x;
+		case 2: return GuardBand * v.w + v.x;
+		case 3: return GuardBand * v.w - v.y;
+		default: return GuardBand * v.w + v.y;
+		}
+	}
+
+	XMFLOAT4 Lerp(const XMFLOAT4& a, const XMFLOAT4& b, float t)
+	{
+		return XMFLOAT4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t);
+	}
+
+	// Möller-Trumbore, only caring whether the segment from origin to
+	// origin + direction hits the triangle before its end
+	bool SegmentHitsTriangle(XMVECTOR origin, XMVECTOR direction, XMVECTOR v0, XMVECTOR v1, XMVECTOR v2)
+	{
+		XMVECTOR edge1 = XMVectorSubtract(v1, v0);
+		XMVECTOR edge2 = XMVectorSubtract(v2, v0);
+		XMVECTOR p = XMVector3Cross(direction, edge2);
+		float determinant = XMVectorGetX(XMVector3Dot(edge1, p));
+		if (fabsf(determinant) < 1e-12f)
+			return false;
+		float inverse = 1.0f / determinant;
+		XMVECTOR s = XMVectorSubtract(origin, v0);
+		float u = XMVectorGetX(XMVector3Dot(s, p)) * inverse;
+		if (u < 0.0f || u > 1.0f)
+			return false;
+		XMVECTOR q = XMVector3Cross(s, edge1);
+		float v = XMVectorGetX(XMVector3Dot(direction, q)) * inverse;
+		if (v < 0.0f || u + v > 1.0f)
+			return false;
+		float t = XMVectorGetX(XMVector3Dot(edge2, q)) * inverse;
+		return t > 1e-4f && t < 1.0f - 1e-4f;
+	}
+}
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+{
+	tilesX = std::max(1, (width + TileSize - 1) / TileSize);
+	tilesY = std::max(1, (height + TileSize - 1) / TileSize);
+	this->width = tilesX * TileSize;
+	this->height = tilesY * TileSize;
+	depth.resize((size_t)this->width * this->height, 0.0f);
+	tileBins.resize((size_t)tilesX * tilesY);
+	XMStoreFloat4x4(&viewProj, XMMatrixIdentity());
+
+	// Halve until a single texel is left (level 0 is the depth buffer itself)
+	levels.resize(1);
+	levelWidths.push_back(this->width);
+	levelHeights.push_back(this->height);
+	while (levelWidths.back() > 1 || levelHeights.back() > 1)
+	{
+		levelWidths.push_back(std::max(1, levelWidths.back() / 2));
+		levelHeights.push_back(std::max(1, levelHeights.back() / 2));
+		levels.push_back(std::vector<float>((size_t)levelWidths.back() * levelHeights.back(), 0.0f));
+	}
+}
+
+void OcclusionCuller::BeginFrame(const XMFLOAT4X4& viewProj)
+{
+	this->viewProj = viewProj;
+	triangles.clear();
+	for (size_t t = 0; t < tileBins.size(); t++)
+		tileBins[t].clear();
+	stats = OcclusionStats();
+}
+
+void OcclusionCuller::AddOccluder(const XMFLOAT3* positions, size_t vertexCount,
+	const uint32_t* indices, size_t indexCount, const XMFLOAT4X4& world)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Straight to clip space
+	XMMATRIX worldViewProj = XMMatrixMultiply(XMLoadFloat4x4(&world), XMLoadFloat4x4(&viewProj));
+	std::vector<XMFLOAT4> clip(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+		XMStoreFloat4(&clip[i], XMVector3Transform(XMLoadFloat3(&positions[i]), worldViewProj));
+
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		XMFLOAT4 corners[3] = { clip[indices[i]], clip[indices[i + 1]], clip[indices[i + 2]] };
+		SetupTriangle(corners);
+	}
+	stats.occluderTriangles += indexCount / 3;
+	stats.setupSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Clips against the near plane and the guard band, then turns each piece
+// into edge functions and a depth plane in pixels
+void OcclusionCuller::SetupTriangle(const XMFLOAT4* clip)
+{
+	// Sutherland-Hodgman, one plane at a time
+	XMFLOAT4 polygon[MaxClipVertices + 1], clipped[MaxClipVertices + 1];
+	int count = 3;
+	for (int i = 0; i < 3; i++)
+		polygon[i] = clip[i];
+	for (int plane = 0; plane < 5 && count >= 3; plane++)
+	{
+		int clippedCount = 0;
+		for (int i = 0; i < count; i++)
+		{
+			const XMFLOAT4& a = polygon[i];
+			const XMFLOAT4& b = polygon[(i + 1) % count];
+			float da = ClipDistance(a, plane);
+			float db = ClipDistance(b, plane);
+			if (da >= 0.0f)
+				clipped[clippedCount++] = a;
+			if ((da >= 0.0f) != (db >= 0.0f))
+				clipped[clippedCount++] = Lerp(a, b, da / (da - db));
+		}
+		count = clippedCount;
+		for (int i = 0; i < count; i++)
+			polygon[i] = clipped[i];
+	}
+	if (count < 3)
+		return;
+
+	// Pixels (y down) and 1 / w
+	float x[MaxClipVertices + 1], y[MaxClipVertices + 1], inverseW[MaxClipVertices + 1];
+	for (int i = 0; i < count; i++)
+	{
+		inverseW[i] = 1.0f / polygon[i].w;
+		x[i] = (polygon[i].x * inverseW[i] * 0.5f + 0.5f) * width;
+		y[i] = (0.5f - polygon[i].y * inverseW[i] * 0.5f) * height;
+	}
+
+	// The clipped polygon is convex, so it's a fan of triangles
+	for (int i = 1; i + 1 < count; i++)
+	{
+		int v[3] = { 0, i, i + 1 };
+		float area = (x[v[1]] - x[v[0]]) * (y[v[2]] - y[v[0]]) - (x[v[2]] - x[v[0]]) * (y[v[1]] - y[v[0]]);
+		if (fabsf(area) < 1e-6f)
+			continue;
+
+		// Only pixels entirely inside the triangle get covered
+		Triangle triangle;
+		float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+		for (int e = 0; e < 3; e++)
+		{
+			int a = v[e], b = v[(e + 1) % 3];
+			minX = fminf(minX, x[a]);
+			minY = fminf(minY, y[a]);
+			maxX = fmaxf(maxX, x[a]);
+			maxY = fmaxf(maxY, y[a]);
+
+			// Positive inside, whichever way the triangle winds
+			float sign = area > 0.0f ? 1.0f : -1.0f;
+			float edgeA = (y[a] - y[b]) * sign;
+			float edgeB = (x[b] - x[a]) * sign;
+			float edgeC = -(edgeA * x[a] + edgeB * y[a]);
+			// Evaluated at pixel corners (x, y), so shift to the center and
+			// then in by however far the pixel reaches towards the edge
+			triangle.edgeA[e] = edgeA;
+			triangle.edgeB[e] = edgeB;
+			triangle.edgeC[e] = edgeC + 0.5f * (edgeA + edgeB) - 0.5f * (fabsf(edgeA) + fabsf(edgeB));
+		}
+
+		// 1 / w = depthA * x + depthB * y + depthC, taking the farthest value
+		// anywhere in the pixel
+		float d1 = inverseW[v[1]] - inverseW[v[0]];
+		float d2 = inverseW[v[2]] - inverseW[v[0]];
+		float depthA = (d1 * (y[v[2]] - y[v[0]]) - d2 * (y[v[1]] - y[v[0]])) / area;
+		float depthB = (d2 * (x[v[1]] - x[v[0]]) - d1 * (x[v[2]] - x[v[0]])) / area;
+		float depthC = inverseW[v[0]] - depthA * x[v[0]] - depthB * y[v[0]];
+		triangle.depthA = depthA;
+		triangle.depthB = depthB;
+		triangle.depthC = depthC + 0.5f * (depthA + depthB) - 0.5f * (fabsf(depthA) + fabsf(depthB));
+
+		// Pixels whose whole square fits between the extremes
+		triangle.minX = std::max(0, (int)ceilf(minX));
+		triangle.minY = std::max(0, (int)ceilf(minY));
+		triangle.maxX = std::min(width - 1, (int)floorf(maxX) - 1);
+		triangle.maxY = std::min(height - 1, (int)floorf(maxY) - 1);
+		if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+			continue;
+
+		uint32_t index = (uint32_t)triangles.size();
+		triangles.push_back(triangle);
+		for (int ty = triangle.minY / TileSize; ty <= triangle.maxY / TileSize; ty++)
+		{
+			for (int tx = triangle.minX / TileSize; tx <= triangle.maxX / TileSize; tx++)
+				tileBins[ty * tilesX + tx].push_back(index);
+		}
+	}
+}
+
+// Tiles are independent, so threads just take the next one until none are left
+void OcclusionCuller::Rasterize(unsigned int threadCount)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	stats.rasterizedTriangles = triangles.size();
+
+	// Split the work by how much there is to do
+	size_t binned = 0;
+	for (size_t t = 0; t < tileBins.size(); t++)
+		binned += tileBins[t].size();
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = (unsigned int)std::min<size_t>(threadCount, std::max<size_t>(1, binned / MinTrianglesPerThread));
+	threadCount = (unsigned int)std::min<size_t>(threadCount, tileBins.size());
+	stats.threads = threadCount;
+
+	std::atomic<int> nextTile(0);
+	int tileCount = (int)tileBins.size();
+	auto work = [this, &nextTile, tileCount]()
+	{
+		for (int tile = nextTile++; tile < tileCount; tile = nextTile++)
+		{
+			RasterizeTile(tile);
+			BuildTileLevels(tile);
+		}
+	};
+
+	// The calling thread works too
+	std::vector<std::thread> workers;
+	for (unsigned int i = 1; i < threadCount; i++)
+		workers.push_back(std::thread(work));
+	work();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	// Levels coarser than a tile mix several tiles, so they're done afterwards
+	int tileLevels = 0;
+	while ((TileSize >> (tileLevels + 1)) > 0 && tileLevels + 1 < (int)levels.size())
+		tileLevels++;
+	for (int level = tileLevels + 1; level < (int)levels.size(); level++)
+	{
+		for (int y = 0; y < levelHeights[level]; y++)
+		{
+			for (int x = 0; x < levelWidths[level]; x++)
+				Downsample(level, x, y);
+		}
+	}
+	stats.rasterizeSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// 4 pixels of a row at a time, keeping the nearest occluder at each
+void OcclusionCuller::RasterizeTile(int tile)
+{
+	float* tileDepth = &depth[(size_t)tile * TileSize * TileSize];
+	std::fill(tileDepth, tileDepth + TileSize * TileSize, 0.0f);
+
+	int tileX = (tile % tilesX) * TileSize;
+	int tileY = (tile / tilesX) * TileSize;
+	const XMVECTOR laneOffsets = XMVectorSet(0, 1, 2, 3);
+	const XMVECTOR zero = XMVectorZero();
+	const std::vector<uint32_t>& bin = tileBins[tile];
+	for (size_t b = 0; b < bin.size(); b++)
+	{
+		const Triangle& triangle = triangles[bin[b]];
+		int x0 = std::max(triangle.minX, tileX) & ~3;
+		int x1 = std::min(triangle.maxX, tileX + TileSize - 1);
+		int y0 = std::max(triangle.minY, tileY);
+		int y1 = std::min(triangle.maxY, tileY + TileSize - 1);
+
+		XMVECTOR edgeA[3], edgeB[3], edgeC[3];
+		for (int e = 0; e < 3; e++)
+		{
+			edgeA[e] = XMVectorReplicate(triangle.edgeA[e]);
+			edgeB[e] = XMVectorReplicate(triangle.edgeB[e]);
+			edgeC[e] = XMVectorReplicate(triangle.edgeC[e]);
+		}
+		XMVECTOR depthA = XMVectorReplicate(triangle.depthA);
+		XMVECTOR depthB = XMVectorReplicate(triangle.depthB);
+		XMVECTOR depthC = XMVectorReplicate(triangle.depthC);
+
+		for (int y = y0; y <= y1; y++)
+		{
+			XMVECTOR py = XMVectorReplicate((float)y);
+			float* row = tileDepth + (y - tileY) * TileSize - tileX;
+			for (int x = x0; x <= x1; x += 4)
+			{
+				XMVECTOR px = XMVectorAdd(XMVectorReplicate((float)x), laneOffsets);
+				XMVECTOR inside = XMVectorTrueInt();
+				for (int e = 0; e < 3; e++)
+				{
+					XMVECTOR edge = XMVectorMultiplyAdd(edgeA[e], px, XMVectorMultiplyAdd(edgeB[e], py, edgeC[e]));
+					inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(edge, zero));
+				}
+				XMVECTOR pixelDepth = XMVectorMultiplyAdd(depthA, px, XMVectorMultiplyAdd(depthB, py, depthC));
+				XMVECTOR current = XMLoadFloat4((const XMFLOAT4*)(row + x));
+				XMStoreFloat4((XMFLOAT4*)(row + x), XMVectorSelect(current, XMVectorMax(current, pixelDepth), inside));
+			}
+		}
+	}
+}
+
+// Every level down to a single texel per tile only needs this tile's pixels
+void OcclusionCuller::BuildTileLevels(int tile)
+{
+	int tileX = (tile % tilesX) * TileSize;
+	int tileY = (tile / tilesX) * TileSize;
+	for (int level = 1; level < (int)levels.size() && (TileSize >> level) > 0; level++)
+	{
+		int size = TileSize >> level;
+		for (int y = (tileY >> level); y < (tileY >> level) + size; y++)
+		{
+			for (int x = (tileX >> level); x < (tileX >> level) + size; x++)
+				Downsample(level, x, y);
+		}
+	}
+}
+
+void OcclusionCuller::Downsample(int level, int x, int y)
+{
+	int sourceWidth = levelWidths[level - 1];
+	int sourceHeight = levelHeights[level - 1];
+	int x0 = std::min(x * 2, sourceWidth - 1), x1 = std::min(x * 2 + 1, sourceWidth - 1);
+	int y0 = std::min(y * 2, sourceHeight - 1), y1 = std::min(y * 2 + 1, sourceHeight - 1);
+	float farthest = fminf(fminf(Sample(level - 1, x0, y0), Sample(level - 1, x1, y0)),
+		fminf(Sample(level - 1, x0, y1), Sample(level - 1, x1, y1)));
+	levels[level][(size_t)y * levelWidths[level] + x] = farthest;
+}
+
+float OcclusionCuller::Sample(int level, int x, int y) const
+{
+	if (level == 0)
+		return depth[TiledIndex(x, y)];
+	return levels[level][(size_t)y * levelWidths[level] + x];
+}
+
+// Projects the corners to find the pixels the box could touch and the
+// nearest it gets, then checks a level of the hierarchy where those
+// pixels fit in 2x2 texels
+bool OcclusionCuller::IsOccluded(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+{
+	stats.tested++;
+	XMMATRIX matrix = XMLoadFloat4x4(&viewProj);
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float nearest = 0.0f;
+	for (int c = 0; c < 8; c++)
+	{
+		XMVECTOR corner = XMVectorSet((c & 1) ? boxMax.x : boxMin.x, (c & 2) ? boxMax.y : boxMin.y, (c & 4) ? boxMax.z : boxMin.z, 1.0f);
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector4Transform(corner, matrix));
+		if (clip.w < NearW)
+			return false;
+
+		float inverseW = 1.0f / clip.w;
+		float x = (clip.x * inverseW * 0.5f + 0.5f) * width;
+		float y = (0.5f - clip.y * inverseW * 0.5f) * height;
+		minX = fminf(minX, x);
+		minY = fminf(minY, y);
+		maxX = fmaxf(maxX, x);
+		maxY = fmaxf(maxY, y);
+		nearest = fmaxf(nearest, inverseW);
+	}
+
+	// Entirely off the screen is the frustum's problem
+	if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+		return false;
+	int x0 = std::max(0, (int)floorf(minX));
+	int y0 = std::max(0, (int)floorf(minY));
+	int x1 = std::min(width - 1, (int)floorf(maxX));
+	int y1 = std::min(height - 1, (int)floorf(maxY));
+
+	int level = 0;
+	while (level + 1 < (int)levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+		level++;
+
+	// Visible as soon as any texel has something farther than the box
+	for (int y = y0 >> level; y <= (y1 >> level); y++)
+	{
+		for (int x = x0 >> level; x <= (x1 >> level); x++)
+		{
+			if (Sample(level, x, y) <= nearest)
+				return false;
+		}
+	}
+	stats.occluded++;
+	return true;
+}
+
+// A wall with a doorway in front of a camera, a floor, and random boxes
+// between them, hiding random boxes spread through the whole space
+OcclusionBenchmark OcclusionCuller::Benchmark(size_t occluderCount, size_t occludeeCount, unsigned int threadCount)
+{
+	OcclusionBenchmark result;
+	result.occludees = occludeeCount;
+
+	uint32_t seed = 12345;
+	auto random = [&seed](float lo, float hi)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return lo + (hi - lo) * ((seed >> 8) / 16777216.0f);
+	};
+
+	// Every occluder is a box, kept as world space triangles
+	std::vector<XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+	auto addBox = [&](XMFLOAT3 lo, XMFLOAT3 hi)
+	{
+		static const uint32_t faces[36] =
+		{
+			0, 2, 3, 0, 3, 1,	4, 5, 7, 4, 7, 6,	0, 1, 5, 0, 5, 4,
+			2, 6, 7, 2, 7, 3,	0, 4, 6, 0, 6, 2,	1, 3, 7, 1, 7, 5
+		};
+		uint32_t first = (uint32_t)positions.size();
+		for (int c = 0; c < 8; c++)
+			positions.push_back(XMFLOAT3((c & 1) ? hi.x : lo.x, (c & 2) ? hi.y : lo.y, (c & 4) ? hi.z : lo.z));
+		for (int i = 0; i < 36; i++)
+			indices.push_back(first + faces[i]);
+	};
+	addBox(XMFLOAT3(-60, -1, 0), XMFLOAT3(60, 0, 120));		// Floor
+	addBox(XMFLOAT3(-60, 0, 30), XMFLOAT3(-2, 20, 31));		// Wall left of the door
+	addBox(XMFLOAT3(2, 0, 30), XMFLOAT3(60, 20, 31));		// Wall right of the door
+	addBox(XMFLOAT3(-2, 4, 30), XMFLOAT3(2, 20, 31));		// Above the door
+	for (size_t i = 0; i < occluderCount; i++)
+	{
+		XMFLOAT3 center(random(-30, 30), random(0, 4), random(8, 28));
+		XMFLOAT3 extent(random(0.5f, 3), random(0.5f, 3), random(0.5f, 3));
+		addBox(XMFLOAT3(center.x - extent.x, center.y - extent.y, center.z - extent.z),
+			XMFLOAT3(center.x + extent.x, center.y + extent.y, center.z + extent.z));
+	}
+	result.occluderTriangles = indices.size() / 3;
+
+	XMVECTOR eye = XMVectorSet(0, 1.5f, 0, 0);
+	XMFLOAT4X4 viewProj, identity;
+	XMStoreFloat4x4(&viewProj, XMMatrixMultiply(
+		XMMatrixLookToLH(eye, XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0)),
+		XMMatrixPerspectiveFovLH(XM_PIDIV4, (float)DefaultWidth / DefaultHeight, 0.1f, 500.0f)));
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+	// One thread, then however many were asked for, which should match exactly
+	OcclusionCuller culler;
+	culler.BeginFrame(viewProj);
+	culler.AddOccluder(&positions[0], positions.size(), &indices[0], indices.size(), identity);
+	culler.Rasterize(1);
+	result.singleThreadSeconds = culler.GetStats().rasterizeSeconds;
+	std::vector<float> singleThreadDepth = culler.depth;
+	culler.Rasterize(threadCount);
+	result.threadedSeconds = culler.GetStats().rasterizeSeconds;
+	result.threads = culler.GetStats().threads;
+	for (size_t i = 0; i < singleThreadDepth.size(); i++)
+		result.threadMismatches += singleThreadDepth[i] != culler.depth[i];
+
+	// Boxes anywhere from right in front of the camera to well past the wall
+	std::vector<XMFLOAT3> mins(occludeeCount), maxs(occludeeCount);
+	for (size_t i = 0; i < occludeeCount; i++)
+	{
+		XMFLOAT3 center(random(-40, 40), random(0.5f, 10), random(5, 80));
+		XMFLOAT3 extent(random(0.2f, 1.5f), random(0.2f, 1.5f), random(0.2f, 1.5f));
+		mins[i] = XMFLOAT3(center.x - extent.x, center.y - extent.y, center.z - extent.z);
+		maxs[i] = XMFLOAT3(center.x + extent.x, center.y + extent.y, center.z + extent.z);
+	}
+	std::vector<uint8_t> occluded(occludeeCount);
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < occludeeCount; i++)
+		occluded[i] = culler.IsOccluded(mins[i], maxs[i]);
+	result.testSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	// Every occluded box should have no point on its surface that's both on
+	// screen and reachable from the camera
+	XMMATRIX matrix = XMLoadFloat4x4(&viewProj);
+	for (size_t i = 0; i < occludeeCount; i++)
+	{
+		if (!occluded[i])
+			continue;
+		result.occluded++;
+
+		bool seen = false;
+		const int Samples = 3;
+		for (int face = 0; face < 6 && !seen; face++)
+		{
+			for (int s = 0; s < Samples * Samples && !seen; s++)
+			{
+				// Grid on the face, including its edges
+				float u = (float)(s % Samples) / (Samples - 1);
+				float v = (float)(s / Samples) / (Samples - 1);
+				int axis = face / 2;
+				float point[3];
+				const float* lo = &mins[i].x;
+				const float* hi = &maxs[i].x;
+				point[axis] = (face & 1) ? hi[axis] : lo[axis];
+				point[(axis + 1) % 3] = lo[(axis + 1) % 3] + (hi[(axis + 1) % 3] - lo[(axis + 1) % 3]) * u;
+				point[(axis + 2) % 3] = lo[(axis + 2) % 3] + (hi[(axis + 2) % 3] - lo[(axis + 2) % 3]) * v;
+				XMVECTOR target = XMVectorSet(point[0], point[1], point[2], 0);
+
+				XMFLOAT4 clip;
+				XMStoreFloat4(&clip, XMVector3Transform(target, matrix));
+				if (clip.w <= 0.0f || fabsf(clip.x) > clip.w || fabsf(clip.y) > clip.w)
+					continue;
+
+				bool blocked = false;
+				XMVECTOR direction = XMVectorSubtract(target, eye);
+				for (size_t t = 0; t < indices.size() && !blocked; t += 3)
+				{
+					blocked = SegmentHitsTriangle(eye, direction, XMLoadFloat3(&positions[indices[t]]),
+						XMLoadFloat3(&positions[indices[t + 1]]), XMLoadFloat3(&positions[indices[t + 2]]));
+				}
+				seen = !blocked;
+			}
+		}
+		result.falseOcclusions += seen;
+	}
+	return result;
+}
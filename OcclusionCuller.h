@@ -0,0 +1,133 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// What the last frame of occlusion culling did
+struct OcclusionStats
+{
+	// Occluder triangles given to AddOccluder
+	size_t occluderTriangles = 0;
+	// Triangles left after clipping that were big enough to cover a pixel
+	size_t rasterizedTriangles = 0;
+	size_t tested = 0;
+	size_t occluded = 0;
+	// Transforming, clipping and binning the occluders
+	double setupSeconds = 0;
+	// Filling the depth buffer and building the hierarchy
+	double rasterizeSeconds = 0;
+	unsigned int threads = 0;
+};
+
+// Timings and correctness checks from OcclusionCuller::Benchmark
+struct OcclusionBenchmark
+{
+	size_t occluderTriangles = 0;
+	size_t occludees = 0;
+	size_t occluded = 0;
+	// Rasterizing on one thread and on the requested number of threads
+	double singleThreadSeconds = 0;
+	double threadedSeconds = 0;
+	unsigned int threads = 0;
+	// Testing every occludee against the hierarchy
+	double testSeconds = 0;
+	// Occluded boxes with a point on their surface that a ray from the
+	// camera reaches without hitting an occluder (should always be 0)
+	size_t falseOcclusions = 0;
+	// Depth texels that came out differently on one and many threads (should be 0)
+	size_t threadMismatches = 0;
+
+	double Speedup() const { return threadedSeconds > 0 ? singleThreadSeconds / threadedSeconds : 0; }
+};
+
+// Software occlusion culling against a small depth buffer
+// - A few large occluders (walls, floors, pillars) are rasterized on the
+//   CPU, then boxes are tested against a min-depth hierarchy (HiZ) of the
+//   result, so anything entirely hidden can be skipped before it's drawn
+// - The buffer is split into square tiles; occluder triangles are binned
+//   to the tiles they touch and tiles are filled in parallel, 4 pixels at a time
+// - Depth is stored as 1 / w (view space depth), which interpolates
+//   linearly across the screen and doesn't care how the projection maps z
+// - Everything errs towards visible: occluders only cover pixels they
+//   cover entirely, at the farthest depth they reach in each pixel, and
+//   boxes are tested at their nearest corner over every pixel they touch
+// - Doesn't need DirectX, so it can be built and checked without a GPU
+class OcclusionCuller
+{
+public:
+	static const int DefaultWidth = 256;
+	static const int DefaultHeight = 128;
+	// Tiles are this many pixels on a side
+	static const int TileSize = 32;
+	// Fewest binned triangles worth giving their own thread
+	static const size_t MinTrianglesPerThread = 64;
+
+	// width and height are rounded up to whole tiles
+	OcclusionCuller(int width = DefaultWidth, int height = DefaultHeight);
+
+	// Starts a new frame seen through viewProj, with nothing hiding anything
+	void BeginFrame(const DirectX::XMFLOAT4X4& viewProj);
+	// Queues an occluder's triangles (object space, placed with world)
+	void AddOccluder(const DirectX::XMFLOAT3* positions, size_t vertexCount,
+		const uint32_t* indices, size_t indexCount, const DirectX::XMFLOAT4X4& world);
+	// Fills the depth buffer from every queued occluder and builds the hierarchy
+	// - threadCount of 0 means one per hardware thread
+	void Rasterize(unsigned int threadCount = 0);
+
+	// Is the world space box entirely behind the occluders?
+	// - Boxes that reach behind the camera, or are entirely off the screen,
+	//   are never occluded
+	bool IsOccluded(const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax);
+
+	int GetWidth() const { return width; }
+	int GetHeight() const { return height; }
+	// 1 / w of the farthest occluder covering a pixel, or 0 if none does
+	float GetDepth(int x, int y) const { return depth[TiledIndex(x, y)]; }
+	const OcclusionStats& GetStats() const { return stats; }
+
+	// Builds a room-like scene (walls with a doorway plus count random
+	// occluder boxes), rasterizes it and tests occludeeCount boxes against it
+	// - Checks the result by ray casting points on every occluded box
+	static OcclusionBenchmark Benchmark(size_t occluderCount, size_t occludeeCount, unsigned int threadCount = 0);
+
+private:
+	// One clipped, projected triangle, ready to fill
+	// - Edge functions and the depth plane are in pixels, already moved in
+	//   by half a pixel so they can be tested at pixel centers
+	struct Triangle
+	{
+		float edgeA[3], edgeB[3], edgeC[3];
+		float depthA, depthB, depthC;
+		int minX, minY, maxX, maxY;
+	};
+
+	int width, height;
+	int tilesX, tilesY;
+	DirectX::XMFLOAT4X4 viewProj;
+	// Full resolution 1 / w, stored a tile at a time
+	std::vector<float> depth;
+	// Coarser levels of the hierarchy (level 1 is half size), row by row,
+	// each texel holding the smallest (farthest) value below it
+	std::vector<std::vector<float>> levels;
+	std::vector<int> levelWidths, levelHeights;
+	std::vector<Triangle> triangles;
+	std::vector<std::vector<uint32_t>> tileBins;
+	OcclusionStats stats;
+
+	size_t TiledIndex(int x, int y) const
+	{
+		int tile = (y / TileSize) * tilesX + x / TileSize;
+		return (size_t)tile * TileSize * TileSize + (y % TileSize) * TileSize + x % TileSize;
+	}
+	// Value of a texel at any level of the hierarchy (0 is full resolution)
+	float Sample(int level, int x, int y) const;
+
+	// Projects, clips and bins one triangle given in clip space
+	void SetupTriangle(const DirectX::XMFLOAT4* clip);
+	// Fills one tile from its bin, then its part of the hierarchy
+	void RasterizeTile(int tile);
+	void BuildTileLevels(int tile);
+	// Builds one texel of a coarser level from the one below it
+	void Downsample(int level, int x, int y);
+};
@@ -1,11 +1,16 @@
 #include "ShaderIncludes.hlsli"
 
 cbuffer ExternalData : register(b0)
+{
+	float specExponent;
+}
+
+// Lights and camera, which only change once a frame
+cbuffer PerFrame : register(b1)
 {
 	DirectionalLight dLight;
 	PointLight pLight;
 	float3 cameraPos;
-	float specExponent;
 }
 
 Texture2D Albedo : register(t0);
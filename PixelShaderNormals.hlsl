@@ -1,12 +1,17 @@
 #include "ShaderIncludes.hlsli"
 
-// Most external data
+// Data that changes with the material
 cbuffer ExternalData : register(b0)
+{
+	float specExponent;
+}
+
+// Lights and camera, which only change once a frame
+cbuffer PerFrame : register(b1)
 {
 	DirectionalLight dLight;
 	PointLight pLight;
 	float3 cameraPos;
-	float specExponent;
 }
 
 // Textures in memory
@@ -26,9 +31,9 @@ float3x3 GetTBN(VertexToPixelNormals input)
 	// Normalized normal
 	float3 N = normalize(input.normal); 
 	// Normalized tangent with anything along the Nth axis removed
-	float3 T = normalize(input.tangent - N * dot(input.tangent, N));
-	// Gram-Schmidt orthogonalization
-	float3 B = cross(T, N);
+	float3 T = normalize(input.tangent.xyz - N * dot(input.tangent.xyz, N));
+	// Gram-Schmidt orthogonalization, flipped for mirrored UVs
+	float3 B = cross(T, N) * input.tangent.w;
 	// Return the matrix
 	return float3x3(T, B, N);
 }
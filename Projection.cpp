@@ -0,0 +1,82 @@
+#include "Projection.h"
+#include <cmath>
+#include <cstdint>
+
+using namespace DirectX;
+
+namespace
+{
+	// Largest value of a 24-bit normalized depth buffer
+	const double Max24 = 16777215.0;
+
+	// Both projections store depth as _33 + _43 / distance, which is all
+	// it takes to go back from a stored depth to a distance
+	double DistanceFromDepth(const XMFLOAT4X4& proj, double depth)
+	{
+		return proj._43 / (depth - proj._33);
+	}
+
+	// Depth exactly as the GPU would get it, in floats from the matrix
+	float ProjectDepth(const XMFLOAT4X4& proj, float distance)
+	{
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector4Transform(XMVectorSet(0, 0, distance, 1), XMLoadFloat4x4(&proj)));
+		return clip.z / clip.w;
+	}
+}
+
+XMMATRIX Projection::Standard(float fov, float aspectRatio, float nearClip, float farClip)
+{
+	return XMMatrixPerspectiveFovLH(fov, aspectRatio, nearClip, farClip);
+}
+
+// Same x and y as the standard projection, but depth is nearClip / z,
+// which is the limit of swapping near and far as far goes to infinity
+XMMATRIX Projection::ReverseZInfinite(float fov, float aspectRatio, float nearClip)
+{
+	float yScale = 1.0f / tanf(fov * 0.5f);
+	float xScale = yScale / aspectRatio;
+	return XMMATRIX(
+		xScale, 0, 0, 0,
+		0, yScale, 0, 0,
+		0, 0, 0, 1,
+		0, 0, nearClip, 0);
+}
+
+DepthPrecisionReport Projection::MeasureDepthPrecision(float nearClip, float farClip, size_t count)
+{
+	DepthPrecisionReport report;
+	report.nearClip = nearClip;
+	report.farClip = farClip;
+
+	XMFLOAT4X4 standard, reverse;
+	XMStoreFloat4x4(&standard, Standard(XM_PIDIV4, 1.0f, nearClip, farClip));
+	XMStoreFloat4x4(&reverse, ReverseZInfinite(XM_PIDIV4, 1.0f, nearClip));
+
+	for (size_t i = 0; i < count; i++)
+	{
+		DepthPrecisionSample sample;
+		float t = count > 1 ? (float)i / (count - 1) : 0.0f;
+		sample.distance = nearClip * powf(farClip / nearClip, t);
+
+		// 24-bit: round to the nearest step, then see where the next one lands
+		// - The last step is used at the far plane, which has nothing after it
+		float standardDepth = ProjectDepth(standard, sample.distance);
+		double step = floor(standardDepth * Max24 + 0.5);
+		step = fmin(step, Max24 - 1);
+		sample.standard24Step = DistanceFromDepth(standard, (step + 1) / Max24) - DistanceFromDepth(standard, step / Max24);
+
+		// Floats: the next representable value towards the far end
+		float nextStandard = nextafterf(standardDepth, 2.0f);
+		sample.standardFloatStep = DistanceFromDepth(standard, nextStandard) - DistanceFromDepth(standard, standardDepth);
+		float reverseDepth = ProjectDepth(reverse, sample.distance);
+		float nextReverse = nextafterf(reverseDepth, -1.0f);
+		sample.reverseFloatStep = DistanceFromDepth(reverse, nextReverse) - DistanceFromDepth(reverse, reverseDepth);
+
+		report.worstStandard24 = fmax(report.worstStandard24, sample.standard24Step / sample.distance);
+		report.worstStandardFloat = fmax(report.worstStandardFloat, sample.standardFloatStep / sample.distance);
+		report.worstReverseFloat = fmax(report.worstReverseFloat, sample.reverseFloatStep / sample.distance);
+		report.samples.push_back(sample);
+	}
+	return report;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <cstddef>
+
+// How finely each kind of depth buffer can tell distances apart at one distance
+// - Steps are the gap, in world units, between this distance and the next
+//   one farther away that stores a different depth value
+struct DepthPrecisionSample
+{
+	float distance = 0;
+	// Standard projection into a 24-bit normalized buffer (what DXCore used to make)
+	double standard24Step = 0;
+	// Standard projection into a 32-bit float buffer
+	double standardFloatStep = 0;
+	// Reverse-Z infinite projection into a 32-bit float buffer
+	double reverseFloatStep = 0;
+};
+
+// Results from Projection::MeasureDepthPrecision
+struct DepthPrecisionReport
+{
+	float nearClip = 0;
+	float farClip = 0;
+	std::vector<DepthPrecisionSample> samples;
+	// Largest step as a share of the distance, over every sample
+	double worstStandard24 = 0;
+	double worstStandardFloat = 0;
+	double worstReverseFloat = 0;
+
+	// How many times finer the worst case gets by switching to reverse-Z
+	double Gain() const { return worstReverseFloat > 0 ? worstStandard24 / worstReverseFloat : 0; }
+};
+
+// Perspective projections for the camera, and a check of how well each
+// one spends the depth buffer's precision
+// - Reverse-Z maps the near plane to 1 and infinity to 0, so the float
+//   depth buffer's dense values near 0 line up with the 1 / distance falloff
+//   instead of fighting it, and there's no far plane to clip the sky
+// - Doesn't need DirectX, so it can be built and checked without a GPU
+class Projection
+{
+public:
+	// The usual left handed projection, depth 0 at nearClip and 1 at farClip
+	static DirectX::XMMATRIX Standard(float fov, float aspectRatio, float nearClip, float farClip);
+	// Left handed, depth 1 at nearClip falling to 0 at infinity
+	static DirectX::XMMATRIX ReverseZInfinite(float fov, float aspectRatio, float nearClip);
+
+	// Projects count distances, spread evenly in log space from nearClip to
+	// farClip, through both projections and measures the depth steps
+	static DepthPrecisionReport MeasureDepthPrecision(float nearClip, float farClip, size_t count);
+};
@@ -0,0 +1,718 @@
+#include "SceneBVH.h"
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+
+using namespace DirectX;
+
+const float SceneBVH::RebuildCostRatio = 1.5f;
+
+namespace
+{
+	// Centroid bins tried on each axis when looking for a split
+	const int BinCount = 12;
+	const uint32_t NoParent = 0xFFFFFFFF;
+
+	// Where a box is compared to one plane
+	enum PlaneSide { PLANE_OUTSIDE, PLANE_INSIDE, PLANE_CROSSING };
+
+	// Distance from the plane to the box's center against how far the box
+	// reaches towards the plane
+	PlaneSide ClassifyBox(const XMFLOAT4& plane, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+	{
+		float centerX = (boxMin.x + boxMax.x) * 0.5f, extentX = (boxMax.x - boxMin.x) * 0.5f;
+		float centerY = (boxMin.y + boxMax.y) * 0.5f, extentY = (boxMax.y - boxMin.y) * 0.5f;
+		float centerZ = (boxMin.z + boxMax.z) * 0.5f, extentZ = (boxMax.z - boxMin.z) * 0.5f;
+		float distance = centerX * plane.x + centerY * plane.y + centerZ * plane.z + plane.w;
+		float reach = extentX * fabsf(plane.x) + extentY * fabsf(plane.y) + extentZ * fabsf(plane.z);
+		if (distance < -reach)
+			return PLANE_OUTSIDE;
+		return distance >= reach ? PLANE_INSIDE : PLANE_CROSSING;
+	}
+
+	bool BoxInFrustum(const Frustum& frustum, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+	{
+		for (int p = 0; p < 6; p++)
+		{
+			if (ClassifyBox(frustum.planes[p], boxMin, boxMax) == PLANE_OUTSIDE)
+				return false;
+		}
+		return true;
+	}
+
+	bool BoxTouchesSphere(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, const XMFLOAT3& center, float radius)
+	{
+		float dx = fmaxf(fmaxf(boxMin.x - center.x, center.x - boxMax.x), 0.0f);
+		float dy = fmaxf(fmaxf(boxMin.y - center.y, center.y - boxMax.y), 0.0f);
+		float dz = fmaxf(fmaxf(boxMin.z - center.z, center.z - boxMax.z), 0.0f);
+		return dx * dx + dy * dy + dz * dz <= radius * radius;
+	}
+
+	bool BoxTouchesBox(const XMFLOAT3& aMin, const XMFLOAT3& aMax, const XMFLOAT3& bMin, const XMFLOAT3& bMax)
+	{
+		return aMin.x <= bMax.x && aMax.x >= bMin.x &&
+			aMin.y <= bMax.y && aMax.y >= bMin.y &&
+			aMin.z <= bMax.z && aMax.z >= bMin.z;
+	}
+
+	bool BoxContainsBox(const XMFLOAT3& outerMin, const XMFLOAT3& outerMax, const XMFLOAT3& innerMin, const XMFLOAT3& innerMax)
+	{
+		return outerMin.x <= innerMin.x && outerMax.x >= innerMax.x &&
+			outerMin.y <= innerMin.y && outerMax.y >= innerMax.y &&
+			outerMin.z <= innerMin.z && outerMax.z >= innerMax.z;
+	}
+
+	// Slab test, returning the distance the ray enters the box or -1 for a miss
+	// - fminf and fmaxf drop the NaNs a ray lying exactly on a slab makes
+	float RayEntersBox(const XMFLOAT3& origin, const XMFLOAT3& inverseDirection, float maxDistance,
+		const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+	{
+		float x0 = (boxMin.x - origin.x) * inverseDirection.x, x1 = (boxMax.x - origin.x) * inverseDirection.x;
+		float y0 = (boxMin.y - origin.y) * inverseDirection.y, y1 = (boxMax.y - origin.y) * inverseDirection.y;
+		float z0 = (boxMin.z - origin.z) * inverseDirection.z, z1 = (boxMax.z - origin.z) * inverseDirection.z;
+		float enter = fmaxf(fmaxf(fminf(x0, x1), fminf(y0, y1)), fmaxf(fminf(z0, z1), 0.0f));
+		float exit = fminf(fminf(fmaxf(x0, x1), fmaxf(y0, y1)), fminf(fmaxf(z0, z1), maxDistance));
+		return enter <= exit ? enter : -1.0f;
+	}
+
+	void Grow(XMFLOAT3& boxMin, XMFLOAT3& boxMax, const XMFLOAT3& otherMin, const XMFLOAT3& otherMax)
+	{
+		boxMin = XMFLOAT3(fminf(boxMin.x, otherMin.x), fminf(boxMin.y, otherMin.y), fminf(boxMin.z, otherMin.z));
+		boxMax = XMFLOAT3(fmaxf(boxMax.x, otherMax.x), fmaxf(boxMax.y, otherMax.y), fmaxf(boxMax.z, otherMax.z));
+	}
+
+	// Box that anything grows out of
+	const XMFLOAT3 EmptyMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	const XMFLOAT3 EmptyMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+}
+
+float SceneBVH::SurfaceArea(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+{
+	float x = fmaxf(boxMax.x - boxMin.x, 0.0f);
+	float y = fmaxf(boxMax.y - boxMin.y, 0.0f);
+	float z = fmaxf(boxMax.z - boxMin.z, 0.0f);
+	return 2.0f * (x * y + y * z + z * x);
+}
+
+void SceneBVH::Build(const XMFLOAT3* mins, const XMFLOAT3* maxs, size_t count)
+{
+	boxMins.assign(mins, mins + count);
+	boxMaxs.assign(maxs, maxs + count);
+	itemLeaves.assign(count, 0);
+	itemDirty.assign(count, 0);
+	dirtyItems.clear();
+	Rebuild();
+}
+
+uint32_t SceneBVH::Add(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+{
+	boxMins.push_back(boxMin);
+	boxMaxs.push_back(boxMax);
+	itemLeaves.push_back(0);
+	itemDirty.push_back(0);
+	needsBuild = true;
+	return (uint32_t)(boxMins.size() - 1);
+}
+
+void SceneBVH::Update(uint32_t item, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+{
+	boxMins[item] = boxMin;
+	boxMaxs[item] = boxMax;
+	if (!itemDirty[item])
+	{
+		itemDirty[item] = 1;
+		dirtyItems.push_back(item);
+	}
+}
+
+// Walks up from each moved item, stopping early once a box stops changing
+void SceneBVH::Refit()
+{
+	if (needsBuild)
+	{
+		Rebuild();
+		return;
+	}
+	if (dirtyItems.empty())
+		return;
+
+	for (size_t i = 0; i < dirtyItems.size(); i++)
+	{
+		uint32_t item = dirtyItems[i];
+		itemDirty[item] = 0;
+		for (uint32_t n = itemLeaves[item]; n != NoParent; n = nodes[n].parent)
+		{
+			Node& node = nodes[n];
+			XMFLOAT3 oldMin = node.boxMin, oldMax = node.boxMax;
+			UpdateNodeBox(node);
+			if (memcmp(&oldMin, &node.boxMin, sizeof(XMFLOAT3)) == 0 && memcmp(&oldMax, &node.boxMax, sizeof(XMFLOAT3)) == 0)
+				break;
+
+			// Leaves cost one test per item, everything else one box test
+			double weight = node.firstChild == 0 ? node.itemCount : 1;
+			totalArea += weight * (SurfaceArea(node.boxMin, node.boxMax) - SurfaceArea(oldMin, oldMax));
+		}
+	}
+	dirtyItems.clear();
+	stats.refits++;
+
+	// Stretched boxes overlap more and more, so start over once it's bad enough
+	UpdateCost();
+	if (stats.cost > stats.builtCost * RebuildCostRatio)
+		Rebuild();
+}
+
+void SceneBVH::Rebuild()
+{
+	needsBuild = false;
+	for (size_t i = 0; i < dirtyItems.size(); i++)
+		itemDirty[dirtyItems[i]] = 0;
+	dirtyItems.clear();
+
+	size_t count = boxMins.size();
+	itemOrder.resize(count);
+	for (size_t i = 0; i < count; i++)
+		itemOrder[i] = (uint32_t)i;
+	nodes.clear();
+	stats.depth = 0;
+	stats.rebuilds++;
+	if (count == 0)
+	{
+		totalArea = 0;
+		UpdateCost();
+		stats.builtCost = stats.cost;
+		return;
+	}
+
+	// Splits are decided by where the centers of the boxes are
+	std::vector<XMFLOAT3> centroids(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		centroids[i] = XMFLOAT3((boxMins[i].x + boxMaxs[i].x) * 0.5f,
+			(boxMins[i].y + boxMaxs[i].y) * 0.5f, (boxMins[i].z + boxMaxs[i].z) * 0.5f);
+	}
+
+	// A binary tree with at least one item per leaf never needs more than 2n - 1 nodes
+	nodes.reserve(count * 2);
+	Node root = {};
+	root.itemCount = (uint32_t)count;
+	root.parent = NoParent;
+	nodes.push_back(root);
+
+	// Split nodes until every leaf is small enough or not worth splitting
+	// - A stack of nodes still to look at instead of recursion, since a
+	//   badly clustered scene can make the tree far deeper than the call
+	//   stack has room for
+	// - Left children come off first, so the nodes end up in the same
+	//   order recursion would put them in
+	std::vector<std::pair<uint32_t, size_t>> pending;
+	pending.push_back(std::make_pair(0u, (size_t)1));
+	while (!pending.empty())
+	{
+		uint32_t node = pending.back().first;
+		size_t depth = pending.back().second;
+		pending.pop_back();
+		stats.depth = std::max(stats.depth, depth);
+		if (!Split(node, centroids))
+			continue;
+
+		uint32_t firstChild = nodes[node].firstChild;
+		pending.push_back(std::make_pair(firstChild + 1, depth + 1));
+		pending.push_back(std::make_pair(firstChild, depth + 1));
+	}
+
+	// Work out the cost and where each item ended up
+	totalArea = 0;
+	stats.leafCount = 0;
+	for (size_t n = 0; n < nodes.size(); n++)
+	{
+		const Node& node = nodes[n];
+		double area = SurfaceArea(node.boxMin, node.boxMax);
+		if (node.firstChild != 0)
+		{
+			totalArea += area;
+			continue;
+		}
+		totalArea += area * node.itemCount;
+		stats.leafCount++;
+		for (uint32_t i = node.itemStart; i < node.itemStart + node.itemCount; i++)
+			itemLeaves[itemOrder[i]] = (uint32_t)n;
+	}
+	stats.nodeCount = nodes.size();
+	UpdateCost();
+	stats.builtCost = stats.cost;
+}
+
+// Binned SAH: drop the centroids into a few bins along each axis, then
+// find the boundary between bins where
+//   area(left) * items(left) + area(right) * items(right)
+// is smallest, and split there unless one leaf would be cheaper
+bool SceneBVH::Split(uint32_t nodeIndex, std::vector<XMFLOAT3>& centroids)
+{
+	UpdateNodeBox(nodes[nodeIndex]);
+	uint32_t start = nodes[nodeIndex].itemStart;
+	uint32_t count = nodes[nodeIndex].itemCount;
+	if (count <= 1)
+		return false;
+
+	// Range the centroids cover
+	XMFLOAT3 centerMin = EmptyMin, centerMax = EmptyMax;
+	for (uint32_t i = start; i < start + count; i++)
+		Grow(centerMin, centerMax, centroids[itemOrder[i]], centroids[itemOrder[i]]);
+
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestBin = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float lo = (&centerMin.x)[axis];
+		float extent = (&centerMax.x)[axis] - lo;
+		if (extent <= 0.0f)
+			continue;
+
+		// Fill the bins
+		uint32_t binCounts[BinCount] = {};
+		XMFLOAT3 binMins[BinCount], binMaxs[BinCount];
+		for (int b = 0; b < BinCount; b++)
+		{
+			binMins[b] = EmptyMin;
+			binMaxs[b] = EmptyMax;
+		}
+		float scale = BinCount / extent;
+		for (uint32_t i = start; i < start + count; i++)
+		{
+			uint32_t item = itemOrder[i];
+			int b = std::min(BinCount - 1, (int)(((&centroids[item].x)[axis] - lo) * scale));
+			binCounts[b]++;
+			Grow(binMins[b], binMaxs[b], boxMins[item], boxMaxs[item]);
+		}
+
+		// Sweep from the right to get the cost of everything past each boundary
+		float rightCosts[BinCount];
+		XMFLOAT3 sweepMin = EmptyMin, sweepMax = EmptyMax;
+		uint32_t sweepCount = 0;
+		for (int b = BinCount - 1; b > 0; b--)
+		{
+			Grow(sweepMin, sweepMax, binMins[b], binMaxs[b]);
+			sweepCount += binCounts[b];
+			rightCosts[b] = sweepCount > 0 ? SurfaceArea(sweepMin, sweepMax) * sweepCount : 0.0f;
+		}
+
+		// Then from the left, adding the two together at each boundary
+		sweepMin = EmptyMin;
+		sweepMax = EmptyMax;
+		sweepCount = 0;
+		for (int b = 0; b < BinCount - 1; b++)
+		{
+			Grow(sweepMin, sweepMax, binMins[b], binMaxs[b]);
+			sweepCount += binCounts[b];
+			if (sweepCount == 0 || sweepCount == count)
+				continue;
+			float cost = SurfaceArea(sweepMin, sweepMax) * sweepCount + rightCosts[b + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b + 1;
+			}
+		}
+	}
+
+	// A leaf costs one test per item, a split one test for each child box
+	// plus whatever is inside the child that's hit
+	const Node& node = nodes[nodeIndex];
+	float area = SurfaceArea(node.boxMin, node.boxMax);
+	float leafCost = area * count;
+	float splitCost = area * 2.0f + bestCost;
+	if (count <= MaxLeafItems && (bestAxis < 0 || splitCost >= leafCost))
+		return false;
+
+	// Move the left items to the front of the range
+	uint32_t leftCount;
+	if (bestAxis >= 0)
+	{
+		float lo = (&centerMin.x)[bestAxis];
+		float scale = BinCount / ((&centerMax.x)[bestAxis] - lo);
+		uint32_t* middle = std::partition(&itemOrder[start], &itemOrder[start] + count, [&](uint32_t item)
+		{
+			return std::min(BinCount - 1, (int)(((&centroids[item].x)[bestAxis] - lo) * scale)) < bestBin;
+		});
+		leftCount = (uint32_t)(middle - &itemOrder[start]);
+	}
+	else
+	{
+		// Every centroid is in the same place, so just halve the list
+		leftCount = count / 2;
+	}
+
+	Node left = {}, right = {};
+	left.itemStart = start;
+	left.itemCount = leftCount;
+	left.parent = nodeIndex;
+	right.itemStart = start + leftCount;
+	right.itemCount = count - leftCount;
+	right.parent = nodeIndex;
+	uint32_t firstChild = (uint32_t)nodes.size();
+	nodes[nodeIndex].firstChild = firstChild;
+	nodes.push_back(left);
+	nodes.push_back(right);
+	return true;
+}
+
+void SceneBVH::UpdateNodeBox(Node& node) const
+{
+	node.boxMin = EmptyMin;
+	node.boxMax = EmptyMax;
+	if (node.firstChild != 0)
+	{
+		for (uint32_t c = node.firstChild; c < node.firstChild + 2; c++)
+			Grow(node.boxMin, node.boxMax, nodes[c].boxMin, nodes[c].boxMax);
+		return;
+	}
+	for (uint32_t i = node.itemStart; i < node.itemStart + node.itemCount; i++)
+		Grow(node.boxMin, node.boxMax, boxMins[itemOrder[i]], boxMaxs[itemOrder[i]]);
+}
+
+void SceneBVH::UpdateCost()
+{
+	float rootArea = nodes.empty() ? 0.0f : SurfaceArea(nodes[0].boxMin, nodes[0].boxMax);
+	stats.cost = rootArea > 0.0f ? (float)(totalArea / rootArea) : 0.0f;
+}
+
+void SceneBVH::AppendItems(const Node& node, std::vector<uint32_t>& items) const
+{
+	items.insert(items.end(), itemOrder.begin() + node.itemStart, itemOrder.begin() + node.itemStart + node.itemCount);
+}
+
+// Planes a box is entirely inside of are left out for its children, and
+// once there are none left the whole subtree is visible
+size_t SceneBVH::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& items) const
+{
+	items.clear();
+	if (nodes.empty())
+		return 0;
+
+	// Node index and the planes still worth testing
+	std::vector<std::pair<uint32_t, uint32_t>> stack;
+	stack.reserve(64);
+	stack.push_back(std::make_pair(0u, 0x3Fu));
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back().first];
+		uint32_t planeMask = stack.back().second;
+		stack.pop_back();
+
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; p++)
+		{
+			if (!(planeMask & (1u << p)))
+				continue;
+			PlaneSide side = ClassifyBox(frustum.planes[p], node.boxMin, node.boxMax);
+			if (side == PLANE_OUTSIDE)
+				outside = true;
+			else if (side == PLANE_INSIDE)
+				planeMask &= ~(1u << p);
+		}
+		if (outside)
+			continue;
+
+		if (planeMask == 0)
+			AppendItems(node, items);
+		else if (node.firstChild != 0)
+		{
+			stack.push_back(std::make_pair(node.firstChild + 1, planeMask));
+			stack.push_back(std::make_pair(node.firstChild, planeMask));
+		}
+		else
+		{
+			for (uint32_t i = node.itemStart; i < node.itemStart + node.itemCount; i++)
+			{
+				uint32_t item = itemOrder[i];
+				if (BoxInFrustum(frustum, boxMins[item], boxMaxs[item]))
+					items.push_back(item);
+			}
+		}
+	}
+	return items.size();
+}
+
+size_t SceneBVH::QuerySphere(const XMFLOAT3& center, float radius, std::vector<uint32_t>& items) const
+{
+	items.clear();
+	if (nodes.empty())
+		return 0;
+
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!BoxTouchesSphere(node.boxMin, node.boxMax, center, radius))
+			continue;
+
+		if (node.firstChild != 0)
+		{
+			stack.push_back(node.firstChild + 1);
+			stack.push_back(node.firstChild);
+			continue;
+		}
+		for (uint32_t i = node.itemStart; i < node.itemStart + node.itemCount; i++)
+		{
+			uint32_t item = itemOrder[i];
+			if (BoxTouchesSphere(boxMins[item], boxMaxs[item], center, radius))
+				items.push_back(item);
+		}
+	}
+	return items.size();
+}
+
+size_t SceneBVH::QueryBox(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, std::vector<uint32_t>& items) const
+{
+	items.clear();
+	if (nodes.empty())
+		return 0;
+
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!BoxTouchesBox(node.boxMin, node.boxMax, boxMin, boxMax))
+			continue;
+
+		// Everything below a node inside the query box is inside it too
+		if (BoxContainsBox(boxMin, boxMax, node.boxMin, node.boxMax))
+			AppendItems(node, items);
+		else if (node.firstChild != 0)
+		{
+			stack.push_back(node.firstChild + 1);
+			stack.push_back(node.firstChild);
+		}
+		else
+		{
+			for (uint32_t i = node.itemStart; i < node.itemStart + node.itemCount; i++)
+			{
+				uint32_t item = itemOrder[i];
+				if (BoxTouchesBox(boxMins[item], boxMaxs[item], boxMin, boxMax))
+					items.push_back(item);
+			}
+		}
+	}
+	return items.size();
+}
+
+// Visits the nearer child first, and skips anything the ray only reaches
+// after the closest hit found so far
+bool SceneBVH::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance,
+	uint32_t& item, float& distance) const
+{
+	if (nodes.empty())
+		return false;
+
+	XMFLOAT3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	float closest = maxDistance;
+	bool hit = false;
+	if (RayEntersBox(origin, inverseDirection, closest, nodes[0].boxMin, nodes[0].boxMax) < 0.0f)
+		return false;
+
+	// Node index and where the ray enters it
+	std::vector<std::pair<uint32_t, float>> stack;
+	stack.reserve(64);
+	stack.push_back(std::make_pair(0u, 0.0f));
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back().first];
+		float enter = stack.back().second;
+		stack.pop_back();
+		if (enter > closest)
+			continue;
+
+		if (node.firstChild == 0)
+		{
+			for (uint32_t i = node.itemStart; i < node.itemStart + node.itemCount; i++)
+			{
+				uint32_t candidate = itemOrder[i];
+				float t = RayEntersBox(origin, inverseDirection, closest, boxMins[candidate], boxMaxs[candidate]);
+				if (t >= 0.0f && (!hit || t < closest || (t == closest && candidate < item)))
+				{
+					closest = t;
+					item = candidate;
+					hit = true;
+				}
+			}
+			continue;
+		}
+
+		// Push the farther child first so the nearer one comes off the stack next
+		const Node& a = nodes[node.firstChild];
+		const Node& b = nodes[node.firstChild + 1];
+		float enterA = RayEntersBox(origin, inverseDirection, closest, a.boxMin, a.boxMax);
+		float enterB = RayEntersBox(origin, inverseDirection, closest, b.boxMin, b.boxMax);
+		bool aFirst = enterA >= 0.0f && (enterB < 0.0f || enterA <= enterB);
+		if (aFirst)
+		{
+			if (enterB >= 0.0f)
+				stack.push_back(std::make_pair(node.firstChild + 1, enterB));
+			stack.push_back(std::make_pair(node.firstChild, enterA));
+		}
+		else
+		{
+			if (enterA >= 0.0f)
+				stack.push_back(std::make_pair(node.firstChild, enterA));
+			if (enterB >= 0.0f)
+				stack.push_back(std::make_pair(node.firstChild + 1, enterB));
+		}
+	}
+
+	if (hit)
+		distance = closest;
+	return hit;
+}
+
+// Random boxes filling a big cube, viewed by the same camera as the
+// FrustumCuller benchmark so the two can be compared
+SceneBVHBenchmark SceneBVH::Benchmark(size_t count)
+{
+	SceneBVHBenchmark result;
+	result.count = count;
+
+	uint32_t seed = 12345;
+	auto random = [&seed](float lo, float hi)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return lo + (hi - lo) * ((seed >> 8) / 16777216.0f);
+	};
+	std::vector<XMFLOAT3> mins(count), maxs(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		XMFLOAT3 center(random(-500, 500), random(-500, 500), random(-500, 500));
+		XMFLOAT3 extent(random(0.25f, 2.5f), random(0.25f, 2.5f), random(0.25f, 2.5f));
+		mins[i] = XMFLOAT3(center.x - extent.x, center.y - extent.y, center.z - extent.z);
+		maxs[i] = XMFLOAT3(center.x + extent.x, center.y + extent.y, center.z + extent.z);
+	}
+
+	XMFLOAT4X4 view, proj;
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(0, 0, -100, 0), XMVectorSet(0.3f, 0.1f, 1, 0), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f));
+	Frustum frustum = Frustum::FromCamera(view, proj);
+
+	// Build
+	SceneBVH bvh;
+	auto start = std::chrono::high_resolution_clock::now();
+	bvh.Build(&mins[0], &maxs[0], count);
+	result.buildSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	// Frustum culling, the three ways
+	std::vector<uint32_t> brute, found;
+	brute.reserve(count);
+	found.reserve(count);
+	auto bruteCull = [&]()
+	{
+		brute.clear();
+		for (size_t i = 0; i < count; i++)
+		{
+			if (BoxInFrustum(frustum, mins[i], maxs[i]))
+				brute.push_back((uint32_t)i);
+		}
+	};
+	// Sorted copies of both lists should match exactly
+	auto compare = [&]()
+	{
+		std::sort(found.begin(), found.end());
+		std::sort(brute.begin(), brute.end());
+		std::vector<uint32_t> difference;
+		std::set_symmetric_difference(found.begin(), found.end(), brute.begin(), brute.end(), std::back_inserter(difference));
+		result.mismatches += difference.size();
+	};
+
+	start = std::chrono::high_resolution_clock::now();
+	bruteCull();
+	result.bruteCullSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	FrustumCuller culler;
+	for (size_t i = 0; i < count; i++)
+	{
+		XMFLOAT3 center((mins[i].x + maxs[i].x) * 0.5f, (mins[i].y + maxs[i].y) * 0.5f, (mins[i].z + maxs[i].z) * 0.5f);
+		float dx = maxs[i].x - center.x, dy = maxs[i].y - center.y, dz = maxs[i].z - center.z;
+		culler.Add(center, sqrtf(dx * dx + dy * dy + dz * dz));
+	}
+	std::vector<uint32_t> flat;
+	flat.reserve(count + 4);
+	start = std::chrono::high_resolution_clock::now();
+	culler.Cull(frustum, flat);
+	result.flatCullSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	result.visible = bvh.QueryFrustum(frustum, found);
+	result.bvhCullSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	compare();
+
+	// Nudge 1 in 100 items, then check culling still agrees
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < count; i += 100)
+	{
+		XMFLOAT3 offset(random(-1, 1), random(-1, 1), random(-1, 1));
+		mins[i] = XMFLOAT3(mins[i].x + offset.x, mins[i].y + offset.y, mins[i].z + offset.z);
+		maxs[i] = XMFLOAT3(maxs[i].x + offset.x, maxs[i].y + offset.y, maxs[i].z + offset.z);
+		bvh.Update((uint32_t)i, mins[i], maxs[i]);
+	}
+	bvh.Refit();
+	result.refitSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	bruteCull();
+	bvh.QueryFrustum(frustum, found);
+	compare();
+
+	// Picking rays from random points in random directions
+	// - Fewer of them for big scenes, since the brute force way is so slow
+	result.rays = count > 100000 ? 100 : 1000;
+	std::vector<XMFLOAT3> origins(result.rays), directions(result.rays);
+	for (size_t r = 0; r < result.rays; r++)
+	{
+		origins[r] = XMFLOAT3(random(-500, 500), random(-500, 500), random(-500, 500));
+		directions[r] = XMFLOAT3(random(-1, 1), random(-1, 1), random(-1, 1));
+	}
+	std::vector<float> bruteDistances(result.rays, -1.0f), bvhDistances(result.rays, -1.0f);
+
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t r = 0; r < result.rays; r++)
+	{
+		XMFLOAT3 inverseDirection(1.0f / directions[r].x, 1.0f / directions[r].y, 1.0f / directions[r].z);
+		float closest = 2000.0f;
+		for (size_t i = 0; i < count; i++)
+		{
+			float t = RayEntersBox(origins[r], inverseDirection, closest, mins[i], maxs[i]);
+			if (t >= 0.0f)
+			{
+				closest = t;
+				bruteDistances[r] = t;
+			}
+		}
+	}
+	result.bruteRaySeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t r = 0; r < result.rays; r++)
+	{
+		uint32_t item;
+		float distance;
+		if (bvh.Raycast(origins[r], directions[r], 2000.0f, item, distance))
+			bvhDistances[r] = distance;
+	}
+	result.bvhRaySeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	for (size_t r = 0; r < result.rays; r++)
+		result.mismatches += bruteDistances[r] != bvhDistances[r];
+
+	// Overlap queries of about the size of a room
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t r = 0; r < result.rays; r++)
+		bvh.QuerySphere(origins[r], 20.0f, found);
+	result.sphereQuerySeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	return result;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include "FrustumCuller.h"
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Shape of a SceneBVH and how it's been kept up to date
+struct SceneBVHStats
+{
+	size_t nodeCount = 0;
+	size_t leafCount = 0;
+	size_t depth = 0;
+	// Surface area heuristic cost, relative to testing only the root box
+	// - Grows as refits stretch the boxes, which is what triggers a rebuild
+	float cost = 0;
+	// Cost right after the last full build
+	float builtCost = 0;
+	size_t refits = 0;
+	size_t rebuilds = 0;
+};
+
+// Timings from SceneBVH::Benchmark
+struct SceneBVHBenchmark
+{
+	size_t count = 0;
+	double buildSeconds = 0;
+	// Every box against the frustum, one at a time
+	double bruteCullSeconds = 0;
+	// FrustumCuller's 4 at a time sphere test over everything, for reference
+	double flatCullSeconds = 0;
+	double bvhCullSeconds = 0;
+	size_t visible = 0;
+	// Moving 1 in 100 items and refitting
+	double refitSeconds = 0;
+	// Rays through the scene, against every box and through the tree
+	size_t rays = 0;
+	double bruteRaySeconds = 0;
+	double bvhRaySeconds = 0;
+	// Sphere overlap queries through the tree
+	double sphereQuerySeconds = 0;
+	// Results that didn't match the brute force versions
+	size_t mismatches = 0;
+
+	double CullSpeedup() const { return bvhCullSeconds > 0 ? bruteCullSeconds / bvhCullSeconds : 0; }
+	double RaySpeedup() const { return bvhRaySeconds > 0 ? bruteRaySeconds / bvhRaySeconds : 0; }
+};
+
+// Bounding volume hierarchy of world space boxes, one per scene item
+// - Built top down with the surface area heuristic (SAH), using binned
+//   centroids like most real time builders
+// - Moving an item only refits the boxes on its path to the root; the
+//   tree is rebuilt once refitting has made it much worse than a fresh build
+// - Answers frustum, ray, sphere and box queries without looking at every item
+// - Items are whatever the caller wants them to be (Game uses entity indices)
+// - Doesn't need DirectX, so it can be built and checked without a GPU
+class SceneBVH
+{
+public:
+	// Most items a leaf is allowed to hold
+	static const uint32_t MaxLeafItems = 4;
+	// Rebuild once refits make the tree this many times more costly than when it was built
+	static const float RebuildCostRatio;
+
+	// Replaces everything with count items and builds the tree
+	void Build(const DirectX::XMFLOAT3* boxMins, const DirectX::XMFLOAT3* boxMaxs, size_t count);
+	// Adds an item, returning its index (the tree is rebuilt at the next Refit)
+	uint32_t Add(const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax);
+	// Moves an item (the tree is fixed up at the next Refit)
+	void Update(uint32_t item, const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax);
+	// Brings the tree up to date with every Add and Update since the last call
+	// - Refits the changed paths, or rebuilds if that isn't good enough
+	void Refit();
+
+	size_t GetCount() const { return boxMins.size(); }
+	const SceneBVHStats& GetStats() const { return stats; }
+
+	// Queries
+	// - Each one replaces items with what it found (in no particular order)
+	//   and returns how many that was
+	// - Only valid while nothing is waiting for Refit
+	size_t QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& items) const;
+	size_t QuerySphere(const DirectX::XMFLOAT3& center, float radius, std::vector<uint32_t>& items) const;
+	size_t QueryBox(const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax, std::vector<uint32_t>& items) const;
+	// Nearest item whose box the ray enters within maxDistance
+	// - direction doesn't need to be normalized, and distance is in units of it
+	// - A ray starting inside a box hits it at distance 0
+	bool Raycast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance,
+		uint32_t& item, float& distance) const;
+
+	// Times building, culling, refitting and picking in a random scene of count boxes
+	static SceneBVHBenchmark Benchmark(size_t count);
+
+private:
+	// Children are always made together, so only the first one is stored
+	// - The items of a node's whole subtree are one range of itemOrder,
+	//   which lets a node that's entirely inside a query skip its children
+	struct Node
+	{
+		DirectX::XMFLOAT3 boxMin;
+		uint32_t itemStart;
+		DirectX::XMFLOAT3 boxMax;
+		uint32_t itemCount;
+		// Index of the first child, or 0 for a leaf (the root is never a child)
+		uint32_t firstChild;
+		uint32_t parent;
+	};
+
+	// By item
+	std::vector<DirectX::XMFLOAT3> boxMins, boxMaxs;
+	std::vector<uint32_t> itemLeaves;	// Leaf holding each item
+	std::vector<uint8_t> itemDirty;
+	std::vector<uint32_t> dirtyItems;
+	// Items in leaf order
+	std::vector<uint32_t> itemOrder;
+	std::vector<Node> nodes;
+	// Sum of every node's surface area (the numerator of the cost)
+	double totalArea = 0;
+	// Items were added since the tree was built
+	bool needsBuild = false;
+	SceneBVHStats stats;
+
+	// Rebuilds the whole tree from the item boxes
+	void Rebuild();
+	// Splits a node in two if the SAH says it's worth it, returning whether it did
+	bool Split(uint32_t node, std::vector<DirectX::XMFLOAT3>& centroids);
+	// Recomputes a node's box from its children or items
+	void UpdateNodeBox(Node& node) const;
+	void UpdateCost();
+	// Appends every item below a node
+	void AppendItems(const Node& node, std::vector<uint32_t>& items) const;
+
+	static float SurfaceArea(const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax);
+};
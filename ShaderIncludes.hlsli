@@ -137,10 +137,32 @@ struct VertexShaderInput
 	//  v    v                v
 	float3 position		: POSITION;     // XYZ position
 	float3 normal		: NORMAL;
-	float3 tangent		: TANGENT;
+	float4 tangent		: TANGENT;		// W is the handedness
 	float2 uv		: UV;
 };
 
+// Compact version of VertexShaderInput
+// - Must match PackedVertex in our C++ code
+// - The semantic suffixes tell SimpleShader the real format of each element:
+//   _UNORM16 and _SNORM16 are 16-bit normalized integers, _HALF is 16-bit floats
+struct VertexShaderInputPacked
+{
+	float4 position		: POSITION_UNORM16;	// XYZ across the mesh bounds, W is the tangent handedness (0 or 1)
+	float2 normal		: NORMAL_SNORM16;	// Octahedral encoded
+	float2 tangent		: TANGENT_SNORM16;	// Octahedral encoded
+	float2 uv			: UV_HALF;
+};
+
+// Turns an octahedral encoded direction back into a unit vector
+// - Same math as VertexPacking::OctDecode() in our C++ code
+float3 OctDecode(float2 e)
+{
+	float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += (n.xy >= 0.0f) ? -t : t;
+	return normalize(n);
+}
+
 // Struct representing the data we expect to receive from earlier pipeline stages
 // - Should match the output of our corresponding vertex shader
 // - The name of the struct itself is unimportant
@@ -167,7 +189,7 @@ struct VertexToPixelNormals
 	float4 position		: SV_POSITION;
 	float4 color		: COLOR;
 	float3 normal		: NORMAL;
-	float3 tangent		: TANGENT;
+	float4 tangent		: TANGENT;		// W is the handedness
 	float3 worldPos		: POSITION;
 	float2 uv			: UV;
 };
@@ -0,0 +1,204 @@
+#include "ShaderReflectionCache.h"
+#include <cstring>
+
+static_assert(sizeof(ShaderReflectionCacheHeader) % 8 == 0, "ShaderReflectionCacheHeader must stay a multiple of 8 bytes");
+
+// Hashes bytes with 64-bit FNV-1a
+uint64_t ShaderReflectionCache::Hash(const void* data, size_t size, uint64_t hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void ShaderReflectionCache::Clear()
+{
+	constantBuffers.clear();
+	textures.clear();
+	samplers.clear();
+	inputParameters.clear();
+}
+
+// Tables are written as 32-bit counts and values, with strings as a length
+// followed by their characters
+namespace
+{
+	struct Writer
+	{
+		std::vector<char>& out;
+
+		void U32(uint32_t value)
+		{
+			const char* bytes = (const char*)&value;
+			out.insert(out.end(), bytes, bytes + sizeof(value));
+		}
+		void String(const std::string& value)
+		{
+			U32((uint32_t)value.size());
+			out.insert(out.end(), value.begin(), value.end());
+		}
+	};
+
+	// Every read checks it stays inside the data, so a bad file can't
+	// read past the end
+	struct Reader
+	{
+		const char* data;
+		size_t size;
+		size_t at = 0;
+		bool ok = true;
+
+		uint32_t U32()
+		{
+			uint32_t value = 0;
+			if (size - at < sizeof(value))
+			{
+				ok = false;
+				return 0;
+			}
+			memcpy(&value, data + at, sizeof(value));
+			at += sizeof(value);
+			return value;
+		}
+		std::string String()
+		{
+			uint32_t length = U32();
+			if (!ok || size - at < length)
+			{
+				ok = false;
+				return std::string();
+			}
+			std::string value(data + at, length);
+			at += length;
+			return value;
+		}
+		// Counts can't be more than the bytes left, which stops a bad count
+		// from reserving huge arrays
+		uint32_t Count()
+		{
+			uint32_t count = U32();
+			if (count > size - at)
+				ok = false;
+			return ok ? count : 0;
+		}
+	};
+}
+
+std::vector<char> ShaderReflectionCache::Serialize(const void* blob, size_t blobSize) const
+{
+	std::vector<char> out(sizeof(ShaderReflectionCacheHeader));
+	Writer writer = { out };
+
+	writer.U32((uint32_t)constantBuffers.size());
+	for (const ReflectedConstantBuffer& cb : constantBuffers)
+	{
+		writer.String(cb.name);
+		writer.U32(cb.type);
+		writer.U32(cb.size);
+		writer.U32(cb.bindIndex);
+		writer.U32((uint32_t)cb.variables.size());
+		for (const ReflectedVariable& var : cb.variables)
+		{
+			writer.String(var.name);
+			writer.U32(var.byteOffset);
+			writer.U32(var.size);
+		}
+	}
+
+	for (const std::vector<ReflectedResource>* resources : { &textures, &samplers })
+	{
+		writer.U32((uint32_t)resources->size());
+		for (const ReflectedResource& resource : *resources)
+		{
+			writer.String(resource.name);
+			writer.U32(resource.bindIndex);
+		}
+	}
+
+	writer.U32((uint32_t)inputParameters.size());
+	for (const ReflectedInputParameter& param : inputParameters)
+	{
+		writer.String(param.semanticName);
+		writer.U32(param.semanticIndex);
+		writer.U32(param.componentType);
+		writer.U32(param.mask);
+	}
+
+	// Fill out the header now the tables are done
+	ShaderReflectionCacheHeader header = {};
+	memcpy(header.magic, "SHRC", 4);
+	header.version = Version;
+	header.blobSize = blobSize;
+	header.blobHash = Hash(blob, blobSize);
+	header.dataSize = (uint32_t)(out.size() - sizeof(header));
+	header.contentHash = Hash(out.data() + sizeof(header), header.dataSize);
+	memcpy(out.data(), &header, sizeof(header));
+	return out;
+}
+
+bool ShaderReflectionCache::Deserialize(const char* data, size_t size, const void* blob, size_t blobSize)
+{
+	Clear();
+
+	// Make sure it's a sidecar we understand, for this exact shader
+	ShaderReflectionCacheHeader header;
+	if (size < sizeof(header))
+		return false;
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, "SHRC", 4) != 0 ||
+		header.version != Version ||
+		header.dataSize != size - sizeof(header) ||
+		header.blobSize != blobSize ||
+		header.blobHash != Hash(blob, blobSize) ||
+		header.contentHash != Hash(data + sizeof(header), header.dataSize))
+		return false;
+
+	Reader reader = { data + sizeof(header), header.dataSize };
+
+	constantBuffers.resize(reader.Count());
+	for (ReflectedConstantBuffer& cb : constantBuffers)
+	{
+		cb.name = reader.String();
+		cb.type = reader.U32();
+		cb.size = reader.U32();
+		cb.bindIndex = reader.U32();
+		cb.variables.resize(reader.Count());
+		for (ReflectedVariable& var : cb.variables)
+		{
+			var.name = reader.String();
+			var.byteOffset = reader.U32();
+			var.size = reader.U32();
+		}
+	}
+
+	for (std::vector<ReflectedResource>* resources : { &textures, &samplers })
+	{
+		resources->resize(reader.Count());
+		for (ReflectedResource& resource : *resources)
+		{
+			resource.name = reader.String();
+			resource.bindIndex = reader.U32();
+		}
+	}
+
+	inputParameters.resize(reader.Count());
+	for (ReflectedInputParameter& param : inputParameters)
+	{
+		param.semanticName = reader.String();
+		param.semanticIndex = reader.U32();
+		param.componentType = reader.U32();
+		param.mask = reader.U32();
+	}
+
+	// Everything should have been read, with nothing left over
+	if (!reader.ok || reader.at != reader.size)
+	{
+		Clear();
+		return false;
+	}
+	return true;
+}
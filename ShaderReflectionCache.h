@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Header at the very start of a shader reflection sidecar file
+// - Followed by dataSize bytes of tables (see ShaderReflectionCache)
+struct ShaderReflectionCacheHeader
+{
+	char magic[4];				// Always "SHRC"
+	uint32_t version;			// Bumped whenever the layout changes
+	uint64_t blobSize;			// Size of the compiled shader it came from
+	uint64_t blobHash;			// Hash of the compiled shader it came from
+	uint64_t contentHash;		// Hash of the tables
+	uint32_t dataSize;			// Bytes of tables after the header
+	uint32_t reserved;			// Keeps the header a multiple of 8 bytes
+};
+
+// A variable in a constant buffer
+struct ReflectedVariable
+{
+	std::string name;
+	uint32_t byteOffset = 0;
+	uint32_t size = 0;
+};
+
+struct ReflectedConstantBuffer
+{
+	std::string name;
+	uint32_t type = 0;			// D3D_CBUFFER_TYPE
+	uint32_t size = 0;
+	uint32_t bindIndex = 0;
+	std::vector<ReflectedVariable> variables;
+};
+
+// A texture or sampler
+struct ReflectedResource
+{
+	std::string name;
+	uint32_t bindIndex = 0;
+};
+
+// One element of the shader's input signature
+// - Kept raw, so how an input layout is made from it can change without
+//   throwing away every sidecar
+struct ReflectedInputParameter
+{
+	std::string semanticName;
+	uint32_t semanticIndex = 0;
+	uint32_t componentType = 0;	// D3D_REGISTER_COMPONENT_TYPE
+	uint32_t mask = 0;
+};
+
+// Everything SimpleShader reflects out of a compiled shader, and a compact
+// binary form of it to save next to the .cso, so later runs can skip
+// reflection altogether
+// - Sidecars are tied to the exact shader they came from by its size and
+//   hash, so a rebuilt shader just gets reflected (and saved) again
+// - Pure C++, so sidecars can be written and checked without a device
+class ShaderReflectionCache
+{
+public:
+	static const uint32_t Version = 1;
+
+	std::vector<ReflectedConstantBuffer> constantBuffers;
+	std::vector<ReflectedResource> textures;
+	std::vector<ReflectedResource> samplers;
+	std::vector<ReflectedInputParameter> inputParameters;
+
+	void Clear();
+
+	// Header and tables for the shader in blob
+	std::vector<char> Serialize(const void* blob, size_t blobSize) const;
+
+	// Reads tables written by Serialize, returning false (and leaving this
+	// empty) if they're corrupt, from another version or another shader
+	bool Deserialize(const char* data, size_t size, const void* blob, size_t blobSize);
+
+	// 64-bit FNV-1a hash of a block of memory
+	static uint64_t Hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+};
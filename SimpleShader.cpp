@@ -1,9 +1,83 @@
 #include "SimpleShader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ BASE SIMPLE SHADER --------------------------------------------------
 ///////////////////////////////////////////////////////////////////////////////
 
+SimpleUploadStats ISimpleShader::uploadStats;
+SimpleReflectionStats ISimpleShader::reflectionStats;
+
+// --------------------------------------------------------
+// A StateCache that can be stored in a device context's
+// private data, so it's released along with the context
+//  - Every shader using it holds a reference too, so it
+//    can't go away while they still bind through it
+// --------------------------------------------------------
+class SimpleStateCacheData : public IUnknown
+{
+public:
+	StateCache Cache;
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object)
+	{
+		if (riid != __uuidof(IUnknown))
+		{
+			*object = 0;
+			return E_NOINTERFACE;
+		}
+		AddRef();
+		*object = this;
+		return S_OK;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() { return (ULONG)InterlockedIncrement(&references); }
+
+	ULONG STDMETHODCALLTYPE Release()
+	{
+		ULONG count = (ULONG)InterlockedDecrement(&references);
+		if (count == 0)
+			delete this;
+		return count;
+	}
+
+private:
+	LONG references = 1;
+};
+
+// Where the cache lives in a context's private data
+static const GUID StateCacheDataGuid = { 0x6b1f3c52, 0x9d4e, 0x4a7b, { 0x8c, 0x21, 0x5e, 0x93, 0x0f, 0x7d, 0xa4, 0x18 } };
+
+// --------------------------------------------------------
+// Gets the StateCache shared by every shader on a context,
+// making it the first time that context is asked about
+//  - Gives back a reference for the caller to release
+//  - Without a context (like the headless tests) the cache
+//    isn't shared with anything
+// --------------------------------------------------------
+static SimpleStateCacheData* AcquireStateCache(ID3D11DeviceContext* context)
+{
+	if (!context)
+		return new SimpleStateCacheData();
+
+	// Shaders made on two threads at once mustn't both make one
+	static std::mutex creation;
+	std::lock_guard<std::mutex> lock(creation);
+
+	IUnknown* existing = 0;
+	UINT size = sizeof(existing);
+	if (SUCCEEDED(context->GetPrivateData(StateCacheDataGuid, &size, &existing)) && existing)
+		return static_cast<SimpleStateCacheData*>(existing);
+
+	// If the context can't hold it, this shader just keeps its own
+	SimpleStateCacheData* data = new SimpleStateCacheData();
+	context->SetPrivateDataInterface(StateCacheDataGuid, data);
+	return data;
+}
+
 // --------------------------------------------------------
 // Constructor accepts DirectX device & context
 // --------------------------------------------------------
@@ -12,6 +86,10 @@ ISimpleShader::ISimpleShader(ID3D11Device* device, ID3D11DeviceContext* context)
 	// Save the device
 	this->device = device;
 	this->deviceContext = context;
+	this->uploader = 0;
+	this->constantAllocator = 0;
+	this->stateCacheData = AcquireStateCache(context);
+	this->stateCache = &stateCacheData->Cache;
 
 	// Set up fields
 	this->constantBufferCount = 0;
@@ -28,6 +106,7 @@ ISimpleShader::~ISimpleShader()
 	// Derived class destructors will call this class's CleanUp method
 	if(shaderBlob)
 		shaderBlob->Release();
+	stateCacheData->Release();
 }
 
 // --------------------------------------------------------
@@ -39,7 +118,8 @@ void ISimpleShader::CleanUp()
 	// Handle constant buffers and local data buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		constantBuffers[i].ConstantBuffer->Release();
+		if (constantBuffers[i].ConstantBuffer)
+			constantBuffers[i].ConstantBuffer->Release();
 		delete[] constantBuffers[i].LocalDataBuffer;
 	}
 
@@ -60,11 +140,176 @@ void ISimpleShader::CleanUp()
 	cbTable.clear();
 	samplerTable.clear();
 	textureTable.clear();
+	varHashes.clear();
+	textureHashes.clear();
+	samplerHashes.clear();
+}
+
+// --------------------------------------------------------
+// Reflects the tables SimpleShader needs out of a compiled
+// shader
+//
+// shaderBlob - The shader's compiled code
+// reflection - Where the tables go
+//
+// Returns true if the shader could be reflected, false otherwise
+// --------------------------------------------------------
+static bool ReflectShaderBlob(ID3DBlob* shaderBlob, ShaderReflectionCache& reflection)
+{
+	reflection.Clear();
+
+	// Set up shader reflection to get information about
+	// this shader and its variables,  buffers, etc.
+	ID3D11ShaderReflection* refl;
+	HRESULT hr = D3DReflect(
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize(),
+		IID_ID3D11ShaderReflection,
+		(void**)&refl);
+	if (hr != S_OK)
+		return false;
+
+	// Get the description of the shader
+	D3D11_SHADER_DESC shaderDesc;
+	refl->GetDesc(&shaderDesc);
+
+	// Handle bound resources (like shaders and samplers)
+	for (unsigned int r = 0; r < shaderDesc.BoundResources; r++)
+	{
+		// Get this resource's description
+		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
+		refl->GetResourceBindingDesc(r, &resourceDesc);
+
+		// Check the type
+		ReflectedResource resource;
+		resource.name = resourceDesc.Name;
+		resource.bindIndex = resourceDesc.BindPoint;
+		if (resourceDesc.Type == D3D_SIT_TEXTURE)
+			reflection.textures.push_back(resource);
+		else if (resourceDesc.Type == D3D_SIT_SAMPLER)
+			reflection.samplers.push_back(resource);
+	}
+
+	// Loop through all constant buffers
+	reflection.constantBuffers.resize(shaderDesc.ConstantBuffers);
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
+	{
+		// Get this buffer and its description
+		ID3D11ShaderReflectionConstantBuffer* cb =
+			refl->GetConstantBufferByIndex(b);
+		D3D11_SHADER_BUFFER_DESC bufferDesc;
+		cb->GetDesc(&bufferDesc);
+
+		// Get the description of the resource binding, so
+		// we know exactly how it's bound in the shader
+		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
+
+		ReflectedConstantBuffer& buffer = reflection.constantBuffers[b];
+		buffer.name = bufferDesc.Name;
+		buffer.type = bufferDesc.Type;
+		buffer.size = bufferDesc.Size;
+		buffer.bindIndex = bindDesc.BindPoint;
+
+		// Loop through all variables in this buffer
+		buffer.variables.resize(bufferDesc.Variables);
+		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		{
+			D3D11_SHADER_VARIABLE_DESC varDesc;
+			cb->GetVariableByIndex(v)->GetDesc(&varDesc);
+			buffer.variables[v].name = varDesc.Name;
+			buffer.variables[v].byteOffset = varDesc.StartOffset;
+			buffer.variables[v].size = varDesc.Size;
+		}
+	}
+
+	// Input signature, for vertex shaders to make an input layout from
+	reflection.inputParameters.resize(shaderDesc.InputParameters);
+	for (unsigned int i = 0; i < shaderDesc.InputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetInputParameterDesc(i, &paramDesc);
+		reflection.inputParameters[i].semanticName = paramDesc.SemanticName;
+		reflection.inputParameters[i].semanticIndex = paramDesc.SemanticIndex;
+		reflection.inputParameters[i].componentType = paramDesc.ComponentType;
+		reflection.inputParameters[i].mask = paramDesc.Mask;
+	}
+
+	// All set
+	refl->Release();
+	return true;
+}
+
+// --------------------------------------------------------
+// Gets the shader's reflection tables, from the sidecar
+// file next to it if there's one made from this exact
+// shader, or by reflecting the shader (and saving a new
+// sidecar) if not
+//
+// shaderFile - The compiled shader the blob came from
+//
+// Returns true if the tables were loaded or reflected,
+// false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::LoadReflection(LPCWSTR shaderFile)
+{
+	std::wstring cacheFile = std::wstring(shaderFile) + L".reflection";
+	const void* blob = shaderBlob->GetBufferPointer();
+	size_t blobSize = shaderBlob->GetBufferSize();
+	auto start = std::chrono::high_resolution_clock::now();
+	auto elapsed = [&start]()
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+	// Try the sidecar first
+	FILE* file = 0;
+	if (_wfopen_s(&file, cacheFile.c_str(), L"rb") == 0 && file)
+	{
+		std::vector<char> data;
+		char chunk[4096];
+		size_t read;
+		while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+			data.insert(data.end(), chunk, chunk + read);
+		fclose(file);
+
+		if (reflection.Deserialize(data.data(), data.size(), blob, blobSize))
+		{
+			reflectionStats.cacheLoads++;
+			reflectionStats.seconds += elapsed();
+			return true;
+		}
+	}
+
+	// Reflect it the slow way
+	bool reflected = ReflectShaderBlob(shaderBlob, reflection);
+	reflectionStats.seconds += elapsed();
+	if (!reflected)
+		return false;
+	reflectionStats.reflections++;
+
+	// Save it for next time (not being able to is fine)
+	// - Written to a file of its own first and then moved into place, so
+	//   a crash or another process loading the shader never sees half
+	//   of a sidecar
+	std::vector<char> data = reflection.Serialize(blob, blobSize);
+	std::wstring tempFile = cacheFile + L"." +
+		std::to_wstring(GetCurrentProcessId()) + L"." + std::to_wstring(GetCurrentThreadId()) + L".tmp";
+	if (_wfopen_s(&file, tempFile.c_str(), L"wb") == 0 && file)
+	{
+		bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+		written = fclose(file) == 0 && written;
+		if (written && MoveFileExW(tempFile.c_str(), cacheFile.c_str(), MOVEFILE_REPLACE_EXISTING))
+			reflectionStats.cacheWrites++;
+		else
+			_wremove(tempFile.c_str());
+	}
+	return true;
 }
 
 // --------------------------------------------------------
 // Loads the specified shader and builds the variable table 
-// using shader reflection.
+// using its reflection tables.
 //
 // shaderFile - A "wide string" specifying the compiled shader to load
 // 
@@ -79,6 +324,14 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	// Get the information about this shader and its variables,
+	// buffers, etc. before creating it, as vertex shaders need
+	// the input signature
+	if (!LoadReflection(shaderFile))
+	{
+		return false;
+	}
+
 	// Create the shader - Calls an overloaded version of this abstract
 	// method in the appropriate child class
 	shaderValid = CreateShader(shaderBlob);
@@ -87,128 +340,172 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
-	// Set up shader reflection to get information about
-	// this shader and its variables,  buffers, etc.
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-	
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
+	BuildTables();
+	return true;
+}
 
+// --------------------------------------------------------
+// Sets up the constant buffers, their local data and the
+// lookup tables for everything in the reflection
+//  - Without a device (like the headless tests) no GPU
+//    buffers are made, so uploads must go to an uploader
+// --------------------------------------------------------
+void ISimpleShader::BuildTables()
+{
 	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
+	constantBufferCount = (unsigned int)reflection.constantBuffers.size();
 	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
-	
+
 	// Handle bound resources (like shaders and samplers)
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
+	for (const ReflectedResource& texture : reflection.textures)
 	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
+		// Create the SRV wrapper
+		SimpleSRV* srv = new SimpleSRV();
+		srv->BindIndex = texture.bindIndex;						// Shader bind point
+		srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
 
-		// Check the type
-		switch (resourceDesc.Type)
-		{
-		case D3D_SIT_TEXTURE: // A texture resource
-		{
-			// Create the SRV wrapper
-			SimpleSRV* srv = new SimpleSRV();
-			srv->BindIndex = resourceDesc.BindPoint;				// Shader bind point
-			srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
-
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
-			shaderResourceViews.push_back(srv);
-		}
-			break;
+		textureTable.insert(std::pair<std::string, SimpleSRV*>(texture.name, srv));
+		shaderResourceViews.push_back(srv);
+	}
 
-		case D3D_SIT_SAMPLER: // A sampler resource
-		{
-			// Create the sampler wrapper
-			SimpleSampler* samp = new SimpleSampler();
-			samp->BindIndex = resourceDesc.BindPoint;			// Shader bind point
-			samp->Index = (unsigned int)samplerStates.size();	// Raw index
+	for (const ReflectedResource& sampler : reflection.samplers)
+	{
+		// Create the sampler wrapper
+		SimpleSampler* samp = new SimpleSampler();
+		samp->BindIndex = sampler.bindIndex;				// Shader bind point
+		samp->Index = (unsigned int)samplerStates.size();	// Raw index
 
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
-			samplerStates.push_back(samp);
-		}
-			break;
-		}
+		samplerTable.insert(std::pair<std::string, SimpleSampler*>(sampler.name, samp));
+		samplerStates.push_back(samp);
 	}
 
 	// Loop through all constant buffers
 	for (unsigned int b = 0; b < constantBufferCount; b++)
 	{
-		// Get this buffer
-		ID3D11ShaderReflectionConstantBuffer* cb =
-			refl->GetConstantBufferByIndex(b);
-		
-		// Get the description of this buffer
-		D3D11_SHADER_BUFFER_DESC bufferDesc;
-		cb->GetDesc(&bufferDesc);
+		const ReflectedConstantBuffer& bufferDesc = reflection.constantBuffers[b];
 
 		// Save the type, which we reference when setting these buffers
-		constantBuffers[b].Type = bufferDesc.Type;
-		
-		// Get the description of the resource binding, so
-		// we know exactly how it's bound in the shader
-		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
-		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
+		constantBuffers[b].Type = (D3D_CBUFFER_TYPE)bufferDesc.type;
 		
 		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
-		constantBuffers[b].Name = bufferDesc.Name;
-		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
+		constantBuffers[b].BindIndex = bufferDesc.bindIndex;
+		constantBuffers[b].Name = bufferDesc.name;
+		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.name, &constantBuffers[b]));
 
 		// Create this constant buffer
 		D3D11_BUFFER_DESC newBuffDesc;
 		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
-		newBuffDesc.ByteWidth = bufferDesc.Size;
+		newBuffDesc.ByteWidth = bufferDesc.size;
 		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 		newBuffDesc.CPUAccessFlags = 0;
 		newBuffDesc.MiscFlags = 0;
 		newBuffDesc.StructureByteStride = 0;
-		device->CreateBuffer(&newBuffDesc, 0, &constantBuffers[b].ConstantBuffer);
+		if (device)
+			device->CreateBuffer(&newBuffDesc, 0, &constantBuffers[b].ConstantBuffer);
 
 		// Set up the data buffer for this constant buffer
-		constantBuffers[b].Size = bufferDesc.Size;
-		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
-		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
+		constantBuffers[b].Size = bufferDesc.size;
+		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.size];
+		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.size);
 
 		// Loop through all variables in this buffer
-		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		for (const ReflectedVariable& varDesc : bufferDesc.variables)
 		{
-			// Get this variable
-			ID3D11ShaderReflectionVariable* var =
-				cb->GetVariableByIndex(v);
-			
-			// Get the description of the variable and its type
-			D3D11_SHADER_VARIABLE_DESC varDesc;
-			var->GetDesc(&varDesc);
-
 			// Create the variable struct
 			SimpleShaderVariable varStruct;
 			varStruct.ConstantBufferIndex = b;
-			varStruct.ByteOffset = varDesc.StartOffset;
-			varStruct.Size = varDesc.Size;
-			
-			// Get a string version
-			std::string varName(varDesc.Name);
+			varStruct.ByteOffset = varDesc.byteOffset;
+			varStruct.Size = varDesc.size;
 
 			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
+			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varDesc.name, varStruct));
 			constantBuffers[b].Variables.push_back(varStruct);
 		}
 	}
 
 	// All set
-	refl->Release();
-	return true;
+	BuildHashTables();
+}
+
+// --------------------------------------------------------
+// Helper for sorting a table of hashed names
+//  - Names whose hashes collide are all kept, next to each
+//    other, for FindHash to pick between
+// --------------------------------------------------------
+template<typename T>
+static void SortHashTable(std::vector<SimpleHashedEntry<T>>& table)
+{
+	std::sort(table.begin(), table.end(),
+		[](const SimpleHashedEntry<T>& a, const SimpleHashedEntry<T>& b)
+		{
+			return a.Hash != b.Hash ? a.Hash < b.Hash : strcmp(a.Name, b.Name) < 0;
+		});
+}
+
+// --------------------------------------------------------
+// Helper for finding a hashed name in a sorted table, giving
+// back an invalid handle if it isn't there
+//  - Names are compared whenever the hash is shared, and
+//    always in debug builds, so a name the shader doesn't
+//    have can't pass for one with the same hash there
+// --------------------------------------------------------
+template<typename T>
+static T FindHash(const std::vector<SimpleHashedEntry<T>>& table, SimpleShaderName name)
+{
+	auto result = std::lower_bound(table.begin(), table.end(), name.Hash,
+		[](const SimpleHashedEntry<T>& entry, uint32_t h) { return entry.Hash < h; });
+	if (result == table.end() || result->Hash != name.Hash)
+		return T();
+
+#if !defined(DEBUG) && !defined(_DEBUG)
+	// The only name with this hash
+	if (result + 1 == table.end() || result[1].Hash != name.Hash)
+		return result->Handle;
+#endif
+
+	for (; result != table.end() && result->Hash == name.Hash; ++result)
+	{
+		if (strcmp(result->Name, name.Name) == 0)
+			return result->Handle;
+	}
+	return T();
+}
+
+// --------------------------------------------------------
+// Builds the hashed name tables from the string tables, so
+// names hashed at compile time can be found without a
+// std::string
+// --------------------------------------------------------
+void ISimpleShader::BuildHashTables()
+{
+	varHashes.clear();
+	for (auto& var : varTable)
+	{
+		SimpleVariableHandle handle;
+		handle.ConstantBufferIndex = (unsigned short)var.second.ConstantBufferIndex;
+		handle.ByteOffset = (unsigned short)var.second.ByteOffset;
+		handle.Size = var.second.Size;
+		varHashes.push_back({ SimpleShaderHash(var.first.c_str()), var.first.c_str(), handle });
+	}
+	SortHashTable(varHashes);
+
+	textureHashes.clear();
+	for (auto& texture : textureTable)
+	{
+		SimpleResourceHandle handle;
+		handle.BindIndex = texture.second->BindIndex;
+		textureHashes.push_back({ SimpleShaderHash(texture.first.c_str()), texture.first.c_str(), handle });
+	}
+	SortHashTable(textureHashes);
+
+	samplerHashes.clear();
+	for (auto& sampler : samplerTable)
+	{
+		SimpleResourceHandle handle;
+		handle.BindIndex = sampler.second->BindIndex;
+		samplerHashes.push_back({ SimpleShaderHash(sampler.first.c_str()), sampler.first.c_str(), handle });
+	}
+	SortHashTable(samplerHashes);
 }
 
 // --------------------------------------------------------
@@ -279,14 +576,9 @@ void ISimpleShader::CopyAllBufferData()
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
-	// Loop through the constant buffers and copy all data
+	// Loop through the constant buffers and copy any that changed
 	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer, 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
-	}
+		UploadBuffer(&constantBuffers[i]);
 }
 
 // --------------------------------------------------------
@@ -314,9 +606,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer, 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -336,9 +626,83 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer, 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
+}
+
+// --------------------------------------------------------
+// Copies a constant buffer's local data to the GPU, unless
+// nothing has changed since it was last copied
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer* cb)
+{
+	// With an allocator, data from an earlier frame is gone too
+	bool current = !cb->Dirty &&
+		(!constantAllocator || cb->AllocatorGeneration == constantAllocator->GetGeneration());
+	if (current)
+	{
+		uploadStats.skipped++;
+		return;
+	}
+
+	if (constantAllocator)
+	{
+		// Copy into this frame's part of the allocator and bind it there,
+		// falling back to the buffer's own storage if the frame is full
+		cb->AllocatorGeneration = constantAllocator->GetGeneration();
+		if (!constantAllocator->Upload(cb->LocalDataBuffer, cb->Size, cb->FirstConstant, cb->ConstantCount, uploader))
+		{
+			cb->ConstantCount = 0;
+			WriteBuffer(cb);
+		}
+		BindConstantBuffer(cb);
+	}
+	else
+		WriteBuffer(cb);
+	cb->Dirty = false;
+	uploadStats.uploads++;
+	uploadStats.bytesUploaded += cb->Size;
+}
+
+// --------------------------------------------------------
+// Writes a constant buffer's local data into its own GPU
+// buffer, through the uploader if there is one
+// --------------------------------------------------------
+void ISimpleShader::WriteBuffer(SimpleConstantBuffer* cb)
+{
+	if (uploader)
+		uploader->Upload(cb->ConstantBuffer, cb->LocalDataBuffer, cb->Size);
+	else
+		deviceContext->UpdateSubresource(cb->ConstantBuffer, 0, 0, cb->LocalDataBuffer, 0, 0);
+}
+
+// --------------------------------------------------------
+// Binds a constant buffer wherever its data currently is
+// --------------------------------------------------------
+void ISimpleShader::BindConstantBuffer(SimpleConstantBuffer* cb)
+{
+	// Skip "buffers" that aren't true constant buffers
+	if (cb->Type != D3D11_CT_CBUFFER)
+		return;
+
+	if (constantAllocator &&
+		cb->AllocatorGeneration == constantAllocator->GetGeneration() &&
+		cb->ConstantCount > 0)
+	{
+		BindConstantBufferRange(cb->BindIndex, constantAllocator->GetBuffer(), cb->FirstConstant, cb->ConstantCount);
+	}
+	else
+	{
+		BindConstantBufferRange(cb->BindIndex, cb->ConstantBuffer, 0, 0);
+	}
+}
+
+// --------------------------------------------------------
+// Binds all of this shader's constant buffers
+// --------------------------------------------------------
+void ISimpleShader::BindConstantBuffers()
+{
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+		BindConstantBuffer(&constantBuffers[i]);
 }
 
 
@@ -353,24 +717,8 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 // --------------------------------------------------------
 bool ISimpleShader::SetData(std::string name, const void* data, unsigned int size)
 {
-	// Look for the variable and verify
-	SimpleShaderVariable* var = FindVariable(name, -1);
-	if (var == 0)
-		return false;
-
-	// Ensure we're not trying to copy more data than the variable can hold
-	// Note: We can copy less data, in the case of a subset of an array
-	if (size > var->Size)
-		return false;
-
-	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
-
-	// Success
-	return true;
+	// Look up the variable, then copy through its handle
+	return SetData(GetVariableHandle(name), data, size);
 }
 
 // --------------------------------------------------------
@@ -414,43 +762,186 @@ bool ISimpleShader::SetFloat3(std::string name, const float data[3])
 }
 
 // --------------------------------------------------------
-// Sets a FLOAT3 variable by name in the local data buffer
+// Sets a FLOAT3 variable by name in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
+{
+	return this->SetData(name, &data, sizeof(float) * 3);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT4 variable by name in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat4(std::string name, const float data[4])
+{
+	return this->SetData(name, (void*)data, sizeof(float) * 4);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT4 variable by name in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
+{
+	return this->SetData(name, &data, sizeof(float) * 4);
+}
+
+// --------------------------------------------------------
+// Sets a MATRIX (4x4) variable by name in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
+{
+	return this->SetData(name, (void*)data, sizeof(float) * 16);
+}
+
+// --------------------------------------------------------
+// Sets a MATRIX (4x4) variable by name in the local data buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data)
+{
+	return this->SetData(name, &data, sizeof(float) * 16);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view by name
+//
+// Returns true if a texture of the given name was found, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+{
+	return SetShaderResourceView(GetShaderResourceViewHandle(name), srv);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state by name
+//
+// Returns true if a sampler of the given name was found, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+{
+	return SetSamplerState(GetSamplerHandle(name), samplerState);
+}
+
+// --------------------------------------------------------
+// Gets a handle to a shader variable, which is invalid if
+// the variable doesn't exist
+// --------------------------------------------------------
+SimpleVariableHandle ISimpleShader::GetVariableHandle(std::string name)
+{
+	SimpleVariableHandle handle;
+	SimpleShaderVariable* var = FindVariable(name, -1);
+	if (var == 0)
+		return handle;
+
+	handle.ConstantBufferIndex = (unsigned short)var->ConstantBufferIndex;
+	handle.ByteOffset = (unsigned short)var->ByteOffset;
+	handle.Size = var->Size;
+	return handle;
+}
+
+// --------------------------------------------------------
+// Gets a handle to a shader variable by hashed name
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
+SimpleVariableHandle ISimpleShader::GetVariableHandle(SimpleShaderName name)
 {
-	return this->SetData(name, &data, sizeof(float) * 3);
+	return FindHash(varHashes, name);
 }
 
 // --------------------------------------------------------
-// Sets a FLOAT4 variable by name in the local data buffer
+// Gets a handle to an SRV, which is invalid if the SRV
+// doesn't exist
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const float data[4])
+SimpleResourceHandle ISimpleShader::GetShaderResourceViewHandle(std::string name)
 {
-	return this->SetData(name, (void*)data, sizeof(float) * 4);
+	SimpleResourceHandle handle;
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	if (srvInfo != 0)
+		handle.BindIndex = srvInfo->BindIndex;
+	return handle;
 }
 
 // --------------------------------------------------------
-// Sets a FLOAT4 variable by name in the local data buffer
+// Gets a handle to an SRV by hashed name
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
+SimpleResourceHandle ISimpleShader::GetShaderResourceViewHandle(SimpleShaderName name)
 {
-	return this->SetData(name, &data, sizeof(float) * 4);
+	return FindHash(textureHashes, name);
 }
 
 // --------------------------------------------------------
-// Sets a MATRIX (4x4) variable by name in the local data buffer
+// Gets a handle to a sampler, which is invalid if the
+// sampler doesn't exist
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
+SimpleResourceHandle ISimpleShader::GetSamplerHandle(std::string name)
 {
-	return this->SetData(name, (void*)data, sizeof(float) * 16);
+	SimpleResourceHandle handle;
+	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	if (sampInfo != 0)
+		handle.BindIndex = sampInfo->BindIndex;
+	return handle;
 }
 
 // --------------------------------------------------------
-// Sets a MATRIX (4x4) variable by name in the local data buffer
+// Gets a handle to a sampler by hashed name
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data)
+SimpleResourceHandle ISimpleShader::GetSamplerHandle(SimpleShaderName name)
 {
-	return this->SetData(name, &data, sizeof(float) * 16);
+	return FindHash(samplerHashes, name);
+}
+
+// --------------------------------------------------------
+// Times setting one variable over and over by string name
+// (a std::string and map lookup per set), by hashed name
+// (a binary search) and by handle (just the copy)
+//  - The sets land in a scratch copy of the variable's
+//    buffer, which is swapped back out afterwards, so the
+//    shader keeps the values it was given
+//  - Two different values take turns, so every set copies
+//    and none stop at the unchanged check
+//
+// variableName - The variable to set
+// sets - How many times to set it each way
+// --------------------------------------------------------
+SimpleShaderSetBenchmark ISimpleShader::BenchmarkSetters(std::string variableName, unsigned int sets)
+{
+	SimpleShaderSetBenchmark result;
+	SimpleVariableHandle handle = GetVariableHandle(variableName);
+	if (!handle.IsValid())
+		return result;
+	result.sets = sets;
+
+	SimpleConstantBuffer& cb = constantBuffers[handle.ConstantBufferIndex];
+	std::vector<unsigned char> scratch(cb.LocalDataBuffer, cb.LocalDataBuffer + cb.Size);
+	unsigned char* live = cb.LocalDataBuffer;
+	bool liveDirty = cb.Dirty;
+	cb.LocalDataBuffer = scratch.data();
+
+	std::vector<unsigned char> values[2] = { std::vector<unsigned char>(handle.Size, 0), std::vector<unsigned char>(handle.Size, 1) };
+	const char* literal = variableName.c_str();
+	SimpleShaderName name(literal);
+	auto seconds = [](std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+	// Like passing a literal to the string setters
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < sets; i++)
+		SetData(literal, values[i & 1].data(), handle.Size);
+	result.stringSeconds = seconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < sets; i++)
+		SetData(name, values[i & 1].data(), handle.Size);
+	result.nameSeconds = seconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < sets; i++)
+		SetData(handle, values[i & 1].data(), handle.Size);
+	result.handleSeconds = seconds(start);
+
+	cb.LocalDataBuffer = live;
+	cb.Dirty = liveDirty;
+	return result;
 }
 
 // --------------------------------------------------------
@@ -577,6 +1068,86 @@ const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(unsigned int index)
 
 
 
+///////////////////////////////////////////////////////////////////////////////
+// ------ SIMPLE CONSTANT ALLOCATOR -------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+// --------------------------------------------------------
+// Creates the shared dynamic constant buffer, if the device
+// supports binding and mapping constant buffers by offset
+//
+// size - Bytes of constant data one frame can use
+// --------------------------------------------------------
+SimpleConstantAllocator::SimpleConstantAllocator(ID3D11Device* device, ID3D11DeviceContext* context, unsigned int size)
+	: allocator(size, FrameAllocator::DefaultAlignment)
+{
+	this->buffer = 0;
+	this->context = 0;
+
+	// Offsets need D3D 11.1 and driver support
+	// - Without a device (like the headless tests) it just stays invalid
+	if (!device)
+		return;
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	HRESULT hr = device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+	if (FAILED(hr) || !options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer)
+		return;
+	if (FAILED(context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&this->context)))
+		return;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = (unsigned int)allocator.GetCapacity();
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	if (FAILED(device->CreateBuffer(&desc, 0, &buffer)))
+		buffer = 0;
+}
+
+// --------------------------------------------------------
+// Releases the buffer and context
+// --------------------------------------------------------
+SimpleConstantAllocator::~SimpleConstantAllocator()
+{
+	if (buffer) buffer->Release();
+	if (context) context->Release();
+}
+
+// --------------------------------------------------------
+// Copies data into the next free slice of this frame
+//
+// data, size - The constant data to copy
+// firstConstant, constantCount - Where it went, in 16 byte constants
+// uploader - Writes the slice instead of mapping here (or null)
+//
+// Returns false if the frame's slices are used up
+// --------------------------------------------------------
+bool SimpleConstantAllocator::Upload(const void* data, unsigned int size, unsigned int& firstConstant, unsigned int& constantCount, ISimpleBufferUploader* uploader)
+{
+	FrameAllocation allocation;
+	if (!buffer || !allocator.Allocate(size, allocation))
+		return false;
+
+	// The frame's first slice throws the old contents away, the rest
+	// promise not to touch anything the GPU might still be reading
+	if (uploader)
+		uploader->UploadSlice(buffer, (unsigned int)allocation.offset, data, size, allocation.firstInFrame);
+	else
+	{
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		D3D11_MAP mapType = allocation.firstInFrame ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+		if (FAILED(context->Map(buffer, 0, mapType, 0, &mapped)))
+			return false;
+		memcpy((unsigned char*)mapped.pData + allocation.offset, data, size);
+		context->Unmap(buffer, 0);
+	}
+
+	firstConstant = (unsigned int)(allocation.offset / 16);
+	constantCount = (unsigned int)(allocation.size / 16);
+	return true;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // ------ SIMPLE VERTEX SHADER ------------------------------------------------
 ///////////////////////////////////////////////////////////////////////////////
@@ -665,32 +1236,17 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 		return true;
 
 	// Vertex shader was created successfully, so we now use the
-	// shader code to re-reflect and create an input layout that 
+	// reflected input signature to create an input layout that 
 	// matches what the vertex shader expects.  Code adapted from:
 	// https://takinginitiative.wordpress.com/2011/12/11/directx-1011-basic-shader-reflection-automatic-input-layout-creation/
 
-	// Reflect shader info
-	ID3D11ShaderReflection* refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)&refl);
-	
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Read input layout description from shader info
 	std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc;
-	for (unsigned int i = 0; i< shaderDesc.InputParameters; i++)
+	for (const ReflectedInputParameter& paramDesc : reflection.inputParameters)
 	{
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetInputParameterDesc(i, &paramDesc);
-
 		// Check the semantic name for "_PER_INSTANCE"
 		std::string perInstanceStr = "_PER_INSTANCE";
-		std::string sem = paramDesc.SemanticName;
+		const std::string& sem = paramDesc.semanticName;
 		int lenDiff = (int)sem.size() - (int)perInstanceStr.size();
 		bool isPerInstance = 
 			lenDiff >= 0 &&
@@ -698,8 +1254,8 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 
 		// Fill out input element desc
 		D3D11_INPUT_ELEMENT_DESC elementDesc;
-		elementDesc.SemanticName = paramDesc.SemanticName;
-		elementDesc.SemanticIndex = paramDesc.SemanticIndex;
+		elementDesc.SemanticName = paramDesc.semanticName.c_str();
+		elementDesc.SemanticIndex = paramDesc.semanticIndex;
 		elementDesc.InputSlot = 0;
 		elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
 		elementDesc.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
@@ -715,30 +1271,53 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 			perInstanceCompatible = true;
 		}
 
+		// Check the semantic name for a packed format suffix
+		// - The shader sees floats either way, so the suffix is the
+		//   only way to know the vertex data is smaller than that
+		// - 16-bit formats only come in 1, 2 and 4 components, so 3
+		//   component inputs read 4 (the vertex data must be padded)
+		DXGI_FORMAT packedFormats[3][4] = {
+			{ DXGI_FORMAT_R16_UNORM, DXGI_FORMAT_R16G16_UNORM, DXGI_FORMAT_R16G16B16A16_UNORM, DXGI_FORMAT_R16G16B16A16_UNORM },
+			{ DXGI_FORMAT_R16_SNORM, DXGI_FORMAT_R16G16_SNORM, DXGI_FORMAT_R16G16B16A16_SNORM, DXGI_FORMAT_R16G16B16A16_SNORM },
+			{ DXGI_FORMAT_R16_FLOAT, DXGI_FORMAT_R16G16_FLOAT, DXGI_FORMAT_R16G16B16A16_FLOAT, DXGI_FORMAT_R16G16B16A16_FLOAT } };
+		std::string packedSuffixes[3] = { "_UNORM16", "_SNORM16", "_HALF" };
+		int packedType = -1;
+		for (int s = 0; s < 3; s++)
+		{
+			int suffixDiff = (int)sem.size() - (int)packedSuffixes[s].size();
+			if (suffixDiff >= 0 && sem.compare(suffixDiff, packedSuffixes[s].size(), packedSuffixes[s]) == 0)
+				packedType = s;
+		}
+
 		// Determine DXGI format
-		if (paramDesc.Mask == 1)
+		if (packedType >= 0 && paramDesc.componentType == D3D_REGISTER_COMPONENT_FLOAT32)
+		{
+			int components = paramDesc.mask == 1 ? 1 : paramDesc.mask <= 3 ? 2 : paramDesc.mask <= 7 ? 3 : 4;
+			elementDesc.Format = packedFormats[packedType][components - 1];
+		}
+		else if (paramDesc.mask == 1)
 		{
-			if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_UINT32) elementDesc.Format = DXGI_FORMAT_R32_UINT;
-			else if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_SINT32) elementDesc.Format = DXGI_FORMAT_R32_SINT;
-			else if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32) elementDesc.Format = DXGI_FORMAT_R32_FLOAT;
+			if (paramDesc.componentType == D3D_REGISTER_COMPONENT_UINT32) elementDesc.Format = DXGI_FORMAT_R32_UINT;
+			else if (paramDesc.componentType == D3D_REGISTER_COMPONENT_SINT32) elementDesc.Format = DXGI_FORMAT_R32_SINT;
+			else if (paramDesc.componentType == D3D_REGISTER_COMPONENT_FLOAT32) elementDesc.Format = DXGI_FORMAT_R32_FLOAT;
 		}
-		else if (paramDesc.Mask <= 3)
+		else if (paramDesc.mask <= 3)
 		{
-			if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_UINT32) elementDesc.Format = DXGI_FORMAT_R32G32_UINT;
-			else if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_SINT32) elementDesc.Format = DXGI_FORMAT_R32G32_SINT;
-			else if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32) elementDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
+			if (paramDesc.componentType == D3D_REGISTER_COMPONENT_UINT32) elementDesc.Format = DXGI_FORMAT_R32G32_UINT;
+			else if (paramDesc.componentType == D3D_REGISTER_COMPONENT_SINT32) elementDesc.Format = DXGI_FORMAT_R32G32_SINT;
+			else if (paramDesc.componentType == D3D_REGISTER_COMPONENT_FLOAT32) elementDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
 		}
-		else if (paramDesc.Mask <= 7)
+		else if (paramDesc.mask <= 7)
 		{
-			if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_UINT32) elementDesc.Format = DXGI_FORMAT_R32G32B32_UINT;
-			else if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_SINT32) elementDesc.Format = DXGI_FORMAT_R32G32B32_SINT;
-			else if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32) elementDesc.Format = DXGI_FORMAT_R32G32B32_FLOAT;
+			if (paramDesc.componentType == D3D_REGISTER_COMPONENT_UINT32) elementDesc.Format = DXGI_FORMAT_R32G32B32_UINT;
+			else if (paramDesc.componentType == D3D_REGISTER_COMPONENT_SINT32) elementDesc.Format = DXGI_FORMAT_R32G32B32_SINT;
+			else if (paramDesc.componentType == D3D_REGISTER_COMPONENT_FLOAT32) elementDesc.Format = DXGI_FORMAT_R32G32B32_FLOAT;
 		}
-		else if (paramDesc.Mask <= 15)
+		else if (paramDesc.mask <= 15)
 		{
-			if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_UINT32) elementDesc.Format = DXGI_FORMAT_R32G32B32A32_UINT;
-			else if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_SINT32) elementDesc.Format = DXGI_FORMAT_R32G32B32A32_SINT;
-			else if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32) elementDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+			if (paramDesc.componentType == D3D_REGISTER_COMPONENT_UINT32) elementDesc.Format = DXGI_FORMAT_R32G32B32A32_UINT;
+			else if (paramDesc.componentType == D3D_REGISTER_COMPONENT_SINT32) elementDesc.Format = DXGI_FORMAT_R32G32B32A32_SINT;
+			else if (paramDesc.componentType == D3D_REGISTER_COMPONENT_FLOAT32) elementDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
 		}
 
 		// Save element desc
@@ -753,8 +1332,7 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 		shaderBlob->GetBufferSize(),
 		&inputLayout);
 
-	// All done, clean up
-	refl->Release();
+	// All done
 	return true;
 }
 
@@ -768,66 +1346,55 @@ void SimpleVertexShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader and input layout
-	deviceContext->IASetInputLayout(inputLayout);
-	deviceContext->VSSetShader(shader, 0, 0);
+	if (stateCache->ChangeInputLayout(inputLayout))
+		deviceContext->IASetInputLayout(inputLayout);
+	if (stateCache->ChangeShader(STATE_STAGE_VERTEX, shader))
+		deviceContext->VSSetShader(shader, 0, 0);
 
 	// Set the constant buffers
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
-
-		// This is a real constant buffer, so set it
-		deviceContext->VSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			&constantBuffers[i].ConstantBuffer);
-	}
+	BindConstantBuffers();
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the vertex shader stage
+// Binds a shader resource view in the vertex shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimpleVertexShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	if (stateCache->ChangeShaderResourceView(STATE_STAGE_VERTEX, bindIndex, srv))
+		deviceContext->VSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the vertex shader stage
+// Binds a sampler state in the vertex shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleVertexShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	if (stateCache->ChangeSampler(STATE_STAGE_VERTEX, bindIndex, samplerState))
+		deviceContext->VSSetSamplers(bindIndex, 1, &samplerState);
+}
 
-	// Success
-	return true;
+// --------------------------------------------------------
+// Binds a constant buffer, or part of one, in the vertex shader stage
+//
+// bindIndex - The register of the constant buffer in the shader
+// buffer - The constant buffer in GPU memory
+// firstConstant, constantCount - The part to bind, in 16 byte
+//   constants (a count of 0 binds the whole buffer)
+// --------------------------------------------------------
+void SimpleVertexShader::BindConstantBufferRange(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	if (!stateCache->ChangeConstantBuffer(STATE_STAGE_VERTEX, bindIndex, buffer, firstConstant, constantCount))
+		return;
+	if (constantCount == 0)
+		deviceContext->VSSetConstantBuffers(bindIndex, 1, &buffer);
+	else
+		constantAllocator->GetContext()->VSSetConstantBuffers1(bindIndex, 1, &buffer, &firstConstant, &constantCount);
 }
 
 
@@ -898,65 +1465,53 @@ void SimplePixelShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 	
 	// Set the shader
-	deviceContext->PSSetShader(shader, 0, 0);
+	if (stateCache->ChangeShader(STATE_STAGE_PIXEL, shader))
+		deviceContext->PSSetShader(shader, 0, 0);
 
 	// Set the constant buffers
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
-
-		// This is a real constant buffer, so set it
-		deviceContext->PSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			&constantBuffers[i].ConstantBuffer);
-	}
+	BindConstantBuffers();
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the pixel shader stage
+// Binds a shader resource view in the pixel shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimplePixelShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	if (stateCache->ChangeShaderResourceView(STATE_STAGE_PIXEL, bindIndex, srv))
+		deviceContext->PSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the pixel shader stage
+// Binds a sampler state in the pixel shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimplePixelShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	if (stateCache->ChangeSampler(STATE_STAGE_PIXEL, bindIndex, samplerState))
+		deviceContext->PSSetSamplers(bindIndex, 1, &samplerState);
+}
 
-	// Success
-	return true;
+// --------------------------------------------------------
+// Binds a constant buffer, or part of one, in the pixel shader stage
+//
+// bindIndex - The register of the constant buffer in the shader
+// buffer - The constant buffer in GPU memory
+// firstConstant, constantCount - The part to bind, in 16 byte
+//   constants (a count of 0 binds the whole buffer)
+// --------------------------------------------------------
+void SimplePixelShader::BindConstantBufferRange(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	if (!stateCache->ChangeConstantBuffer(STATE_STAGE_PIXEL, bindIndex, buffer, firstConstant, constantCount))
+		return;
+	if (constantCount == 0)
+		deviceContext->PSSetConstantBuffers(bindIndex, 1, &buffer);
+	else
+		constantAllocator->GetContext()->PSSetConstantBuffers1(bindIndex, 1, &buffer, &firstConstant, &constantCount);
 }
 
 
@@ -1029,65 +1584,53 @@ void SimpleDomainShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->DSSetShader(shader, 0, 0);
+	if (stateCache->ChangeShader(STATE_STAGE_DOMAIN, shader))
+		deviceContext->DSSetShader(shader, 0, 0);
 
 	// Set the constant buffers
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
-
-		// This is a real constant buffer, so set it
-		deviceContext->DSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			&constantBuffers[i].ConstantBuffer);
-	}
+	BindConstantBuffers();
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the domain shader stage
+// Binds a shader resource view in the domain shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimpleDomainShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->DSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	if (stateCache->ChangeShaderResourceView(STATE_STAGE_DOMAIN, bindIndex, srv))
+		deviceContext->DSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the domain shader stage
+// Binds a sampler state in the domain shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleDomainShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->DSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	if (stateCache->ChangeSampler(STATE_STAGE_DOMAIN, bindIndex, samplerState))
+		deviceContext->DSSetSamplers(bindIndex, 1, &samplerState);
+}
 
-	// Success
-	return true;
+// --------------------------------------------------------
+// Binds a constant buffer, or part of one, in the domain shader stage
+//
+// bindIndex - The register of the constant buffer in the shader
+// buffer - The constant buffer in GPU memory
+// firstConstant, constantCount - The part to bind, in 16 byte
+//   constants (a count of 0 binds the whole buffer)
+// --------------------------------------------------------
+void SimpleDomainShader::BindConstantBufferRange(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	if (!stateCache->ChangeConstantBuffer(STATE_STAGE_DOMAIN, bindIndex, buffer, firstConstant, constantCount))
+		return;
+	if (constantCount == 0)
+		deviceContext->DSSetConstantBuffers(bindIndex, 1, &buffer);
+	else
+		constantAllocator->GetContext()->DSSetConstantBuffers1(bindIndex, 1, &buffer, &firstConstant, &constantCount);
 }
 
 
@@ -1159,65 +1702,53 @@ void SimpleHullShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->HSSetShader(shader, 0, 0);
+	if (stateCache->ChangeShader(STATE_STAGE_HULL, shader))
+		deviceContext->HSSetShader(shader, 0, 0);
 
-	// Set the constant buffers?
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
-
-		// This is a real constant buffer, so set it
-		deviceContext->HSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			&constantBuffers[i].ConstantBuffer);
-	}
+	// Set the constant buffers
+	BindConstantBuffers();
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the hull shader stage
+// Binds a shader resource view in the hull shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimpleHullShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->HSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	if (stateCache->ChangeShaderResourceView(STATE_STAGE_HULL, bindIndex, srv))
+		deviceContext->HSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the hull shader stage
+// Binds a sampler state in the hull shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleHullShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->HSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	if (stateCache->ChangeSampler(STATE_STAGE_HULL, bindIndex, samplerState))
+		deviceContext->HSSetSamplers(bindIndex, 1, &samplerState);
+}
 
-	// Success
-	return true;
+// --------------------------------------------------------
+// Binds a constant buffer, or part of one, in the hull shader stage
+//
+// bindIndex - The register of the constant buffer in the shader
+// buffer - The constant buffer in GPU memory
+// firstConstant, constantCount - The part to bind, in 16 byte
+//   constants (a count of 0 binds the whole buffer)
+// --------------------------------------------------------
+void SimpleHullShader::BindConstantBufferRange(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	if (!stateCache->ChangeConstantBuffer(STATE_STAGE_HULL, bindIndex, buffer, firstConstant, constantCount))
+		return;
+	if (constantCount == 0)
+		deviceContext->HSSetConstantBuffers(bindIndex, 1, &buffer);
+	else
+		constantAllocator->GetContext()->HSSetConstantBuffers1(bindIndex, 1, &buffer, &firstConstant, &constantCount);
 }
 
 
@@ -1412,65 +1943,53 @@ void SimpleGeometryShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->GSSetShader(shader, 0, 0);
+	if (stateCache->ChangeShader(STATE_STAGE_GEOMETRY, shader))
+		deviceContext->GSSetShader(shader, 0, 0);
 
-	// Set the constant buffers?
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
-
-		// This is a real constant buffer, so set it
-		deviceContext->GSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			&constantBuffers[i].ConstantBuffer);
-	}
+	// Set the constant buffers
+	BindConstantBuffers();
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the Geometry shader stage
+// Binds a shader resource view in the Geometry shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimpleGeometryShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->GSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	if (stateCache->ChangeShaderResourceView(STATE_STAGE_GEOMETRY, bindIndex, srv))
+		deviceContext->GSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the Geometry shader stage
+// Binds a sampler state in the Geometry shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleGeometryShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->GSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	if (stateCache->ChangeSampler(STATE_STAGE_GEOMETRY, bindIndex, samplerState))
+		deviceContext->GSSetSamplers(bindIndex, 1, &samplerState);
+}
 
-	// Success
-	return true;
+// --------------------------------------------------------
+// Binds a constant buffer, or part of one, in the Geometry shader stage
+//
+// bindIndex - The register of the constant buffer in the shader
+// buffer - The constant buffer in GPU memory
+// firstConstant, constantCount - The part to bind, in 16 byte
+//   constants (a count of 0 binds the whole buffer)
+// --------------------------------------------------------
+void SimpleGeometryShader::BindConstantBufferRange(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	if (!stateCache->ChangeConstantBuffer(STATE_STAGE_GEOMETRY, bindIndex, buffer, firstConstant, constantCount))
+		return;
+	if (constantCount == 0)
+		deviceContext->GSSetConstantBuffers(bindIndex, 1, &buffer);
+	else
+		constantAllocator->GetContext()->GSSetConstantBuffers1(bindIndex, 1, &buffer, &firstConstant, &constantCount);
 }
 
 // --------------------------------------------------------
@@ -1609,21 +2128,11 @@ void SimpleComputeShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->CSSetShader(shader, 0, 0);
+	if (stateCache->ChangeShader(STATE_STAGE_COMPUTE, shader))
+		deviceContext->CSSetShader(shader, 0, 0);
 
-	// Set the constant buffers?
-	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
-			continue;
-
-		// This is a real constant buffer, so set it
-		deviceContext->CSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			&constantBuffers[i].ConstantBuffer);
-	}
+	// Set the constant buffers
+	BindConstantBuffers();
 }
 
 // --------------------------------------------------------
@@ -1680,47 +2189,45 @@ void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int
 }
 
 // --------------------------------------------------------
-// Sets a shader resource view in the Compute shader stage
+// Binds a shader resource view in the Compute shader stage
 //
-// name - The name of the texture resource in the shader
+// bindIndex - The register of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
-//
-// Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+void SimpleComputeShader::BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv)
 {
-	// Look for the variable and verify
-	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
-	if (srvInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->CSSetShaderResources(srvInfo->BindIndex, 1, &srv);
-
-	// Success
-	return true;
+	if (stateCache->ChangeShaderResourceView(STATE_STAGE_COMPUTE, bindIndex, srv))
+		deviceContext->CSSetShaderResources(bindIndex, 1, &srv);
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the Compute shader stage
+// Binds a sampler state in the Compute shader stage
 //
-// name - The name of the sampler state in the shader
+// bindIndex - The register of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
-//
-// Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+void SimpleComputeShader::BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
-		return false;
-
-	// Set the shader resource view
-	deviceContext->CSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	if (stateCache->ChangeSampler(STATE_STAGE_COMPUTE, bindIndex, samplerState))
+		deviceContext->CSSetSamplers(bindIndex, 1, &samplerState);
+}
 
-	// Success
-	return true;
+// --------------------------------------------------------
+// Binds a constant buffer, or part of one, in the Compute shader stage
+//
+// bindIndex - The register of the constant buffer in the shader
+// buffer - The constant buffer in GPU memory
+// firstConstant, constantCount - The part to bind, in 16 byte
+//   constants (a count of 0 binds the whole buffer)
+// --------------------------------------------------------
+void SimpleComputeShader::BindConstantBufferRange(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	if (!stateCache->ChangeConstantBuffer(STATE_STAGE_COMPUTE, bindIndex, buffer, firstConstant, constantCount))
+		return;
+	if (constantCount == 0)
+		deviceContext->CSSetConstantBuffers(bindIndex, 1, &buffer);
+	else
+		constantAllocator->GetContext()->CSSetConstantBuffers1(bindIndex, 1, &buffer, &firstConstant, &constantCount);
 }
 
 // --------------------------------------------------------
@@ -1742,6 +2249,10 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, ID3D11Unorder
 	// Set the shader resource view
 	deviceContext->CSSetUnorderedAccessViews(bindIndex, 1, &uav, &appendConsumeOffset);
 
+	// The runtime unbinds the UAV's resource from any stage reading it,
+	// so the state cache can't trust its shader resource views anymore
+	stateCache->InvalidateShaderResourceViews();
+
 	// Success
 	return true;
 }
@@ -3,12 +3,19 @@
 #pragma comment(lib, "d3dcompiler.lib")
 
 #include <d3d11.h>
+#include <d3d11_1.h>
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <cstring>
+
+#include "FrameAllocator.h"
+#include "StateCache.h"
+#include "ShaderReflectionCache.h"
 
 // --------------------------------------------------------
 // Used by simple shaders to store information about
@@ -21,6 +28,88 @@ struct SimpleShaderVariable
 	unsigned int ConstantBufferIndex;
 };
 
+// --------------------------------------------------------
+// Hashes a name (FNV-1a), at compile time when the name
+// is a literal
+// --------------------------------------------------------
+constexpr uint32_t SimpleShaderHash(const char* name)
+{
+	uint32_t hash = 2166136261u;
+	while (*name)
+	{
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// --------------------------------------------------------
+// A variable, texture or sampler name that was hashed ahead
+// of time, so looking it up doesn't build a std::string
+//  - Write literal names as "cameraPos"_ssn
+//  - The name is kept too (it has to outlive the lookup), so
+//    names whose hashes collide can still be told apart
+// --------------------------------------------------------
+struct SimpleShaderName
+{
+	uint32_t Hash;
+	const char* Name;
+	constexpr explicit SimpleShaderName(const char* name) : Hash(SimpleShaderHash(name)), Name(name) {}
+};
+
+constexpr SimpleShaderName operator"" _ssn(const char* name, size_t)
+{
+	return SimpleShaderName(name);
+}
+
+// --------------------------------------------------------
+// One name in a shader's hashed name tables
+//  - Name points at the key in the matching string table
+// --------------------------------------------------------
+template<typename T>
+struct SimpleHashedEntry
+{
+	uint32_t Hash;
+	const char* Name;
+	T Handle;
+};
+
+// --------------------------------------------------------
+// A shader variable looked up ahead of time, so setting
+// it is just a copy into the local data buffer
+//  - Only valid for the shader it came from
+// --------------------------------------------------------
+struct SimpleVariableHandle
+{
+	unsigned short ConstantBufferIndex = 0;
+	unsigned short ByteOffset = 0;
+	unsigned int Size = 0; // 0 if the variable wasn't found
+	bool IsValid() const { return Size != 0; }
+};
+
+// --------------------------------------------------------
+// A texture or sampler looked up ahead of time
+//  - Only valid for the shader it came from
+// --------------------------------------------------------
+struct SimpleResourceHandle
+{
+	unsigned int BindIndex = (unsigned int)-1;
+	bool IsValid() const { return BindIndex != (unsigned int)-1; }
+};
+
+// --------------------------------------------------------
+// Time taken to set one variable many times by string name,
+// hashed name and handle (see ISimpleShader::BenchmarkSetters)
+// --------------------------------------------------------
+struct SimpleShaderSetBenchmark
+{
+	unsigned int sets = 0;
+	double stringSeconds = 0;
+	double nameSeconds = 0;
+	double handleSeconds = 0;
+	double Speedup() const { return handleSeconds > 0 ? stringSeconds / handleSeconds : 0; }
+};
+
 // --------------------------------------------------------
 // Contains information about a specific
 // constant buffer in a shader, as well as
@@ -35,6 +124,99 @@ struct SimpleConstantBuffer
 	ID3D11Buffer* ConstantBuffer = 0;
 	unsigned char* LocalDataBuffer = 0;
 	std::vector<SimpleShaderVariable> Variables;
+	bool Dirty = true; // Local data differs from what was last uploaded
+
+	// Where the data went when it was last uploaded to a SimpleConstantAllocator
+	// - A ConstantCount of 0 means it's in ConstantBuffer instead
+	uint32_t AllocatorGeneration = 0;
+	unsigned int FirstConstant = 0;
+	unsigned int ConstantCount = 0;
+};
+
+// --------------------------------------------------------
+// Counts of constant buffer copies that were uploaded or
+// skipped because nothing had changed, over all shaders
+// --------------------------------------------------------
+struct SimpleUploadStats
+{
+	size_t uploads = 0;
+	size_t skipped = 0;
+	size_t bytesUploaded = 0;
+};
+
+// --------------------------------------------------------
+// Where shaders got their reflection tables from, over all
+// shaders (see ISimpleShader::LoadReflection)
+// --------------------------------------------------------
+struct SimpleReflectionStats
+{
+	size_t cacheLoads = 0;	// Read from a sidecar file
+	size_t reflections = 0;	// Reflected, as there was no good sidecar
+	size_t cacheWrites = 0;	// New sidecars saved
+	double seconds = 0;		// Spent getting the tables, sidecar or not
+};
+
+// --------------------------------------------------------
+// Where constant buffer data goes when it's copied
+//  - Shaders write through their device context unless
+//    given one of these, so uploads can be redirected (or
+//    recorded by a mock, to check which buffers go up)
+//  - Whole buffers go to Upload, and slices of a constant
+//    allocator's buffer go to UploadSlice
+// --------------------------------------------------------
+class ISimpleBufferUploader
+{
+public:
+	virtual ~ISimpleBufferUploader() {}
+	virtual void Upload(ID3D11Buffer* buffer, const void* data, unsigned int size) = 0;
+	// A discard throws the rest of the buffer away, otherwise nothing
+	// outside the slice may be touched, as the GPU may still be reading it
+	virtual void UploadSlice(ID3D11Buffer* buffer, unsigned int offset, const void* data, unsigned int size, bool discard) = 0;
+};
+
+// --------------------------------------------------------
+// One big dynamic constant buffer that shaders copy their
+// data into whenever it changes, instead of updating their
+// own small buffers
+//  - Each copy gets its own 256 byte aligned slice, bound by
+//    offset (needs D3D 11.1), so the driver never has to
+//    make a new version of a buffer that's still in use
+//  - The buffer is discarded once a frame (BeginFrame), then
+//    filled front to back with no-overwrite maps
+//  - Copies that don't fit go to the shader's own buffer
+// --------------------------------------------------------
+class SimpleConstantAllocator
+{
+public:
+	static const unsigned int DefaultSize = 1024 * 1024;
+
+	SimpleConstantAllocator(ID3D11Device* device, ID3D11DeviceContext* context, unsigned int size = DefaultSize);
+	~SimpleConstantAllocator();
+	SimpleConstantAllocator(const SimpleConstantAllocator&) = delete;
+	SimpleConstantAllocator& operator=(const SimpleConstantAllocator&) = delete;
+
+	// False if the device can't bind constant buffers by offset or
+	// map them without overwriting, in which case nothing should use it
+	bool IsValid() { return buffer != 0; }
+
+	// Call before the frame's first copy
+	void BeginFrame() { allocator.BeginFrame(); }
+
+	// Copies data into this frame's part of the buffer, giving back where it
+	// went in 16 byte constants (or false if the frame is full)
+	// - Goes through the uploader if there is one, otherwise this maps the
+	//   buffer itself
+	bool Upload(const void* data, unsigned int size, unsigned int& firstConstant, unsigned int& constantCount, ISimpleBufferUploader* uploader = 0);
+
+	ID3D11Buffer* GetBuffer() { return buffer; }
+	ID3D11DeviceContext1* GetContext() { return context; }
+	uint32_t GetGeneration() const { return allocator.GetGeneration(); }
+	const FrameAllocator& GetAllocator() const { return allocator; }
+
+private:
+	FrameAllocator allocator;
+	ID3D11Buffer* buffer;
+	ID3D11DeviceContext1* context;
 };
 
 // --------------------------------------------------------
@@ -55,6 +237,9 @@ struct SimpleSampler
 	unsigned int BindIndex; // The register of the Sampler
 };
 
+// Holds the StateCache a device context's shaders share
+class SimpleStateCacheData;
+
 // --------------------------------------------------------
 // Base abstract class for simplifying shader handling
 // --------------------------------------------------------
@@ -68,6 +253,7 @@ public:
 	bool IsShaderValid() { return shaderValid; }
 
 	// Activating the shader and copying data
+	// - Copies skip buffers whose data hasn't changed since their last upload
 	void SetShader();
 	void CopyAllBufferData();
 	void CopyBufferData(unsigned int index);
@@ -75,6 +261,23 @@ public:
 
 	// Sets arbitrary shader data
 	bool SetData(std::string name, const void* data, unsigned int size);
+	bool SetData(SimpleShaderName name, const void* data, unsigned int size) { return SetData(GetVariableHandle(name), data, size); }
+	bool SetData(SimpleVariableHandle variable, const void* data, unsigned int size)
+	{
+		// Can copy less than the variable holds, in the case of a subset of an array
+		if (!variable.IsValid() || size > variable.Size)
+			return false;
+
+		// Only mark the buffer for upload if the bytes actually change
+		SimpleConstantBuffer& cb = constantBuffers[variable.ConstantBufferIndex];
+		unsigned char* destination = cb.LocalDataBuffer + variable.ByteOffset;
+		if (memcmp(destination, data, size) != 0)
+		{
+			memcpy(destination, data, size);
+			cb.Dirty = true;
+		}
+		return true;
+	}
 
 	bool SetInt(std::string name, int data);
 	bool SetFloat(std::string name, float data);
@@ -87,9 +290,56 @@ public:
 	bool SetMatrix4x4(std::string name, const float data[16]);
 	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
 
+	// Same setters by hashed name, which skip building a std::string
+	bool SetInt(SimpleShaderName name, int data) { return SetData(name, &data, sizeof(int)); }
+	bool SetFloat(SimpleShaderName name, float data) { return SetData(name, &data, sizeof(float)); }
+	bool SetFloat2(SimpleShaderName name, const DirectX::XMFLOAT2& data) { return SetData(name, &data, sizeof(float) * 2); }
+	bool SetFloat3(SimpleShaderName name, const DirectX::XMFLOAT3& data) { return SetData(name, &data, sizeof(float) * 3); }
+	bool SetFloat4(SimpleShaderName name, const DirectX::XMFLOAT4& data) { return SetData(name, &data, sizeof(float) * 4); }
+	bool SetMatrix4x4(SimpleShaderName name, const DirectX::XMFLOAT4X4& data) { return SetData(name, &data, sizeof(float) * 16); }
+
+	// Same setters by handle, which skip the lookup entirely
+	bool SetInt(SimpleVariableHandle variable, int data) { return SetData(variable, &data, sizeof(int)); }
+	bool SetFloat(SimpleVariableHandle variable, float data) { return SetData(variable, &data, sizeof(float)); }
+	bool SetFloat2(SimpleVariableHandle variable, const DirectX::XMFLOAT2& data) { return SetData(variable, &data, sizeof(float) * 2); }
+	bool SetFloat3(SimpleVariableHandle variable, const DirectX::XMFLOAT3& data) { return SetData(variable, &data, sizeof(float) * 3); }
+	bool SetFloat4(SimpleVariableHandle variable, const DirectX::XMFLOAT4& data) { return SetData(variable, &data, sizeof(float) * 4); }
+	bool SetMatrix4x4(SimpleVariableHandle variable, const DirectX::XMFLOAT4X4& data) { return SetData(variable, &data, sizeof(float) * 16); }
+
 	// Setting shader resources
-	virtual bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv) = 0;
-	virtual bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState) = 0;
+	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
+	bool SetShaderResourceView(SimpleShaderName name, ID3D11ShaderResourceView* srv) { return SetShaderResourceView(GetShaderResourceViewHandle(name), srv); }
+	bool SetShaderResourceView(SimpleResourceHandle handle, ID3D11ShaderResourceView* srv)
+	{
+		if (!handle.IsValid())
+			return false;
+		BindShaderResourceView(handle.BindIndex, srv);
+		return true;
+	}
+	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetSamplerState(SimpleShaderName name, ID3D11SamplerState* samplerState) { return SetSamplerState(GetSamplerHandle(name), samplerState); }
+	bool SetSamplerState(SimpleResourceHandle handle, ID3D11SamplerState* samplerState)
+	{
+		if (!handle.IsValid())
+			return false;
+		BindSamplerState(handle.BindIndex, samplerState);
+		return true;
+	}
+
+	// Looking up handles once, for setting the same things every frame
+	// - Handles for names the shader doesn't have are invalid, and
+	//   setting through them does nothing
+	SimpleVariableHandle GetVariableHandle(std::string name);
+	SimpleVariableHandle GetVariableHandle(SimpleShaderName name);
+	SimpleResourceHandle GetShaderResourceViewHandle(std::string name);
+	SimpleResourceHandle GetShaderResourceViewHandle(SimpleShaderName name);
+	SimpleResourceHandle GetSamplerHandle(std::string name);
+	SimpleResourceHandle GetSamplerHandle(SimpleShaderName name);
+
+	// Times setting a variable by string, hashed name and handle
+	// - Runs on a scratch copy of the variable's buffer, so the values
+	//   the shader was given are left alone
+	SimpleShaderSetBenchmark BenchmarkSetters(std::string variableName, unsigned int sets);
 
 	// Getting data about variables and resources
 	const SimpleShaderVariable* GetVariableInfo(std::string name);
@@ -111,12 +361,46 @@ public:
 	// Misc getters
 	ID3DBlob* GetShaderBlob() { return shaderBlob; }
 
+	// Sends this shader's buffer uploads somewhere other than its
+	// device context (null goes back to the context)
+	void SetBufferUploader(ISimpleBufferUploader* uploader) { this->uploader = uploader; }
+
+	// Copies this shader's buffers into a shared allocator (null goes back
+	// to its own buffers)
+	// - Each copy binds where the data went, so CopyAllBufferData (or
+	//   CopyBufferData) must come after SetShader and before drawing
+	void SetConstantAllocator(SimpleConstantAllocator* allocator) { constantAllocator = allocator; }
+
+	// What's bound to this shader's device context, shared by every shader
+	// using that context
+	// - Kept in the context's private data, so it lasts as long as the
+	//   context (or the last shader using it) does
+	// - Binding straight through the context (not through a shader) must be
+	//   followed by invalidating what was bound, or a later bind may be skipped
+	StateCache& GetStateCache() { return *stateCache; }
+
+	// Upload counts over every shader since the last reset
+	static const SimpleUploadStats& GetUploadStats() { return uploadStats; }
+	static void ResetUploadStats() { uploadStats = SimpleUploadStats(); }
+
+	// Reflection sidecar use over every shader loaded so far
+	static const SimpleReflectionStats& GetReflectionStats() { return reflectionStats; }
+
 protected:
 	
 	bool shaderValid;
 	ID3DBlob* shaderBlob;
 	ID3D11Device* device;
 	ID3D11DeviceContext* deviceContext;
+	ISimpleBufferUploader* uploader;
+	SimpleConstantAllocator* constantAllocator;
+	SimpleStateCacheData* stateCacheData;
+	StateCache* stateCache;
+	static SimpleUploadStats uploadStats;
+	static SimpleReflectionStats reflectionStats;
+
+	// Constant buffers, resources and input signature of the shader
+	ShaderReflectionCache reflection;
 
 	// Resource counts
 	unsigned int constantBufferCount;
@@ -130,18 +414,36 @@ protected:
 	std::unordered_map<std::string, SimpleSRV*> textureTable;
 	std::unordered_map<std::string, SimpleSampler*> samplerTable;
 
-	// Initialization method
+	// Hashed names sorted by hash, for lookups that don't need a std::string
+	// - Names whose hashes collide sit next to each other, and lookups
+	//   compare the names to pick between them
+	std::vector<SimpleHashedEntry<SimpleVariableHandle>> varHashes;
+	std::vector<SimpleHashedEntry<SimpleResourceHandle>> textureHashes;
+	std::vector<SimpleHashedEntry<SimpleResourceHandle>> samplerHashes;
+
+	// Initialization methods
 	bool LoadShaderFile(LPCWSTR shaderFile);
+	bool LoadReflection(LPCWSTR shaderFile);
 
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(ID3DBlob* shaderBlob) = 0;
 	virtual void SetShaderAndCBs() = 0;
+	virtual void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv) = 0;
+	virtual void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState) = 0;
+	// A constantCount of 0 binds the whole buffer
+	virtual void BindConstantBufferRange(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount) = 0;
 
 	virtual void CleanUp();
 
 	// Helpers for finding data by name
 	SimpleShaderVariable* FindVariable(std::string name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+	void BuildTables();
+	void BuildHashTables();
+	void UploadBuffer(SimpleConstantBuffer* cb);
+	void WriteBuffer(SimpleConstantBuffer* cb);
+	void BindConstantBuffer(SimpleConstantBuffer* cb);
+	void BindConstantBuffers();
 };
 
 // --------------------------------------------------------
@@ -157,15 +459,15 @@ public:
 	ID3D11InputLayout* GetInputLayout() { return inputLayout; }
 	bool GetPerInstanceCompatible() { return perInstanceCompatible; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
 protected:
 	bool perInstanceCompatible;
 	ID3D11InputLayout* inputLayout;
 	ID3D11VertexShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
+	void BindConstantBufferRange(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount);
 	void CleanUp();
 };
 
@@ -180,13 +482,13 @@ public:
 	~SimplePixelShader();
 	ID3D11PixelShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
 protected:
 	ID3D11PixelShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
+	void BindConstantBufferRange(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount);
 	void CleanUp();
 };
 
@@ -200,13 +502,13 @@ public:
 	~SimpleDomainShader();
 	ID3D11DomainShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
 protected:
 	ID3D11DomainShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
+	void BindConstantBufferRange(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount);
 	void CleanUp();
 };
 
@@ -220,13 +522,13 @@ public:
 	~SimpleHullShader();
 	ID3D11HullShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
 protected:
 	ID3D11HullShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
+	void BindConstantBufferRange(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount);
 	void CleanUp();
 };
 
@@ -240,9 +542,6 @@ public:
 	~SimpleGeometryShader();
 	ID3D11GeometryShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-
 	bool CreateCompatibleStreamOutBuffer(ID3D11Buffer** buffer, int vertexCount);
 
 	static void UnbindStreamOutStage(ID3D11DeviceContext* deviceContext);
@@ -259,6 +558,9 @@ protected:
 	bool CreateShader(ID3DBlob* shaderBlob);
 	bool CreateShaderWithStreamOut(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
+	void BindConstantBufferRange(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount);
 	void CleanUp();
 
 	// Helpers
@@ -279,8 +581,6 @@ public:
 	void DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
 	void DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ);
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
 	bool SetUnorderedAccessView(std::string name, ID3D11UnorderedAccessView* uav, unsigned int appendConsumeOffset = -1);
 
 	int GetUnorderedAccessViewIndex(std::string name);
@@ -296,5 +596,8 @@ protected:
 
 	bool CreateShader(ID3DBlob* shaderBlob);
 	void SetShaderAndCBs();
+	void BindShaderResourceView(unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(unsigned int bindIndex, ID3D11SamplerState* samplerState);
+	void BindConstantBufferRange(unsigned int bindIndex, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int constantCount);
 	void CleanUp();
 };
\ No newline at end of file
@@ -21,6 +21,9 @@ Sky::Sky(std::shared_ptr<Mesh> mesh, Microsoft::WRL::ComPtr<ID3D11SamplerState>
 	// Allows 1.0 dist to be valid
 	stencilDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
 	device->CreateDepthStencilState(&stencilDesc, depthStencilState.GetAddressOf());
+	// Allows 0.0 dist to be valid, for reverse-Z
+	stencilDesc.DepthFunc = D3D11_COMPARISON_GREATER_EQUAL;
+	device->CreateDepthStencilState(&stencilDesc, reverseZDepthStencilState.GetAddressOf());
 	// Next set up rasterizer
 	D3D11_RASTERIZER_DESC rasterizerDesc = {};
 	// Reverse faces
@@ -34,7 +37,7 @@ void Sky::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_
 {
 	// Change states for rendering
 	context->RSSetState(rasterizerOptions.Get());
-	context->OMSetDepthStencilState(depthStencilState.Get(), 0);
+	context->OMSetDepthStencilState(camera->GetReverseZ() ? reverseZDepthStencilState.Get() : depthStencilState.Get(), 0);
 
 	// Prepare the sky specific shaders
 	vertexShader->SetShader();
@@ -42,6 +45,7 @@ void Sky::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_
 	// Set vertex shader data
 	vertexShader->SetMatrix4x4("viewMatrix", camera->GetViewMatrix());
 	vertexShader->SetMatrix4x4("projMatrix", camera->GetProjMatrix());
+	vertexShader->SetFloat("farDepth", camera->GetFarDepth());
 	// Set pixel shader data
 	pixelShader->SetSamplerState("samplerOptions", samplerOptions.Get());
 	pixelShader->SetShaderResourceView("cubeTex", cubeTexSRV.Get());
@@ -50,10 +54,10 @@ void Sky::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_
 	pixelShader->CopyAllBufferData();
 
 	// Set up drawing the mesh
-	UINT stride = sizeof(Vertex);
+	UINT stride = geometry->GetVertexStride();
 	UINT offset = 0;
 	context->IASetVertexBuffers(0, 1, geometry->GetVertexBuffer().GetAddressOf(), &stride, &offset);
-	context->IASetIndexBuffer(geometry->GetIndexBuffer().Get(), DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(geometry->GetIndexBuffer().Get(), geometry->GetIndexFormat(), 0);
 
 	// Draw the mesh
 	context->DrawIndexed(
@@ -17,6 +17,8 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeTexSRV;
 	// For adjusting the depth buffer comparison type
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencilState;
+	// The same for a reverse-Z camera, where the far end is 0
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> reverseZDepthStencilState;
 	// For switching to inside out
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizerOptions;
 
@@ -0,0 +1,95 @@
+#include "StateCache.h"
+#include <cstdint>
+
+// Address nothing can be bound at, for slots whose binding isn't known
+static const void* const Unknown = reinterpret_cast<const void*>(~(uintptr_t)0);
+
+void StateCache::Invalidate()
+{
+	for (int s = 0; s < STATE_STAGE_COUNT; s++)
+	{
+		StageBindings& stage = stages[s];
+		stage.shader = Unknown;
+		for (unsigned int i = 0; i < ConstantBufferSlots; i++)
+			stage.constantBuffers[i] = { Unknown, 0, 0 };
+		for (unsigned int i = 0; i < ShaderResourceSlots; i++)
+			stage.shaderResourceViews[i] = Unknown;
+		for (unsigned int i = 0; i < SamplerSlots; i++)
+			stage.samplers[i] = Unknown;
+	}
+	inputLayout = Unknown;
+}
+
+void StateCache::InvalidateShaderResourceViews(StateStage stage, unsigned int firstSlot, unsigned int count)
+{
+	for (unsigned int i = firstSlot; i < firstSlot + count && i < ShaderResourceSlots; i++)
+		stages[stage].shaderResourceViews[i] = Unknown;
+}
+
+void StateCache::InvalidateShaderResourceViews()
+{
+	for (int s = 0; s < STATE_STAGE_COUNT; s++)
+		InvalidateShaderResourceViews((StateStage)s, 0, ShaderResourceSlots);
+}
+
+bool StateCache::Change(const void*& bound, const void* value)
+{
+	if (bound == value)
+	{
+		stats.filtered++;
+		return false;
+	}
+	bound = value;
+	stats.issued++;
+	return true;
+}
+
+bool StateCache::ChangeShader(StateStage stage, const void* shader)
+{
+	return Change(stages[stage].shader, shader);
+}
+
+bool StateCache::ChangeInputLayout(const void* inputLayout)
+{
+	return Change(this->inputLayout, inputLayout);
+}
+
+bool StateCache::ChangeConstantBuffer(StateStage stage, unsigned int slot, const void* buffer, unsigned int firstConstant, unsigned int constantCount)
+{
+	// Slots past the end aren't tracked, so they always go through
+	if (slot >= ConstantBufferSlots)
+	{
+		stats.issued++;
+		return true;
+	}
+
+	ConstantBufferBinding& bound = stages[stage].constantBuffers[slot];
+	if (bound.buffer == buffer && bound.firstConstant == firstConstant && bound.constantCount == constantCount)
+	{
+		stats.filtered++;
+		return false;
+	}
+	bound = { buffer, firstConstant, constantCount };
+	stats.issued++;
+	return true;
+}
+
+bool StateCache::ChangeShaderResourceView(StateStage stage, unsigned int slot, const void* srv)
+{
+	if (slot >= ShaderResourceSlots)
+	{
+		stats.issued++;
+		return true;
+	}
+	return Change(stages[stage].shaderResourceViews[slot], srv);
+}
+
+bool StateCache::ChangeSampler(StateStage stage, unsigned int slot, const void* sampler)
+{
+	if (slot >= SamplerSlots)
+	{
+		stats.issued++;
+		return true;
+	}
+	return Change(stages[stage].samplers[slot], sampler);
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+
+// Shader stages a StateCache tracks
+enum StateStage
+{
+	STATE_STAGE_VERTEX,
+	STATE_STAGE_PIXEL,
+	STATE_STAGE_DOMAIN,
+	STATE_STAGE_HULL,
+	STATE_STAGE_GEOMETRY,
+	STATE_STAGE_COMPUTE,
+	STATE_STAGE_COUNT
+};
+
+// Binding calls that reached the device context, and ones skipped because
+// the same thing was already bound
+struct StateCacheStats
+{
+	size_t issued = 0;
+	size_t filtered = 0;
+
+	double FilteredShare() const { return issued + filtered > 0 ? (double)filtered / (issued + filtered) : 0; }
+};
+
+// Copy of what's bound to a device context (shaders, input layout, constant
+// buffers, shader resource views and samplers), so binding something that's
+// already bound can be skipped
+// - The Change functions record the new binding and return whether it
+//   differs, in which case the caller makes the real call
+// - Every slot starts unknown, so the first bind always goes through;
+//   anything bound behind the cache's back has to be invalidated
+// - Objects are only compared by address (a context holds a reference to
+//   whatever is bound, so a bound address can't be reused)
+// - Doesn't need DirectX, so it can be built and checked without a GPU
+class StateCache
+{
+public:
+	// Slot counts from D3D11_COMMONSHADER_*_SLOT_COUNT
+	static const unsigned int ConstantBufferSlots = 14;
+	static const unsigned int ShaderResourceSlots = 128;
+	static const unsigned int SamplerSlots = 16;
+
+	StateCache() { Invalidate(); }
+
+	// Forgets everything, so the next bind of anything goes through
+	void Invalidate();
+	// Forgets some shader resource slots (after binding them directly)
+	void InvalidateShaderResourceViews(StateStage stage, unsigned int firstSlot, unsigned int count);
+	// Forgets every stage's shader resource slots (after binding a render
+	// target or UAV, which unbinds its resource from shader inputs)
+	void InvalidateShaderResourceViews();
+
+	bool ChangeShader(StateStage stage, const void* shader);
+	bool ChangeInputLayout(const void* inputLayout);
+	// A constantCount of 0 means the whole buffer
+	bool ChangeConstantBuffer(StateStage stage, unsigned int slot, const void* buffer, unsigned int firstConstant = 0, unsigned int constantCount = 0);
+	bool ChangeShaderResourceView(StateStage stage, unsigned int slot, const void* srv);
+	bool ChangeSampler(StateStage stage, unsigned int slot, const void* sampler);
+
+	const StateCacheStats& GetStats() const { return stats; }
+	void ResetStats() { stats = StateCacheStats(); }
+
+private:
+	struct ConstantBufferBinding
+	{
+		const void* buffer;
+		unsigned int firstConstant;
+		unsigned int constantCount;
+	};
+
+	struct StageBindings
+	{
+		const void* shader;
+		ConstantBufferBinding constantBuffers[ConstantBufferSlots];
+		const void* shaderResourceViews[ShaderResourceSlots];
+		const void* samplers[SamplerSlots];
+	};
+
+	StageBindings stages[STATE_STAGE_COUNT];
+	const void* inputLayout;
+	StateCacheStats stats;
+
+	bool Change(const void*& bound, const void* value);
+};
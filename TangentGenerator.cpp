@@ -0,0 +1,464 @@
+#include "TangentGenerator.h"
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+using namespace DirectX;
+
+// UV area small enough that 1/area would blow up
+const float TangentGenerator::DegenerateEpsilon = 1e-20f;
+
+// Splits triangles across threads to work out each triangle's tangent,
+// then gives every thread a range of vertices to sum up and finalize
+// - Memory grows with the mesh, not the thread count: one tangent per
+//   triangle plus one corner index per usable corner, and a single set of sums
+// - Each vertex adds up its triangles in index order, exactly like the
+//   single threaded path, so the results don't depend on the thread count
+void TangentGenerator::Generate(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices,
+	unsigned int threadCount, TangentStats* stats)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	size_t triangleCount = numIndices / 3;
+	threadCount = ChooseThreadCount(triangleCount, threadCount);
+
+	size_t degenerate = 0;
+	size_t fallback = 0;
+	if (threadCount <= 1)
+	{
+		// Everything on this thread
+		std::vector<Accumulator> sums(numVerts);
+		memset(sums.data(), 0, sizeof(Accumulator) * numVerts);
+		degenerate = AccumulateRange(verts, indices, 0, triangleCount, sums.data());
+		fallback = Finalize(verts, 0, numVerts, sums.data());
+	}
+	else
+	{
+		// Each thread owns a contiguous range of vertices, and is the only
+		// one that ever writes to their sums
+		// - Ranges are whole batches of 4, so Finalize leaves the same
+		//   vertices to its one at a time loop as on a single thread
+		size_t vertexChunk = ((numVerts + threadCount - 1) / threadCount + 3) & ~(size_t)3;
+		std::vector<Accumulator> faces(triangleCount);
+		std::vector<Accumulator> sums(numVerts);
+		std::vector<std::vector<uint32_t>> corners(threadCount * threadCount);
+		std::vector<size_t> degenerateCounts(threadCount, 0);
+		std::vector<size_t> fallbackCounts(threadCount, 0);
+		std::vector<std::thread> workers;
+		for (unsigned int t = 0; t < threadCount; t++)
+		{
+			workers.push_back(std::thread([&, t]()
+			{
+				size_t first = triangleCount * t / threadCount;
+				size_t last = triangleCount * (t + 1) / threadCount;
+				degenerateCounts[t] = FaceRange(verts, indices, first, last, faces.data(),
+					vertexChunk, &corners[t * threadCount]);
+			}));
+		}
+		for (size_t i = 0; i < workers.size(); i++)
+			workers[i].join();
+
+		// Sum up each owned vertex range, going through the triangle
+		// threads in order so every vertex sees its triangles in index
+		// order, then finish those vertices off while they're hot
+		workers.clear();
+		for (unsigned int t = 0; t < threadCount; t++)
+		{
+			workers.push_back(std::thread([&, t]()
+			{
+				size_t first = std::min(numVerts, vertexChunk * t);
+				size_t last = std::min(numVerts, vertexChunk * (t + 1));
+				memset(&sums[first], 0, sizeof(Accumulator) * (last - first));
+				for (unsigned int from = 0; from < threadCount; from++)
+				{
+					const std::vector<uint32_t>& mine = corners[from * threadCount + t];
+					for (size_t c = 0; c < mine.size(); c++)
+					{
+						const Accumulator& face = faces[mine[c] / 3];
+						Accumulator& a = sums[indices[mine[c]]];
+						XMStoreFloat4A(&a.tangent, XMVectorAdd(XMLoadFloat4A(&a.tangent), XMLoadFloat4A(&face.tangent)));
+						XMStoreFloat4A(&a.bitangent, XMVectorAdd(XMLoadFloat4A(&a.bitangent), XMLoadFloat4A(&face.bitangent)));
+					}
+				}
+				fallbackCounts[t] = Finalize(verts, first, last, sums.data());
+			}));
+		}
+		for (size_t i = 0; i < workers.size(); i++)
+			workers[i].join();
+
+		for (unsigned int t = 0; t < threadCount; t++)
+		{
+			degenerate += degenerateCounts[t];
+			fallback += fallbackCounts[t];
+		}
+	}
+
+	if (stats)
+	{
+		stats->degenerateTriangles = degenerate;
+		stats->fallbackVertices = fallback;
+		stats->threads = threadCount;
+		stats->seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+// Does 4 triangles per loop with each lane of a vector holding one triangle,
+// handing each usable one to store(triangle, tangent, bitangent)
+// - The math is the same as the scalar version below, just spread across lanes
+// - Corner positions are loaded as whole vectors and transposed into lanes,
+//   and the results are transposed back so they can be added as whole vectors
+template<typename Store>
+static size_t TriangleTangents(const Vertex* verts, const unsigned int* indices,
+	size_t first, size_t last, float degenerateEpsilon, Store store)
+{
+	const XMVECTOR epsilon = XMVectorReplicate(degenerateEpsilon);
+	const XMVECTOR zero = XMVectorZero();
+	size_t degenerate = 0;
+
+	for (size_t t = first; t < last; t += 4)
+	{
+		// Indices of the (up to) 4 triangles in this batch
+		// - Missing lanes at the end point at vertex 0 three times,
+		//   which has no UV area and so adds nothing
+		unsigned int corners[3][4];
+		size_t lanes = std::min<size_t>(4, last - t);
+		for (size_t l = 0; l < 4; l++)
+		{
+			for (int c = 0; c < 3; c++)
+				corners[c][l] = l < lanes ? indices[(t + l) * 3 + c] : 0;
+		}
+
+		// Gather the 3 corners of all 4 triangles, turning them into
+		// one vector per component (x, y, z, u and v of each corner)
+		XMVECTOR x[3], y[3], z[3], u[3], v[3];
+		for (int c = 0; c < 3; c++)
+		{
+			const Vertex* v0 = &verts[corners[c][0]];
+			const Vertex* v1 = &verts[corners[c][1]];
+			const Vertex* v2 = &verts[corners[c][2]];
+			const Vertex* v3 = &verts[corners[c][3]];
+			XMMATRIX positions = XMMatrixTranspose(XMMATRIX(
+				XMLoadFloat3(&v0->Position), XMLoadFloat3(&v1->Position),
+				XMLoadFloat3(&v2->Position), XMLoadFloat3(&v3->Position)));
+			x[c] = positions.r[0];
+			y[c] = positions.r[1];
+			z[c] = positions.r[2];
+			u[c] = XMVectorSet(v0->UV.x, v1->UV.x, v2->UV.x, v3->UV.x);
+			v[c] = XMVectorSet(v0->UV.y, v1->UV.y, v2->UV.y, v3->UV.y);
+		}
+
+		// Vectors relative to the first corner
+		XMVECTOR ex1 = XMVectorSubtract(x[1], x[0]);
+		XMVECTOR ey1 = XMVectorSubtract(y[1], y[0]);
+		XMVECTOR ez1 = XMVectorSubtract(z[1], z[0]);
+		XMVECTOR ex2 = XMVectorSubtract(x[2], x[0]);
+		XMVECTOR ey2 = XMVectorSubtract(y[2], y[0]);
+		XMVECTOR ez2 = XMVectorSubtract(z[2], z[0]);
+		XMVECTOR s1 = XMVectorSubtract(u[1], u[0]);
+		XMVECTOR t1 = XMVectorSubtract(v[1], v[0]);
+		XMVECTOR s2 = XMVectorSubtract(u[2], u[0]);
+		XMVECTOR t2 = XMVectorSubtract(v[2], v[0]);
+
+		// r = 1 / (s1 * t2 - s2 * t1), or 0 when the UVs have no area
+		XMVECTOR det = XMVectorNegativeMultiplySubtract(s2, t1, XMVectorMultiply(s1, t2));
+		XMVECTOR valid = XMVectorGreater(XMVectorAbs(det), epsilon);
+		XMVECTOR r = XMVectorSelect(zero, XMVectorReciprocal(det), valid);
+
+		// Tangent: (t2 * e1 - t1 * e2) * r
+		// Bitangent: (s1 * e2 - s2 * e1) * r
+		// - Transposed back so each row is one triangle's vector
+		XMMATRIX tangents = XMMatrixTranspose(XMMATRIX(
+			XMVectorMultiply(XMVectorNegativeMultiplySubtract(t1, ex2, XMVectorMultiply(t2, ex1)), r),
+			XMVectorMultiply(XMVectorNegativeMultiplySubtract(t1, ey2, XMVectorMultiply(t2, ey1)), r),
+			XMVectorMultiply(XMVectorNegativeMultiplySubtract(t1, ez2, XMVectorMultiply(t2, ez1)), r),
+			zero));
+		XMMATRIX bitangents = XMMatrixTranspose(XMMATRIX(
+			XMVectorMultiply(XMVectorNegativeMultiplySubtract(s2, ex1, XMVectorMultiply(s1, ex2)), r),
+			XMVectorMultiply(XMVectorNegativeMultiplySubtract(s2, ey1, XMVectorMultiply(s1, ey2)), r),
+			XMVectorMultiply(XMVectorNegativeMultiplySubtract(s2, ez1, XMVectorMultiply(s1, ez2)), r),
+			zero));
+
+		XMFLOAT4A rLanes;
+		XMStoreFloat4A(&rLanes, r);
+		const float* laneR = &rLanes.x;
+
+		// Hand them out one lane at a time, since triangles in the same
+		// batch can share vertices
+		for (size_t l = 0; l < lanes; l++)
+		{
+			if (laneR[l] == 0.0f)
+			{
+				degenerate++;
+				continue;
+			}
+			store(t + l, tangents.r[l], bitangents.r[l]);
+		}
+	}
+
+	return degenerate;
+}
+
+// Scatters each triangle straight out to its corners
+size_t TangentGenerator::AccumulateRange(const Vertex* verts, const unsigned int* indices,
+	size_t first, size_t last, Accumulator* sums)
+{
+	return TriangleTangents(verts, indices, first, last, DegenerateEpsilon,
+		[&](size_t triangle, const XMVECTOR& tangent, const XMVECTOR& bitangent)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			Accumulator& a = sums[indices[triangle * 3 + c]];
+			XMStoreFloat4A(&a.tangent, XMVectorAdd(XMLoadFloat4A(&a.tangent), tangent));
+			XMStoreFloat4A(&a.bitangent, XMVectorAdd(XMLoadFloat4A(&a.bitangent), bitangent));
+		}
+	});
+}
+
+// Keeps each triangle's tangent and notes which thread has to add it to
+// each of its corners (degenerate triangles are left out entirely)
+size_t TangentGenerator::FaceRange(const Vertex* verts, const unsigned int* indices,
+	size_t first, size_t last, Accumulator* faces,
+	size_t vertexChunk, std::vector<uint32_t>* corners)
+{
+	return TriangleTangents(verts, indices, first, last, DegenerateEpsilon,
+		[&](size_t triangle, const XMVECTOR& tangent, const XMVECTOR& bitangent)
+	{
+		XMStoreFloat4A(&faces[triangle].tangent, tangent);
+		XMStoreFloat4A(&faces[triangle].bitangent, bitangent);
+		for (int c = 0; c < 3; c++)
+		{
+			size_t corner = triangle * 3 + c;
+			corners[indices[corner] / vertexChunk].push_back((uint32_t)corner);
+		}
+	});
+}
+
+// Orthogonalizes summed tangents against their normals, 4 vertices at a time
+// - Vertices are transposed so each lane is one vertex, which turns the
+//   dot and cross products into plain multiplies and adds
+size_t TangentGenerator::Finalize(Vertex* verts, size_t first, size_t last, const Accumulator* sums)
+{
+	const XMVECTOR epsilon = XMVectorReplicate(1e-20f);
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorReplicate(1.0f);
+	const XMVECTOR minusOne = XMVectorReplicate(-1.0f);
+	size_t fallback = 0;
+
+	size_t i = first;
+	for (; i + 4 <= last; i += 4)
+	{
+		Vertex* v = &verts[i];
+		const Accumulator* a = &sums[i];
+
+		// One vector per component, one lane per vertex
+		XMMATRIX n = XMMatrixTranspose(XMMATRIX(
+			XMLoadFloat3(&v[0].Normal), XMLoadFloat3(&v[1].Normal),
+			XMLoadFloat3(&v[2].Normal), XMLoadFloat3(&v[3].Normal)));
+		XMMATRIX t = XMMatrixTranspose(XMMATRIX(
+			XMLoadFloat4A(&a[0].tangent), XMLoadFloat4A(&a[1].tangent),
+			XMLoadFloat4A(&a[2].tangent), XMLoadFloat4A(&a[3].tangent)));
+		XMMATRIX b = XMMatrixTranspose(XMMATRIX(
+			XMLoadFloat4A(&a[0].bitangent), XMLoadFloat4A(&a[1].bitangent),
+			XMLoadFloat4A(&a[2].bitangent), XMLoadFloat4A(&a[3].bitangent)));
+
+		// Use Gram-Schmidt orthogonalize: t - n * dot(n, t)
+		XMVECTOR nDotT = XMVectorMultiplyAdd(n.r[2], t.r[2], XMVectorMultiplyAdd(n.r[1], t.r[1], XMVectorMultiply(n.r[0], t.r[0])));
+		XMVECTOR tx = XMVectorNegativeMultiplySubtract(n.r[0], nDotT, t.r[0]);
+		XMVECTOR ty = XMVectorNegativeMultiplySubtract(n.r[1], nDotT, t.r[1]);
+		XMVECTOR tz = XMVectorNegativeMultiplySubtract(n.r[2], nDotT, t.r[2]);
+
+		// Normalize (lanes with nothing left are redone below)
+		XMVECTOR lengthSq = XMVectorMultiplyAdd(tz, tz, XMVectorMultiplyAdd(ty, ty, XMVectorMultiply(tx, tx)));
+		XMVECTOR usable = XMVectorGreater(lengthSq, epsilon);
+		XMVECTOR invLength = XMVectorSelect(zero, XMVectorReciprocalSqrt(lengthSq), usable);
+		tx = XMVectorMultiply(tx, invLength);
+		ty = XMVectorMultiply(ty, invLength);
+		tz = XMVectorMultiply(tz, invLength);
+
+		// Handedness: sign of dot(cross(n, t), b)
+		XMVECTOR cx = XMVectorNegativeMultiplySubtract(n.r[2], ty, XMVectorMultiply(n.r[1], tz));
+		XMVECTOR cy = XMVectorNegativeMultiplySubtract(n.r[0], tz, XMVectorMultiply(n.r[2], tx));
+		XMVECTOR cz = XMVectorNegativeMultiplySubtract(n.r[1], tx, XMVectorMultiply(n.r[0], ty));
+		XMVECTOR side = XMVectorMultiplyAdd(cz, b.r[2], XMVectorMultiplyAdd(cy, b.r[1], XMVectorMultiply(cx, b.r[0])));
+		XMVECTOR w = XMVectorSelect(one, minusOne, XMVectorLess(side, zero));
+
+		// Back to one vector per vertex
+		XMMATRIX result = XMMatrixTranspose(XMMATRIX(tx, ty, tz, w));
+		XMFLOAT4A usableLanes;
+		XMStoreFloat4A(&usableLanes, usable);
+		for (int l = 0; l < 4; l++)
+		{
+			if ((&usableLanes.x)[l] != 0.0f)
+				XMStoreFloat4(&v[l].Tangent, result.r[l]);
+			else if (!FinalizeVertex(v[l], a[l]))
+				fallback++;
+		}
+	}
+
+	// Leftovers one at a time
+	for (; i < last; i++)
+	{
+		if (!FinalizeVertex(verts[i], sums[i]))
+			fallback++;
+	}
+	return fallback;
+}
+
+// Orthogonalizes one summed tangent against its normal and works out handedness
+// - Returns false when there was no usable tangent and one had to be made up
+bool TangentGenerator::FinalizeVertex(Vertex& vert, const Accumulator& sum)
+{
+	// Grab the vectors
+	XMVECTOR normal = XMLoadFloat3(&vert.Normal);
+	XMVECTOR tangent = XMLoadFloat4A(&sum.tangent);
+	XMVECTOR bitangent = XMLoadFloat4A(&sum.bitangent);
+
+	// Use Gram-Schmidt orthogonalize
+	tangent = XMVectorSubtract(tangent, XMVectorMultiply(normal, XMVector3Dot(normal, tangent)));
+
+	// Nothing usable left (only degenerate triangles, or a tangent along
+	// the normal), so pick any direction perpendicular to the normal
+	bool usable = XMVectorGetX(XMVector3LengthSq(tangent)) > 1e-20f;
+	if (!usable)
+	{
+		XMVECTOR axis = fabsf(vert.Normal.x) < 0.9f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+		tangent = XMVectorSubtract(axis, XMVectorMultiply(normal, XMVector3Dot(normal, axis)));
+	}
+	tangent = XMVector3Normalize(tangent);
+
+	// Shaders rebuild the bitangent as cross(T, N) * w, which for
+	// unmirrored UVs points the opposite way to the UV bitangent
+	float handedness = XMVectorGetX(XMVector3Dot(XMVector3Cross(normal, tangent), bitangent)) < 0.0f ? -1.0f : 1.0f;
+
+	// Store the tangent
+	XMStoreFloat4(&vert.Tangent, XMVectorSetW(tangent, handedness));
+	return usable;
+}
+
+// The original one-triangle-at-a-time loop (plus degenerate protection)
+void TangentGenerator::GenerateScalar(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices,
+	TangentStats* stats)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<Accumulator> sums(numVerts);
+	memset(sums.data(), 0, sizeof(Accumulator) * numVerts);
+	size_t degenerate = 0;
+
+	// Calculate tangents one whole triangle at a time
+	for (size_t i = 0; i + 2 < numIndices; i += 3)
+	{
+		// Grab indices and vertices of the triangle
+		unsigned int i1 = indices[i];
+		unsigned int i2 = indices[i + 1];
+		unsigned int i3 = indices[i + 2];
+		const Vertex* v1 = &verts[i1];
+		const Vertex* v2 = &verts[i2];
+		const Vertex* v3 = &verts[i3];
+
+		// Calculate vectors relative to triangle positions
+		float x1 = v2->Position.x - v1->Position.x;
+		float y1 = v2->Position.y - v1->Position.y;
+		float z1 = v2->Position.z - v1->Position.z;
+
+		float x2 = v3->Position.x - v1->Position.x;
+		float y2 = v3->Position.y - v1->Position.y;
+		float z2 = v3->Position.z - v1->Position.z;
+
+		// Do the same for vectors relative to triangle uv's
+		float s1 = v2->UV.x - v1->UV.x;
+		float t1 = v2->UV.y - v1->UV.y;
+
+		float s2 = v3->UV.x - v1->UV.x;
+		float t2 = v3->UV.y - v1->UV.y;
+
+		// Skip triangles whose UVs have no area, since r would be infinite
+		float det = s1 * t2 - s2 * t1;
+		if (fabsf(det) <= DegenerateEpsilon)
+		{
+			degenerate++;
+			continue;
+		}
+		float r = 1.0f / det;
+
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		float bx = (s1 * x2 - s2 * x1) * r;
+		float by = (s1 * y2 - s2 * y1) * r;
+		float bz = (s1 * z2 - s2 * z1) * r;
+
+		// Adjust tangents of each vert of the triangle
+		unsigned int corners[3] = { i1, i2, i3 };
+		for (int c = 0; c < 3; c++)
+		{
+			Accumulator& a = sums[corners[c]];
+			a.tangent.x += tx; a.tangent.y += ty; a.tangent.z += tz;
+			a.bitangent.x += bx; a.bitangent.y += by; a.bitangent.z += bz;
+		}
+	}
+
+	// Finish each vertex off one at a time too
+	size_t fallback = 0;
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		if (!FinalizeVertex(verts[i], sums[i]))
+			fallback++;
+	}
+
+	if (stats)
+	{
+		stats->degenerateTriangles = degenerate;
+		stats->fallbackVertices = fallback;
+		stats->threads = 1;
+		stats->seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+// Times both versions (best of several runs) and measures how far apart they are
+TangentBenchmark TangentGenerator::Benchmark(const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices,
+	unsigned int threadCount, int repeats)
+{
+	TangentBenchmark result;
+	std::vector<Vertex> scalar(verts, verts + numVerts);
+	std::vector<Vertex> simd(verts, verts + numVerts);
+
+	result.scalarSeconds = 1e30;
+	result.simdSeconds = 1e30;
+	for (int i = 0; i < std::max(1, repeats); i++)
+	{
+		TangentStats stats;
+		GenerateScalar(scalar.data(), numVerts, indices, numIndices, &stats);
+		result.scalarSeconds = std::min(result.scalarSeconds, stats.seconds);
+
+		Generate(simd.data(), numVerts, indices, numIndices, threadCount, &stats);
+		result.simdSeconds = std::min(result.simdSeconds, stats.seconds);
+		result.threads = stats.threads;
+	}
+
+	// Compare the two sets of tangents
+	float minCos = 1.0f;
+	for (size_t i = 0; i < numVerts; i++)
+	{
+		XMVECTOR a = XMLoadFloat4(&scalar[i].Tangent);
+		XMVECTOR b = XMLoadFloat4(&simd[i].Tangent);
+		minCos = std::min(minCos, XMVectorGetX(XMVector3Dot(a, b)));
+		if (scalar[i].Tangent.w != simd[i].Tangent.w)
+			result.handednessMismatches++;
+	}
+	result.maxAngleError = XMConvertToDegrees(acosf(std::max(-1.0f, std::min(1.0f, minCos))));
+	return result;
+}
+
+// How many threads are actually worth using for this many triangles
+unsigned int TangentGenerator::ChooseThreadCount(size_t triangleCount, unsigned int requested)
+{
+	if (requested == 0)
+		requested = std::max(1u, std::thread::hardware_concurrency());
+
+	// Don't give any thread too small a piece
+	size_t useful = std::max<size_t>(1, triangleCount / MinTrianglesPerThread);
+	return (unsigned int)std::min<size_t>(requested, useful);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "Vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// What happened during a tangent generation pass
+struct TangentStats
+{
+	// Triangles skipped because their UVs have (almost) no area
+	size_t degenerateTriangles = 0;
+	// Vertices that got no usable tangent and were given an arbitrary one
+	size_t fallbackVertices = 0;
+	// How many threads did the accumulation
+	unsigned int threads = 1;
+	double seconds = 0;
+};
+
+// Results of running the SIMD path against the scalar one on the same mesh
+struct TangentBenchmark
+{
+	double scalarSeconds = 0;
+	double simdSeconds = 0;
+	unsigned int threads = 1;
+	// Largest angle (in degrees) between the two paths' tangents
+	float maxAngleError = 0;
+	// Vertices where the two paths disagree on handedness
+	size_t handednessMismatches = 0;
+
+	double Speedup() const { return simdSeconds > 0 ? scalarSeconds / simdSeconds : 0; }
+};
+
+// Builds per-vertex tangents for indexed triangle lists
+// - Tangent.xyz is the normalized tangent, orthogonal to the normal
+// - Tangent.w is the handedness: the shaders rebuild the bitangent as
+//   cross(T, N) * w, so mirrored UVs get a correctly flipped bitangent
+// - Only depends on DirectXMath, so it can be run and checked headless
+class TangentGenerator
+{
+public:
+	// Fewest triangles each thread should get before splitting is worth it
+	static const size_t MinTrianglesPerThread = 32 * 1024;
+
+	// Vectorized version that does 4 triangles at a time
+	// - threadCount of 0 uses every hardware thread (small meshes stay on one)
+	static void Generate(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices,
+		unsigned int threadCount = 1, TangentStats* stats = nullptr);
+
+	// Straightforward one-triangle-at-a-time version, used as the reference
+	static void GenerateScalar(Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices,
+		TangentStats* stats = nullptr);
+
+	// Runs both versions on copies of the vertices and compares the results
+	// - The vertices passed in are left untouched
+	static TangentBenchmark Benchmark(const Vertex* verts, size_t numVerts, const unsigned int* indices, size_t numIndices,
+		unsigned int threadCount = 0, int repeats = 5);
+
+private:
+	// Per-vertex sums of triangle tangents and bitangents (w unused)
+	struct Accumulator
+	{
+		DirectX::XMFLOAT4A tangent;
+		DirectX::XMFLOAT4A bitangent;
+	};
+
+	// UV area below which a triangle is treated as degenerate
+	static const float DegenerateEpsilon;
+
+	// Adds the tangents of triangles [first, last) into sums
+	static size_t AccumulateRange(const Vertex* verts, const unsigned int* indices,
+		size_t first, size_t last, Accumulator* sums);
+
+	// Works out the tangents of triangles [first, last) without adding them
+	// up anywhere, storing one per triangle in faces
+	// - Also sorts each usable corner into the list for the thread that
+	//   owns its vertex (corners[owner], owners of vertexChunk vertices each)
+	static size_t FaceRange(const Vertex* verts, const unsigned int* indices,
+		size_t first, size_t last, Accumulator* faces,
+		size_t vertexChunk, std::vector<uint32_t>* corners);
+
+	// Turns summed tangents into final orthogonalized tangents with handedness
+	// - Returns how many vertices needed a made up tangent
+	static size_t Finalize(Vertex* verts, size_t first, size_t last, const Accumulator* sums);
+	static bool FinalizeVertex(Vertex& vert, const Accumulator& sum);
+
+	static unsigned int ChooseThreadCount(size_t triangleCount, unsigned int requested);
+};
@@ -0,0 +1,144 @@
+#include "Test.h"
+#include "Camera.h"
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Everything the camera caches, copied out so it can be compared later
+	struct CameraState
+	{
+		XMFLOAT4X4 view;
+		XMFLOAT4X4 proj;
+		XMFLOAT4X4 viewProj;
+		XMFLOAT4X4 inverseView;
+		XMFLOAT4X4 inverseProj;
+		XMFLOAT4X4 inverseViewProj;
+		uint32_t version;
+	};
+
+	CameraState Capture(Camera& camera)
+	{
+		CameraState state;
+		state.view = camera.GetViewMatrix();
+		state.proj = camera.GetProjMatrix();
+		state.viewProj = camera.GetViewProjMatrix();
+		state.inverseView = camera.GetInverseViewMatrix();
+		state.inverseProj = camera.GetInverseProjMatrix();
+		state.inverseViewProj = camera.GetInverseViewProjMatrix();
+		state.version = camera.GetVersion();
+		return state;
+	}
+
+	bool Same(const XMFLOAT4X4& a, const XMFLOAT4X4& b)
+	{
+		return memcmp(&a, &b, sizeof(XMFLOAT4X4)) == 0;
+	}
+
+	bool Near(const XMFLOAT4X4& actual, XMMATRIX reference)
+	{
+		XMFLOAT4X4 expected;
+		XMStoreFloat4x4(&expected, reference);
+		for (int i = 0; i < 16; i++)
+		{
+			float e = (&expected._11)[i];
+			if (fabsf((&actual._11)[i] - e) > 1e-4f * (1.0f + fabsf(e)))
+				return false;
+		}
+		return true;
+	}
+
+	// The cached products and inverses agree with the view and projection
+	bool Consistent(const CameraState& state)
+	{
+		XMMATRIX view = XMLoadFloat4x4(&state.view);
+		XMMATRIX proj = XMLoadFloat4x4(&state.proj);
+		return Near(state.viewProj, view * proj) &&
+			Near(state.inverseView, XMMatrixInverse(nullptr, view)) &&
+			Near(state.inverseProj, XMMatrixInverse(nullptr, proj)) &&
+			Near(state.inverseViewProj, XMMatrixInverse(nullptr, view * proj));
+	}
+}
+
+// Asking again, or updating with nothing changed, leaves the version and
+// every cached matrix alone
+TEST(CameraCacheUnchanged)
+{
+	Camera camera(XMFLOAT3(1, 2, -5), XMFLOAT3(0.1f, 0.2f, 0), 16.0f / 9.0f);
+	CameraState first = Capture(camera);
+	CHECK(first.version > 0);
+	CHECK(Consistent(first));
+
+	camera.UpdateViewMatrix();
+	camera.GetFrustum();
+	camera.Update(0.016f);
+	CameraState second = Capture(camera);
+	CHECK(second.version == first.version);
+	CHECK(memcmp(&first, &second, sizeof(CameraState)) == 0);
+
+	// The shorter constructors build a working camera too
+	Camera simple(2.0f);
+	CameraState simpleState = Capture(simple);
+	CHECK(simpleState.version > 0);
+	CHECK(fabsf(simpleState.proj._22 / simpleState.proj._11 - 2.0f) < 1e-4f);
+	CHECK(Consistent(simpleState));
+	Camera placed(XMFLOAT3(0, 3, 0), XMFLOAT3(0, 0, 0), 1.0f);
+	CHECK(Near(placed.GetInverseViewMatrix(), XMMatrixTranslation(0, 3, 0)));
+}
+
+// Every setter moves the version on and rebuilds what depends on it, and
+// only that
+TEST(CameraCacheInvalidation)
+{
+	Camera camera(XMFLOAT3(0, 0, -5), XMFLOAT3(0, 0, 0), 1.5f);
+	CameraState before = Capture(camera);
+
+	// Moving changes the view but not the projection
+	camera.transform.SetPosition(3, 1, -4);
+	CameraState moved = Capture(camera);
+	CHECK(moved.version != before.version);
+	CHECK(!Same(moved.view, before.view) && Same(moved.proj, before.proj));
+	CHECK(!Same(moved.viewProj, before.viewProj));
+	CHECK(Consistent(moved));
+	CHECK(Capture(camera).version == moved.version);
+
+	camera.transform.LocalTranslate(0, 0, 1);
+	CameraState translated = Capture(camera);
+	CHECK(translated.version != moved.version && !Same(translated.view, moved.view));
+
+	// Turning, both ways the transform allows
+	camera.transform.Rotate(0, 0.5f, 0);
+	CameraState turned = Capture(camera);
+	CHECK(turned.version != translated.version && !Same(turned.view, translated.view));
+	CHECK(Consistent(turned));
+	camera.transform.SetRotation(0.2f, 0, 0);
+	CameraState set = Capture(camera);
+	CHECK(set.version != turned.version && !Same(set.view, turned.view));
+
+	// A new aspect ratio changes the projection but not the view
+	camera.UpdateProjectionMatrix(0.75f);
+	CameraState resized = Capture(camera);
+	CHECK(resized.version != set.version);
+	CHECK(Same(resized.view, set.view) && !Same(resized.proj, set.proj));
+	CHECK(!Same(resized.inverseViewProj, set.inverseViewProj));
+	CHECK(Consistent(resized));
+
+	// Reverse-Z, and back
+	CHECK(!camera.GetReverseZ() && camera.GetFarDepth() == 1.0f);
+	camera.SetReverseZ(true);
+	CameraState reversed = Capture(camera);
+	CHECK(camera.GetReverseZ() && camera.GetFarDepth() == 0.0f);
+	CHECK(reversed.version != resized.version);
+	CHECK(Same(reversed.view, resized.view) && !Same(reversed.proj, resized.proj));
+	CHECK(Consistent(reversed));
+	camera.SetReverseZ(false);
+	CameraState restored = Capture(camera);
+	CHECK(restored.version != reversed.version);
+	CHECK(Same(restored.proj, resized.proj));
+
+	// The frustum follows along
+	Frustum frustum = camera.GetFrustum();
+	camera.transform.SetPosition(0, 0, 100);
+	Frustum farther = camera.GetFrustum();
+	CHECK(memcmp(&frustum, &farther, sizeof(Frustum)) != 0);
+}
@@ -0,0 +1,78 @@
+#include "Test.h"
+#include "FrameAllocator.h"
+
+// Every slice starts and ends on a 256 byte boundary, since that's the step
+// constant buffer offsets are set in
+TEST(FrameAllocatorAlignment)
+{
+	// Only whole blocks fit
+	FrameAllocator allocator(1000);
+	CHECK(allocator.GetCapacity() == 768);
+
+	FrameAllocation first, second, third;
+	CHECK(allocator.Allocate(1, first));
+	CHECK(first.offset == 0 && first.size == 256 && first.firstInFrame);
+	CHECK(allocator.Allocate(257, second));
+	CHECK(second.offset == 256 && second.size == 512 && !second.firstInFrame);
+	CHECK(allocator.GetUsed() == 768);
+	CHECK(allocator.GetStats().allocations == 2);
+	CHECK(allocator.GetStats().bytes == 768);
+
+	// Other alignments round the same way
+	FrameAllocator small(100, 16);
+	CHECK(small.GetCapacity() == 96);
+	CHECK(small.Allocate(17, first) && first.size == 32);
+	CHECK(small.Allocate(16, second) && second.offset == 32 && second.size == 16);
+	CHECK(small.Allocate(48, third) && third.offset == 48);
+}
+
+// A frame that's full says so, and leaves what was handed out alone
+TEST(FrameAllocatorOverflow)
+{
+	FrameAllocator allocator(1024);
+	FrameAllocation allocation;
+	CHECK(allocator.Allocate(512, allocation));
+	CHECK(!allocator.Allocate(513, allocation));
+	CHECK(allocation.offset == 0);
+	CHECK(allocator.GetUsed() == 512);
+
+	// What still fits goes in after a failure
+	CHECK(allocator.Allocate(512, allocation));
+	CHECK(allocation.offset == 512);
+	CHECK(!allocator.Allocate(1, allocation));
+	CHECK(!allocator.Allocate(0, allocation));
+	CHECK(allocator.GetStats().overflows == 3);
+	CHECK(allocator.GetStats().allocations == 2);
+
+	// Nothing at all fits in an empty allocator
+	FrameAllocator empty;
+	CHECK(!empty.Allocate(16, allocation));
+
+	// The next frame starts over from the front
+	allocator.BeginFrame();
+	CHECK(allocator.GetUsed() == 0);
+	CHECK(allocator.GetStats().overflows == 0);
+	CHECK(allocator.GetHighWater() == 1024);
+	CHECK(allocator.Allocate(16, allocation));
+	CHECK(allocation.offset == 0 && allocation.firstInFrame);
+}
+
+// Each frame is a new generation, and 0 never is one, even after wrapping
+// around, since it means "never allocated"
+TEST(FrameAllocatorGenerations)
+{
+	FrameAllocator allocator(1024);
+	CHECK(allocator.GetGeneration() == 1);
+	allocator.BeginFrame();
+	CHECK(allocator.GetGeneration() == 2);
+
+	FrameAllocator wrapping(1024, FrameAllocator::DefaultAlignment, 0xFFFFFFFFu);
+	CHECK(wrapping.GetGeneration() == 0xFFFFFFFFu);
+	wrapping.BeginFrame();
+	CHECK(wrapping.GetGeneration() == 1);
+	wrapping.BeginFrame();
+	CHECK(wrapping.GetGeneration() == 2);
+
+	FrameAllocator zero(1024, FrameAllocator::DefaultAlignment, 0);
+	CHECK(zero.GetGeneration() == 1);
+}
@@ -0,0 +1,136 @@
+#include "Test.h"
+#include "FrustumCuller.h"
+#include <vector>
+
+using namespace DirectX;
+
+// Same random numbers as FrustumCuller::Benchmark
+static float Random(uint32_t& seed, float lo, float hi)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return lo + (hi - lo) * ((seed >> 8) / 16777216.0f);
+}
+
+static Frustum CameraFrustum()
+{
+	XMFLOAT4X4 view, proj;
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(0, 0, -100, 0), XMVectorSet(0.3f, 0.1f, 1, 0), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f));
+	return Frustum::FromCamera(view, proj);
+}
+
+// Planes that everything passes, so only the padding can be culled
+static Frustum EverythingFrustum()
+{
+	Frustum frustum;
+	for (int p = 0; p < 6; p++)
+		frustum.planes[p] = XMFLOAT4(0, 0, 0, 1);
+	return frustum;
+}
+
+// Both ways of culling have to give the same list
+static void CheckAgreement(const FrustumCuller& culler, const Frustum& frustum)
+{
+	std::vector<uint32_t> scalarVisible, simdVisible;
+	size_t scalarCount = culler.CullScalar(frustum, scalarVisible);
+	size_t simdCount = culler.Cull(frustum, simdVisible);
+	CHECK(scalarCount == simdCount);
+	CHECK(simdVisible.size() == simdCount);
+	CHECK(scalarVisible == simdVisible);
+	for (size_t i = 0; i < simdVisible.size(); i++)
+		CHECK(simdVisible[i] < culler.GetCount());
+}
+
+// Every count from empty up to a few blocks, so each way the last block
+// can be partly padding is covered
+TEST(FrustumCullerMatchesScalar)
+{
+	Frustum frustum = CameraFrustum();
+	uint32_t seed = 12345;
+	for (size_t count = 0; count <= 13; count++)
+	{
+		FrustumCuller culler;
+		for (size_t i = 0; i < count; i++)
+			culler.Add(XMFLOAT3(Random(seed, -50, 50), Random(seed, -50, 50), Random(seed, -50, 50)), Random(seed, 0.5f, 20.0f));
+		CheckAgreement(culler, frustum);
+	}
+
+	// A big scene that isn't a multiple of 4
+	FrustumCuller culler;
+	for (size_t i = 0; i < 10001; i++)
+		culler.Add(XMFLOAT3(Random(seed, -500, 500), Random(seed, -500, 500), Random(seed, -500, 500)), Random(seed, 0.5f, 5.0f));
+	CheckAgreement(culler, frustum);
+}
+
+// With planes that pass everything, every real sphere is visible and no
+// padding lane ever is
+TEST(FrustumCullerSkipsPadding)
+{
+	Frustum frustum = EverythingFrustum();
+	for (size_t count = 1; count <= 9; count++)
+	{
+		FrustumCuller culler;
+		for (size_t i = 0; i < count; i++)
+			culler.Add(XMFLOAT3(0, 0, 0), 0.0f);
+
+		std::vector<uint32_t> visible;
+		CHECK(culler.Cull(frustum, visible) == count);
+		for (size_t i = 0; i < visible.size(); i++)
+			CHECK(visible[i] == i);
+		CheckAgreement(culler, frustum);
+	}
+}
+
+// Clearing has to bring the padding back, even over slots that held real
+// spheres before
+TEST(FrustumCullerClearResetsPadding)
+{
+	Frustum frustum = EverythingFrustum();
+	FrustumCuller culler;
+	for (int i = 0; i < 8; i++)
+		culler.Add(XMFLOAT3(0, 0, 0), 1.0f);
+	culler.Clear();
+	culler.Add(XMFLOAT3(0, 0, 0), 1.0f);
+
+	std::vector<uint32_t> visible;
+	CHECK(culler.Cull(frustum, visible) == 1);
+	CHECK(visible.size() == 1 && visible[0] == 0);
+	CheckAgreement(culler, frustum);
+}
+
+// Spheres just touching a plane, a radius of 0 and moved spheres
+TEST(FrustumCullerEdges)
+{
+	// The near plane is z = 0.1 with the camera at the origin looking down +z
+	XMFLOAT4X4 view, proj;
+	XMStoreFloat4x4(&view, XMMatrixIdentity());
+	XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, 0.1f, 100.0f));
+	Frustum frustum = Frustum::FromCamera(view, proj);
+
+	FrustumCuller culler;
+	culler.Add(XMFLOAT3(0, 0, -0.85f), 1.0f);		// Just reaching past the near plane
+	culler.Add(XMFLOAT3(0, 0, -1.0f), 0.5f);		// Behind the camera
+	culler.Add(XMFLOAT3(0, 0, 10.0f), 0.0f);		// A point in view
+	culler.Add(XMFLOAT3(0, 0, 150.0f), 10.0f);		// Past the far plane
+	culler.Add(XMFLOAT3(20.0f, 0, 10.0f), 10.5f);	// Poking in from the side
+	CheckAgreement(culler, frustum);
+
+	std::vector<uint32_t> visible;
+	culler.Cull(frustum, visible);
+	CHECK(visible.size() == 3);
+	CHECK(visible.size() == 3 && visible[0] == 0 && visible[1] == 2 && visible[2] == 4);
+
+	// Moving a sphere out of view
+	culler.Set(2, XMFLOAT3(0, 0, -10.0f), 1.0f);
+	CheckAgreement(culler, frustum);
+	culler.Cull(frustum, visible);
+	CHECK(visible.size() == 2);
+}
+
+// The benchmark's own comparison, at sizes that aren't multiples of 4
+TEST(FrustumCullerBenchmarkMismatches)
+{
+	const size_t counts[3] = { 1, 1003, 100001 };
+	for (int i = 0; i < 3; i++)
+		CHECK(FrustumCuller::Benchmark(counts[i]).mismatches == 0);
+}
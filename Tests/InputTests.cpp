@@ -0,0 +1,250 @@
+#include "Test.h"
+#include "Input.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#endif
+
+namespace
+{
+	// A path in the system's temporary directory
+	std::string TempPath(const char* name)
+	{
+#ifdef _WIN32
+		char dir[MAX_PATH + 1];
+		DWORD length = GetTempPathA(MAX_PATH + 1, dir);
+		std::string path = length > 0 && length <= MAX_PATH ? std::string(dir, length) : std::string(".\\");
+#else
+		const char* dir = getenv("TMPDIR");
+		std::string path = std::string(dir && *dir ? dir : "/tmp") + "/";
+#endif
+		return path + name;
+	}
+
+	void WriteBytes(const std::string& file, const std::vector<char>& bytes)
+	{
+		std::ofstream out(file, std::ios::binary | std::ios::trunc);
+		out.write(bytes.data(), bytes.size());
+	}
+
+	std::vector<char> ReadBytes(const std::string& file)
+	{
+		std::ifstream in(file, std::ios::binary);
+		return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+
+	// Everything a frame's input looks like from outside
+	struct FrameState
+	{
+		float deltaTime;
+		int mouseX, mouseY;
+		bool down[Input::KeyCount];
+		bool pressed[Input::KeyCount];
+
+		bool operator==(const FrameState& other) const
+		{
+			return deltaTime == other.deltaTime && mouseX == other.mouseX && mouseY == other.mouseY &&
+				memcmp(down, other.down, sizeof(down)) == 0 && memcmp(pressed, other.pressed, sizeof(pressed)) == 0;
+		}
+	};
+
+	FrameState Capture(const Input& input, float deltaTime)
+	{
+		FrameState state;
+		state.deltaTime = deltaTime;
+		state.mouseX = input.GetMouseX();
+		state.mouseY = input.GetMouseY();
+		for (int key = 0; key < Input::KeyCount; key++)
+		{
+			state.down[key] = input.IsKeyDown(key);
+			state.pressed[key] = input.WasKeyPressed(key);
+		}
+		return state;
+	}
+
+	// Keys spread over every word of the key bits
+	const int ScriptKeys[8] = { INPUT_KEY_LBUTTON, INPUT_KEY_SPACE, 'A', 'D', 'S', 'W', 0x90, 0xFE };
+
+	// Records a few hundred frames of keys going up and down at random, a
+	// wandering mouse (once far off screen) and uneven frame times
+	std::vector<FrameState> RecordScript(const std::string& file)
+	{
+		Input input;
+		CHECK(input.StartRecording(file.c_str()));
+		CHECK(input.GetMode() == INPUT_RECORD);
+
+		std::vector<FrameState> frames;
+		bool held[8] = {};
+		uint32_t state = 5;
+		for (int frame = 0; frame < 300; frame++)
+		{
+			int keys[8];
+			int keyCount = 0;
+			for (int k = 0; k < 8; k++)
+			{
+				state = state * 1664525u + 1013904223u;
+				// The first frame always has something held
+				if ((state >> 8) % 4 == 0 || (frame == 0 && k == 2))
+					held[k] = !held[k];
+				if (held[k])
+					keys[keyCount++] = ScriptKeys[k];
+			}
+			state = state * 1664525u + 1013904223u;
+			int mouseX = frame == 100 ? 50000 : (int)((state >> 8) % 2000) - 100;
+			int mouseY = (int)((state >> 20) % 1200) - 50;
+			float deltaTime = 0.005f + ((state >> 4) % 100) * 0.0003f;
+
+			float used = input.BeginFrame(deltaTime, keys, keyCount, mouseX, mouseY);
+			CHECK(used == deltaTime);
+			frames.push_back(Capture(input, used));
+		}
+		CHECK(input.GetFrame() == frames.size());
+		input.Stop();
+		CHECK(input.GetMode() == INPUT_LIVE);
+		return frames;
+	}
+
+	bool Rejected(const std::string& file, const std::vector<char>& bytes)
+	{
+		WriteBytes(file, bytes);
+		Input input;
+		bool started = input.StartReplay(file.c_str());
+		return !started && input.GetMode() == INPUT_LIVE;
+	}
+}
+
+// Scripted input played back from its recording comes out the same,
+// frame for frame, and holding a key only presses it once
+TEST(InputRecordReplay)
+{
+	std::string file = TempPath("InputRecordReplay.inp");
+	std::vector<FrameState> recorded = RecordScript(file);
+
+	// Presses are keys that just went down, and the far off mouse was clamped
+	size_t presses = 0;
+	for (size_t f = 1; f < recorded.size(); f++)
+	{
+		for (int key = 0; key < Input::KeyCount; key++)
+		{
+			CHECK(recorded[f].pressed[key] == (recorded[f].down[key] && !recorded[f - 1].down[key]));
+			presses += recorded[f].pressed[key] ? 1 : 0;
+		}
+	}
+	CHECK(presses > 100);
+	CHECK(recorded[100].mouseX == 32767);
+
+	Input input;
+	CHECK(input.StartReplay(file.c_str()));
+	CHECK(input.GetMode() == INPUT_REPLAY);
+	bool same = true;
+	for (size_t f = 0; f < recorded.size(); f++)
+	{
+		// Scripted and live input are both ignored while replaying
+		int ignored = 'Q';
+		float deltaTime = f % 2 ? input.BeginFrame(1.0f, nullptr) : input.BeginFrame(1.0f, &ignored, 1, 7, 7);
+		same = same && Capture(input, deltaTime) == recorded[f];
+		CHECK(!input.IsReplayFinished());
+	}
+	CHECK(same);
+
+	// Past the end, keys stay held but nothing new is pressed
+	float deltaTime = input.BeginFrame(0.02f, nullptr);
+	CHECK(input.IsReplayFinished());
+	FrameState last = recorded.back();
+	last.deltaTime = 0.02f;
+	memset(last.pressed, 0, sizeof(last.pressed));
+	CHECK(Capture(input, deltaTime) == last);
+
+	// A fixed time step replaces the recorded one
+	CHECK(input.StartReplay(file.c_str(), 1.0f / 60.0f));
+	CHECK(input.BeginFrame(1.0f, nullptr) == 1.0f / 60.0f);
+	FrameState first = recorded[0];
+	first.deltaTime = 1.0f / 60.0f;
+	CHECK(Capture(input, 1.0f / 60.0f) == first);
+	input.Stop();
+	remove(file.c_str());
+}
+
+// Logs that were cut short, run on, never finished or were damaged are
+// turned down before a single frame plays
+TEST(InputRejectsBadLogs)
+{
+	std::string file = TempPath("InputRejectsBadLogs.inp");
+	RecordScript(file);
+	std::vector<char> good = ReadBytes(file);
+	CHECK(good.size() > sizeof(InputLogHeader));
+	{
+		Input input;
+		CHECK(input.StartReplay(file.c_str()));
+	}
+
+	// Cut off anywhere, including between two frames
+	size_t truncated = 0;
+	for (size_t length = 0; length < good.size(); length++)
+		truncated += Rejected(file, std::vector<char>(good.begin(), good.begin() + length)) ? 1 : 0;
+	CHECK(truncated == good.size());
+
+	std::vector<char> bad = good;
+	bad.push_back(0);
+	CHECK(Rejected(file, bad));
+
+	// Header damage, including a recording that never stopped and so has
+	// no frame count
+	InputLogHeader header;
+	memcpy(&header, good.data(), sizeof(header));
+	CHECK(header.frameCount == 300);
+	for (int field = 0; field < 4; field++)
+	{
+		InputLogHeader broken = header;
+		if (field == 0)
+			broken.magic[0] = 'X';
+		else if (field == 1)
+			broken.version = Input::Version + 1;
+		else if (field == 2)
+			broken.frameCount = 0;
+		else
+			broken.frameCount++;
+		bad = good;
+		memcpy(bad.data(), &broken, sizeof(broken));
+		CHECK(Rejected(file, bad));
+	}
+
+	// The first frame: deltaTime, mouse, change count, then its changes
+	const size_t frame = sizeof(InputLogHeader);
+	const size_t firstChange = frame + sizeof(float) + sizeof(int16_t) * 2 + 1;
+	CHECK(good[frame + 8] > 0);
+
+	bad = good;
+	float notANumber = std::numeric_limits<float>::quiet_NaN();
+	memcpy(&bad[frame], &notANumber, sizeof(float));
+	CHECK(Rejected(file, bad));
+	bad = good;
+	float negative = -0.5f;
+	memcpy(&bad[frame], &negative, sizeof(float));
+	CHECK(Rejected(file, bad));
+
+	// Unknown flags, or no key at all
+	bad = good;
+	bad[firstChange + 1] |= 0x80;
+	CHECK(Rejected(file, bad));
+	bad = good;
+	bad[firstChange] = 0;
+	CHECK(Rejected(file, bad));
+
+	// A wrong change count throws off every record after it
+	bad = good;
+	bad[frame + 8]++;
+	CHECK(Rejected(file, bad));
+
+	CHECK(!Input().StartReplay(TempPath("InputMissing.inp").c_str()));
+	remove(file.c_str());
+}
@@ -0,0 +1,239 @@
+#include "Test.h"
+#include "MeshCache.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+namespace
+{
+	const uint32_t Flags = 3;
+	const uint32_t VertexSize = 32;
+
+	// A path in the system's temporary directory
+	std::string TempPath(const char* name)
+	{
+#ifdef _WIN32
+		char dir[MAX_PATH + 1];
+		DWORD length = GetTempPathA(MAX_PATH + 1, dir);
+		std::string path = length > 0 && length <= MAX_PATH ? std::string(dir, length) : std::string(".\\");
+#else
+		const char* dir = getenv("TMPDIR");
+		std::string path = std::string(dir && *dir ? dir : "/tmp") + "/";
+#endif
+		return path + name;
+	}
+
+	void WriteBytes(const std::string& file, const std::vector<char>& bytes)
+	{
+		std::ofstream out(file, std::ios::binary | std::ios::trunc);
+		out.write(bytes.data(), bytes.size());
+	}
+
+	std::vector<char> ReadBytes(const std::string& file)
+	{
+		std::ifstream in(file, std::ios::binary);
+		return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+
+	void WriteSource(const std::string& file, const char* text)
+	{
+		WriteBytes(file, std::vector<char>(text, text + strlen(text)));
+	}
+
+	// Moves a file's modification time, since an edit within the same
+	// second wouldn't
+	bool Touch(const std::string& file, int seconds)
+	{
+		struct stat info;
+		if (stat(file.c_str(), &info) != 0)
+			return false;
+		struct utimbuf times;
+		times.actime = info.st_atime;
+		times.modtime = info.st_mtime + seconds;
+		return utime(file.c_str(), &times) == 0;
+	}
+
+	// A quad of 4 vertices with a second, one triangle LOD
+	// - 6 16-bit indices, so the index array needs padding
+	struct Bake
+	{
+		float vertices[4][VertexSize / sizeof(float)];
+		uint16_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+		MeshLod lods[2] = { { 0, 6, 0.0f }, { 0, 3, 0.5f } };
+		float boundsMin[3] = { 0, 0, 0 };
+		float boundsMax[3] = { 1, 1, 0 };
+
+		Bake()
+		{
+			for (int v = 0; v < 4; v++)
+				for (int f = 0; f < 8; f++)
+					vertices[v][f] = v * 8.0f + f;
+		}
+
+		bool Write(const std::string& cacheFile, const std::string& sourceFile) const
+		{
+			return MeshCache::Write(cacheFile.c_str(), sourceFile.c_str(), Flags,
+				vertices, VertexSize, 4, indices, 2, 6, lods, 2, boundsMin, boundsMax, 0.75f);
+		}
+	};
+
+	// Opens with the full hash check, closing again before returning so
+	// the file can be replaced (which Windows won't do while it's mapped)
+	bool Opens(const std::string& cacheFile, const std::string& sourceFile, uint32_t flags = Flags, uint32_t vertexSize = VertexSize)
+	{
+		MeshCache cache;
+		return cache.Open(cacheFile.c_str(), sourceFile.c_str(), flags, vertexSize, true);
+	}
+}
+
+// What goes in comes back out, and only for the same options
+TEST(MeshCacheRoundTrip)
+{
+	std::string source = TempPath("MeshCacheRoundTrip.obj");
+	std::string cacheFile = TempPath("MeshCacheRoundTrip.mesh");
+	WriteSource(source, "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n");
+	remove(cacheFile.c_str());
+
+	// A miss when there's no bake yet
+	CHECK(!Opens(cacheFile, source));
+
+	Bake bake;
+	CHECK(bake.Write(cacheFile, source));
+	{
+		MeshCache cache;
+		CHECK(cache.Open(cacheFile.c_str(), source.c_str(), Flags, VertexSize, true));
+		const MeshCacheHeader* header = cache.GetHeader();
+		CHECK(header != nullptr);
+		if (header)
+		{
+			CHECK(header->vertexCount == 4 && header->indexCount == 6 && header->indexSize == 2);
+			CHECK(header->lodCount == 2 && header->boundsRadius == 0.75f);
+			CHECK(header->boundsMax[0] == 1 && header->boundsMax[2] == 0);
+			CHECK(memcmp(cache.GetVertices(), bake.vertices, sizeof(bake.vertices)) == 0);
+			CHECK(memcmp(cache.GetIndices(), bake.indices, sizeof(bake.indices)) == 0);
+			CHECK(cache.GetLods()[1].indexCount == 3 && cache.GetLods()[1].error == 0.5f);
+			CHECK(cache.GetFileSize() == sizeof(MeshCacheHeader) + sizeof(bake.vertices) + 12 + 2 * sizeof(MeshLod));
+		}
+	}
+
+	// Other options or vertex formats are misses
+	CHECK(!Opens(cacheFile, source, Flags + 1));
+	CHECK(!Opens(cacheFile, source, Flags, VertexSize + 4));
+
+	// A bake can ship without its source
+	remove(source.c_str());
+	CHECK(Opens(cacheFile, source));
+
+	// But can't be written without one
+	CHECK(!bake.Write(cacheFile, source));
+	remove(cacheFile.c_str());
+}
+
+// Changing the source OBJ makes the bake stale
+TEST(MeshCacheStaleSource)
+{
+	std::string source = TempPath("MeshCacheStale.obj");
+	std::string cacheFile = TempPath("MeshCacheStale.mesh");
+	WriteSource(source, "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 3\n");
+
+	Bake bake;
+	CHECK(bake.Write(cacheFile, source));
+	CHECK(Opens(cacheFile, source));
+
+	// An edit that changes the size
+	WriteSource(source, "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3\n");
+	CHECK(!Opens(cacheFile, source));
+
+	// Baking again brings it back up to date
+	CHECK(bake.Write(cacheFile, source));
+	CHECK(Opens(cacheFile, source));
+
+	// An edit that keeps the size
+	WriteSource(source, "v 0 0 0\nv 2 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3\n");
+	CHECK(Touch(source, 10));
+	CHECK(!Opens(cacheFile, source));
+
+	remove(source.c_str());
+	remove(cacheFile.c_str());
+}
+
+// Damaged bakes are misses rather than bad data
+TEST(MeshCacheRejectsDamage)
+{
+	std::string source = TempPath("MeshCacheDamage.obj");
+	std::string cacheFile = TempPath("MeshCacheDamage.mesh");
+	std::string damagedFile = TempPath("MeshCacheDamaged.mesh");
+	WriteSource(source, "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 3\n");
+	Bake bake;
+	CHECK(bake.Write(cacheFile, source));
+	std::vector<char> bytes = ReadBytes(cacheFile);
+	CHECK(bytes.size() > sizeof(MeshCacheHeader));
+
+	// Cut short anywhere, including part way through the header
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		WriteBytes(damagedFile, std::vector<char>(bytes.begin(), bytes.begin() + size));
+		CHECK(!Opens(damagedFile, source));
+	}
+
+	// Or with extra bytes on the end
+	std::vector<char> longer = bytes;
+	longer.push_back(0);
+	WriteBytes(damagedFile, longer);
+	CHECK(!Opens(damagedFile, source));
+
+	// Every changed byte of the payload is caught by the hash
+	for (size_t i = sizeof(MeshCacheHeader); i < bytes.size(); i++)
+	{
+		std::vector<char> corrupt = bytes;
+		corrupt[i] ^= 0x20;
+		WriteBytes(damagedFile, corrupt);
+		CHECK(!Opens(damagedFile, source));
+	}
+
+	// A bad LOD range is caught even without the hash
+	std::vector<char> badLod = bytes;
+	MeshLod lod = { 3, 6, 0.0f };
+	memcpy(badLod.data() + badLod.size() - sizeof(MeshLod), &lod, sizeof(lod));
+	WriteBytes(damagedFile, badLod);
+	{
+		MeshCache cache;
+		CHECK(!cache.Open(damagedFile.c_str(), source.c_str(), Flags, VertexSize, false));
+		CHECK(cache.GetHeader() == nullptr);
+	}
+
+	// So is a bad magic or version
+	std::vector<char> badHeader = bytes;
+	badHeader[0] = 'X';
+	WriteBytes(damagedFile, badHeader);
+	CHECK(!Opens(damagedFile, source));
+	badHeader = bytes;
+	MeshCacheHeader header;
+	memcpy(&header, badHeader.data(), sizeof(header));
+	header.version = MeshCache::Version + 1;
+	memcpy(badHeader.data(), &header, sizeof(header));
+	WriteBytes(damagedFile, badHeader);
+	CHECK(!Opens(damagedFile, source));
+
+	// The real bake was never touched
+	CHECK(Opens(cacheFile, source));
+
+	remove(source.c_str());
+	remove(cacheFile.c_str());
+	remove(damagedFile.c_str());
+}
@@ -0,0 +1,156 @@
+#include "Test.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// A position plus the vertex's original index, which follows it
+	// through the vertex fetch reordering
+	struct GridVertex
+	{
+		float position[3];
+		uint32_t id;
+	};
+
+	struct Triangle
+	{
+		uint32_t a, b, c;
+		bool operator<(const Triangle& other) const
+		{
+			return a != other.a ? a < other.a : b != other.b ? b < other.b : c < other.c;
+		}
+		bool operator==(const Triangle& other) const
+		{
+			return a == other.a && b == other.b && c == other.c;
+		}
+	};
+
+	// Same seedable generator everywhere, so failures reproduce
+	uint32_t Next(uint32_t& state)
+	{
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	}
+
+	// A bumpy grid with its triangles shuffled and each one started at a
+	// random corner, which is about as cache unfriendly as a mesh gets
+	void ShuffledGrid(int size, std::vector<GridVertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				GridVertex v = { { (float)x, (float)((x * 7 + y * 3) % 5) * 0.25f, (float)y }, (uint32_t)vertices.size() };
+				vertices.push_back(v);
+			}
+		}
+
+		std::vector<Triangle> triangles;
+		for (int y = 0; y + 1 < size; y++)
+		{
+			for (int x = 0; x + 1 < size; x++)
+			{
+				uint32_t i = (uint32_t)(y * size + x);
+				triangles.push_back({ i, i + (uint32_t)size, i + 1 });
+				triangles.push_back({ i + 1, i + (uint32_t)size, i + (uint32_t)size + 1 });
+			}
+		}
+
+		uint32_t state = 12345;
+		for (size_t t = triangles.size() - 1; t > 0; t--)
+			std::swap(triangles[t], triangles[Next(state) % (t + 1)]);
+		for (size_t t = 0; t < triangles.size(); t++)
+		{
+			const uint32_t corners[3] = { triangles[t].a, triangles[t].b, triangles[t].c };
+			uint32_t start = Next(state) % 3;
+			for (uint32_t k = 0; k < 3; k++)
+				indices.push_back(corners[(start + k) % 3]);
+		}
+	}
+
+	// The triangles by original vertex, each rotated to start at its
+	// smallest index (keeping the winding), then sorted
+	std::vector<Triangle> TriangleSet(const std::vector<GridVertex>& vertices, const std::vector<unsigned int>& indices)
+	{
+		std::vector<Triangle> triangles;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			uint32_t a = vertices[indices[i]].id, b = vertices[indices[i + 1]].id, c = vertices[indices[i + 2]].id;
+			if (b < a && b < c)
+				triangles.push_back({ b, c, a });
+			else if (c < a && c < b)
+				triangles.push_back({ c, a, b });
+			else
+				triangles.push_back({ a, b, c });
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+// The full pass keeps every triangle, wound the same way, and makes the
+// cache behave better
+TEST(MeshOptimizerShuffledGrid)
+{
+	std::vector<GridVertex> vertices;
+	std::vector<unsigned int> indices;
+	ShuffledGrid(48, vertices, indices);
+	std::vector<Triangle> before = TriangleSet(vertices, indices);
+
+	MeshOptimizeStats stats;
+	size_t vertexCount = MeshOptimizer::Optimize(vertices.data(), vertices.size(), sizeof(GridVertex),
+		offsetof(GridVertex, position), indices.data(), indices.size(), &stats);
+	CHECK(vertexCount == vertices.size());
+	CHECK(stats.after.acmr < stats.before.acmr);
+	CHECK(stats.after.acmr < 1.0f);
+	CHECK(stats.after.atvr < stats.before.atvr);
+
+	// The stats match a fresh measurement
+	MeshCacheStats after = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+	CHECK(after.acmr == stats.after.acmr);
+
+	// Vertices appear in the order they're first used
+	unsigned int nextNew = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		CHECK(indices[i] <= nextNew);
+		if (indices[i] == nextNew)
+			nextNew++;
+	}
+	CHECK(TriangleSet(vertices, indices) == before);
+}
+
+// The overdraw order is only kept when it costs at most 5% more ACMR
+// than the cache order it starts from, and is undone otherwise
+TEST(MeshOptimizerOverdrawThreshold)
+{
+	std::vector<GridVertex> vertices;
+	std::vector<unsigned int> indices;
+	ShuffledGrid(48, vertices, indices);
+	std::vector<Triangle> before = TriangleSet(vertices, indices);
+
+	std::vector<size_t> clusters;
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertices.size(),
+		MeshOptimizer::DefaultCacheSize, &clusters);
+	CHECK(!clusters.empty() && clusters[0] == 0);
+	float cacheAcmr = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size()).acmr;
+
+	std::vector<unsigned int> sorted = indices;
+	bool applied = MeshOptimizer::OptimizeOverdraw(sorted.data(), sorted.size(), clusters,
+		vertices.data(), vertices.size(), sizeof(GridVertex), offsetof(GridVertex, position));
+	float sortedAcmr = MeshOptimizer::AnalyzeVertexCache(sorted.data(), sorted.size(), vertices.size()).acmr;
+	if (applied)
+		CHECK(sortedAcmr <= cacheAcmr * 1.05f);
+	else
+		CHECK(sorted == indices);
+	CHECK(TriangleSet(vertices, sorted) == before);
+
+	// A threshold nothing can meet leaves the cache order alone
+	std::vector<unsigned int> rejected = indices;
+	CHECK(!MeshOptimizer::OptimizeOverdraw(rejected.data(), rejected.size(), clusters,
+		vertices.data(), vertices.size(), sizeof(GridVertex), offsetof(GridVertex, position), 0.5f));
+	CHECK(rejected == indices);
+}
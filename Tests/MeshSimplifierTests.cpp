@@ -0,0 +1,176 @@
+#include "Test.h"
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// A bumpy open grid of size x size quads, cut into four by a seam down
+	// the middle column (like a UV seam) and across the middle row (like
+	// a hard normal edge), so every vertex on a seam has a copy per side
+	// and the center has four
+	void SeamedGrid(int size, std::vector<XMFLOAT3>& positions, std::vector<uint32_t>& indices)
+	{
+		int half = size / 2;
+		std::vector<int> copies((size + 1) * (size + 1) * 4, -1);
+		auto vertex = [&](int x, int z, int sideX, int sideZ)
+		{
+			int copy = (x == half ? sideX : 0) + (z == half ? sideZ * 2 : 0);
+			int& index = copies[(z * (size + 1) + x) * 4 + copy];
+			if (index < 0)
+			{
+				index = (int)positions.size();
+				positions.push_back(XMFLOAT3((float)x, sinf(x * 0.4f) * cosf(z * 0.3f) * 0.5f, (float)z));
+			}
+			return (uint32_t)index;
+		};
+
+		for (int z = 0; z < size; z++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				int sideX = x < half ? 0 : 1;
+				int sideZ = z < half ? 0 : 1;
+				uint32_t a = vertex(x, z, sideX, sideZ);
+				uint32_t b = vertex(x + 1, z, sideX, sideZ);
+				uint32_t c = vertex(x, z + 1, sideX, sideZ);
+				uint32_t d = vertex(x + 1, z + 1, sideX, sideZ);
+				uint32_t quad[6] = { a, c, b, b, c, d };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	typedef std::pair<float, float> GridPoint;
+	typedef std::pair<GridPoint, GridPoint> Edge;
+
+	// Edges used by exactly one triangle, compared by position so the
+	// two sides of a seam count as the same edge
+	std::vector<Edge> OpenEdges(const std::vector<XMFLOAT3>& positions, const uint32_t* indices, size_t indexCount)
+	{
+		std::map<Edge, int> uses;
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				const XMFLOAT3& p = positions[indices[i + e]];
+				const XMFLOAT3& q = positions[indices[i + (e + 1) % 3]];
+				GridPoint a(p.x, p.z), b(q.x, q.z);
+				uses[a < b ? Edge(a, b) : Edge(b, a)]++;
+			}
+		}
+
+		std::vector<Edge> open;
+		for (std::map<Edge, int>::const_iterator it = uses.begin(); it != uses.end(); ++it)
+		{
+			if (it->second == 1)
+				open.push_back(it->first);
+		}
+		return open;
+	}
+
+	// Seam edges used from one side, as positions
+	std::vector<Edge> SideEdges(const std::vector<XMFLOAT3>& positions, const uint32_t* indices, size_t indexCount,
+		float seam, bool lowSide)
+	{
+		std::vector<Edge> edges;
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			float centerX = (positions[indices[i]].x + positions[indices[i + 1]].x + positions[indices[i + 2]].x) / 3;
+			if ((centerX < seam) != lowSide)
+				continue;
+			for (int e = 0; e < 3; e++)
+			{
+				const XMFLOAT3& p = positions[indices[i + e]];
+				const XMFLOAT3& q = positions[indices[i + (e + 1) % 3]];
+				if (p.x != seam || q.x != seam)
+					continue;
+				GridPoint a(p.x, p.z), b(q.x, q.z);
+				edges.push_back(a < b ? Edge(a, b) : Edge(b, a));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		return edges;
+	}
+}
+
+// Each level has fewer triangles than the last, every index is in range
+// and no triangle has collapsed to a line
+TEST(MeshSimplifierLodChain)
+{
+	std::vector<XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+	SeamedGrid(32, positions, indices);
+	size_t fullCount = indices.size();
+
+	std::vector<MeshLod> lods;
+	MeshSimplifyStats stats;
+	MeshSimplifier::BuildLods(positions.data(), positions.size(), indices, lods, &stats);
+	CHECK(stats.lodCount == lods.size());
+	CHECK(lods.size() == MeshSimplifier::DefaultLodCount);
+	CHECK(stats.lockedVertices > 0);
+	CHECK(lods[0].indexStart == 0 && lods[0].indexCount == fullCount && lods[0].error == 0);
+
+	for (size_t l = 0; l < lods.size(); l++)
+	{
+		const MeshLod& lod = lods[l];
+		CHECK(lod.indexCount > 0 && lod.indexCount % 3 == 0);
+		CHECK(lod.indexStart + lod.indexCount <= indices.size());
+		if (l > 0)
+		{
+			CHECK(lod.indexCount < lods[l - 1].indexCount);
+			CHECK(lod.indexStart == lods[l - 1].indexStart + lods[l - 1].indexCount);
+			CHECK(lod.error >= lods[l - 1].error);
+		}
+
+		for (size_t i = lod.indexStart; i < lod.indexStart + lod.indexCount; i += 3)
+		{
+			uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+			CHECK(a < positions.size() && b < positions.size() && c < positions.size());
+			CHECK(a != b && b != c && a != c);
+		}
+	}
+
+	// The chain got somewhere
+	CHECK(lods.back().indexCount * 4 < fullCount);
+}
+
+// Open borders stay exactly where they were, and seams never tear: each
+// level's open edges are the grid's border, and both sides of the seam
+// share the same edges
+TEST(MeshSimplifierKeepsSeamsAndBorders)
+{
+	std::vector<XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+	SeamedGrid(32, positions, indices);
+	std::vector<Edge> border = OpenEdges(positions, indices.data(), indices.size());
+	CHECK(border.size() == 4 * 32);
+
+	std::vector<MeshLod> lods;
+	MeshSimplifier::BuildLods(positions.data(), positions.size(), indices, lods);
+	for (size_t l = 1; l < lods.size(); l++)
+	{
+		const uint32_t* lod = &indices[lods[l].indexStart];
+		CHECK(OpenEdges(positions, lod, lods[l].indexCount) == border);
+
+		std::vector<Edge> low = SideEdges(positions, lod, lods[l].indexCount, 16.0f, true);
+		std::vector<Edge> high = SideEdges(positions, lod, lods[l].indexCount, 16.0f, false);
+		CHECK(!low.empty());
+		CHECK(low == high);
+	}
+
+	// With no error budget only collapses that leave the surface where it
+	// was can happen
+	std::vector<uint32_t> out(indices.size());
+	float error = -1;
+	size_t written = MeshSimplifier::Simplify(positions.data(), positions.size(), indices.data(), lods[0].indexCount,
+		out.data(), lods[0].indexCount / 4, 0.0f, &error);
+	CHECK(written <= lods[0].indexCount && written % 3 == 0);
+	CHECK(error == 0.0f);
+	CHECK(OpenEdges(positions, out.data(), written) == border);
+}
@@ -0,0 +1,207 @@
+#include "Test.h"
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Triangle
+	{
+		uint32_t a, b, c;
+		bool operator<(const Triangle& other) const
+		{
+			return a != other.a ? a < other.a : b != other.b ? b < other.b : c < other.c;
+		}
+		bool operator==(const Triangle& other) const
+		{
+			return a == other.a && b == other.b && c == other.c;
+		}
+	};
+
+	// Rotated to start at the smallest index, so the winding is kept
+	Triangle Canonical(uint32_t a, uint32_t b, uint32_t c)
+	{
+		if (b < a && b < c)
+			return { b, c, a };
+		if (c < a && c < b)
+			return { c, a, b };
+		return { a, b, c };
+	}
+
+	// A UV sphere, wound so cross(p1 - p0, p2 - p0) points outward
+	void Sphere(int rings, int segments, std::vector<XMFLOAT3>& positions, std::vector<uint32_t>& indices)
+	{
+		for (int r = 0; r <= rings; r++)
+		{
+			float phi = 3.14159265f * r / rings;
+			for (int s = 0; s <= segments; s++)
+			{
+				float theta = 6.28318531f * s / segments;
+				positions.push_back(XMFLOAT3(sinf(phi) * cosf(theta) * 2.0f, cosf(phi) * 2.0f, sinf(phi) * sinf(theta) * 2.0f));
+			}
+		}
+		uint32_t row = (uint32_t)segments + 1;
+		for (uint32_t r = 0; r < (uint32_t)rings; r++)
+		{
+			for (uint32_t s = 0; s < (uint32_t)segments; s++)
+			{
+				uint32_t i = r * row + s;
+				uint32_t quad[6] = { i, i + 1, i + row, i + 1, i + row + 1, i + row };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	// Checks the limits and that every input triangle comes back exactly once
+	void CheckPartition(const std::vector<uint32_t>& indices, const MeshletData& data,
+		size_t vertexCount, size_t maxVertices, size_t maxTriangles)
+	{
+		std::vector<Triangle> expected;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+			expected.push_back(Canonical(indices[i], indices[i + 1], indices[i + 2]));
+		std::sort(expected.begin(), expected.end());
+
+		std::vector<Triangle> found;
+		size_t vertexEntries = 0;
+		for (size_t m = 0; m < data.meshlets.size(); m++)
+		{
+			const Meshlet& meshlet = data.meshlets[m];
+			CHECK(meshlet.vertexCount > 0 && meshlet.vertexCount <= maxVertices);
+			CHECK(meshlet.triangleCount > 0 && meshlet.triangleCount <= maxTriangles);
+			CHECK(meshlet.vertexOffset + meshlet.vertexCount <= data.vertices.size());
+			CHECK(meshlet.triangleOffset + meshlet.triangleCount * 3 <= data.triangles.size());
+			vertexEntries += meshlet.vertexCount;
+
+			// Each meshlet lists its vertices once
+			std::vector<uint32_t> vertices(data.vertices.begin() + meshlet.vertexOffset,
+				data.vertices.begin() + meshlet.vertexOffset + meshlet.vertexCount);
+			std::sort(vertices.begin(), vertices.end());
+			CHECK(std::adjacent_find(vertices.begin(), vertices.end()) == vertices.end());
+
+			for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+			{
+				const uint8_t* local = &data.triangles[meshlet.triangleOffset + t * 3];
+				CHECK(local[0] < meshlet.vertexCount && local[1] < meshlet.vertexCount && local[2] < meshlet.vertexCount);
+				const uint32_t* v = &data.vertices[meshlet.vertexOffset];
+				CHECK(v[local[0]] < vertexCount && v[local[1]] < vertexCount && v[local[2]] < vertexCount);
+				found.push_back(Canonical(v[local[0]], v[local[1]], v[local[2]]));
+			}
+		}
+		CHECK(vertexEntries == data.vertices.size());
+		std::sort(found.begin(), found.end());
+		CHECK(found == expected);
+	}
+}
+
+// Within the limits, and every triangle in exactly one meshlet
+TEST(MeshletBuilderPartition)
+{
+	std::vector<XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+	Sphere(48, 96, positions, indices);
+
+	MeshletData data;
+	MeshletStats stats;
+	MeshletBuilder::Build(positions.data(), positions.size(), indices.data(), indices.size(), data, &stats);
+	CHECK(stats.meshletCount == data.meshlets.size());
+	CHECK(data.meshlets.size() >= indices.size() / 3 / MeshletBuilder::MaxTriangles);
+	CheckPartition(indices, data, positions.size(), MeshletBuilder::MaxVertices, MeshletBuilder::MaxTriangles);
+
+	// Other limits are kept to just the same
+	MeshletData small;
+	MeshletBuilder::Build(positions.data(), positions.size(), indices.data(), indices.size(), small, nullptr, 16, 20);
+	CHECK(small.meshlets.size() > data.meshlets.size());
+	CheckPartition(indices, small, positions.size(), 16, 20);
+}
+
+// The sphere holds every vertex, and the cone every triangle's normal,
+// so a meshlet is only ever called backfacing when all of it is
+TEST(MeshletBuilderBounds)
+{
+	std::vector<XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+	Sphere(24, 48, positions, indices);
+	MeshletData data;
+	MeshletBuilder::Build(positions.data(), positions.size(), indices.data(), indices.size(), data);
+
+	const XMFLOAT3 cameras[6] = {
+		XMFLOAT3(0, 0, -6), XMFLOAT3(5, 1, 0), XMFLOAT3(0, 10, 0),
+		XMFLOAT3(-3, -3, 3), XMFLOAT3(0.5f, 0, 0), XMFLOAT3(30, 20, 10) };
+	size_t cones = 0;
+	size_t culled = 0;
+	for (size_t m = 0; m < data.meshlets.size(); m++)
+	{
+		const Meshlet& meshlet = data.meshlets[m];
+		const uint32_t* vertices = &data.vertices[meshlet.vertexOffset];
+		for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		{
+			XMFLOAT3 offset = Subtract(positions[vertices[i]], meshlet.center);
+			CHECK(sqrtf(Dot(offset, offset)) <= meshlet.radius * 1.0001f);
+		}
+
+		if (meshlet.coneCutoff >= 1.0f)
+			continue;
+		cones++;
+		CHECK(fabsf(Dot(meshlet.coneAxis, meshlet.coneAxis) - 1) < 1e-4f);
+		float minDot = sqrtf(1.0f - meshlet.coneCutoff * meshlet.coneCutoff);
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			const uint8_t* local = &data.triangles[meshlet.triangleOffset + t * 3];
+			const XMFLOAT3& p0 = positions[vertices[local[0]]];
+			XMFLOAT3 normal = Cross(Subtract(positions[vertices[local[1]]], p0), Subtract(positions[vertices[local[2]]], p0));
+			float length = sqrtf(Dot(normal, normal));
+			if (length <= 0.0f)
+				continue;
+			CHECK(Dot(normal, meshlet.coneAxis) / length >= minDot - 1e-4f);
+
+			// Culled from a camera means that camera sees the triangle's back
+			for (int c = 0; c < 6; c++)
+			{
+				if (MeshletBuilder::IsBackfacing(meshlet, cameras[c]))
+					CHECK(Dot(normal, Subtract(p0, cameras[c])) >= 0.0f);
+			}
+		}
+		for (int c = 0; c < 6; c++)
+			culled += MeshletBuilder::IsBackfacing(meshlet, cameras[c]) ? 1 : 0;
+	}
+
+	// Small patches of a sphere have useful cones, and some get culled
+	CHECK(cones > data.meshlets.size() / 2);
+	CHECK(culled > 0);
+}
+
+// The same input always gives the same meshlets
+TEST(MeshletBuilderDeterministic)
+{
+	std::vector<XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+	Sphere(32, 64, positions, indices);
+
+	MeshletData first, second;
+	MeshletBuilder::Build(positions.data(), positions.size(), indices.data(), indices.size(), first);
+	MeshletBuilder::Build(positions.data(), positions.size(), indices.data(), indices.size(), second);
+	CHECK(first.meshlets.size() == second.meshlets.size());
+	CHECK(first.vertices == second.vertices);
+	CHECK(first.triangles == second.triangles);
+	if (first.meshlets.size() == second.meshlets.size())
+		CHECK(memcmp(first.meshlets.data(), second.meshlets.data(), sizeof(Meshlet) * first.meshlets.size()) == 0);
+}
@@ -0,0 +1,156 @@
+#include "Test.h"
+#include "ObjParser.h"
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// A long strip of vertices with faces after each one, using every kind
+	// of index, so the chunk boundaries of a threaded parse fall between
+	// faces and the vertices they refer back to
+	// - expected gets the 0-based corners the faces should resolve to
+	std::string StripObj(int vertexCount, std::vector<ObjCorner>& expected)
+	{
+		std::string text = "# strip\ng strip\n";
+		char line[200];
+		for (int i = 0; i < vertexCount; i++)
+		{
+			snprintf(line, sizeof(line), "v %d.%03d %.6e -%d.5\nvt 0.%04d 1.%04d\nvn 0 %d 1\n",
+				i, i % 1000, i * 0.001f, i % 7, i % 10000, (i * 7) % 10000, i % 3);
+			text += line;
+			if (i < 3)
+				continue;
+
+			// Relative, reaching back a little or (every so often) a long way
+			int back = (i % 50 == 0 && i >= 1500) ? 1500 : 3;
+			snprintf(line, sizeof(line), "f -1/-1/-1 -2/-2/-2 -%d/-%d/-%d\n", back, back, back);
+			text += line;
+			expected.push_back({ i, i, i });
+			expected.push_back({ i - 1, i - 1, i - 1 });
+			expected.push_back({ i + 1 - back, i + 1 - back, i + 1 - back });
+
+			// Absolute, mixed with relative and missing attributes, as a quad
+			snprintf(line, sizeof(line), "f %d//%d -2/-2 %d %d/%d/-1\n", i + 1, i + 1, i - 1, i - 2, i - 2);
+			text += line;
+			ObjCorner a = { i, -1, i }, b = { i - 1, i - 1, -1 }, c = { i - 2, -1, -1 }, d = { i - 3, i - 3, i };
+			expected.push_back(a); expected.push_back(b); expected.push_back(c);
+			expected.push_back(a); expected.push_back(c); expected.push_back(d);
+		}
+		return text;
+	}
+
+	bool SameCorners(const std::vector<ObjCorner>& a, const std::vector<ObjCorner>& b)
+	{
+		if (a.size() != b.size())
+			return false;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			if (a[i].position != b[i].position || a[i].uv != b[i].uv || a[i].normal != b[i].normal)
+				return false;
+		}
+		return true;
+	}
+
+	// Every array, compared bit for bit
+	bool SameData(const ObjData& a, const ObjData& b)
+	{
+		return a.positions.size() == b.positions.size() &&
+			a.uvs.size() == b.uvs.size() &&
+			a.normals.size() == b.normals.size() &&
+			memcmp(a.positions.data(), b.positions.data(), sizeof(ObjFloat3) * a.positions.size()) == 0 &&
+			memcmp(a.uvs.data(), b.uvs.data(), sizeof(ObjFloat2) * a.uvs.size()) == 0 &&
+			memcmp(a.normals.data(), b.normals.data(), sizeof(ObjFloat3) * a.normals.size()) == 0 &&
+			SameCorners(a.corners, b.corners);
+	}
+
+	float Float(const char* text)
+	{
+		const char* cursor = text;
+		return ObjParser::ParseFloat(cursor, text + strlen(text));
+	}
+
+	int Int(const char* text)
+	{
+		const char* cursor = text;
+		return ObjParser::ParseInt(cursor, text + strlen(text));
+	}
+}
+
+// Relative indices have to resolve the same way whichever chunk they land in
+TEST(ObjParserThreadsMatch)
+{
+	std::vector<ObjCorner> expected;
+	std::string text = StripObj(24000, expected);
+	// Enough text that 8 threads each get a full chunk
+	CHECK(text.size() >= ObjParser::MinBytesPerThread * 8);
+
+	ObjData serial;
+	ObjParser::ParseText(text.data(), text.size(), serial, 1);
+	CHECK(serial.positions.size() == 24000);
+	CHECK(serial.uvs.size() == 24000);
+	CHECK(serial.normals.size() == 24000);
+	CHECK(SameCorners(serial.corners, expected));
+
+	const unsigned int threadCounts[3] = { 2, 3, 8 };
+	for (int t = 0; t < 3; t++)
+	{
+		ObjData threaded;
+		ObjParser::ParseText(text.data(), text.size(), threaded, threadCounts[t]);
+		CHECK(SameData(threaded, serial));
+	}
+}
+
+TEST(ObjParserNumbers)
+{
+	CHECK(Float("1.25") == 1.25f);
+	CHECK(Float("  -1.25e-3") == -1.25e-3f);
+	CHECK(Float("+4E2") == 400.0f);
+	// Digits past the 19th only move the exponent
+	CHECK(fabsf(Float("123456789012345678901234") / 1.23456789e23f - 1) < 1e-6f);
+	CHECK(fabsf(Float("0.000000000000000000000000000000000001") / 1e-36f - 1) < 1e-6f);
+
+	// Huge exponents clamp instead of overflowing the exponent sum
+	CHECK(std::isinf(Float("1e99999999999")));
+	CHECK(Float("1e-99999999999") == 0.0f);
+	CHECK(std::isinf(Float("1e2147483647")));
+
+	// Integers stop at INT_MAX rather than wrapping around
+	CHECK(Int("2147483647") == INT_MAX);
+	CHECK(Int("99999999999") == INT_MAX);
+	CHECK(Int("-99999999999") == -INT_MAX);
+	CHECK(Int("-42") == -42);
+}
+
+// Faces the way the old loader didn't read them
+TEST(ObjParserFaces)
+{
+	const char text[] =
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 0 2 0\n"
+		"vn 0 0 1\n"
+		"f 1//1 2//1 3//1 4//1 5//1\n"
+		"f 1 2 99999999999\n"
+		"usemtl ignored\n"
+		"f -1 -2 -3";
+	ObjData data;
+	ObjParser::ParseText(text, sizeof(text) - 1, data, 1);
+	CHECK(data.positions.size() == 5);
+	CHECK(data.corners.size() == 3 * 5);
+
+	// The pentagon as a fan
+	const int fan[9] = { 0, 1, 2, 0, 2, 3, 0, 3, 4 };
+	for (int i = 0; i < 9; i++)
+	{
+		CHECK(data.corners[i].position == fan[i]);
+		CHECK(data.corners[i].uv == -1 && data.corners[i].normal == 0);
+	}
+
+	// A clamped index ends up out of range, not negative
+	CHECK(data.corners[11].position == INT_MAX - 1);
+
+	// The last line has no newline
+	CHECK(data.corners[12].position == 4 && data.corners[14].position == 2);
+}
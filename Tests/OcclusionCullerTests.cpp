@@ -0,0 +1,111 @@
+#include "Test.h"
+#include "OcclusionCuller.h"
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Camera at head height looking down +z, like OcclusionCuller::Benchmark
+	XMFLOAT4X4 ViewProj()
+	{
+		XMFLOAT4X4 viewProj;
+		XMStoreFloat4x4(&viewProj, XMMatrixMultiply(
+			XMMatrixLookToLH(XMVectorSet(0, 1.5f, 0, 0), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0)),
+			XMMatrixPerspectiveFovLH(XM_PIDIV4, (float)OcclusionCuller::DefaultWidth / OcclusionCuller::DefaultHeight, 0.1f, 500.0f)));
+		return viewProj;
+	}
+
+	// A wall 20 units away, covering most of the view
+	// - Occluders only cover pixels they cover entirely, so the pixels along
+	//   the diagonal the two triangles share stay open (boxes behind the
+	//   wall are kept well above it)
+	// - It fits on screen, since clipping would cut it into more triangles
+	//   with more open edges
+	void AddWall(OcclusionCuller& culler)
+	{
+		const XMFLOAT3 positions[4] = { XMFLOAT3(-12, -3, 20), XMFLOAT3(12, -3, 20), XMFLOAT3(-12, 6, 20), XMFLOAT3(12, 6, 20) };
+		const uint32_t indices[6] = { 0, 2, 3, 0, 3, 1 };
+		XMFLOAT4X4 identity;
+		XMStoreFloat4x4(&identity, XMMatrixIdentity());
+		culler.AddOccluder(positions, 4, indices, 6, identity);
+	}
+}
+
+// The benchmark ray casts every box it called occluded, and compares the
+// depth buffer from one thread against many
+TEST(OcclusionCullerBenchmarkChecks)
+{
+	const size_t occluderCounts[3] = { 0, 20, 200 };
+	for (int i = 0; i < 3; i++)
+	{
+		OcclusionBenchmark result = OcclusionCuller::Benchmark(occluderCounts[i], 2000, 4);
+		CHECK(result.falseOcclusions == 0);
+		CHECK(result.threadMismatches == 0);
+		// The wall always hides something, or the checks above prove nothing
+		CHECK(result.occluded > 0);
+	}
+}
+
+TEST(OcclusionCullerWall)
+{
+	OcclusionCuller culler;
+	culler.BeginFrame(ViewProj());
+	AddWall(culler);
+	culler.Rasterize(1);
+
+	CHECK(culler.IsOccluded(XMFLOAT3(-8, 3, 30), XMFLOAT3(-6, 5, 32)));		// Behind the wall
+	CHECK(!culler.IsOccluded(XMFLOAT3(-8, 3, 10), XMFLOAT3(-6, 5, 12)));		// In front of it
+	CHECK(!culler.IsOccluded(XMFLOAT3(-8, 3, 18), XMFLOAT3(-6, 5, 22)));		// Poking through it
+	CHECK(!culler.IsOccluded(XMFLOAT3(-8, 3, -10), XMFLOAT3(-6, 5, -8)));	// Behind the camera
+	CHECK(!culler.IsOccluded(XMFLOAT3(-8, 3, -10), XMFLOAT3(-6, 5, 40)));	// Reaching behind the camera
+	CHECK(culler.GetStats().occluded == 1);
+	CHECK(culler.GetStats().tested == 5);
+
+	// Nothing hides anything in a frame without occluders
+	culler.BeginFrame(ViewProj());
+	culler.Rasterize(1);
+	CHECK(!culler.IsOccluded(XMFLOAT3(-8, 3, 30), XMFLOAT3(-6, 5, 32)));
+}
+
+// Any number of threads has to fill exactly the same depth buffer
+TEST(OcclusionCullerThreadsMatch)
+{
+	const XMFLOAT3 positions[8] =
+	{
+		XMFLOAT3(-3, 0, 10), XMFLOAT3(3, 0, 10), XMFLOAT3(-3, 4, 10), XMFLOAT3(3, 4, 10),
+		XMFLOAT3(-3, 0, 16), XMFLOAT3(3, 0, 16), XMFLOAT3(-3, 4, 16), XMFLOAT3(3, 4, 16)
+	};
+	const uint32_t indices[36] =
+	{
+		0, 2, 3, 0, 3, 1,	4, 5, 7, 4, 7, 6,	0, 1, 5, 0, 5, 4,
+		2, 6, 7, 2, 7, 3,	0, 4, 6, 0, 6, 2,	1, 3, 7, 1, 7, 5
+	};
+
+	std::vector<float> reference;
+	const unsigned int threadCounts[4] = { 1, 2, 3, 8 };
+	for (int t = 0; t < 4; t++)
+	{
+		OcclusionCuller culler;
+		culler.BeginFrame(ViewProj());
+		AddWall(culler);
+		for (int i = 0; i < 50; i++)
+		{
+			XMFLOAT4X4 world;
+			XMStoreFloat4x4(&world, XMMatrixTranslation((float)(i % 10) * 4 - 20, (float)(i / 10) - 2, (float)(i % 7)));
+			culler.AddOccluder(positions, 8, indices, 36, world);
+		}
+		culler.Rasterize(threadCounts[t]);
+
+		std::vector<float> depth;
+		for (int y = 0; y < culler.GetHeight(); y++)
+		{
+			for (int x = 0; x < culler.GetWidth(); x++)
+				depth.push_back(culler.GetDepth(x, y));
+		}
+		if (t == 0)
+			reference = depth;
+		else
+			CHECK(depth == reference);
+	}
+}
@@ -0,0 +1,58 @@
+#include "Test.h"
+#include "Projection.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Depth the projection stores for a point straight ahead
+	float ProjectDepth(const XMFLOAT4X4& proj, float distance)
+	{
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector4Transform(XMVectorSet(0, 0, distance, 1), XMLoadFloat4x4(&proj)));
+		return clip.z / clip.w;
+	}
+}
+
+TEST(ProjectionDepthRanges)
+{
+	XMFLOAT4X4 standard, reverse;
+	XMStoreFloat4x4(&standard, Projection::Standard(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f));
+	CHECK(fabsf(ProjectDepth(standard, 0.1f)) < 1e-6f);
+	CHECK(fabsf(ProjectDepth(standard, 1000.0f) - 1.0f) < 1e-6f);
+
+	// Reverse-Z runs the other way and never reaches 0
+	XMStoreFloat4x4(&reverse, Projection::ReverseZInfinite(XM_PIDIV4, 16.0f / 9.0f, 0.1f));
+	CHECK(fabsf(ProjectDepth(reverse, 0.1f) - 1.0f) < 1e-6f);
+	CHECK(ProjectDepth(reverse, 1000.0f) > 0.0f);
+	CHECK(ProjectDepth(reverse, 1e30f) >= 0.0f);
+	CHECK(ProjectDepth(reverse, 1000.0f) < ProjectDepth(reverse, 10.0f));
+}
+
+// Past the near plane, reverse-Z into a float buffer has to tell distances
+// apart more finely than either standard buffer at every distance tested
+// - At the near plane itself all three are as fine as a float allows, so
+//   only the worst case is compared there
+TEST(ProjectionReverseZIsFiner)
+{
+	const float clips[3][2] = { { 1.0f, 1000.0f }, { 0.1f, 1000.0f }, { 0.01f, 10000.0f } };
+	for (int c = 0; c < 3; c++)
+	{
+		DepthPrecisionReport report = Projection::MeasureDepthPrecision(clips[c][0], clips[c][1], 9);
+		CHECK(report.samples.size() == 9);
+		for (size_t i = 1; i < report.samples.size(); i++)
+		{
+			const DepthPrecisionSample& sample = report.samples[i];
+			CHECK(sample.reverseFloatStep > 0);
+			CHECK(sample.reverseFloatStep < sample.standard24Step);
+			CHECK(sample.reverseFloatStep < sample.standardFloatStep);
+			// A float's relative precision, near or far
+			CHECK(sample.reverseFloatStep / sample.distance < 2.5e-7);
+		}
+
+		CHECK(report.worstReverseFloat < report.worstStandard24);
+		CHECK(report.worstReverseFloat < report.worstStandardFloat);
+		CHECK(report.Gain() > 100);
+	}
+}
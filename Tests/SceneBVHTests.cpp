@@ -0,0 +1,265 @@
+#include "Test.h"
+#include "SceneBVH.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Boxes
+	{
+		std::vector<XMFLOAT3> mins, maxs;
+
+		void Add(const XMFLOAT3& center, const XMFLOAT3& extent)
+		{
+			mins.push_back(XMFLOAT3(center.x - extent.x, center.y - extent.y, center.z - extent.z));
+			maxs.push_back(XMFLOAT3(center.x + extent.x, center.y + extent.y, center.z + extent.z));
+		}
+		size_t Count() const { return mins.size(); }
+	};
+
+	float Random(uint32_t& seed, float lo, float hi)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return lo + (hi - lo) * ((seed >> 8) / 16777216.0f);
+	}
+
+	// Random boxes filling a cube, like SceneBVH::Benchmark
+	Boxes RandomBoxes(size_t count, uint32_t& seed)
+	{
+		Boxes boxes;
+		for (size_t i = 0; i < count; i++)
+		{
+			XMFLOAT3 center(Random(seed, -500, 500), Random(seed, -500, 500), Random(seed, -500, 500));
+			boxes.Add(center, XMFLOAT3(Random(seed, 0.25f, 2.5f), Random(seed, 0.25f, 2.5f), Random(seed, 0.25f, 2.5f)));
+		}
+		return boxes;
+	}
+
+	Frustum CameraFrustum()
+	{
+		XMFLOAT4X4 view, proj;
+		XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(0, 0, -100, 0), XMVectorSet(0.3f, 0.1f, 1, 0), XMVectorSet(0, 1, 0, 0)));
+		XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f));
+		return Frustum::FromCamera(view, proj);
+	}
+
+	// Brute force versions of each query, written out separately from SceneBVH's
+	bool BoxInFrustum(const Frustum& frustum, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+	{
+		for (int p = 0; p < 6; p++)
+		{
+			const XMFLOAT4& plane = frustum.planes[p];
+			float centerX = (boxMin.x + boxMax.x) * 0.5f, extentX = (boxMax.x - boxMin.x) * 0.5f;
+			float centerY = (boxMin.y + boxMax.y) * 0.5f, extentY = (boxMax.y - boxMin.y) * 0.5f;
+			float centerZ = (boxMin.z + boxMax.z) * 0.5f, extentZ = (boxMax.z - boxMin.z) * 0.5f;
+			float distance = centerX * plane.x + centerY * plane.y + centerZ * plane.z + plane.w;
+			float reach = extentX * fabsf(plane.x) + extentY * fabsf(plane.y) + extentZ * fabsf(plane.z);
+			if (distance < -reach)
+				return false;
+		}
+		return true;
+	}
+
+	bool BoxTouchesSphere(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, const XMFLOAT3& center, float radius)
+	{
+		float dx = fmaxf(fmaxf(boxMin.x - center.x, center.x - boxMax.x), 0.0f);
+		float dy = fmaxf(fmaxf(boxMin.y - center.y, center.y - boxMax.y), 0.0f);
+		float dz = fmaxf(fmaxf(boxMin.z - center.z, center.z - boxMax.z), 0.0f);
+		return dx * dx + dy * dy + dz * dz <= radius * radius;
+	}
+
+	bool BoxTouchesBox(const XMFLOAT3& aMin, const XMFLOAT3& aMax, const XMFLOAT3& bMin, const XMFLOAT3& bMax)
+	{
+		return aMin.x <= bMax.x && aMax.x >= bMin.x &&
+			aMin.y <= bMax.y && aMax.y >= bMin.y &&
+			aMin.z <= bMax.z && aMax.z >= bMin.z;
+	}
+
+	float RayEntersBox(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, const XMFLOAT3& boxMin, const XMFLOAT3& boxMax)
+	{
+		XMFLOAT3 inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+		float x0 = (boxMin.x - origin.x) * inverse.x, x1 = (boxMax.x - origin.x) * inverse.x;
+		float y0 = (boxMin.y - origin.y) * inverse.y, y1 = (boxMax.y - origin.y) * inverse.y;
+		float z0 = (boxMin.z - origin.z) * inverse.z, z1 = (boxMax.z - origin.z) * inverse.z;
+		float enter = fmaxf(fmaxf(fminf(x0, x1), fminf(y0, y1)), fmaxf(fminf(z0, z1), 0.0f));
+		float exit = fminf(fminf(fmaxf(x0, x1), fmaxf(y0, y1)), fminf(fmaxf(z0, z1), maxDistance));
+		return enter <= exit ? enter : -1.0f;
+	}
+
+	// The tree's results come in no particular order
+	bool SameItems(std::vector<uint32_t> a, std::vector<uint32_t> b)
+	{
+		std::sort(a.begin(), a.end());
+		std::sort(b.begin(), b.end());
+		return a == b;
+	}
+
+	// Runs every kind of query through the tree and by brute force
+	void CheckQueries(const SceneBVH& bvh, const Boxes& boxes, uint32_t& seed)
+	{
+		std::vector<uint32_t> found, brute;
+		Frustum frustum = CameraFrustum();
+		bvh.QueryFrustum(frustum, found);
+		brute.clear();
+		for (size_t i = 0; i < boxes.Count(); i++)
+		{
+			if (BoxInFrustum(frustum, boxes.mins[i], boxes.maxs[i]))
+				brute.push_back((uint32_t)i);
+		}
+		CHECK(SameItems(found, brute));
+
+		for (int q = 0; q < 50; q++)
+		{
+			XMFLOAT3 point(Random(seed, -500, 500), Random(seed, -500, 500), Random(seed, -500, 500));
+
+			// Sphere
+			float radius = Random(seed, 1, 60);
+			bvh.QuerySphere(point, radius, found);
+			brute.clear();
+			for (size_t i = 0; i < boxes.Count(); i++)
+			{
+				if (BoxTouchesSphere(boxes.mins[i], boxes.maxs[i], point, radius))
+					brute.push_back((uint32_t)i);
+			}
+			CHECK(SameItems(found, brute));
+
+			// Box
+			XMFLOAT3 queryMin(point.x - radius, point.y - radius * 0.5f, point.z - radius * 2);
+			XMFLOAT3 queryMax(point.x + radius, point.y + radius * 0.5f, point.z + radius * 2);
+			bvh.QueryBox(queryMin, queryMax, found);
+			brute.clear();
+			for (size_t i = 0; i < boxes.Count(); i++)
+			{
+				if (BoxTouchesBox(boxes.mins[i], boxes.maxs[i], queryMin, queryMax))
+					brute.push_back((uint32_t)i);
+			}
+			CHECK(SameItems(found, brute));
+
+			// Ray, where ties go to the lowest item
+			XMFLOAT3 direction(Random(seed, -1, 1), Random(seed, -1, 1), Random(seed, -1, 1));
+			float closest = 2000.0f;
+			bool bruteHit = false;
+			uint32_t bruteItem = 0;
+			for (size_t i = 0; i < boxes.Count(); i++)
+			{
+				float t = RayEntersBox(point, direction, closest, boxes.mins[i], boxes.maxs[i]);
+				if (t >= 0.0f && (!bruteHit || t < closest))
+				{
+					closest = t;
+					bruteItem = (uint32_t)i;
+					bruteHit = true;
+				}
+			}
+			uint32_t item = 0;
+			float distance = 0;
+			bool hit = bvh.Raycast(point, direction, 2000.0f, item, distance);
+			CHECK(hit == bruteHit);
+			if (hit && bruteHit)
+			{
+				CHECK(item == bruteItem);
+				CHECK(distance == closest);
+			}
+		}
+	}
+}
+
+TEST(SceneBVHQueriesMatchBruteForce)
+{
+	uint32_t seed = 12345;
+	const size_t counts[4] = { 1, 5, 1000, 20000 };
+	for (int c = 0; c < 4; c++)
+	{
+		Boxes boxes = RandomBoxes(counts[c], seed);
+		SceneBVH bvh;
+		bvh.Build(&boxes.mins[0], &boxes.maxs[0], boxes.Count());
+		CHECK(bvh.GetCount() == boxes.Count());
+		CHECK(bvh.GetStats().leafCount > 0);
+		CheckQueries(bvh, boxes, seed);
+	}
+}
+
+TEST(SceneBVHEmpty)
+{
+	SceneBVH bvh;
+	bvh.Build(nullptr, nullptr, 0);
+	std::vector<uint32_t> found(3);
+	CHECK(bvh.QueryFrustum(CameraFrustum(), found) == 0 && found.empty());
+	CHECK(bvh.QuerySphere(XMFLOAT3(0, 0, 0), 1000, found) == 0);
+	uint32_t item;
+	float distance;
+	CHECK(!bvh.Raycast(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), 1000, item, distance));
+}
+
+// Moving items refits (and sometimes rebuilds) the tree, which has to
+// keep answering the same as brute force
+TEST(SceneBVHRefitAndAdd)
+{
+	uint32_t seed = 777;
+	Boxes boxes = RandomBoxes(5000, seed);
+	SceneBVH bvh;
+	bvh.Build(&boxes.mins[0], &boxes.maxs[0], boxes.Count());
+
+	for (int frame = 0; frame < 20; frame++)
+	{
+		// Bigger moves each frame, so refits eventually trigger a rebuild
+		float reach = 2.0f + frame * 10.0f;
+		for (size_t i = frame; i < boxes.Count(); i += 37)
+		{
+			XMFLOAT3 offset(Random(seed, -reach, reach), Random(seed, -reach, reach), Random(seed, -reach, reach));
+			boxes.mins[i] = XMFLOAT3(boxes.mins[i].x + offset.x, boxes.mins[i].y + offset.y, boxes.mins[i].z + offset.z);
+			boxes.maxs[i] = XMFLOAT3(boxes.maxs[i].x + offset.x, boxes.maxs[i].y + offset.y, boxes.maxs[i].z + offset.z);
+			bvh.Update((uint32_t)i, boxes.mins[i], boxes.maxs[i]);
+		}
+		bvh.Refit();
+		CheckQueries(bvh, boxes, seed);
+	}
+	CHECK(bvh.GetStats().refits > 0);
+	CHECK(bvh.GetStats().rebuilds > 1);
+
+	// Added items show up after the next Refit
+	for (int i = 0; i < 10; i++)
+	{
+		boxes.Add(XMFLOAT3(Random(seed, -500, 500), 0, 0), XMFLOAT3(1, 1, 1));
+		CHECK(bvh.Add(boxes.mins.back(), boxes.maxs.back()) == boxes.Count() - 1);
+	}
+	bvh.Refit();
+	CheckQueries(bvh, boxes, seed);
+}
+
+// Boxes all in one spot can't be split by position, and boxes whose
+// centers grow further apart each time only split off the farthest few at
+// a time, making a tree far deeper than a balanced one
+TEST(SceneBVHDegenerateScenes)
+{
+	uint32_t seed = 99;
+	Boxes stacked;
+	for (int i = 0; i < 1000; i++)
+		stacked.Add(XMFLOAT3(10, 10, 10), XMFLOAT3(1, 1, 1));
+	SceneBVH bvh;
+	bvh.Build(&stacked.mins[0], &stacked.maxs[0], stacked.Count());
+	CHECK(bvh.GetStats().depth <= 12);
+	CheckQueries(bvh, stacked, seed);
+
+	Boxes spread;
+	float x = 1.0f;
+	for (int i = 0; i < 700; i++, x *= 1.1f)
+		spread.Add(XMFLOAT3(x, 0, 0), XMFLOAT3(0.5f, 0.5f, 0.5f));
+	bvh.Build(&spread.mins[0], &spread.maxs[0], spread.Count());
+	CHECK(bvh.GetStats().depth > 20);
+	std::vector<uint32_t> found;
+	CHECK(bvh.QueryBox(XMFLOAT3(-FLT_MAX, -1, -1), XMFLOAT3(FLT_MAX, 1, 1), found) == spread.Count());
+	uint32_t item = 0;
+	float distance = 0;
+	CHECK(bvh.Raycast(XMFLOAT3(-10, 0, 0), XMFLOAT3(1, 0, 0), FLT_MAX, item, distance) && item == 0);
+}
+
+// The benchmark's own comparison
+TEST(SceneBVHBenchmarkMismatches)
+{
+	CHECK(SceneBVH::Benchmark(1000).mismatches == 0);
+	CHECK(SceneBVH::Benchmark(100000).mismatches == 0);
+}
@@ -0,0 +1,209 @@
+#include "Test.h"
+#include "ShaderReflectionCache.h"
+#include <cstring>
+
+namespace
+{
+	// Stands in for a compiled shader, which sidecars are tied to
+	const char Blob[] = "DXBC pretend compiled shader";
+	const char OtherBlob[] = "DXBC another compiled shader";
+
+	ShaderReflectionCache Tables()
+	{
+		ShaderReflectionCache tables;
+		tables.constantBuffers.resize(2);
+		tables.constantBuffers[0].name = "externalData";
+		tables.constantBuffers[0].size = 224;
+		tables.constantBuffers[0].variables.resize(2);
+		tables.constantBuffers[0].variables[0].name = "cameraPos";
+		tables.constantBuffers[0].variables[0].byteOffset = 112;
+		tables.constantBuffers[0].variables[0].size = 12;
+		tables.constantBuffers[0].variables[1].name = "specExponent";
+		tables.constantBuffers[0].variables[1].byteOffset = 124;
+		tables.constantBuffers[0].variables[1].size = 4;
+		tables.constantBuffers[1].name = "perFrame";
+		tables.constantBuffers[1].type = 1;
+		tables.constantBuffers[1].size = 64;
+		tables.constantBuffers[1].bindIndex = 1;
+
+		tables.textures.resize(2);
+		tables.textures[0].name = "Albedo";
+		tables.textures[1].name = "NormalMap";
+		tables.textures[1].bindIndex = 1;
+		tables.samplers.resize(1);
+		tables.samplers[0].name = "samplerOptions";
+
+		tables.inputParameters.resize(1);
+		tables.inputParameters[0].semanticName = "POSITION";
+		tables.inputParameters[0].componentType = 3;
+		tables.inputParameters[0].mask = 7;
+		return tables;
+	}
+
+	bool Same(const ShaderReflectionCache& a, const ShaderReflectionCache& b)
+	{
+		if (a.constantBuffers.size() != b.constantBuffers.size() ||
+			a.textures.size() != b.textures.size() ||
+			a.samplers.size() != b.samplers.size() ||
+			a.inputParameters.size() != b.inputParameters.size())
+			return false;
+
+		for (size_t i = 0; i < a.constantBuffers.size(); i++)
+		{
+			const ReflectedConstantBuffer& x = a.constantBuffers[i];
+			const ReflectedConstantBuffer& y = b.constantBuffers[i];
+			if (x.name != y.name || x.type != y.type || x.size != y.size ||
+				x.bindIndex != y.bindIndex || x.variables.size() != y.variables.size())
+				return false;
+			for (size_t v = 0; v < x.variables.size(); v++)
+			{
+				if (x.variables[v].name != y.variables[v].name ||
+					x.variables[v].byteOffset != y.variables[v].byteOffset ||
+					x.variables[v].size != y.variables[v].size)
+					return false;
+			}
+		}
+
+		for (size_t i = 0; i < a.textures.size(); i++)
+		{
+			if (a.textures[i].name != b.textures[i].name || a.textures[i].bindIndex != b.textures[i].bindIndex)
+				return false;
+		}
+		for (size_t i = 0; i < a.samplers.size(); i++)
+		{
+			if (a.samplers[i].name != b.samplers[i].name || a.samplers[i].bindIndex != b.samplers[i].bindIndex)
+				return false;
+		}
+		for (size_t i = 0; i < a.inputParameters.size(); i++)
+		{
+			const ReflectedInputParameter& x = a.inputParameters[i];
+			const ReflectedInputParameter& y = b.inputParameters[i];
+			if (x.semanticName != y.semanticName || x.semanticIndex != y.semanticIndex ||
+				x.componentType != y.componentType || x.mask != y.mask)
+				return false;
+		}
+		return true;
+	}
+
+	bool Empty(const ShaderReflectionCache& tables)
+	{
+		return tables.constantBuffers.empty() && tables.textures.empty() &&
+			tables.samplers.empty() && tables.inputParameters.empty();
+	}
+
+	// Reads a sidecar into tables that already hold something, so a
+	// rejection can be seen to leave them empty
+	bool Load(const std::vector<char>& sidecar, const void* blob, size_t blobSize, ShaderReflectionCache& tables)
+	{
+		tables = Tables();
+		return tables.Deserialize(sidecar.data(), sidecar.size(), blob, blobSize);
+	}
+
+	// Fixes up the header after the tables were tampered with, so only the
+	// tables themselves are wrong
+	void Rehash(std::vector<char>& sidecar)
+	{
+		ShaderReflectionCacheHeader header;
+		memcpy(&header, sidecar.data(), sizeof(header));
+		header.dataSize = (uint32_t)(sidecar.size() - sizeof(header));
+		header.contentHash = ShaderReflectionCache::Hash(sidecar.data() + sizeof(header), header.dataSize);
+		memcpy(sidecar.data(), &header, sizeof(header));
+	}
+}
+
+TEST(ShaderReflectionCacheRoundTrip)
+{
+	ShaderReflectionCache tables = Tables();
+	std::vector<char> sidecar = tables.Serialize(Blob, sizeof(Blob));
+	CHECK(sidecar.size() > sizeof(ShaderReflectionCacheHeader));
+
+	ShaderReflectionCache loaded;
+	CHECK(loaded.Deserialize(sidecar.data(), sidecar.size(), Blob, sizeof(Blob)));
+	CHECK(Same(loaded, tables));
+
+	// Nothing at all reflected is still a good sidecar
+	ShaderReflectionCache empty;
+	sidecar = empty.Serialize(Blob, sizeof(Blob));
+	CHECK(Load(sidecar, Blob, sizeof(Blob), loaded));
+	CHECK(Empty(loaded));
+}
+
+TEST(ShaderReflectionCacheRejectsTruncated)
+{
+	std::vector<char> sidecar = Tables().Serialize(Blob, sizeof(Blob));
+	ShaderReflectionCache loaded;
+	for (size_t size = 0; size < sidecar.size(); size++)
+	{
+		std::vector<char> truncated(sidecar.begin(), sidecar.begin() + size);
+		CHECK(!Load(truncated, Blob, sizeof(Blob), loaded));
+		CHECK(Empty(loaded));
+	}
+
+	// Or cut short with a header that agrees
+	std::vector<char> shortened(sidecar.begin(), sidecar.end() - 1);
+	Rehash(shortened);
+	CHECK(!Load(shortened, Blob, sizeof(Blob), loaded));
+	CHECK(Empty(loaded));
+
+	// Or with extra bytes after the tables
+	std::vector<char> longer = sidecar;
+	longer.push_back(0);
+	CHECK(!Load(longer, Blob, sizeof(Blob), loaded));
+	Rehash(longer);
+	CHECK(!Load(longer, Blob, sizeof(Blob), loaded));
+	CHECK(Empty(loaded));
+}
+
+TEST(ShaderReflectionCacheRejectsBadHeader)
+{
+	std::vector<char> sidecar = Tables().Serialize(Blob, sizeof(Blob));
+	ShaderReflectionCache loaded;
+
+	std::vector<char> badMagic = sidecar;
+	badMagic[0] = 'X';
+	CHECK(!Load(badMagic, Blob, sizeof(Blob), loaded));
+	CHECK(Empty(loaded));
+
+	std::vector<char> badVersion = sidecar;
+	ShaderReflectionCacheHeader header;
+	memcpy(&header, badVersion.data(), sizeof(header));
+	header.version = ShaderReflectionCache::Version + 1;
+	memcpy(badVersion.data(), &header, sizeof(header));
+	CHECK(!Load(badVersion, Blob, sizeof(Blob), loaded));
+	CHECK(Empty(loaded));
+}
+
+// A sidecar for any other shader, even one the same size, is ignored
+TEST(ShaderReflectionCacheRejectsWrongBlob)
+{
+	std::vector<char> sidecar = Tables().Serialize(Blob, sizeof(Blob));
+	ShaderReflectionCache loaded;
+	CHECK(sizeof(OtherBlob) == sizeof(Blob));
+	CHECK(!Load(sidecar, OtherBlob, sizeof(OtherBlob), loaded));
+	CHECK(Empty(loaded));
+	CHECK(!Load(sidecar, Blob, sizeof(Blob) - 1, loaded));
+	CHECK(Empty(loaded));
+}
+
+TEST(ShaderReflectionCacheRejectsContentHashMismatch)
+{
+	std::vector<char> sidecar = Tables().Serialize(Blob, sizeof(Blob));
+	ShaderReflectionCache loaded;
+
+	// Every changed byte in the tables is caught by the hash
+	for (size_t i = sizeof(ShaderReflectionCacheHeader); i < sidecar.size(); i++)
+	{
+		std::vector<char> corrupt = sidecar;
+		corrupt[i] ^= 0x20;
+		CHECK(!Load(corrupt, Blob, sizeof(Blob), loaded));
+		CHECK(Empty(loaded));
+	}
+
+	// A count bigger than the data left fails even when the hash agrees
+	std::vector<char> badCount = sidecar;
+	uint32_t count = 0xFFFFFFFFu;
+	memcpy(badCount.data() + sizeof(ShaderReflectionCacheHeader), &count, sizeof(count));
+	Rehash(badCount);
+	CHECK(!Load(badCount, Blob, sizeof(Blob), loaded));
+	CHECK(Empty(loaded));
+}
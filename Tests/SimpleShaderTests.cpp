@@ -0,0 +1,183 @@
+#include "Test.h"
+#include "SimpleShader.h"
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Records which buffers go up instead of sending them anywhere
+	// - Buffers are told apart by their local data, since a shader without
+	//   a device has no GPU buffers
+	class MockUploader : public ISimpleBufferUploader
+	{
+	public:
+		std::vector<const void*> uploads;
+		size_t slices = 0;
+		void Upload(ID3D11Buffer*, const void* data, unsigned int) { uploads.push_back(data); }
+		void UploadSlice(ID3D11Buffer*, unsigned int, const void*, unsigned int, bool) { slices++; }
+	};
+
+	// A shader set up straight from reflected tables, with no device,
+	// context or compiled shader
+	class ReflectedShader : public ISimpleShader
+	{
+	public:
+		ReflectedShader(const ShaderReflectionCache& tables)
+			: ISimpleShader(0, 0)
+		{
+			reflection = tables;
+			BuildTables();
+			shaderValid = true;
+		}
+		~ReflectedShader() { CleanUp(); }
+
+	protected:
+		bool CreateShader(ID3DBlob*) { return true; }
+		void SetShaderAndCBs() {}
+		void BindShaderResourceView(unsigned int, ID3D11ShaderResourceView*) {}
+		void BindSamplerState(unsigned int, ID3D11SamplerState*) {}
+		void BindConstantBufferRange(unsigned int, ID3D11Buffer*, unsigned int, unsigned int) {}
+	};
+
+	ReflectedVariable Variable(const char* name, uint32_t byteOffset, uint32_t size)
+	{
+		ReflectedVariable variable;
+		variable.name = name;
+		variable.byteOffset = byteOffset;
+		variable.size = size;
+		return variable;
+	}
+
+	// Laid out like the pixel and vertex shader buffers
+	// - "yaczf" and "glbpp" have the same hash
+	ShaderReflectionCache Tables()
+	{
+		ShaderReflectionCache tables;
+		tables.constantBuffers.resize(2);
+		tables.constantBuffers[0].name = "externalData";
+		tables.constantBuffers[0].size = 32;
+		tables.constantBuffers[0].variables.push_back(Variable("cameraPos", 0, 12));
+		tables.constantBuffers[0].variables.push_back(Variable("specExponent", 12, 4));
+		tables.constantBuffers[0].variables.push_back(Variable("yaczf", 16, 4));
+		tables.constantBuffers[0].variables.push_back(Variable("glbpp", 20, 4));
+		tables.constantBuffers[1].name = "perFrame";
+		tables.constantBuffers[1].size = 64;
+		tables.constantBuffers[1].bindIndex = 1;
+		tables.constantBuffers[1].variables.push_back(Variable("viewProjMatrix", 0, 64));
+
+		ReflectedResource albedo;
+		albedo.name = "Albedo";
+		albedo.bindIndex = 2;
+		tables.textures.push_back(albedo);
+		return tables;
+	}
+}
+
+// Only buffers whose bytes changed since their last copy go up
+TEST(SimpleShaderUploadsChangedBuffers)
+{
+	ReflectedShader shader(Tables());
+	MockUploader uploader;
+	shader.SetBufferUploader(&uploader);
+	const void* externalData = shader.GetBufferInfo(0u)->LocalDataBuffer;
+	const void* perFrame = shader.GetBufferInfo(1u)->LocalDataBuffer;
+	ISimpleShader::ResetUploadStats();
+
+	// Everything goes up the first time
+	shader.CopyAllBufferData();
+	CHECK(uploader.uploads.size() == 2);
+	shader.CopyAllBufferData();
+	CHECK(uploader.uploads.size() == 2);
+
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, XMMatrixIdentity());
+	CHECK(shader.SetMatrix4x4("viewProjMatrix"_ssn, viewProj));
+	shader.CopyAllBufferData();
+	CHECK(uploader.uploads.size() == 3 && uploader.uploads[2] == perFrame);
+
+	// Setting the values already there changes nothing
+	CHECK(shader.SetMatrix4x4("viewProjMatrix"_ssn, viewProj));
+	CHECK(shader.SetFloat("specExponent", 0.0f));
+	shader.CopyAllBufferData();
+	CHECK(uploader.uploads.size() == 3);
+
+	// Copying one buffer leaves the others dirty
+	CHECK(shader.SetFloat("specExponent", 2.0f));
+	shader.CopyBufferData("perFrame");
+	CHECK(uploader.uploads.size() == 3);
+	shader.CopyBufferData(0u);
+	CHECK(uploader.uploads.size() == 4 && uploader.uploads[3] == externalData);
+
+	const SimpleUploadStats& stats = ISimpleShader::GetUploadStats();
+	CHECK(stats.uploads == 4);
+	CHECK(stats.skipped == 6);
+	CHECK(stats.bytesUploaded == 32 + 64 + 64 + 32);
+}
+
+// Strings, hashed names and handles all reach the same variable
+TEST(SimpleShaderNamesAndHandles)
+{
+	ReflectedShader shader(Tables());
+	SimpleVariableHandle cameraPos = shader.GetVariableHandle("cameraPos");
+	CHECK(cameraPos.IsValid() && cameraPos.ByteOffset == 0 && cameraPos.Size == 12);
+	CHECK(shader.GetVariableHandle("cameraPos"_ssn).ByteOffset == cameraPos.ByteOffset);
+	CHECK(!shader.GetVariableHandle("cameraPosition"_ssn).IsValid());
+	CHECK(!shader.SetFloat("nope"_ssn, 1.0f));
+	CHECK(!shader.SetMatrix4x4("cameraPos"_ssn, XMFLOAT4X4()));
+
+	const float* data = (const float*)shader.GetBufferInfo(0u)->LocalDataBuffer;
+	CHECK(shader.SetFloat3("cameraPos"_ssn, XMFLOAT3(1, 2, 3)));
+	CHECK(data[0] == 1 && data[1] == 2 && data[2] == 3);
+	CHECK(shader.SetFloat3(cameraPos, XMFLOAT3(4, 5, 6)));
+	CHECK(data[0] == 4 && data[1] == 5 && data[2] == 6);
+
+	// Names whose hashes collide still find their own variables
+	CHECK(("yaczf"_ssn).Hash == ("glbpp"_ssn).Hash);
+	CHECK(shader.GetVariableHandle("yaczf"_ssn).ByteOffset == 16);
+	CHECK(shader.GetVariableHandle("glbpp"_ssn).ByteOffset == 20);
+
+	CHECK(shader.GetShaderResourceViewHandle("Albedo"_ssn).BindIndex == 2);
+	CHECK(!shader.GetShaderResourceViewHandle("NormalMap"_ssn).IsValid());
+	CHECK(!shader.GetSamplerHandle("samplerOptions"_ssn).IsValid());
+}
+
+// The setter benchmark works on a copy, so the shader keeps its values
+TEST(SimpleShaderBenchmarkKeepsValues)
+{
+	ReflectedShader shader(Tables());
+	MockUploader uploader;
+	shader.SetBufferUploader(&uploader);
+	CHECK(shader.SetFloat3("cameraPos"_ssn, XMFLOAT3(1, 2, 3)));
+	shader.CopyAllBufferData();
+
+	SimpleShaderSetBenchmark result = shader.BenchmarkSetters("cameraPos", 1001);
+	CHECK(result.sets == 1001);
+	const float* data = (const float*)shader.GetBufferInfo(0u)->LocalDataBuffer;
+	CHECK(data[0] == 1 && data[1] == 2 && data[2] == 3);
+	shader.CopyAllBufferData();
+	CHECK(uploader.uploads.size() == 2);
+}
+
+// Copies that don't fit in a constant allocator go to the shader's own
+// buffers through the uploader too
+// - Without a device the allocator can't make its buffer, so nothing fits
+TEST(SimpleShaderAllocatorOverflowUsesUploader)
+{
+	ReflectedShader shader(Tables());
+	MockUploader uploader;
+	SimpleConstantAllocator allocator(0, 0);
+	CHECK(!allocator.IsValid());
+	shader.SetBufferUploader(&uploader);
+	shader.SetConstantAllocator(&allocator);
+
+	shader.CopyAllBufferData();
+	CHECK(uploader.uploads.size() == 2);
+	CHECK(uploader.slices == 0);
+	CHECK(shader.GetBufferInfo(0u)->ConstantCount == 0);
+
+	// A new frame means the data has to go up again
+	allocator.BeginFrame();
+	shader.CopyAllBufferData();
+	CHECK(uploader.uploads.size() == 4);
+}
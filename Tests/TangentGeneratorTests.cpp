@@ -0,0 +1,135 @@
+#include "Test.h"
+#include "TangentGenerator.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// A bumpy size x size grid of quads in the XZ plane, with v running
+	// along +Z and u along +X, or along -X when mirrored
+	// - Each grid gets its own vertices, so mirrored and unmirrored
+	//   triangles never share one
+	void AddGrid(int size, bool mirrored, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		unsigned int base = (unsigned int)verts.size();
+		for (int z = 0; z <= size; z++)
+		{
+			for (int x = 0; x <= size; x++)
+			{
+				// Height is sin(x/3) * cos(z/5), with its matching normal
+				float height = sinf(x / 3.0f) * cosf(z / 5.0f);
+				float dx = cosf(x / 3.0f) * cosf(z / 5.0f) / 3.0f;
+				float dz = -sinf(x / 3.0f) * sinf(z / 5.0f) / 5.0f;
+				Vertex v = {};
+				v.Position = XMFLOAT3((float)x, height, (float)z);
+				XMStoreFloat3(&v.Normal, XMVector3Normalize(XMVectorSet(-dx, 1, -dz, 0)));
+				float u = (float)x / size;
+				v.UV = XMFLOAT2(mirrored ? 1 - u : u, (float)z / size);
+				verts.push_back(v);
+			}
+		}
+
+		unsigned int row = (unsigned int)size + 1;
+		for (unsigned int z = 0; z < (unsigned int)size; z++)
+		{
+			for (unsigned int x = 0; x < (unsigned int)size; x++)
+			{
+				unsigned int i = base + z * row + x;
+				unsigned int quad[6] = { i, i + row, i + 1, i + 1, i + row, i + row + 1 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	float Dot(const XMFLOAT4& a, const XMFLOAT4& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+}
+
+// The vectorized path agrees with the scalar reference, and mirrored UVs
+// flip the handedness so the bitangent rebuilt in the shaders still
+// follows v
+// - With Y up, cross(N, T) for an unmirrored grid points along -Z, so
+//   that grid is the one with a w of -1
+TEST(TangentGeneratorMatchesScalar)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	AddGrid(40, false, verts, indices);
+	size_t mirrorStart = verts.size();
+	AddGrid(40, true, verts, indices);
+
+	// Plus one triangle with no UV area, whose vertices need a made up tangent
+	Vertex flat = verts[0];
+	unsigned int flatStart = (unsigned int)verts.size();
+	verts.push_back(flat);
+	flat.Position.x += 1;
+	verts.push_back(flat);
+	flat.Position.z += 1;
+	verts.push_back(flat);
+	indices.push_back(flatStart);
+	indices.push_back(flatStart + 1);
+	indices.push_back(flatStart + 2);
+
+	std::vector<Vertex> scalar = verts;
+	std::vector<Vertex> simd = verts;
+	TangentStats scalarStats, simdStats;
+	TangentGenerator::GenerateScalar(scalar.data(), scalar.size(), indices.data(), indices.size(), &scalarStats);
+	TangentGenerator::Generate(simd.data(), simd.size(), indices.data(), indices.size(), 1, &simdStats);
+	CHECK(scalarStats.degenerateTriangles == 1 && simdStats.degenerateTriangles == 1);
+	CHECK(scalarStats.fallbackVertices == 3 && simdStats.fallbackVertices == 3);
+
+	for (size_t i = 0; i < verts.size(); i++)
+	{
+		const XMFLOAT4& a = scalar[i].Tangent;
+		const XMFLOAT4& b = simd[i].Tangent;
+		CHECK(Dot(a, b) > 0.99999f);
+		CHECK(a.w == b.w);
+		CHECK(b.w == 1.0f || b.w == -1.0f);
+
+		// Unit length and at right angles to the normal
+		XMVECTOR tangent = XMLoadFloat4(&b);
+		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+		CHECK(fabsf(XMVectorGetX(XMVector3Length(tangent)) - 1) < 1e-5f);
+		CHECK(fabsf(XMVectorGetX(XMVector3Dot(tangent, normal))) < 1e-5f);
+		if (i >= flatStart)
+			continue;
+
+		// u runs along the tangent, and cross(N, T) * w along v (+Z)
+		float along = mirrorStart <= i ? -b.x : b.x;
+		CHECK(along > 0.5f);
+		XMVECTOR rebuilt = XMVectorScale(XMVector3Cross(normal, tangent), b.w);
+		CHECK(XMVectorGetZ(rebuilt) > 0.5f);
+		CHECK(b.w == (i < mirrorStart ? -1.0f : 1.0f));
+	}
+}
+
+// Every thread count gives exactly the same tangents
+// - Each grid has an odd number of vertices, so thread ranges that
+//   ignored Finalize's batches of 4 would show up here
+TEST(TangentGeneratorThreadsMatch)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	AddGrid(256, false, verts, indices);
+	AddGrid(256, true, verts, indices);
+	// Enough triangles that 8 threads each get a full share
+	CHECK(indices.size() / 3 >= TangentGenerator::MinTrianglesPerThread * 8);
+
+	std::vector<Vertex> serial = verts;
+	TangentGenerator::Generate(serial.data(), serial.size(), indices.data(), indices.size(), 1);
+
+	const unsigned int threadCounts[3] = { 2, 3, 8 };
+	for (int t = 0; t < 3; t++)
+	{
+		std::vector<Vertex> threaded = verts;
+		TangentStats stats;
+		TangentGenerator::Generate(threaded.data(), threaded.size(), indices.data(), indices.size(), threadCounts[t], &stats);
+		CHECK(stats.threads == threadCounts[t]);
+		CHECK(memcmp(threaded.data(), serial.data(), sizeof(Vertex) * verts.size()) == 0);
+	}
+}
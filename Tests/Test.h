@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+
+// Tests register themselves by name with TEST(name), and the Tests program
+// runs all of them, or just the ones named on its command line
+// - CHECK(condition) records a failure (with the file and line) and keeps
+//   going, so one run shows everything that's wrong
+// - The program returns non-zero if any check failed, which fails the
+//   post-build step that runs it
+// - Everything runs headless, so no window or GPU is needed
+typedef void (*TestFunction)();
+
+struct TestRegistration
+{
+	TestRegistration(const char* name, TestFunction function);
+};
+
+#define TEST(name) \
+	static void name##Test(); \
+	static TestRegistration name##Registration(#name, name##Test); \
+	static void name##Test()
+
+// Prints the failure and counts it against the running test
+void ReportFailure(const char* file, int line, const char* condition);
+
+#define CHECK(condition) \
+	((condition) ? (void)0 : ReportFailure(__FILE__, __LINE__, #condition))
@@ -0,0 +1,71 @@
+#include "Test.h"
+#include <vector>
+#include <cstdio>
+#include <cstring>
+
+struct TestEntry
+{
+	const char* name;
+	TestFunction function;
+};
+
+// Function local, so registrations from other files can't run before it exists
+static std::vector<TestEntry>& GetTests()
+{
+	static std::vector<TestEntry> tests;
+	return tests;
+}
+
+TestRegistration::TestRegistration(const char* name, TestFunction function)
+{
+	GetTests().push_back({ name, function });
+}
+
+// Failed checks in the test that's running
+static size_t failures = 0;
+
+void ReportFailure(const char* file, int line, const char* condition)
+{
+	printf("%s(%d): CHECK(%s) failed\n", file, line, condition);
+	failures++;
+}
+
+// Runs every test, or only the ones named on the command line
+// - "-list" prints the names instead
+// - Returns the number of tests that failed
+int main(int argc, char* argv[])
+{
+	std::vector<TestEntry>& tests = GetTests();
+	if (argc > 1 && strcmp(argv[1], "-list") == 0)
+	{
+		for (size_t i = 0; i < tests.size(); i++)
+			printf("%s\n", tests[i].name);
+		return 0;
+	}
+
+	int run = 0;
+	int failed = 0;
+	for (size_t i = 0; i < tests.size(); i++)
+	{
+		bool wanted = argc <= 1;
+		for (int a = 1; a < argc; a++)
+			wanted = wanted || strcmp(argv[a], tests[i].name) == 0;
+		if (!wanted)
+			continue;
+
+		failures = 0;
+		tests[i].function();
+		printf("%s %s\n", failures == 0 ? "passed" : "FAILED", tests[i].name);
+		fflush(stdout);
+		run++;
+		failed += failures != 0;
+	}
+
+	if (run == 0)
+	{
+		printf("No tests matched, use -list to see them\n");
+		return 1;
+	}
+	printf("%d of %d tests passed\n", run - failed, run);
+	return failed;
+}
@@ -0,0 +1,217 @@
+#include "Test.h"
+#include "TransformStore.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// What one transform should be, kept separately from the store
+	struct Expected
+	{
+		XMFLOAT3 position = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 scale = XMFLOAT3(1, 1, 1);
+		XMFLOAT4 orientation = XMFLOAT4(0, 0, 0, 1);
+		uint32_t parent = TransformStore::NoParent;
+	};
+
+	// Same seedable generator everywhere, so failures reproduce
+	struct Random
+	{
+		uint32_t state;
+		explicit Random(uint32_t seed) : state(seed) {}
+		uint32_t Next()
+		{
+			state = state * 1664525u + 1013904223u;
+			return state >> 8;
+		}
+		float Range(float lo, float hi)
+		{
+			return lo + (hi - lo) * (Next() & 0xFFFF) / 65535.0f;
+		}
+		uint32_t Pick(const std::vector<uint32_t>& from)
+		{
+			return from[Next() % from.size()];
+		}
+	};
+
+	// Is ancestor anywhere above id?
+	bool IsAbove(const std::map<uint32_t, Expected>& expected, uint32_t ancestor, uint32_t id)
+	{
+		for (uint32_t p = expected.at(id).parent; p != TransformStore::NoParent; p = expected.at(p).parent)
+		{
+			if (p == ancestor)
+				return true;
+		}
+		return false;
+	}
+
+	// World matrix straight from the definition, walking up every parent
+	XMMATRIX NaiveWorld(const std::map<uint32_t, Expected>& expected, uint32_t id)
+	{
+		XMMATRIX world = XMMatrixIdentity();
+		for (uint32_t p = id; p != TransformStore::NoParent; p = expected.at(p).parent)
+		{
+			const Expected& e = expected.at(p);
+			XMMATRIX local = XMMatrixScaling(e.scale.x, e.scale.y, e.scale.z) *
+				XMMatrixRotationQuaternion(XMLoadFloat4(&e.orientation)) *
+				XMMatrixTranslation(e.position.x, e.position.y, e.position.z);
+			world = world * local;
+		}
+		return world;
+	}
+
+	bool Near(const XMFLOAT4X4& actual, XMMATRIX reference)
+	{
+		XMFLOAT4X4 expected;
+		XMStoreFloat4x4(&expected, reference);
+		for (int i = 0; i < 16; i++)
+		{
+			float e = (&expected._11)[i];
+			if (fabsf((&actual._11)[i] - e) > 1e-4f * std::max(1.0f, fabsf(e)))
+				return false;
+		}
+		return true;
+	}
+}
+
+// 20000 random steps of adding, freeing, moving and reparenting, with
+// world matrices checked against a from scratch recompute both through
+// the batch update (on 1 to 3 threads) and one at a time in between
+TEST(TransformStoreRandomized)
+{
+	TransformStore store;
+	std::map<uint32_t, Expected> expected;
+	std::vector<uint32_t> live;
+	Random random(7);
+	size_t rejectedLoops = 0;
+	size_t fullChecks = 0;
+
+	for (int step = 0; step < 20000; step++)
+	{
+		uint32_t roll = random.Next() % 100;
+		if (roll < 25 || live.size() < 4)
+		{
+			// New slots always start out as the identity with no parent
+			uint32_t id = store.Allocate();
+			CHECK(expected.count(id) == 0);
+			CHECK(store.GetParent(id) == TransformStore::NoParent);
+			CHECK(store.GetScale(id).x == 1 && store.GetOrientation(id).w == 1 && store.GetPosition(id).y == 0);
+			expected[id] = Expected();
+			live.push_back(id);
+			if (random.Next() % 2 && live.size() > 1)
+			{
+				uint32_t parent = live[random.Next() % (live.size() - 1)];
+				CHECK(store.SetParent(id, parent));
+				expected[id].parent = parent;
+			}
+		}
+		else if (roll < 37)
+		{
+			// Freeing orphans the children
+			size_t index = random.Next() % live.size();
+			uint32_t id = live[index];
+			store.Free(id);
+			live.erase(live.begin() + index);
+			expected.erase(id);
+			for (std::map<uint32_t, Expected>::iterator it = expected.begin(); it != expected.end(); ++it)
+			{
+				if (it->second.parent == id)
+					it->second.parent = TransformStore::NoParent;
+			}
+		}
+		else if (roll < 55)
+		{
+			// Reparenting, which has to turn down loops
+			uint32_t id = random.Pick(live);
+			uint32_t parent = random.Next() % 4 == 0 ? TransformStore::NoParent : random.Pick(live);
+			bool loop = parent == id || (parent != TransformStore::NoParent && IsAbove(expected, id, parent));
+			CHECK(store.SetParent(id, parent) == !loop);
+			if (loop)
+				rejectedLoops++;
+			else
+				expected[id].parent = parent;
+			CHECK(store.GetParent(id) == expected[id].parent);
+		}
+		else if (roll < 85)
+		{
+			// Any one part of a transform changing
+			uint32_t id = random.Pick(live);
+			Expected& e = expected[id];
+			switch (random.Next() % 4)
+			{
+			case 0:
+				e.position = XMFLOAT3(random.Range(-10, 10), random.Range(-10, 10), random.Range(-10, 10));
+				store.SetPosition(id, e.position);
+				break;
+			case 1:
+				e.scale = XMFLOAT3(random.Range(0.8f, 1.25f), random.Range(0.8f, 1.25f), random.Range(0.8f, 1.25f));
+				store.SetScale(id, e.scale);
+				break;
+			case 2:
+				XMStoreFloat4(&e.orientation, XMQuaternionNormalize(XMVectorSet(
+					random.Range(-1, 1), random.Range(-1, 1), random.Range(-1, 1), random.Range(-1, 1))));
+				store.SetOrientation(id, e.orientation);
+				break;
+			default:
+			{
+				XMFLOAT3 rotation(random.Range(-3, 3), random.Range(-3, 3), random.Range(-3, 3));
+				XMStoreFloat4(&e.orientation, XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z));
+				store.SetRotation(id, rotation);
+				break;
+			}
+			}
+			CHECK(store.IsDirty(id));
+		}
+		else if (roll < 95)
+		{
+			// One at a time, which brings the parents up to date as it goes
+			uint32_t id = random.Pick(live);
+			CHECK(Near(store.GetWorldMatrix(id), NaiveWorld(expected, id)));
+		}
+		else
+		{
+			// The batch update, checked everywhere
+			store.UpdateWorldMatrices(1 + random.Next() % 3);
+			fullChecks++;
+			for (size_t i = 0; i < live.size(); i++)
+			{
+				CHECK(!store.IsDirty(live[i]));
+				uint32_t version = store.GetWorldVersion(live[i]);
+				CHECK(Near(store.GetWorldMatrix(live[i]), NaiveWorld(expected, live[i])));
+				CHECK(store.GetWorldVersion(live[i]) == version);
+			}
+		}
+		CHECK(store.GetCount() == live.size());
+	}
+
+	// Every kind of step actually happened
+	CHECK(rejectedLoops > 0);
+	CHECK(fullChecks > 100);
+}
+
+// Only transforms below a change get new world matrices
+TEST(TransformStoreVersions)
+{
+	TransformStore store;
+	uint32_t root = store.Allocate();
+	uint32_t child = store.Allocate();
+	uint32_t other = store.Allocate();
+	CHECK(store.SetParent(child, root));
+	store.UpdateWorldMatrices(1);
+	uint32_t childVersion = store.GetWorldVersion(child);
+	uint32_t otherVersion = store.GetWorldVersion(other);
+
+	// Nothing changed, nothing rebuilt
+	store.UpdateWorldMatrices(1);
+	CHECK(store.GetWorldVersion(child) == childVersion);
+
+	store.SetPosition(root, XMFLOAT3(1, 2, 3));
+	store.UpdateWorldMatrices(1);
+	CHECK(store.GetWorldVersion(child) != childVersion);
+	CHECK(store.GetWorldVersion(other) == otherVersion);
+	CHECK(store.GetWorldMatrix(child)._42 == 2.0f);
+}
@@ -0,0 +1,224 @@
+#include "Test.h"
+#include "Transform.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	bool Near(const XMFLOAT4X4& actual, XMMATRIX reference)
+	{
+		XMFLOAT4X4 expected;
+		XMStoreFloat4x4(&expected, reference);
+		for (int i = 0; i < 16; i++)
+		{
+			if (fabsf((&actual._11)[i] - (&expected._11)[i]) > 1e-4f)
+				return false;
+		}
+		return true;
+	}
+
+	bool Near(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return fabsf(a.x - b.x) < 1e-4f && fabsf(a.y - b.y) < 1e-4f && fabsf(a.z - b.z) < 1e-4f;
+	}
+
+	// The matrix a transform's own values make, from scratch
+	XMMATRIX Local(Transform& t)
+	{
+		XMFLOAT3 s = t.GetScale();
+		XMFLOAT4 q = t.GetOrientation();
+		XMFLOAT3 p = t.GetPosition();
+		return XMMatrixScaling(s.x, s.y, s.z) * XMMatrixRotationQuaternion(XMLoadFloat4(&q)) * XMMatrixTranslation(p.x, p.y, p.z);
+	}
+}
+
+// World matrices follow the parents through reparenting, detaching and
+// parents going away
+TEST(TransformHierarchy)
+{
+	TransformStore store;
+	Transform root(&store);
+	Transform* arm = new Transform(&store);
+	Transform hand(&store);
+	root.SetPosition(10, 0, 0);
+	root.SetRotation(0, XM_PIDIV2, 0);
+	arm->SetPosition(0, 2, 0);
+	arm->SetScale(2, 2, 2);
+	hand.SetPosition(1, 0, 0);
+	hand.SetRotation(0.3f, 0, 0.2f);
+	CHECK(arm->SetParent(&root));
+	CHECK(hand.SetParent(arm));
+
+	CHECK(Near(hand.GetWorldMatrix(), Local(hand) * Local(*arm) * Local(root)));
+	CHECK(Near(hand.GetLocalMatrix(), Local(hand)));
+
+	// Yawing the root a quarter turn swings the hand's offset from +X to -Z
+	XMFLOAT3 handPosition = hand.GetWorldPosition();
+	CHECK(Near(handPosition, XMFLOAT3(10, 2, -2)));
+
+	// Moving a parent moves everything below it
+	uint32_t version = hand.GetWorldVersion();
+	root.WorldTranslate(0, 5, 0);
+	store.UpdateWorldMatrices(1);
+	CHECK(hand.GetWorldVersion() != version);
+	CHECK(Near(hand.GetWorldPosition(), XMFLOAT3(10, 7, -2)));
+
+	// No loops, and no parents from other stores
+	CHECK(!root.SetParent(&hand));
+	CHECK(!hand.SetParent(&hand));
+	TransformStore otherStore;
+	Transform stranger(&otherStore);
+	CHECK(!hand.SetParent(&stranger));
+	CHECK(Near(hand.GetWorldMatrix(), Local(hand) * Local(*arm) * Local(root)));
+
+	// Straight onto the root instead
+	CHECK(hand.SetParent(&root));
+	CHECK(Near(hand.GetWorldMatrix(), Local(hand) * Local(root)));
+
+	// Back under the arm, which then goes away and leaves the hand on its own
+	CHECK(hand.SetParent(arm));
+	delete arm;
+	CHECK(Near(hand.GetWorldMatrix(), Local(hand)));
+	store.UpdateWorldMatrices(1);
+	CHECK(Near(hand.GetWorldMatrix(), Local(hand)));
+
+	// Copies take the values but not the parent
+	CHECK(hand.SetParent(&root));
+	Transform copy(hand);
+	CHECK(Near(copy.GetWorldMatrix(), Local(hand)));
+	copy = root;
+	CHECK(Near(copy.GetPosition(), root.GetPosition()));
+	CHECK(hand.SetParent(nullptr));
+	CHECK(Near(hand.GetWorldMatrix(), Local(hand)));
+}
+
+// A forest big enough to be split across threads comes out exactly the
+// same as on one thread, and a change only rebuilds its own tree
+TEST(TransformThreadedUpdate)
+{
+	const size_t trees = 64;
+	const size_t treeSize = 1024;
+	CHECK(trees * treeSize >= TransformStore::MinTransformsPerThread * 4);
+
+	TransformStore single, threaded;
+	std::vector<uint32_t> ids;
+	uint32_t state = 99;
+	for (size_t t = 0; t < trees; t++)
+	{
+		size_t first = ids.size();
+		for (size_t i = 0; i < treeSize; i++)
+		{
+			uint32_t id = single.Allocate();
+			CHECK(threaded.Allocate() == id);
+			ids.push_back(id);
+
+			state = state * 1664525u + 1013904223u;
+			XMFLOAT3 position((state >> 8) % 7 - 3.0f, (state >> 12) % 5 - 2.0f, (state >> 16) % 3 - 1.0f);
+			XMFLOAT3 rotation(((state >> 4) % 100) * 0.01f, ((state >> 9) % 100) * 0.02f, 0);
+			single.SetPosition(id, position);
+			threaded.SetPosition(id, position);
+			single.SetRotation(id, rotation);
+			threaded.SetRotation(id, rotation);
+			if (i > 0)
+			{
+				uint32_t parent = ids[first + (state >> 3) % i];
+				CHECK(single.SetParent(id, parent));
+				CHECK(threaded.SetParent(id, parent));
+			}
+		}
+	}
+
+	single.UpdateWorldMatrices(1);
+	threaded.UpdateWorldMatrices(4);
+	bool same = true;
+	for (size_t i = 0; i < ids.size(); i++)
+		same = same && memcmp(&single.GetWorldMatrix(ids[i]), &threaded.GetWorldMatrix(ids[i]), sizeof(XMFLOAT4X4)) == 0;
+	CHECK(same);
+
+	// Moving one root only touches its own tree
+	std::vector<uint32_t> versions(ids.size());
+	for (size_t i = 0; i < ids.size(); i++)
+		versions[i] = threaded.GetWorldVersion(ids[i]);
+	threaded.SetPosition(ids[treeSize * 3], XMFLOAT3(0, 100, 0));
+	threaded.UpdateWorldMatrices(4);
+	size_t rebuilt = 0;
+	bool onlyThatTree = true;
+	for (size_t i = 0; i < ids.size(); i++)
+	{
+		if (threaded.GetWorldVersion(ids[i]) == versions[i])
+			continue;
+		rebuilt++;
+		onlyThatTree = onlyThatTree && i / treeSize == 3;
+	}
+	CHECK(rebuilt == treeSize);
+	CHECK(onlyThatTree);
+}
+
+// Euler angles go in and come back out through the quaternion, and the
+// cached axes are the quaternion's rotated basis vectors
+TEST(TransformQuaternionRoundTrip)
+{
+	TransformStore store;
+	Transform t(&store);
+	const XMFLOAT4 orientation(0.1825742f, 0.3651484f, 0.5477226f, 0.7302967f);
+	t.SetOrientation(orientation);
+	XMFLOAT4 back = t.GetOrientation();
+	CHECK(memcmp(&back, &orientation, sizeof(XMFLOAT4)) == 0);
+
+	for (int p = -7; p <= 7; p++)
+	{
+		for (int y = -15; y <= 15; y += 2)
+		{
+			for (int r = -15; r <= 15; r += 3)
+			{
+				// Pitch stays clear of straight up and down, where yaw and roll
+				// mean the same thing
+				XMFLOAT3 rotation(p * 0.2f, y * 0.2f, r * 0.2f);
+				t.SetRotation(rotation.x, rotation.y, rotation.z);
+				CHECK(Near(t.GetRotation(), rotation));
+
+				XMFLOAT4 orientation = t.GetOrientation();
+				XMVECTOR q = XMLoadFloat4(&orientation);
+				CHECK(fabsf(XMVectorGetX(XMVector4Length(q)) - 1) < 1e-5f);
+				XMFLOAT3 right, up, forward;
+				XMStoreFloat3(&right, XMVector3Rotate(XMVectorSet(1, 0, 0, 0), q));
+				XMStoreFloat3(&up, XMVector3Rotate(XMVectorSet(0, 1, 0, 0), q));
+				XMStoreFloat3(&forward, XMVector3Rotate(XMVectorSet(0, 0, 1, 0), q));
+				CHECK(Near(t.GetRight(), right) && Near(t.GetUp(), up) && Near(t.GetForward(), forward));
+			}
+		}
+	}
+
+	// Straight up, the angles that come back still make the same orientation
+	t.SetRotation(XM_PIDIV2, 0.5f, 0.25f);
+	XMFLOAT4 before = t.GetOrientation();
+	XMFLOAT3 gimbal = t.GetRotation();
+	CHECK(fabsf(gimbal.x - XM_PIDIV2) < 1e-3f && gimbal.z == 0.0f);
+	t.SetRotation(gimbal.x, gimbal.y, gimbal.z);
+	XMFLOAT4 after = t.GetOrientation();
+	CHECK(fabsf(XMVectorGetX(XMVector4Dot(XMLoadFloat4(&before), XMLoadFloat4(&after)))) > 0.99999f);
+}
+
+// Turning adds to the angles like it did when they were stored directly,
+// and lots of small turns don't drift off a unit quaternion
+TEST(TransformQuaternionRotate)
+{
+	TransformStore store;
+	Transform t(&store);
+	t.SetRotation(0.4f, 1.0f, 0);
+	t.Rotate(0.2f, -0.5f, 0);
+	CHECK(Near(t.GetRotation(), XMFLOAT3(0.6f, 0.5f, 0)));
+	t.Rotate(0, 0, 0);
+	CHECK(Near(t.GetRotation(), XMFLOAT3(0.6f, 0.5f, 0)));
+
+	// Roll happens around the forward axis, which stays put
+	XMFLOAT3 forward = t.GetForward();
+	t.Rotate(0, 0, 0.7f);
+	CHECK(Near(t.GetForward(), forward));
+
+	for (int i = 0; i < 100000; i++)
+		t.Rotate(0.001f, 0.0013f, 0.0007f);
+	XMFLOAT4 q = t.GetOrientation();
+	CHECK(fabsf(XMVectorGetX(XMVector4Length(XMLoadFloat4(&q))) - 1) < 1e-5f);
+}
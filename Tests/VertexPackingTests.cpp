@@ -0,0 +1,153 @@
+#include "Test.h"
+#include "VertexPacking.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Evenly spread directions over the whole sphere (a Fibonacci spiral),
+	// plus the axes and the edges of the octahedral fold
+	std::vector<XMFLOAT3> Directions(int count)
+	{
+		std::vector<XMFLOAT3> directions;
+		for (int i = 0; i < count; i++)
+		{
+			float y = 1.0f - 2.0f * (i + 0.5f) / count;
+			float radius = sqrtf(std::max(0.0f, 1.0f - y * y));
+			float angle = i * 2.39996323f;
+			directions.push_back(XMFLOAT3(cosf(angle) * radius, y, sinf(angle) * radius));
+		}
+
+		const float edge = 0.70710678f;
+		const XMFLOAT3 special[10] = {
+			XMFLOAT3(1, 0, 0), XMFLOAT3(-1, 0, 0), XMFLOAT3(0, 1, 0), XMFLOAT3(0, -1, 0),
+			XMFLOAT3(0, 0, 1), XMFLOAT3(0, 0, -1), XMFLOAT3(edge, edge, 0), XMFLOAT3(-edge, 0, edge),
+			XMFLOAT3(0, -edge, -edge), XMFLOAT3(0.57735027f, -0.57735027f, -0.57735027f) };
+		directions.insert(directions.end(), special, special + 10);
+		return directions;
+	}
+
+	// Angle between two vectors, in degrees
+	// - atan2 of the cross and dot products in doubles, since acos of a
+	//   float dot product can't resolve angles this small
+	float AngleBetween(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		double cx = (double)a.y * b.z - (double)a.z * b.y;
+		double cy = (double)a.z * b.x - (double)a.x * b.z;
+		double cz = (double)a.x * b.y - (double)a.y * b.x;
+		double dot = (double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z;
+		return (float)(atan2(sqrt(cx * cx + cy * cy + cz * cz), dot) * 180.0 / 3.14159265358979);
+	}
+
+	Vertex MakeVertex(const XMFLOAT3& position, const XMFLOAT3& direction, float handedness, const XMFLOAT2& uv)
+	{
+		Vertex v;
+		v.Position = position;
+		v.Normal = direction;
+		// Any direction at right angles to the normal will do
+		XMVECTOR axis = fabsf(direction.x) < 0.9f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+		XMVECTOR tangent = XMVector3Normalize(XMVector3Cross(XMLoadFloat3(&direction), axis));
+		XMStoreFloat4(&v.Tangent, XMVectorSetW(tangent, handedness));
+		v.UV = uv;
+		return v;
+	}
+}
+
+// 48 bytes down to 20, as PackedVertex's comment says
+TEST(VertexPackingSizes)
+{
+	CHECK(sizeof(Vertex) == 48);
+	CHECK(sizeof(PackedVertex) == 20);
+
+	Vertex vertex = MakeVertex(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 1, 0), 1, XMFLOAT2(0, 0));
+	VertexPackingReport report = VertexPacking::Measure(&vertex, 1, XMFLOAT3(-1, -1, -1), XMFLOAT3(1, 1, 1));
+	CHECK(report.fullBytes == 48 && report.packedBytes == 20);
+}
+
+// 16-bit octahedral directions stay within a hundredth of a degree
+TEST(VertexPackingOctahedral)
+{
+	std::vector<XMFLOAT3> directions = Directions(20000);
+	float worst = 0;
+	for (size_t i = 0; i < directions.size(); i++)
+	{
+		int16_t encoded[2];
+		VertexPacking::OctEncode(directions[i], encoded);
+		XMFLOAT3 decoded = VertexPacking::OctDecode(encoded);
+		worst = std::max(worst, AngleBetween(directions[i], decoded));
+		CHECK(fabsf(XMVectorGetX(XMVector3Length(XMLoadFloat3(&decoded))) - 1) < 1e-5f);
+	}
+	CHECK(worst < 0.01f);
+
+	// The tangent goes through the same encoding
+	float worstTangent = 0;
+	for (size_t i = 0; i < directions.size(); i++)
+	{
+		Vertex vertex = MakeVertex(XMFLOAT3(0, 0, 0), directions[i], 1, XMFLOAT2(0, 0));
+		Vertex unpacked = VertexPacking::Unpack(VertexPacking::Pack(vertex, XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1)),
+			XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1));
+		XMFLOAT3 tangent(vertex.Tangent.x, vertex.Tangent.y, vertex.Tangent.z);
+		XMFLOAT3 unpackedTangent(unpacked.Tangent.x, unpacked.Tangent.y, unpacked.Tangent.z);
+		worstTangent = std::max(worstTangent, AngleBetween(tangent, unpackedTangent));
+	}
+	CHECK(worstTangent < 0.01f);
+}
+
+// Positions land within half a UNORM16 step of the bounds on each axis,
+// UVs within half a float16 step, and the handedness sign comes back
+TEST(VertexPackingRoundTrip)
+{
+	const XMFLOAT3 boundsMin(-3.0f, 0.5f, -100.0f);
+	const XMFLOAT3 boundsMax(5.0f, 0.75f, 250.0f);
+	const float* lo = &boundsMin.x;
+	const float* hi = &boundsMax.x;
+	std::vector<XMFLOAT3> directions = Directions(4096);
+
+	std::vector<Vertex> vertices;
+	for (size_t i = 0; i < directions.size(); i++)
+	{
+		// Spread across the box, corners included, with UVs past 0-1 too
+		float f = (float)i / (directions.size() - 1);
+		float g = (float)((i * 37) % directions.size()) / (directions.size() - 1);
+		XMFLOAT3 position(lo[0] + (hi[0] - lo[0]) * f, lo[1] + (hi[1] - lo[1]) * g, lo[2] + (hi[2] - lo[2]) * (1 - f));
+		XMFLOAT2 uv(f * 8.0f - 4.0f, g * 3.0f);
+		vertices.push_back(MakeVertex(position, directions[i], i % 3 == 0 ? -1.0f : 1.0f, uv));
+	}
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const Vertex& v = vertices[i];
+		Vertex unpacked = VertexPacking::Unpack(VertexPacking::Pack(v, boundsMin, boundsMax), boundsMin, boundsMax);
+
+		const float* position = &v.Position.x;
+		const float* unpackedPosition = &unpacked.Position.x;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float step = (hi[axis] - lo[axis]) / 65535.0f;
+			CHECK(fabsf(unpackedPosition[axis] - position[axis]) <= step * 0.5f + fabsf(position[axis]) * 1e-6f);
+		}
+
+		// Half floats keep 11 significant bits
+		CHECK(fabsf(unpacked.UV.x - v.UV.x) <= fabsf(v.UV.x) / 2048.0f);
+		CHECK(fabsf(unpacked.UV.y - v.UV.y) <= fabsf(v.UV.y) / 2048.0f);
+		CHECK(unpacked.Tangent.w == v.Tangent.w);
+	}
+
+	// The report agrees
+	VertexPackingReport report = VertexPacking::Measure(vertices.data(), vertices.size(), boundsMin, boundsMax);
+	CHECK(report.vertexCount == vertices.size());
+	CHECK(report.handednessMismatches == 0);
+	CHECK(report.maxNormalError < 0.01f && report.maxTangentError < 0.01f);
+	CHECK(report.maxPositionError <= (hi[2] - lo[2]) / 65535.0f);
+	CHECK(report.maxUVError <= 4.0f / 2048.0f);
+
+	// A flat axis stores nothing and decodes to the bounds
+	Vertex flat = vertices[1];
+	flat.Position.y = 2.0f;
+	Vertex unpacked = VertexPacking::Unpack(VertexPacking::Pack(flat, XMFLOAT3(-3, 2, -100), XMFLOAT3(5, 2, 250)),
+		XMFLOAT3(-3, 2, -100), XMFLOAT3(5, 2, 250));
+	CHECK(unpacked.Position.y == 2.0f);
+}
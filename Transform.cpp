@@ -1,80 +1,132 @@
 #include "Transform.h"
 
-Transform::Transform()
+Transform::Transform() : Transform(&TransformStore::Default())
 {
-	// Set default values
-	position = XMFLOAT3(0, 0, 0);
-	rotation = XMFLOAT3(0, 0, 0);
-	scale = XMFLOAT3(1, 1, 1);
-	// Values have been changed
-	dirty = true;
-	// Get default world matrix calculated
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
+}
+
+Transform::Transform(TransformStore* store)
+{
+	// Get a slot (it starts out as the identity)
+	this->store = store;
+	id = store->Allocate();
+}
+
+// Copies get their own slot
+Transform::Transform(const Transform& other) : Transform(other.store)
+{
+	other.store->Copy(other.id, id);
+}
+
+// Assigning keeps this slot and just takes the values
+Transform& Transform::operator=(const Transform& other)
+{
+	if (this != &other)
+		store->Copy(other.id, id);
+	return *this;
+}
+
+Transform::~Transform()
+{
+	store->Free(id);
 }
 
 // Return the world matrix
+// - Already up to date if the store's batch update ran since the last change
 XMFLOAT4X4 Transform::GetWorldMatrix()
 {
-	// Check if current matrix is correct
-	if (dirty)
-	{
-		// Create temp matrices out of the transform data
-		XMMATRIX transMatrix = XMMatrixTranslation(position.x, position.y, position.z);
-		XMMATRIX scaleMatrix = XMMatrixScaling(scale.x, scale.y, scale.z);
-		// The name is order of when the rotations are done
-		// The parameters are sill pitch yaw roll
-		XMMATRIX rotMatrix = XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
-
-		// Create the matrix (reverse order)
-		XMMATRIX world = scaleMatrix * rotMatrix * transMatrix;
-		
-		// Translate it back into xmfloat4x4
-		XMStoreFloat4x4(&worldMatrix, world);
-	}
-	// Return the world matrix
-	return worldMatrix;
+	return store->GetWorldMatrix(id);
+}
+
+// Return the matrix relative to the parent
+XMFLOAT4X4 Transform::GetLocalMatrix()
+{
+	return store->GetLocalMatrix(id);
+}
+
+// The translation part of the world matrix
+XMFLOAT3 Transform::GetWorldPosition()
+{
+	const XMFLOAT4X4& world = store->GetWorldMatrix(id);
+	return XMFLOAT3(world._41, world._42, world._43);
+}
+
+uint32_t Transform::GetWorldVersion()
+{
+	return store->GetWorldVersion(id);
+}
+
+// Attach to another transform, or detach with nullptr
+bool Transform::SetParent(Transform* parent)
+{
+	if (parent == nullptr)
+		return store->SetParent(id, TransformStore::NoParent);
+	if (parent->store != store)
+		return false;
+	return store->SetParent(id, parent->id);
 }
 
 // Return the position
 XMFLOAT3 Transform::GetPosition()
 {
-	return position;
+	return store->GetPosition(id);
 }
 
 // Set the position directly
 void Transform::SetPosition(float x, float y, float z)
 {
-	position = XMFLOAT3(x, y, z);
-	// A piece of transformation data has changed
-	dirty = true;
+	store->SetPosition(id, XMFLOAT3(x, y, z));
 }
 
 // Return the scale
 XMFLOAT3 Transform::GetScale()
 {
-	return scale;
+	return store->GetScale(id);
 }
 
 // Set the scale directly
 void Transform::SetScale(float x, float y, float z)
 {
-	scale = XMFLOAT3(x, y, z);
-	// A piece of transformation data has changed
-	dirty = true;
+	store->SetScale(id, XMFLOAT3(x, y, z));
 }
 
 // Return the rotation
 XMFLOAT3 Transform::GetRotation()
 {
-	return rotation;
+	return store->GetRotation(id);
 }
 
 // Set the rotation directly
 void Transform::SetRotation(float pitch, float yaw, float roll)
 {
-	rotation = XMFLOAT3(pitch, yaw, roll);
-	// A piece of transformation data has changed
-	dirty = true;
+	store->SetRotation(id, XMFLOAT3(pitch, yaw, roll));
+}
+
+// Return the orientation
+XMFLOAT4 Transform::GetOrientation()
+{
+	return store->GetOrientation(id);
+}
+
+// Set the orientation directly
+void Transform::SetOrientation(XMFLOAT4 orientation)
+{
+	store->SetOrientation(id, orientation);
+}
+
+// The store keeps these up to date, so there's no math here
+XMFLOAT3 Transform::GetForward()
+{
+	return store->GetForward(id);
+}
+
+XMFLOAT3 Transform::GetRight()
+{
+	return store->GetRight(id);
+}
+
+XMFLOAT3 Transform::GetUp()
+{
+	return store->GetUp(id);
 }
 
 
@@ -83,38 +135,47 @@ void Transform::SetRotation(float pitch, float yaw, float roll)
 void Transform::WorldTranslate(float x, float y, float z)
 {
 	// Calculate the new position
-	position = XMFLOAT3(position.x + x, position.y + y, position.z + z);
-	// A piece of transformation data has changed
-	dirty = true;
+	XMFLOAT3 position = GetPosition();
+	SetPosition(position.x + x, position.y + y, position.z + z);
 }
 
 // Add to the position within a local relative space
 void Transform::LocalTranslate(float x, float y, float z)
 {
-	// Move to information into the XMVECTOR for math 
-	XMVECTOR vec = XMVectorSet(x, y, z, 0);
-	XMVECTOR rotationVec = XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
-	// Rotate the vector and add it on
-	XMVECTOR newPos = XMLoadFloat3(&position) + XMVector3Rotate(vec, rotationVec);
-	// Move back from Vector to Float3
-	XMStoreFloat3(&position, newPos);
+	// Step along each of the cached axes
+	XMFLOAT3 position = GetPosition();
+	XMVECTOR offset = XMVectorScale(XMLoadFloat3(&store->GetRight(id)), x);
+	offset = XMVectorMultiplyAdd(XMVectorReplicate(y), XMLoadFloat3(&store->GetUp(id)), offset);
+	offset = XMVectorMultiplyAdd(XMVectorReplicate(z), XMLoadFloat3(&store->GetForward(id)), offset);
+	XMStoreFloat3(&position, XMLoadFloat3(&position) + offset);
+	SetPosition(position.x, position.y, position.z);
 }
 
 // Multiply the scale
 void Transform::Scale(float x, float y, float z)
 {
 	// Calculate the new scale
-	scale = XMFLOAT3(scale.x * x, scale.y * y, scale.z * z);
-	// A piece of transformation data has changed
-	dirty = true;
+	XMFLOAT3 scale = GetScale();
+	SetScale(scale.x * x, scale.y * y, scale.z * z);
 }
 
-// Add to the rotation
+// Turn by some more pitch, yaw and roll
+// - Same result as adding to the Euler angles as long as there's no roll
 void Transform::Rotate(float pitch, float yaw, float roll)
 {
-	// Calculate the new rotation
-	rotation = XMFLOAT3(rotation.x + pitch, rotation.y + yaw, rotation.z + roll);
-	// A piece of transformation data has changed
-	dirty = true;
-}
+	if (pitch == 0 && yaw == 0 && roll == 0)
+		return;
 
+	// Roll and pitch happen first, in the transform's own space, and yaw
+	// happens last, around the world's up axis
+	XMFLOAT4 orientation = GetOrientation();
+	XMVECTOR q = XMLoadFloat4(&orientation);
+	if (pitch != 0 || roll != 0)
+		q = XMQuaternionMultiply(XMQuaternionRotationRollPitchYaw(pitch, 0, roll), q);
+	if (yaw != 0)
+		q = XMQuaternionMultiply(q, XMQuaternionRotationRollPitchYaw(0, yaw, 0));
+
+	// Keep rounding from building up
+	XMStoreFloat4(&orientation, XMQuaternionNormalize(q));
+	SetOrientation(orientation);
+}
@@ -1,30 +1,46 @@
 #pragma once
 #include <DirectXMath.h>
+#include "TransformStore.h"
 
 // So I don't have to keep retyping DirectX:: before every vector
 using namespace DirectX;
 
+// Handle to one slot of a TransformStore
+// - The data itself lives in the store, so the store can rebuild every
+//   world matrix in one batch instead of one at a time
+// - Copying a transform makes a new slot with the same values (but no parent)
+// - Position, rotation and scale are relative to the parent, if there is one
 class Transform
 {
 private:
 	// Fields
-	// World matrix which contains all of the following transformations
-	XMFLOAT4X4 worldMatrix;
-	// Position
-	XMFLOAT3 position;
-	// Scale
-	XMFLOAT3 scale;
-	// Rotation
-	XMFLOAT3 rotation;
-	// Does the world matrix need to be recalculated
-	bool dirty;
+	// Where the data lives
+	TransformStore* store;
+	// Slot in the store
+	uint32_t id;
 
 public:
 	// Default constructor
 	Transform();
+	// Uses a specific store instead of the default one
+	Transform(TransformStore* store);
+	Transform(const Transform& other);
+	Transform& operator=(const Transform& other);
+	~Transform();
 
-	// Getter for world matrix
+	// Getter for world matrix (includes every parent)
 	XMFLOAT4X4 GetWorldMatrix();
+	// Getter for the matrix relative to the parent
+	XMFLOAT4X4 GetLocalMatrix();
+	// Position after every parent is applied
+	XMFLOAT3 GetWorldPosition();
+	// Changes whenever the world matrix is rebuilt (see TransformStore::GetWorldVersion)
+	uint32_t GetWorldVersion();
+
+	// Hierarchy
+	// - The parent has to come from the same store, and nullptr detaches
+	// - Returns false (changing nothing) if it would make a loop
+	bool SetParent(Transform* parent);
 	// Getter and Setter for position
 	XMFLOAT3 GetPosition();
 	void SetPosition(float x, float y, float z);
@@ -32,17 +48,25 @@ public:
 	XMFLOAT3 GetScale();
 	void SetScale(float x, float y, float z);
 	// Getter and Setter for rotation
+	// - Pitch, yaw and roll worked out from the orientation
 	XMFLOAT3 GetRotation();
 	void SetRotation(float pitch, float yaw, float roll);
+	// Getter and Setter for the orientation quaternion
+	XMFLOAT4 GetOrientation();
+	void SetOrientation(XMFLOAT4 orientation);
+	// Directions of the local axes (relative to the parent)
+	XMFLOAT3 GetForward();
+	XMFLOAT3 GetRight();
+	XMFLOAT3 GetUp();
 
 	// Transformations
 	// This is the a rename for moveabsolute because it makes more sense to me
 	void WorldTranslate(float x, float y, float z);
-	// Method to implement in the future for moving depending on the forward vector
+	// Move along the local axes (x right, y up, z forward)
 	void LocalTranslate(float x, float y, float z);
 	// Multiply the scale
 	void Scale(float x, float y, float z);
-	// Add to the rotation
+	// Turn by some more pitch, yaw and roll
+	// - Pitch and roll turn around the local axes, yaw around the world up axis
 	void Rotate(float pitch, float yaw, float roll);
 };
-
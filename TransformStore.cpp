@@ -0,0 +1,655 @@
+#include "TransformStore.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+
+using namespace DirectX;
+
+// Shared by every Transform made without a store of its own
+TransformStore& TransformStore::Default()
+{
+	static TransformStore store;
+	return store;
+}
+
+// Adds another word's worth of slots
+// - Array sizes stay a multiple of 4, so blocks can always be loaded whole
+void TransformStore::Grow()
+{
+	size_t oldSize = localMatrices.size();
+	size_t newSize = oldSize + SlotsPerWord;
+	positionX.resize(newSize, 0.0f);
+	positionY.resize(newSize, 0.0f);
+	positionZ.resize(newSize, 0.0f);
+	orientationX.resize(newSize, 0.0f);
+	orientationY.resize(newSize, 0.0f);
+	orientationZ.resize(newSize, 0.0f);
+	orientationW.resize(newSize, 1.0f);
+	rights.resize(newSize, XMFLOAT3(1, 0, 0));
+	ups.resize(newSize, XMFLOAT3(0, 1, 0));
+	forwards.resize(newSize, XMFLOAT3(0, 0, 1));
+	scaleX.resize(newSize, 1.0f);
+	scaleY.resize(newSize, 1.0f);
+	scaleZ.resize(newSize, 1.0f);
+	localMatrices.resize(newSize);
+	worldMatrices.resize(newSize);
+	parents.resize(newSize, (uint32_t)NoParent);
+	alive.resize(newSize, 0);
+	orderPositions.resize(newSize, 0);
+	worldVersions.resize(newSize, 0);
+	dirty.push_back(0);
+
+	// Hand out the new slots lowest first
+	for (size_t i = newSize; i > oldSize; i--)
+		freeSlots.push_back((uint32_t)(i - 1));
+}
+
+uint32_t TransformStore::Allocate()
+{
+	if (freeSlots.empty())
+		Grow();
+	uint32_t id = freeSlots.back();
+	freeSlots.pop_back();
+	count++;
+
+	// Start from the identity
+	positionX[id] = positionY[id] = positionZ[id] = 0.0f;
+	orientationX[id] = orientationY[id] = orientationZ[id] = 0.0f;
+	orientationW[id] = 1.0f;
+	rights[id] = XMFLOAT3(1, 0, 0);
+	ups[id] = XMFLOAT3(0, 1, 0);
+	forwards[id] = XMFLOAT3(0, 0, 1);
+	scaleX[id] = scaleY[id] = scaleZ[id] = 1.0f;
+	XMStoreFloat4x4(&localMatrices[id], XMMatrixIdentity());
+	parents[id] = NoParent;
+	alive[id] = 1;
+	if (!orderDirty)
+		AppendToOrder(id);
+	else
+		MarkDirty(id);	// The slot may still be in the old order from before it was freed
+	return id;
+}
+
+void TransformStore::Free(uint32_t id)
+{
+	// Orphan the children
+	// - When the order is current they're all inside this slot's range,
+	//   otherwise every slot has to be checked
+	if (!orderDirty)
+	{
+		uint32_t position = orderPositions[id];
+		uint32_t end = subtreeEnds[position];
+
+		// The children become roots, which can stay where they are as
+		// long as no range above still covers them
+		// - A leaf just leaves a hole in its parent's range
+		bool inPlace = end == position + 1 || parents[id] == NoParent || DetachInOrder(id);
+		for (uint32_t p = position + 1; p < end; p++)
+		{
+			if (orderParents[p] != position)
+				continue;
+			parents[order[p]] = NoParent;
+			if (inPlace)
+				orderParents[p] = NoParent;
+		}
+
+		if (inPlace)
+		{
+			// Everything below lost its parent's transform
+			if (end > position + 1)
+				memset(&stale[position + 1], 1, end - position - 1);
+			order[position] = NoParent;
+			orderParents[position] = NoParent;
+			subtreeEnds[position] = position + 1;
+			stale[position] = 0;
+			if (++orderHoles > order.size() / 2)
+				orderDirty = true;
+		}
+		else
+			orderDirty = true;
+	}
+	else
+	{
+		for (size_t i = 0; i < parents.size(); i++)
+		{
+			if (parents[i] == id)
+				parents[i] = NoParent;
+		}
+	}
+
+	// Freed slots are never rebuilt
+	ClearDirty(id);
+	parents[id] = NoParent;
+	alive[id] = 0;
+	freeSlots.push_back(id);
+	count--;
+}
+
+// Getters put the components back together
+XMFLOAT3 TransformStore::GetPosition(uint32_t id) const
+{
+	return XMFLOAT3(positionX[id], positionY[id], positionZ[id]);
+}
+
+// Pulls pitch, yaw and roll back out of the rotation matrix
+// - The matrix is roll, then pitch, then yaw, so its third row is
+//   (cos(pitch) sin(yaw), -sin(pitch), cos(pitch) cos(yaw)) and the middle
+//   column holds sin(roll) cos(pitch) and cos(roll) cos(pitch)
+// - Straight up or down, roll and yaw do the same thing, so it's all yaw
+XMFLOAT3 TransformStore::GetRotation(uint32_t id) const
+{
+	const XMFLOAT3& right = rights[id];
+	const XMFLOAT3& up = ups[id];
+	const XMFLOAT3& forward = forwards[id];
+	float sinPitch = -forward.y;
+	if (fabsf(sinPitch) > 0.99999f)
+		return XMFLOAT3(sinPitch > 0 ? XM_PIDIV2 : -XM_PIDIV2, atan2f(-right.z, right.x), 0.0f);
+	return XMFLOAT3(asinf(sinPitch), atan2f(forward.x, forward.z), atan2f(right.y, up.y));
+}
+
+XMFLOAT4 TransformStore::GetOrientation(uint32_t id) const
+{
+	return XMFLOAT4(orientationX[id], orientationY[id], orientationZ[id], orientationW[id]);
+}
+
+XMFLOAT3 TransformStore::GetScale(uint32_t id) const
+{
+	return XMFLOAT3(scaleX[id], scaleY[id], scaleZ[id]);
+}
+
+// Setters split them apart and flag the matrix
+void TransformStore::SetPosition(uint32_t id, const XMFLOAT3& position)
+{
+	positionX[id] = position.x;
+	positionY[id] = position.y;
+	positionZ[id] = position.z;
+	MarkDirty(id);
+}
+
+// Euler angles are only turned into a quaternion here, once
+void TransformStore::SetRotation(uint32_t id, const XMFLOAT3& rotation)
+{
+	XMFLOAT4 orientation;
+	XMStoreFloat4(&orientation, XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z));
+	SetOrientation(id, orientation);
+}
+
+// Refreshes the direction vectors along with the orientation
+// - They're the rows of the rotation matrix, which only takes multiplies
+void TransformStore::SetOrientation(uint32_t id, const XMFLOAT4& orientation)
+{
+	orientationX[id] = orientation.x;
+	orientationY[id] = orientation.y;
+	orientationZ[id] = orientation.z;
+	orientationW[id] = orientation.w;
+
+	XMMATRIX rotation = XMMatrixRotationQuaternion(XMLoadFloat4(&orientation));
+	XMStoreFloat3(&rights[id], rotation.r[0]);
+	XMStoreFloat3(&ups[id], rotation.r[1]);
+	XMStoreFloat3(&forwards[id], rotation.r[2]);
+	MarkDirty(id);
+}
+
+void TransformStore::SetScale(uint32_t id, const XMFLOAT3& scale)
+{
+	scaleX[id] = scale.x;
+	scaleY[id] = scale.y;
+	scaleZ[id] = scale.z;
+	MarkDirty(id);
+}
+
+void TransformStore::Copy(uint32_t from, uint32_t to)
+{
+	SetPosition(to, GetPosition(from));
+	SetOrientation(to, GetOrientation(from));
+	SetScale(to, GetScale(from));
+}
+
+// A changed transform makes everything below it stale too
+// - A stale transform's children are always stale already, so there's
+//   nothing more to do if this one is
+void TransformStore::MarkDirty(uint32_t id)
+{
+	dirty[id >> 6] |= 1ull << (id & 63);
+
+	// Slots added since the order went out of date aren't in it yet, and
+	// start out stale anyway
+	// - While it's out of date only the transform itself is marked, since
+	//   the new order spreads it to whatever ends up below
+	uint32_t position = orderPositions[id];
+	if (position >= order.size() || order[position] != id)
+		return;
+	if (stale[position])
+		return;
+	if (orderDirty)
+		stale[position] = 1;
+	else
+		memset(&stale[position], 1, subtreeEnds[position] - position);
+}
+
+// Reparenting patches the order in place when it can, and otherwise
+// leaves it to be rebuilt lazily
+bool TransformStore::SetParent(uint32_t id, uint32_t parent)
+{
+	for (uint32_t p = parent; p != NoParent; p = parents[p])
+	{
+		if (p == id)
+			return false;
+	}
+	if (parents[id] == parent)
+		return true;
+
+	uint32_t oldParent = parents[id];
+	parents[id] = parent;
+	if (orderDirty)
+		return true;
+	bool inPlace = oldParent == NoParent || DetachInOrder(id);
+	if (inPlace && parent != NoParent)
+		inPlace = AttachInOrder(id, parent);
+	if (!inPlace)
+		orderDirty = true;
+	return true;
+}
+
+// A new root without children is a subtree of one at the very end
+void TransformStore::AppendToOrder(uint32_t id)
+{
+	orderPositions[id] = (uint32_t)order.size();
+	order.push_back(id);
+	orderParents.push_back((uint32_t)NoParent);
+	subtreeEnds.push_back((uint32_t)order.size());
+	stale.push_back(1);
+}
+
+// Every range holds just its descendants (and holes), so a subtree can
+// only leave in place if it's at the end of all of them
+bool TransformStore::DetachInOrder(uint32_t id)
+{
+	uint32_t position = orderPositions[id];
+	uint32_t end = subtreeEnds[position];
+	for (uint32_t a = orderParents[position]; a != NoParent; a = orderParents[a])
+	{
+		if (subtreeEnds[a] != end)
+			return false;
+	}
+
+	for (uint32_t a = orderParents[position]; a != NoParent; a = orderParents[a])
+		subtreeEnds[a] = position;
+	orderParents[position] = NoParent;
+	memset(&stale[position], 1, end - position);
+	return true;
+}
+
+// Nothing but parent's range and the ones above it can end where a root
+// starts, so growing those to cover the subtree keeps every range exact
+bool TransformStore::AttachInOrder(uint32_t id, uint32_t parent)
+{
+	uint32_t position = orderPositions[id];
+	uint32_t parentPosition = orderPositions[parent];
+	if (subtreeEnds[parentPosition] != position)
+		return false;
+
+	uint32_t end = subtreeEnds[position];
+	for (uint32_t a = parentPosition; a != NoParent; a = orderParents[a])
+		subtreeEnds[a] = end;
+	orderParents[position] = parentPosition;
+	memset(&stale[position], 1, end - position);
+	return true;
+}
+
+// Depth first walk from every root, in slot order
+void TransformStore::RebuildOrder()
+{
+	// Children of each slot as one flat array
+	size_t slots = parents.size();
+	std::vector<uint32_t> childOffsets(slots + 1, 0);
+	for (size_t i = 0; i < slots; i++)
+	{
+		if (alive[i] && parents[i] != NoParent)
+			childOffsets[parents[i] + 1]++;
+	}
+	for (size_t i = 0; i < slots; i++)
+		childOffsets[i + 1] += childOffsets[i];
+	std::vector<uint32_t> children(childOffsets[slots]);
+	std::vector<uint32_t> fill(childOffsets.begin(), childOffsets.end() - 1);
+	for (size_t i = 0; i < slots; i++)
+	{
+		if (alive[i] && parents[i] != NoParent)
+			children[fill[parents[i]]++] = (uint32_t)i;
+	}
+
+	// Keep the old order around to see what moved
+	std::vector<uint32_t> oldOrder;
+	std::vector<uint32_t> oldOrderParents;
+	std::vector<uint8_t> oldStale;
+	oldOrder.swap(order);
+	oldOrderParents.swap(orderParents);
+	oldStale.swap(stale);
+	std::vector<uint32_t> oldPositions(orderPositions);
+
+	order.reserve(count);
+	orderParents.reserve(count);
+	std::vector<uint32_t> stack;
+	for (size_t root = 0; root < slots; root++)
+	{
+		if (!alive[root] || parents[root] != NoParent)
+			continue;
+
+		stack.push_back((uint32_t)root);
+		while (!stack.empty())
+		{
+			uint32_t id = stack.back();
+			stack.pop_back();
+			uint32_t parentPosition = NoParent;
+			if (parents[id] != NoParent)
+				parentPosition = orderPositions[parents[id]];
+			orderPositions[id] = (uint32_t)order.size();
+			orderParents.push_back(parentPosition);
+			order.push_back(id);
+
+			// Reversed so children come out in slot order
+			for (uint32_t c = childOffsets[id + 1]; c > childOffsets[id]; c--)
+				stack.push_back(children[c - 1]);
+		}
+	}
+
+	// Each subtree ends where its last descendant does
+	subtreeEnds.resize(order.size());
+	for (size_t p = 0; p < order.size(); p++)
+		subtreeEnds[p] = (uint32_t)(p + 1);
+	for (size_t p = order.size(); p > 0; p--)
+	{
+		uint32_t parent = orderParents[p - 1];
+		if (parent != NoParent)
+			subtreeEnds[parent] = std::max(subtreeEnds[parent], subtreeEnds[p - 1]);
+	}
+
+	// Anything that was already in the old order under the same parent
+	// keeps its world matrix
+	// - Everything else (new slots and moved subtrees) is stale, along
+	//   with whatever ended up below it
+	stale.assign(order.size(), 0);
+	for (size_t p = 0; p < order.size(); p++)
+	{
+		uint32_t id = order[p];
+		uint32_t old = oldPositions[id];
+		bool kept = old < oldOrder.size() && oldOrder[old] == id;
+		if (kept)
+		{
+			uint32_t oldParent = NoParent;
+			if (oldOrderParents[old] != NoParent)
+				oldParent = oldOrder[oldOrderParents[old]];
+			kept = oldParent == parents[id];
+		}
+		if (!stale[p] && (!kept || oldStale[old]))
+			memset(&stale[p], 1, subtreeEnds[p] - p);
+	}
+	orderHoles = 0;
+	orderDirty = false;
+}
+
+// Single transforms are rebuilt right away, so reads between batch
+// updates are never stale
+const XMFLOAT4X4& TransformStore::GetLocalMatrix(uint32_t id)
+{
+	if (IsDirty(id))
+	{
+		UpdateLocalMatrix(id);
+		ClearDirty(id);
+	}
+	return localMatrices[id];
+}
+
+// Brings the parents up to date first, then this one
+// - Children are left stale, since they might not be needed
+const XMFLOAT4X4& TransformStore::GetWorldMatrix(uint32_t id)
+{
+	if (orderDirty)
+		RebuildOrder();
+
+	uint32_t position = orderPositions[id];
+	if (stale[position])
+	{
+		XMMATRIX world = XMLoadFloat4x4(&GetLocalMatrix(id));
+		if (parents[id] != NoParent)
+			world = world * XMLoadFloat4x4(&GetWorldMatrix(parents[id]));
+		XMStoreFloat4x4(&worldMatrices[id], world);
+		stale[position] = 0;
+		worldVersions[id]++;
+	}
+	return worldMatrices[id];
+}
+
+// Scale, then rotate, then translate
+void TransformStore::UpdateLocalMatrix(uint32_t id)
+{
+	XMMATRIX transMatrix = XMMatrixTranslation(positionX[id], positionY[id], positionZ[id]);
+	XMMATRIX scaleMatrix = XMMatrixScaling(scaleX[id], scaleY[id], scaleZ[id]);
+	XMMATRIX rotMatrix = XMMatrixRotationQuaternion(XMVectorSet(orientationX[id], orientationY[id], orientationZ[id], orientationW[id]));
+	XMStoreFloat4x4(&localMatrices[id], scaleMatrix * rotMatrix * transMatrix);
+}
+
+// Local matrices first, then world matrices
+void TransformStore::UpdateWorldMatrices(unsigned int threadCount)
+{
+	if (orderDirty)
+		RebuildOrder();
+
+	// Go through the dirty bits a word at a time, rebuilding any group of
+	// 4 slots that has at least one dirty transform in it
+	for (size_t word = 0; word < dirty.size(); word++)
+	{
+		uint64_t bits = dirty[word];
+		if (bits == 0)
+			continue;
+
+		for (size_t block = 0; block < SlotsPerWord / 4; block++)
+		{
+			if ((bits >> (block * 4)) & 0xF)
+				UpdateBlock(word * SlotsPerWord + block * 4);
+		}
+		dirty[word] = 0;
+	}
+
+	// Split the hierarchy into one range of whole trees per thread
+	// - A tree never spans two ranges, so no thread waits on another
+	// - Small hierarchies stay on this thread, since handing out the work
+	//   would cost more than it saves
+	size_t total = order.size();
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	unsigned int ranges = (unsigned int)std::min<size_t>(threadCount, std::max<size_t>(1, total / MinTransformsPerThread));
+	if (ranges <= 1)
+	{
+		UpdateWorldRange(0, total);
+		return;
+	}
+
+	// The pool is sized by what was asked for, not by the ranges this
+	// frame, so a hierarchy that grows or shrinks doesn't restart it
+	if (!pool || pool->GetThreadCount() != threadCount)
+		pool.reset(new WorkerPool(threadCount));
+
+	std::vector<size_t> bounds(1, 0);
+	size_t position = 0;
+	for (unsigned int t = 1; t < ranges; t++)
+	{
+		// Hop from root to root until this thread has its share
+		size_t goal = total * t / ranges;
+		while (position < goal)
+			position = subtreeEnds[position];
+		if (position > bounds.back() && position < total)
+			bounds.push_back(position);
+	}
+	bounds.push_back(total);
+
+	pool->Run(bounds.size() - 1, [this, &bounds](size_t i)
+	{
+		UpdateWorldRange(bounds[i], bounds[i + 1]);
+	});
+}
+
+// Parents come before their children, so a parent's world matrix is
+// always finished by the time a child needs it
+void TransformStore::UpdateWorldRange(size_t first, size_t last)
+{
+	for (size_t p = first; p < last; p++)
+	{
+		if (!stale[p])
+			continue;
+
+		// Holes left by freed transforms
+		if (order[p] == NoParent)
+		{
+			stale[p] = 0;
+			continue;
+		}
+
+		uint32_t id = order[p];
+		XMMATRIX world = XMLoadFloat4x4(&localMatrices[id]);
+		if (orderParents[p] != NoParent)
+			world = world * XMLoadFloat4x4(&worldMatrices[order[orderParents[p]]]);
+		XMStoreFloat4x4(&worldMatrices[id], world);
+		stale[p] = 0;
+		worldVersions[id]++;
+	}
+}
+
+// Same matrix as UpdateLocalMatrix, but for 4 transforms at once
+// - Each vector holds one matrix element for all 4 transforms, and the
+//   rows are transposed back into matrices at the end
+// - Clean slots in the block are rebuilt too, which gives the same result
+void TransformStore::UpdateBlock(size_t first)
+{
+	// Quaternion components of all 4 transforms
+	XMVECTOR x = XMLoadFloat4((const XMFLOAT4*)&orientationX[first]);
+	XMVECTOR y = XMLoadFloat4((const XMFLOAT4*)&orientationY[first]);
+	XMVECTOR z = XMLoadFloat4((const XMFLOAT4*)&orientationZ[first]);
+	XMVECTOR w = XMLoadFloat4((const XMFLOAT4*)&orientationW[first]);
+
+	// Rotation matrix (the same as XMMatrixRotationQuaternion), no trig needed
+	XMVECTOR one = XMVectorSplatOne();
+	XMVECTOR x2 = XMVectorAdd(x, x);
+	XMVECTOR y2 = XMVectorAdd(y, y);
+	XMVECTOR z2 = XMVectorAdd(z, z);
+	XMVECTOR xx = XMVectorMultiply(x, x2);
+	XMVECTOR yy = XMVectorMultiply(y, y2);
+	XMVECTOR zz = XMVectorMultiply(z, z2);
+	XMVECTOR xy = XMVectorMultiply(x, y2);
+	XMVECTOR xz = XMVectorMultiply(x, z2);
+	XMVECTOR yz = XMVectorMultiply(y, z2);
+	XMVECTOR wx = XMVectorMultiply(w, x2);
+	XMVECTOR wy = XMVectorMultiply(w, y2);
+	XMVECTOR wz = XMVectorMultiply(w, z2);
+	XMVECTOR r00 = XMVectorSubtract(one, XMVectorAdd(yy, zz));
+	XMVECTOR r01 = XMVectorAdd(xy, wz);
+	XMVECTOR r02 = XMVectorSubtract(xz, wy);
+	XMVECTOR r10 = XMVectorSubtract(xy, wz);
+	XMVECTOR r11 = XMVectorSubtract(one, XMVectorAdd(xx, zz));
+	XMVECTOR r12 = XMVectorAdd(yz, wx);
+	XMVECTOR r20 = XMVectorAdd(xz, wy);
+	XMVECTOR r21 = XMVectorSubtract(yz, wx);
+	XMVECTOR r22 = XMVectorSubtract(one, XMVectorAdd(xx, yy));
+
+	// Scaling first just scales each row of the rotation
+	XMVECTOR sx = XMLoadFloat4((const XMFLOAT4*)&scaleX[first]);
+	XMVECTOR sy = XMLoadFloat4((const XMFLOAT4*)&scaleY[first]);
+	XMVECTOR sz = XMLoadFloat4((const XMFLOAT4*)&scaleZ[first]);
+	XMVECTOR zero = XMVectorZero();
+	XMMATRIX row0 = XMMatrixTranspose(XMMATRIX(XMVectorMultiply(r00, sx), XMVectorMultiply(r01, sx), XMVectorMultiply(r02, sx), zero));
+	XMMATRIX row1 = XMMatrixTranspose(XMMATRIX(XMVectorMultiply(r10, sy), XMVectorMultiply(r11, sy), XMVectorMultiply(r12, sy), zero));
+	XMMATRIX row2 = XMMatrixTranspose(XMMATRIX(XMVectorMultiply(r20, sz), XMVectorMultiply(r21, sz), XMVectorMultiply(r22, sz), zero));
+
+	// Translation is the last row
+	XMMATRIX row3 = XMMatrixTranspose(XMMATRIX(
+		XMLoadFloat4((const XMFLOAT4*)&positionX[first]),
+		XMLoadFloat4((const XMFLOAT4*)&positionY[first]),
+		XMLoadFloat4((const XMFLOAT4*)&positionZ[first]),
+		one));
+
+	for (int i = 0; i < 4; i++)
+	{
+		XMFLOAT4X4& local = localMatrices[first + i];
+		XMStoreFloat4((XMFLOAT4*)local.m[0], row0.r[i]);
+		XMStoreFloat4((XMFLOAT4*)local.m[1], row1.r[i]);
+		XMStoreFloat4((XMFLOAT4*)local.m[2], row2.r[i]);
+		XMStoreFloat4((XMFLOAT4*)local.m[3], row3.r[i]);
+	}
+}
+
+// Fills a throwaway store with random transforms and times both paths
+// - Every 16th transform is a root and the rest are its children, so the
+//   world matrices take a real multiply on both sides
+TransformBenchmark TransformStore::Benchmark(size_t count)
+{
+	TransformBenchmark result;
+	result.count = count;
+
+	TransformStore store;
+	std::vector<uint32_t> ids(count);
+	uint32_t seed = 12345;
+	auto random = [&seed](float lo, float hi)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return lo + (hi - lo) * ((seed >> 8) / 16777216.0f);
+	};
+	for (size_t i = 0; i < count; i++)
+	{
+		ids[i] = store.Allocate();
+		if (i % 16 != 0)
+			store.SetParent(ids[i], ids[i - i % 16]);
+		store.SetPosition(ids[i], XMFLOAT3(random(-100, 100), random(-100, 100), random(-100, 100)));
+		store.SetRotation(ids[i], XMFLOAT3(random(-XM_PI, XM_PI), random(-XM_PI, XM_PI), random(-XM_PI, XM_PI)));
+		store.SetScale(ids[i], XMFLOAT3(random(0.5f, 2), random(0.5f, 2), random(0.5f, 2)));
+	}
+
+	// The old way, one at a time
+	// - Parents come first, so their world matrix is always done already
+	std::vector<XMFLOAT4X4> reference(count);
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < count; i++)
+	{
+		store.UpdateLocalMatrix(ids[i]);
+		XMMATRIX world = XMLoadFloat4x4(&store.localMatrices[ids[i]]);
+		if (i % 16 != 0)
+			world = world * XMLoadFloat4x4(&reference[i - i % 16]);
+		XMStoreFloat4x4(&reference[i], world);
+	}
+	result.onDemandSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	// Everything is still dirty from being set up, local and world matrices
+	auto compare = [&]()
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			const float* a = &reference[i]._11;
+			const float* b = &store.worldMatrices[ids[i]]._11;
+			for (int e = 0; e < 16; e++)
+				result.maxError = std::max(result.maxError, fabsf(a[e] - b[e]));
+		}
+	};
+	start = std::chrono::high_resolution_clock::now();
+	store.UpdateWorldMatrices(1);
+	result.batchSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	compare();
+
+	// The same on the pool (the first call starts its threads, so it isn't timed)
+	result.threads = std::max(1u, std::thread::hardware_concurrency());
+	store.UpdateWorldMatrices(result.threads);
+	for (size_t i = 0; i < count; i++)
+		store.MarkDirty(ids[i]);
+	start = std::chrono::high_resolution_clock::now();
+	store.UpdateWorldMatrices(result.threads);
+	result.threadedSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	compare();
+
+	// A typical frame where only some things moved
+	for (size_t i = 0; i < count; i += 10)
+		store.MarkDirty(ids[i]);
+	start = std::chrono::high_resolution_clock::now();
+	store.UpdateWorldMatrices(1);
+	result.sparseSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	return result;
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include "WorkerPool.h"
+
+// Timings from TransformStore::Benchmark
+struct TransformBenchmark
+{
+	size_t count = 0;
+	// Local and world matrix built one transform at a time with the regular
+	// DirectXMath calls, like Transform used to do on demand
+	double onDemandSeconds = 0;
+	// UpdateWorldMatrices on one thread with every transform dirty
+	double batchSeconds = 0;
+	// The same, split across the worker pool
+	double threadedSeconds = 0;
+	unsigned int threads = 0;
+	// UpdateWorldMatrices with about 1 in 10 dirty
+	double sparseSeconds = 0;
+	// Largest difference between the two ways of building a matrix
+	float maxError = 0;
+
+	double Speedup() const { return batchSeconds > 0 ? onDemandSeconds / batchSeconds : 0; }
+};
+
+// Central storage for every transform's position, orientation, scale and matrices
+// - Components are kept as separate arrays (structure of arrays) so the
+//   local matrices of 4 transforms can be built at once with SIMD
+// - Orientation is a quaternion, so building matrices and direction
+//   vectors never needs any trig (Euler angles are converted on the way
+//   in and worked out again on the way out)
+// - A bit per transform says whether its local matrix is out of date, so
+//   only the ones that changed get rebuilt
+// - Transforms can have a parent, and their position, rotation and scale
+//   are relative to it
+// - The hierarchy is kept as a flattened, parents-first (preorder) array
+//   so every subtree is one contiguous range: dirtying a transform marks
+//   just that range, and the update is a single forward walk that always
+//   finds a parent's world matrix already done
+// - World matrices are stored by slot like everything else, so flattening
+//   the hierarchy again never has to move them
+// - New transforms go on the end of that array, and freeing or reparenting
+//   patches it in place whenever the subtree is at the edge of the ranges
+//   involved; anything else flattens it again, but only the moved subtrees
+//   get their world matrices rebuilt
+// - Transforms refer to their slot by index, which never moves
+class TransformStore
+{
+public:
+	// Parent of a transform that doesn't have one
+	static const uint32_t NoParent = 0xFFFFFFFF;
+	// Smallest share of the hierarchy worth giving its own thread
+	static const size_t MinTransformsPerThread = 16 * 1024;
+
+	// Store used by every Transform that isn't given one
+	static TransformStore& Default();
+
+	// Slots
+	// - A new slot is at the origin with no rotation, a scale of 1 and no parent
+	uint32_t Allocate();
+	// Any children are left without a parent
+	void Free(uint32_t id);
+	// Number of slots in use
+	size_t GetCount() const { return count; }
+
+	// Per transform data (relative to the parent)
+	DirectX::XMFLOAT3 GetPosition(uint32_t id) const;
+	DirectX::XMFLOAT3 GetScale(uint32_t id) const;
+	DirectX::XMFLOAT4 GetOrientation(uint32_t id) const;
+	void SetPosition(uint32_t id, const DirectX::XMFLOAT3& position);
+	void SetScale(uint32_t id, const DirectX::XMFLOAT3& scale);
+	// orientation has to be a unit quaternion
+	void SetOrientation(uint32_t id, const DirectX::XMFLOAT4& orientation);
+	// Pitch, yaw and roll, in the order XMMatrixRotationRollPitchYaw takes them
+	DirectX::XMFLOAT3 GetRotation(uint32_t id) const;
+	void SetRotation(uint32_t id, const DirectX::XMFLOAT3& rotation);
+
+	// Unit vectors along the local axes, kept up to date with the orientation
+	const DirectX::XMFLOAT3& GetRight(uint32_t id) const { return rights[id]; }
+	const DirectX::XMFLOAT3& GetUp(uint32_t id) const { return ups[id]; }
+	const DirectX::XMFLOAT3& GetForward(uint32_t id) const { return forwards[id]; }
+	// Copies everything but the matrices and the parent
+	void Copy(uint32_t from, uint32_t to);
+
+	// Hierarchy
+	// - Returns false (changing nothing) if it would make a loop
+	// - parent can be NoParent to detach
+	bool SetParent(uint32_t id, uint32_t parent);
+	uint32_t GetParent(uint32_t id) const { return parents[id]; }
+
+	// Matrices, rebuilt first if this transform (or for the world matrix,
+	// anything above it) has changed
+	const DirectX::XMFLOAT4X4& GetLocalMatrix(uint32_t id);
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(uint32_t id);
+	bool IsDirty(uint32_t id) const { return (dirty[id >> 6] >> (id & 63)) & 1; }
+	// Goes up every time the world matrix is rebuilt, so anything derived
+	// from it (like bounds) can tell when it needs redoing
+	uint32_t GetWorldVersion(uint32_t id) const { return worldVersions[id]; }
+
+	// Rebuilds every dirty local matrix, then every world matrix below a change
+	// - Meant to be called once a frame, before anything is drawn
+	// - Separate trees are split across threads when there are enough transforms
+	// - threadCount of 0 means one per hardware thread
+	// - The threads are kept between calls, so splitting the work every
+	//   frame doesn't mean starting new ones
+	void UpdateWorldMatrices(unsigned int threadCount = 0);
+
+	// Compares building world matrices one at a time against the batch update
+	static TransformBenchmark Benchmark(size_t count);
+
+private:
+	// Slots are added 64 at a time, which is one word of dirty bits
+	static const size_t SlotsPerWord = 64;
+
+	// By slot
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> orientationX, orientationY, orientationZ, orientationW;
+	std::vector<DirectX::XMFLOAT3> rights, ups, forwards;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<DirectX::XMFLOAT4X4> localMatrices;
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	std::vector<uint64_t> dirty;
+	std::vector<uint32_t> parents;
+	std::vector<uint8_t> alive;
+	std::vector<uint32_t> orderPositions;	// Where each slot is in the flattened hierarchy
+	std::vector<uint32_t> worldVersions;
+	std::vector<uint32_t> freeSlots;
+	size_t count = 0;
+
+	// By position in the flattened hierarchy
+	std::vector<uint32_t> order;			// Slot at each position
+	std::vector<uint32_t> orderParents;		// Position of the parent, or NoParent
+	std::vector<uint32_t> subtreeEnds;		// One past the last descendant
+	std::vector<uint8_t> stale;				// Does the world matrix need rebuilding?
+	// Has the hierarchy changed in a way the order couldn't be patched for?
+	bool orderDirty = false;
+	// Positions left behind by freed transforms (order holds NoParent there)
+	// - Squeezed out by flattening again once they're half the array
+	size_t orderHoles = 0;
+
+	// Threads for UpdateWorldMatrices, started the first time there's
+	// enough work to share (and again if it's asked for a different number)
+	std::unique_ptr<WorkerPool> pool;
+
+	void MarkDirty(uint32_t id);
+	void ClearDirty(uint32_t id) { dirty[id >> 6] &= ~(1ull << (id & 63)); }
+	void Grow();
+	// Flattens the hierarchy again
+	// - World matrices are carried over, and only transforms whose parent
+	//   changed (plus everything below them) are marked stale
+	void RebuildOrder();
+	// In place edits of the order, for when it's still current
+	// - A new transform with no children goes on the end
+	void AppendToOrder(uint32_t id);
+	// Makes a subtree a root of its own, if it's the last thing in every
+	// range above it (returns false, changing nothing, if it isn't)
+	bool DetachInOrder(uint32_t id);
+	// Hangs a root's subtree under parent, if parent's range ends right
+	// where the subtree starts (returns false, changing nothing, if it doesn't)
+	bool AttachInOrder(uint32_t id, uint32_t parent);
+	// Builds one local matrix with the regular DirectXMath calls
+	void UpdateLocalMatrix(uint32_t id);
+	// Builds the local matrices of 4 neighboring slots at once
+	void UpdateBlock(size_t first);
+	// Rebuilds the stale world matrices in part of the flattened hierarchy
+	void UpdateWorldRange(size_t first, size_t last);
+};
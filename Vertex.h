@@ -11,6 +11,6 @@ struct Vertex
 {
 	DirectX::XMFLOAT3 Position;
 	DirectX::XMFLOAT3 Normal;
-	DirectX::XMFLOAT3 Tangent;
+	DirectX::XMFLOAT4 Tangent;	// w holds the handedness (+1 or -1)
 	DirectX::XMFLOAT2 UV;
 };
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "VertexPacking.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must match VertexShaderInputPacked");
+
+// Helpers for the 16-bit normalized formats (rounded like the GPU expects)
+static uint16_t ToUnorm16(float f)
+{
+	f = std::min(1.0f, std::max(0.0f, f));
+	return (uint16_t)(f * 65535.0f + 0.5f);
+}
+
+static int16_t ToSnorm16(float f)
+{
+	f = std::min(1.0f, std::max(-1.0f, f));
+	return (int16_t)std::lround(f * 32767.0f);
+}
+
+static float FromSnorm16(int16_t s)
+{
+	// -32768 and -32767 both mean -1
+	return std::max(-1.0f, s / 32767.0f);
+}
+
+// Signs with 0 counted as positive, like the shader's version
+static float SignNotZero(float f)
+{
+	return f >= 0.0f ? 1.0f : -1.0f;
+}
+
+// Folds the unit sphere onto an octahedron, then the octahedron onto a square
+void VertexPacking::OctEncode(const XMFLOAT3& n, int16_t out[2])
+{
+	float length = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	if (length <= 0.0f)
+	{
+		out[0] = out[1] = 0;
+		return;
+	}
+
+	float x = n.x / length;
+	float y = n.y / length;
+
+	// Bottom half is folded over the top half's corners
+	if (n.z < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	out[0] = ToSnorm16(x);
+	out[1] = ToSnorm16(y);
+}
+
+// Unfolds the square back into a unit vector
+XMFLOAT3 VertexPacking::OctDecode(const int16_t in[2])
+{
+	float x = FromSnorm16(in[0]);
+	float y = FromSnorm16(in[1]);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	// Undo the fold for the bottom half
+	float t = std::max(0.0f, -z);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	XMFLOAT3 n;
+	XMStoreFloat3(&n, XMVector3Normalize(XMVectorSet(x, y, z, 0)));
+	return n;
+}
+
+// Quantizes one vertex
+PackedVertex VertexPacking::Pack(const Vertex& v, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	PackedVertex p;
+
+	// Position as a fraction of the way across the bounds
+	// - Flat axes (no size) just store 0
+	const float* pos = &v.Position.x;
+	const float* lo = &boundsMin.x;
+	const float* hi = &boundsMax.x;
+	for (int i = 0; i < 3; i++)
+	{
+		float size = hi[i] - lo[i];
+		p.position[i] = size > 0.0f ? ToUnorm16((pos[i] - lo[i]) / size) : 0;
+	}
+	p.position[3] = v.Tangent.w < 0.0f ? 0 : 65535;
+
+	// Directions
+	OctEncode(v.Normal, p.normal);
+	OctEncode(XMFLOAT3(v.Tangent.x, v.Tangent.y, v.Tangent.z), p.tangent);
+
+	// Texture coordinates
+	p.uv[0] = XMConvertFloatToHalf(v.UV.x);
+	p.uv[1] = XMConvertFloatToHalf(v.UV.y);
+	return p;
+}
+
+// Decodes one vertex the same way the packed vertex shader does
+Vertex VertexPacking::Unpack(const PackedVertex& p, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	Vertex v;
+	v.Position = XMFLOAT3(
+		boundsMin.x + (boundsMax.x - boundsMin.x) * (p.position[0] / 65535.0f),
+		boundsMin.y + (boundsMax.y - boundsMin.y) * (p.position[1] / 65535.0f),
+		boundsMin.z + (boundsMax.z - boundsMin.z) * (p.position[2] / 65535.0f));
+	v.Normal = OctDecode(p.normal);
+	XMFLOAT3 tangent = OctDecode(p.tangent);
+	v.Tangent = XMFLOAT4(tangent.x, tangent.y, tangent.z, p.position[3] != 0 ? 1.0f : -1.0f);
+	v.UV = XMFLOAT2(XMConvertHalfToFloat(p.uv[0]), XMConvertHalfToFloat(p.uv[1]));
+	return v;
+}
+
+void VertexPacking::PackAll(const Vertex* vertices, size_t count, const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax,
+	PackedVertex* packed)
+{
+	for (size_t i = 0; i < count; i++)
+		packed[i] = Pack(vertices[i], boundsMin, boundsMax);
+}
+
+// Angle between two unit vectors, in degrees
+// - Taken from both the cross and the dot product, since acos of the dot
+//   product alone can't tell apart angles below about 0.03 degrees
+static float AngleBetween(XMVECTOR a, XMVECTOR b)
+{
+	float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(a, b)));
+	float cosine = XMVectorGetX(XMVector3Dot(a, b));
+	return XMConvertToDegrees(atan2f(sine, cosine));
+}
+
+// Compares every vertex against its round tripped self
+VertexPackingReport VertexPacking::Measure(const Vertex* vertices, size_t count,
+	const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	VertexPackingReport report;
+	report.vertexCount = count;
+	report.fullBytes = sizeof(Vertex) * count;
+	report.packedBytes = sizeof(PackedVertex) * count;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const Vertex& a = vertices[i];
+		Vertex b = Unpack(Pack(a, boundsMin, boundsMax), boundsMin, boundsMax);
+
+		// Position and UV errors
+		XMVECTOR posA = XMLoadFloat3(&a.Position);
+		XMVECTOR posB = XMLoadFloat3(&b.Position);
+		report.maxPositionError = std::max(report.maxPositionError, XMVectorGetX(XMVector3Length(XMVectorSubtract(posA, posB))));
+		report.maxUVError = std::max(report.maxUVError, std::max(fabsf(a.UV.x - b.UV.x), fabsf(a.UV.y - b.UV.y)));
+
+		// Angles between directions (skipping ones that were never set)
+		XMVECTOR normalA = XMLoadFloat3(&a.Normal);
+		if (XMVectorGetX(XMVector3LengthSq(normalA)) > 0.0f)
+			report.maxNormalError = std::max(report.maxNormalError, AngleBetween(XMVector3Normalize(normalA), XMLoadFloat3(&b.Normal)));
+		XMVECTOR tangentA = XMVectorSetW(XMLoadFloat4(&a.Tangent), 0);
+		if (XMVectorGetX(XMVector3LengthSq(tangentA)) > 0.0f)
+			report.maxTangentError = std::max(report.maxTangentError, AngleBetween(XMVector3Normalize(tangentA), XMVectorSetW(XMLoadFloat4(&b.Tangent), 0)));
+		if ((a.Tangent.w < 0.0f) != (b.Tangent.w < 0.0f))
+			report.handednessMismatches++;
+	}
+	return report;
+}
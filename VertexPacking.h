@@ -0,0 +1,67 @@
+#pragma once
+#include "Vertex.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <cstddef>
+
+// Which vertex struct a mesh's vertex buffer holds
+enum MeshVertexFormat
+{
+	MESH_VERTEX_FULL,		// Vertex: full floats everywhere
+	MESH_VERTEX_PACKED		// PackedVertex: quantized, decoded in the vertex shader
+};
+
+// Compact version of Vertex (20 bytes instead of 48)
+// - Must match VertexShaderInputPacked in ShaderIncludes.hlsli
+// - The semantic suffixes there (_UNORM16, _SNORM16, _HALF) tell
+//   SimpleVertexShader which formats to put in the input layout
+struct PackedVertex
+{
+	uint16_t position[4];	// xyz as 0-1 across the mesh bounds, w is the tangent handedness (0 = -1, 1 = +1)
+	int16_t normal[2];		// Octahedral encoded unit normal
+	int16_t tangent[2];		// Octahedral encoded unit tangent
+	uint16_t uv[2];			// Half floats
+};
+
+// How much a set of vertices lost and saved by being packed
+struct VertexPackingReport
+{
+	size_t vertexCount = 0;
+	size_t fullBytes = 0;
+	size_t packedBytes = 0;
+	// Largest position error, in object space units
+	float maxPositionError = 0;
+	// Largest angle error, in degrees
+	float maxNormalError = 0;
+	float maxTangentError = 0;
+	// Largest error in either UV component
+	float maxUVError = 0;
+	// Vertices whose handedness didn't survive
+	size_t handednessMismatches = 0;
+
+	float SavingsRatio() const { return packedBytes > 0 ? (float)fullBytes / packedBytes : 0; }
+};
+
+// Conversions between Vertex and PackedVertex
+// - Positions are quantized relative to the mesh's bounding box, so the
+//   same bounds have to be handed to the shader to decode them
+// - Pure CPU code, so the error and savings can be checked without a GPU
+class VertexPacking
+{
+public:
+	static PackedVertex Pack(const Vertex& v, const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax);
+	static Vertex Unpack(const PackedVertex& p, const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax);
+
+	// Packs a whole array
+	static void PackAll(const Vertex* vertices, size_t count, const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax,
+		PackedVertex* packed);
+
+	// Round trips every vertex and reports the worst errors
+	static VertexPackingReport Measure(const Vertex* vertices, size_t count,
+		const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax);
+
+	// Octahedral mapping of unit vectors to two 16-bit values
+	// - Same math as OctDecode() in ShaderIncludes.hlsli
+	static void OctEncode(const DirectX::XMFLOAT3& n, int16_t out[2]);
+	static DirectX::XMFLOAT3 OctDecode(const int16_t in[2]);
+};
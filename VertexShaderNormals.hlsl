@@ -1,12 +1,17 @@
 #include "ShaderIncludes.hlsli"
 
-// Constant buffer
+// Constant buffer that changes every draw
 cbuffer ExternalData : register(b0)
 {
 	float4 colorTint;
 	matrix worldMatrix;
-	matrix viewMatrix;
-	matrix projMatrix;
+}
+
+// Constant buffer that only changes once a frame, so it isn't uploaded per draw
+cbuffer PerFrame : register(b1)
+{
+	// View then projection, combined once per camera change on the CPU
+	matrix viewProjMatrix;
 }
 
 // --------------------------------------------------------
@@ -31,7 +36,7 @@ VertexToPixelNormals main(VertexShaderInput input)
 	//   a perspective projection matrix, which we'll get to in the future).
 
 	// Multiply the world matrix by the view and then the projection matrix
-	matrix wvp = mul(projMatrix, mul(viewMatrix, worldMatrix));
+	matrix wvp = mul(viewProjMatrix, worldMatrix);
 	output.position = mul(wvp, float4(input.position, 1.0f));
 
 	// World position of the point
@@ -46,7 +51,8 @@ VertexToPixelNormals main(VertexShaderInput input)
 	output.normal = mul((float3x3)worldMatrix, input.normal);
 
 	// Get a normalized vector of the tangent rotated into world space
-	output.tangent = normalize(mul((float3x3)worldMatrix, input.tangent));
+	// - The handedness passes through untouched
+	output.tangent = float4(normalize(mul((float3x3)worldMatrix, input.tangent.xyz)), input.tangent.w);
 
 	// Keep uvs the same
 	output.uv = input.uv;
@@ -0,0 +1,58 @@
+#include "ShaderIncludes.hlsli"
+
+// Constant buffer that changes every draw
+cbuffer ExternalData : register(b0)
+{
+	float4 colorTint;
+	matrix worldMatrix;
+
+	// Decodes positions: offset + packed * scale
+	float3 positionScale;
+	float3 positionOffset;
+}
+
+// Constant buffer that only changes once a frame, so it isn't uploaded per draw
+cbuffer PerFrame : register(b1)
+{
+	// View then projection, combined once per camera change on the CPU
+	matrix viewProjMatrix;
+}
+
+// --------------------------------------------------------
+// Same as VertexShaderNormals, but for meshes stored as PackedVertex
+// 
+// - Everything is decoded back to full floats up front, so the
+//   rest of the shader (and the pixel shader) doesn't change
+// --------------------------------------------------------
+VertexToPixelNormals main(VertexShaderInputPacked input)
+{
+	// Set up output struct
+	VertexToPixelNormals output;
+
+	// Unpack the vertex
+	float3 position = positionOffset + input.position.xyz * positionScale;
+	float3 normal = OctDecode(input.normal);
+	float3 tangent = OctDecode(input.tangent);
+	float handedness = input.position.w * 2.0f - 1.0f;
+
+	// Multiply the world matrix by the view and then the projection matrix
+	matrix wvp = mul(viewProjMatrix, worldMatrix);
+	output.position = mul(wvp, float4(position, 1.0f));
+
+	// World position of the point
+	output.worldPos = mul(worldMatrix, float4(position, 1.0f)).xyz;
+
+	// Pass the color through 
+	output.color = colorTint;
+
+	// Move the normal into world space (no translation)
+	output.normal = mul((float3x3)worldMatrix, normal);
+
+	// Get a normalized vector of the tangent rotated into world space
+	output.tangent = float4(normalize(mul((float3x3)worldMatrix, tangent)), handedness);
+
+	// Keep uvs the same
+	output.uv = input.uv;
+
+	return output;
+}
@@ -5,6 +5,8 @@ cbuffer ExternalData : register(b0)
 {
 	matrix viewMatrix;
 	matrix projMatrix;
+	// Depth of the far end of the view (1, or 0 with reverse-Z)
+	float farDepth;
 }
 
 // --------------------------------------------------------
@@ -28,7 +30,9 @@ VertexToPixelSky main(VertexShaderInput input)
 	// Multiply the world matrix by the view and then the projection matrix
 	matrix vp = mul(projMatrix, viewNoTranslation);
 	output.position = mul(vp, float4(input.position, 1.0f));
-	output.position.z = output.position.w;
+	// Pin the sky to the far end of the view (an infinite projection has
+	// no far plane to put it on otherwise)
+	output.position.z = output.position.w * farDepth;
 
 	// Direction just for this shader
 	output.sampleDir = input.position;
@@ -0,0 +1,84 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned int threadCount)
+	: nextJob(0)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned int i = 1; i < threadCount; i++)
+		workers.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+}
+
+void WorkerPool::Run(size_t count, const std::function<void(size_t)>& work)
+{
+	// Nothing to share
+	if (workers.empty() || count <= 1)
+	{
+		for (size_t i = 0; i < count; i++)
+			work(i);
+		return;
+	}
+
+	// Start the batch
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &work;
+		jobCount = count;
+		nextJob = 0;
+		busy = (unsigned int)workers.size();
+		generation++;
+	}
+	wake.notify_all();
+
+	// Help out, then wait for the stragglers
+	// - The batch can't be cleared until every worker has checked in, since
+	//   a late one could still be reading job and jobCount
+	Drain();
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [this]() { return busy == 0; });
+	job = nullptr;
+}
+
+void WorkerPool::Drain()
+{
+	for (size_t i = nextJob++; i < jobCount; i = nextJob++)
+		(*job)(i);
+}
+
+// Sleeps until there's a new batch, works on it, then checks in
+void WorkerPool::WorkerLoop()
+{
+	unsigned int seen = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&]() { return quit || generation != seen; });
+			if (quit)
+				return;
+			seen = generation;
+		}
+
+		Drain();
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			last = --busy == 0;
+		}
+		if (last)
+			finished.notify_one();
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <cstddef>
+
+// A few threads that stay alive between frames, so work that gets split
+// up every frame doesn't pay for creating and joining threads each time
+// - The thread that calls Run works too, so a pool of N runs N jobs at
+//   once with N - 1 extra threads
+// - Doesn't need DirectX, so it can be built and checked without a GPU
+class WorkerPool
+{
+public:
+	// threadCount includes the calling thread (0 means one per hardware thread)
+	explicit WorkerPool(unsigned int threadCount = 0);
+	~WorkerPool();
+
+	// Threads that take part in Run, counting the caller
+	unsigned int GetThreadCount() const { return (unsigned int)workers.size() + 1; }
+
+	// Calls job(0) to job(jobCount - 1) spread across the pool, and
+	// returns once every one of them is done
+	// - Jobs are handed out one at a time, so uneven ones balance out
+	void Run(size_t jobCount, const std::function<void(size_t)>& job);
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable finished;
+
+	// The batch being run (only changed while no worker is inside one)
+	const std::function<void(size_t)>* job = nullptr;
+	size_t jobCount = 0;
+	std::atomic<size_t> nextJob;
+	// Workers still busy with the current batch
+	unsigned int busy = 0;
+	// Goes up once per batch, so sleeping workers can tell a new one started
+	unsigned int generation = 0;
+	bool quit = false;
+
+	void WorkerLoop();
+	// Takes jobs until none are left
+	void Drain();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+};